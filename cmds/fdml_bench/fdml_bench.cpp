@@ -0,0 +1,1311 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+
+#include <boost/geometry.hpp>
+#include <boost/program_options.hpp>
+
+#include "fdml/executor.hpp"
+#include "fdml/internal/half_plane_clipper.hpp"
+#include "fdml/internal/json_utils.hpp"
+#include "fdml/internal/prs_event.hpp"
+#include "fdml/internal/utils.hpp"
+#include "fdml/interval_index.hpp"
+#include "fdml/json_result_writer.hpp"
+#include "fdml/locator.hpp"
+#include "fdml/retcode.hpp"
+
+namespace FDML {
+
+/* Generate a random scene: a star shaped room with small star shaped holes placed on a grid within it */
+static Polygon_with_holes generate_scene(unsigned int vertices_num, unsigned int holes_num, unsigned int seed) {
+    const unsigned int hole_vertices_num = 5;
+    if (vertices_num < 3 + holes_num * hole_vertices_num)
+        throw std::invalid_argument("too few vertices for the requested number of holes");
+    std::mt19937 rand(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    auto star_polygon = [&](double cx, double cy, double radius, unsigned int n) {
+        Polygon polygon;
+        for (unsigned int i = 0; i < n; i++) {
+            double angle = 2 * M_PI * (i + 0.25 + 0.5 * unit(rand)) / n;
+            double r = radius * (0.8 + 0.2 * unit(rand));
+            polygon.push_back(Point(cx + r * std::cos(angle), cy + r * std::sin(angle)));
+        }
+        return polygon;
+    };
+
+    const double room_radius = 100;
+    Polygon_with_holes scene(star_polygon(0, 0, room_radius, vertices_num - holes_num * hole_vertices_num));
+
+    /* holes are placed on a grid within the inner half of the room */
+    unsigned int grid_size = 1;
+    while (grid_size * grid_size < holes_num)
+        grid_size++;
+    const double cell_size = room_radius / grid_size;
+    for (unsigned int h = 0; h < holes_num; h++) {
+        double cx = -room_radius / 2 + cell_size * (h % grid_size + 0.5);
+        double cy = -room_radius / 2 + cell_size * (h / grid_size + 0.5);
+        Polygon hole = star_polygon(cx, cy, cell_size / 3, hole_vertices_num);
+        hole.reverse_orientation();
+        scene.add_hole(hole);
+    }
+    return scene;
+}
+
+/* Measure the time of an operation in milliseconds */
+template <typename OP> static double measure_ms(const OP& op) {
+    auto begin = std::chrono::steady_clock::now();
+    op();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+/* Preprocess a scene by a locator of a benchmark, and set its executor if given. Returns the preprocessing time in
+ * milliseconds */
+static double init_locator(Locator& locator, const Polygon_with_holes& scene,
+                           std::shared_ptr<Executor> executor = nullptr) {
+    double init_time = measure_ms([&locator, &scene]() { locator.init(scene); });
+    if (executor)
+        locator.set_executor(std::move(executor));
+    return init_time;
+}
+
+/* Random single measurements, and pairs of measurements of half their length, of the queries benchmarks */
+template <typename FT> struct RandomMeasurements {
+    std::vector<FT> ds;
+    std::vector<std::pair<FT, FT>> ds2;
+};
+
+/* Draw random measurements in the room scale from a generator, which benchmarks may keep using for other random
+ * query parameters */
+template <typename FT = Kernel::FT>
+static RandomMeasurements<FT> random_measurements(std::mt19937& rand, unsigned int num) {
+    std::uniform_real_distribution<double> distance(1.0, 60.0);
+    RandomMeasurements<FT> measurements;
+    for (unsigned int i = 0; i < num; i++) {
+        measurements.ds.push_back(distance(rand));
+        measurements.ds2.emplace_back(distance(rand) / 2, distance(rand) / 2);
+    }
+    return measurements;
+}
+
+/* Compare the sort time of all the parallel rotational sweep events using exact predicates only, and using the
+ * precomputed filtered keys */
+static int bench_sort_events(const Polygon_with_holes& scene, unsigned int repeat) {
+    General_polygon_set_2 scene_set(scene);
+    const Arrangement& arr = scene_set.arrangement();
+    std::vector<Vertex> vertices;
+    for (auto v = arr.vertices_begin(); v != arr.vertices_end(); ++v)
+        vertices.push_back(v);
+
+    std::vector<EventLess::VerticesPair> events;
+    for (unsigned int v1 = 0; v1 < vertices.size(); v1++)
+        for (unsigned int v2 = 0; v2 < vertices.size(); v2++)
+            if (v1 != v2)
+                events.emplace_back(v1, v2);
+    fdml_infoln("[Bench] sort " << events.size() << " events of " << vertices.size() << " vertices");
+
+    const EventLess event_less(vertices);
+    for (unsigned int r = 0; r < repeat; r++) {
+        std::vector<EventLess::VerticesPair> exact_sorted(events);
+        double exact_time = measure_ms([&event_less, &exact_sorted]() {
+            std::sort(exact_sorted.begin(), exact_sorted.end(),
+                      [&event_less](const auto& e1, const auto& e2) { return event_less.exact_less(e1, e2); });
+        });
+
+        std::vector<EventLess::KeyedEvent> filtered_sorted;
+        double filtered_time = measure_ms([&event_less, &events, &filtered_sorted]() {
+            filtered_sorted.reserve(events.size());
+            for (const auto& e : events)
+                filtered_sorted.push_back(event_less.get_keyed(e));
+            std::sort(filtered_sorted.begin(), filtered_sorted.end(), event_less);
+        });
+
+        for (size_t i = 0; i < events.size(); i++)
+            if (exact_sorted[i] != filtered_sorted[i].vertices)
+                throw std::logic_error("filtered sort order differs from the exact sort order");
+
+        fdml_infoln("[Bench] exact: " << exact_time << "ms, filtered keys: " << filtered_time << "ms");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* Compare the time of preprocessing a scene and of loading a saved snapshot of it, and verify the loaded locator
+ * answers queries the same as the preprocessed one */
+static int bench_snapshot(const Polygon_with_holes& scene, unsigned int repeat) {
+    const std::string filename = "fdml_bench_snapshot.bin";
+    Locator locator;
+    double init_time = init_locator(locator, scene);
+    double save_time = measure_ms([&locator, &filename]() { locator.save(filename); });
+    fdml_infoln("[Bench] init: " << init_time << "ms, save: " << save_time << "ms");
+
+    for (unsigned int r = 0; r < repeat; r++) {
+        Locator loaded;
+        double load_time = measure_ms([&loaded, &filename]() { loaded.load(filename); });
+        for (double d : {1.0, 5.0, 20.0}) {
+            if (locator.query(d).size() != loaded.query(d).size() ||
+                locator.query(d, d / 2).size() != loaded.query(d, d / 2).size())
+                throw std::logic_error("loaded snapshot query result differs from the preprocessed one");
+        }
+        fdml_infoln("[Bench] load: " << load_time << "ms");
+    }
+    std::remove(filename.c_str());
+    return FDML_RETCODE_OK;
+}
+
+/* Compare the time of incrementally removing and adding back a hole of the scene to the time of a full rebuild. The
+ * first update of each kind is verified against a full rebuild, and all of them with verify */
+static int bench_update(const Polygon_with_holes& scene, unsigned int repeat, bool verify) {
+    if (scene.number_of_holes() == 0)
+        throw std::invalid_argument("scene must contain at least one hole");
+    const unsigned int hole_idx = scene.number_of_holes() - 1;
+    const Polygon hole = *std::next(scene.holes_begin(), hole_idx);
+    Polygon_with_holes scene_without_hole = scene;
+    scene_without_hole.erase_hole(std::next(scene_without_hole.holes_begin(), hole_idx));
+
+    Locator locator;
+    init_locator(locator, scene);
+    /* the first removal and addition are always verified against a full rebuild, outside of the measured time */
+    locator.set_update_verification(true);
+    locator.remove_hole(hole_idx);
+    locator.add_hole(hole);
+    locator.set_update_verification(verify);
+    for (unsigned int r = 0; r < repeat; r++) {
+        double remove_time = measure_ms([&locator, hole_idx]() { locator.remove_hole(hole_idx); });
+        double add_time = measure_ms([&locator, &hole]() { locator.add_hole(hole); });
+        Locator rebuilt;
+        double rebuild_without_time =
+            measure_ms([&rebuilt, &scene_without_hole]() { rebuilt.init(scene_without_hole); });
+        double rebuild_time = measure_ms([&rebuilt, &scene]() { rebuilt.init(scene); });
+        fdml_infoln("[Bench] remove hole: " << remove_time << "ms (rebuild " << rebuild_without_time << "ms)");
+        fdml_infoln("[Bench] add hole: " << add_time << "ms (rebuild " << rebuild_time << "ms)");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* Compare the throughput of single and batch queries of random measurements, and verify both produce the same number
+ * of result entries for each measurement */
+static int bench_query_batch(const Polygon_with_holes& scene, unsigned int repeat, unsigned int batch_size,
+                             unsigned int threads_num, unsigned int seed) {
+    Locator locator;
+    init_locator(locator, scene, std::make_shared<Executor>(threads_num));
+
+    std::mt19937 rand(seed);
+    const auto measurements = random_measurements(rand, batch_size);
+    const auto& ds = measurements.ds;
+    const auto& ds2 = measurements.ds2;
+
+    auto qps = [batch_size](double time_ms) { return time_ms > 0 ? batch_size * 1000.0 / time_ms : 0; };
+    for (unsigned int r = 0; r < repeat; r++) {
+        std::vector<std::vector<Locator::Res1d>> single_res;
+        double single_time = measure_ms([&locator, &ds, &single_res]() {
+            for (const auto& d : ds)
+                single_res.push_back(locator.query(d));
+        });
+        Locator::BatchRes<Locator::Res1d> batch_res;
+        double batch_time = measure_ms([&]() { batch_res = locator.query_batch(ds); });
+        for (unsigned int i = 0; i < batch_size; i++)
+            if (single_res[i].size() != (size_t)(batch_res.end(i) - batch_res.begin(i)))
+                throw std::logic_error("batch query1 result differs from the single query result");
+        fdml_infoln("[Bench] query1 single: " << qps(single_time) << " q/s, batch: " << qps(batch_time) << " q/s");
+
+        std::vector<std::vector<Locator::Res2d>> single_res2;
+        double single_time2 = measure_ms([&locator, &ds2, &single_res2]() {
+            for (const auto& d : ds2)
+                single_res2.push_back(locator.query(d.first, d.second));
+        });
+        Locator::BatchRes<Locator::Res2d> batch_res2;
+        double batch_time2 = measure_ms([&]() { batch_res2 = locator.query_batch(ds2); });
+        for (unsigned int i = 0; i < batch_size; i++)
+            if (single_res2[i].size() != (size_t)(batch_res2.end(i) - batch_res2.begin(i)))
+                throw std::logic_error("batch query2 result differs from the single query result");
+        fdml_infoln("[Bench] query2 single: " << qps(single_time2) << " q/s, batch: " << qps(batch_time2) << " q/s");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* Compare the latency of single queries with short measurements, which have many candidate trapezoids, evaluated
+ * inline and by a pool executor, and verify both produce the same result entries */
+static int bench_query_parallel(const Polygon_with_holes& scene, unsigned int repeat, unsigned int threads_num,
+                                unsigned int seed) {
+    Locator locator;
+    init_locator(locator, scene);
+    auto inline_executor = std::make_shared<Executor>();
+    auto pool_executor = std::make_shared<Executor>(threads_num);
+
+    std::mt19937 rand(seed);
+    std::uniform_real_distribution<double> distance(0.1, 2.0);
+    for (unsigned int r = 0; r < repeat; r++) {
+        const Kernel::FT d(distance(rand)), d1(distance(rand) / 2), d2(distance(rand) / 2);
+
+        std::vector<Locator::Res1d> inline_res, pool_res;
+        locator.set_executor(inline_executor);
+        double inline_time = measure_ms([&]() { inline_res = locator.query(d); });
+        locator.set_executor(pool_executor);
+        double pool_time = measure_ms([&]() { pool_res = locator.query(d); });
+        if (inline_res.size() != pool_res.size())
+            throw std::logic_error("parallel query1 result differs from the inline query result");
+        for (size_t i = 0; i < inline_res.size(); i++)
+            if (inline_res[i].edge != pool_res[i].edge || inline_res[i].pos != pool_res[i].pos)
+                throw std::logic_error("parallel query1 result differs from the inline query result");
+        fdml_infoln("[Bench] query1 (" << inline_res.size() << " entries) inline: " << inline_time << "ms, "
+                                       << pool_executor->get_threads_num() << " threads: " << pool_time << "ms");
+
+        std::vector<Locator::Res2d> inline_res2, pool_res2;
+        locator.set_executor(inline_executor);
+        double inline_time2 = measure_ms([&]() { inline_res2 = locator.query(d1, d2); });
+        locator.set_executor(pool_executor);
+        double pool_time2 = measure_ms([&]() { pool_res2 = locator.query(d1, d2); });
+        if (inline_res2.size() != pool_res2.size())
+            throw std::logic_error("parallel query2 result differs from the inline query result");
+        for (size_t i = 0; i < inline_res2.size(); i++)
+            if (inline_res2[i].edge1 != pool_res2[i].edge1 || inline_res2[i].edge2 != pool_res2[i].edge2 ||
+                inline_res2[i].pos != pool_res2[i].pos)
+                throw std::logic_error("parallel query2 result differs from the inline query result");
+        fdml_infoln("[Bench] query2 (" << inline_res2.size() << " entries) inline: " << inline_time2 << "ms, "
+                                       << pool_executor->get_threads_num() << " threads: " << pool_time2 << "ms");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* Compare the latency of exact and inexact results of random queries, and report the number of result entries of
+ * both, which may differ only in degenerate cases */
+static int bench_query_inexact(const Polygon_with_holes& scene, unsigned int repeat, unsigned int batch_size,
+                               unsigned int seed) {
+    Locator locator;
+    init_locator(locator, scene);
+    ResultOptions exact_options, inexact_options;
+    inexact_options.inexact = true;
+
+    std::mt19937 rand(seed);
+    const auto measurements = random_measurements(rand, batch_size);
+    const auto& ds = measurements.ds;
+    const auto& ds2 = measurements.ds2;
+
+    for (unsigned int r = 0; r < repeat; r++) {
+        Locator::BatchRes<Locator::Res1d> exact_res, inexact_res;
+        double exact_time = measure_ms([&]() { exact_res = locator.query_batch(ds, exact_options); });
+        double inexact_time = measure_ms([&]() { inexact_res = locator.query_batch(ds, inexact_options); });
+        fdml_infoln("[Bench] query1 exact: " << exact_time << "ms (" << exact_res.entries.size()
+                                             << " entries), inexact: " << inexact_time << "ms ("
+                                             << inexact_res.entries.size() << " entries)");
+
+        Locator::BatchRes<Locator::Res2d> exact_res2, inexact_res2;
+        double exact_time2 = measure_ms([&]() { exact_res2 = locator.query_batch(ds2, exact_options); });
+        double inexact_time2 = measure_ms([&]() { inexact_res2 = locator.query_batch(ds2, inexact_options); });
+        fdml_infoln("[Bench] query2 exact: " << exact_time2 << "ms (" << exact_res2.entries.size()
+                                             << " entries), inexact: " << inexact_time2 << "ms ("
+                                             << inexact_res2.entries.size() << " entries)");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* Measure the candidate trapezoids selection of random queries, relative to the full queries */
+static int bench_candidates(const Polygon_with_holes& scene, unsigned int repeat, unsigned int batch_size,
+                            unsigned int seed) {
+    Locator locator;
+    init_locator(locator, scene);
+
+    std::mt19937 rand(seed);
+    const auto measurements = random_measurements(rand, batch_size);
+    const auto& ds = measurements.ds;
+    const auto& ds2 = measurements.ds2;
+
+    for (unsigned int r = 0; r < repeat; r++) {
+        size_t candidates_num = 0, candidates_num2 = 0;
+        double select_time = measure_ms([&]() {
+            for (const auto& d : ds)
+                candidates_num += locator.query_candidates(d).size();
+        });
+        double select_time2 = measure_ms([&]() {
+            for (const auto& d : ds2)
+                candidates_num2 += locator.query_candidates(d.first, d.second).size();
+        });
+        double query_time = measure_ms([&]() {
+            for (const auto& d : ds)
+                locator.query(d);
+        });
+        double query_time2 = measure_ms([&]() {
+            for (const auto& d : ds2)
+                locator.query(d.first, d.second);
+        });
+        fdml_infoln("[Bench] query1 selection: " << select_time * 1e6 / batch_size << "ns per query ("
+                                                 << (double)candidates_num / batch_size << " candidates), "
+                                                 << 100 * select_time / query_time << "% of the query time");
+        fdml_infoln("[Bench] query2 selection: " << select_time2 * 1e6 / batch_size << "ns per query ("
+                                                 << (double)candidates_num2 / batch_size << " candidates), "
+                                                 << 100 * select_time2 / query_time2 << "% of the query time");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* Compare the half plane clipper to the reference arrangement based clipping of the scene polygons, by random lines
+ * and by lines through the polygons vertices, and verify both produce pieces with the same areas */
+static int bench_clip(const Polygon_with_holes& scene, unsigned int repeat, unsigned int lines_num,
+                      unsigned int seed) {
+    std::vector<Polygon> polygons = {scene.outer_boundary()};
+    polygons.insert(polygons.end(), scene.holes_begin(), scene.holes_end());
+
+    std::mt19937 rand(seed);
+    std::uniform_real_distribution<double> coordinate(-100, 100);
+    auto pieces_areas = [](const std::vector<Polygon>& pieces) {
+        std::vector<Kernel::FT> areas;
+        for (const auto& piece : pieces)
+            areas.push_back(piece.area());
+        sort(areas.begin(), areas.end());
+        return areas;
+    };
+
+    for (unsigned int r = 0; r < repeat; r++) {
+        double clip_time = 0, arr_time = 0;
+        unsigned int pieces_num = 0;
+        for (unsigned int l = 0; l < lines_num; l++) {
+            const Polygon& poly = polygons[l % polygons.size()];
+            Line line;
+            if (l % 2 == 0) {
+                line = Line(Point(coordinate(rand), coordinate(rand)), Point(coordinate(rand), coordinate(rand)));
+            } else {
+                /* a line through two vertices, which may contain edges of the polygon */
+                std::uniform_int_distribution<unsigned int> vertex(0, poly.size() - 1);
+                unsigned int v1 = vertex(rand), v2 = vertex(rand);
+                if (v1 == v2)
+                    v2 = (v1 + 1) % poly.size();
+                line = Line(poly[v1], poly[v2]);
+            }
+
+            /* the holes are clockwise, which is supported only by the clipper */
+            Polygon ccw_poly(poly);
+            if (ccw_poly.orientation() == CGAL::CLOCKWISE)
+                ccw_poly.reverse_orientation();
+            std::vector<Polygon> clip_res, arr_res;
+            clip_time += measure_ms([&]() { clip_res = HalfPlaneClipper::clip(poly, line); });
+            arr_time += measure_ms([&]() { arr_res = HalfPlaneClipper::clip_by_arrangement(ccw_poly, line); });
+            if (pieces_areas(clip_res) != pieces_areas(arr_res))
+                throw std::logic_error("half plane clipper result differs from the arrangement result");
+            for (const auto& piece : clip_res)
+                if (!piece.is_simple() || piece.orientation() != CGAL::COUNTERCLOCKWISE)
+                    throw std::logic_error("half plane clipper produced an invalid piece");
+            pieces_num += clip_res.size();
+        }
+        fdml_infoln("[Bench] clip " << lines_num << " lines (" << pieces_num << " pieces): " << clip_time
+                                    << "ms, arrangement: " << arr_time << "ms");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* Squared distance from a point to a segment in double arithmetic */
+static double segment_squared_distance(double px, double py, double sx, double sy, double tx, double ty) {
+    const double vx = tx - sx, vy = ty - sy, len2 = vx * vx + vy * vy;
+    const double t = len2 > 0 ? std::max(0.0, std::min(1.0, ((px - sx) * vx + (py - sy) * vy) / len2)) : 0;
+    const double dx = sx + vx * t - px, dy = sy + vy * t - py;
+    return dx * dx + dy * dy;
+}
+
+/* The boundary segments of query results in double arithmetic, grouped by the trapezoid edges the results measure */
+template <typename Key> class ResultBoundaries {
+  public:
+    void add(const Key& key, const Point& source, const Point& target) {
+        auto it = std::find(keys.begin(), keys.end(), key);
+        if (it == keys.end()) {
+            keys.push_back(key);
+            segments.emplace_back();
+            it = keys.end() - 1;
+        }
+        segments[it - keys.begin()].push_back({CGAL::to_double(source.x()), CGAL::to_double(source.y()),
+                                               CGAL::to_double(target.x()), CGAL::to_double(target.y())});
+    }
+
+    /* The maximal distance from the end and middle points of the segments to the nearest segment of the same edges in
+     * other boundaries. Infinite if the other boundaries miss the edges of some segments. */
+    double distance_to(const ResultBoundaries& other) const {
+        double max_dist2 = 0;
+        for (size_t i = 0; i < keys.size(); i++) {
+            auto other_it = std::find(other.keys.begin(), other.keys.end(), keys[i]);
+            if (other_it == other.keys.end())
+                return std::numeric_limits<double>::infinity();
+            const auto& other_segments = other.segments[other_it - other.keys.begin()];
+            for (const auto& seg : segments[i]) {
+                const double points[3][2] = {
+                    {seg.sx, seg.sy}, {seg.tx, seg.ty}, {(seg.sx + seg.tx) / 2, (seg.sy + seg.ty) / 2}};
+                for (const auto& p : points) {
+                    double min_dist2 = std::numeric_limits<double>::infinity();
+                    for (const auto& other_seg : other_segments)
+                        min_dist2 = std::min(min_dist2, other_seg.squared_distance(p[0], p[1]));
+                    max_dist2 = std::max(max_dist2, min_dist2);
+                }
+            }
+        }
+        return std::sqrt(max_dist2);
+    }
+
+  private:
+    struct InexactSegment {
+        double sx, sy, tx, ty;
+
+        double squared_distance(double px, double py) const {
+            return segment_squared_distance(px, py, sx, sy, tx, ty);
+        }
+    };
+    std::vector<Key> keys;
+    std::vector<std::vector<InexactSegment>> segments;
+};
+
+/* Measure the latency and the result size of random queries with the fixed sampling, with decreasing tolerances and in
+ * parametric mode. The results of each tolerance are verified to be within the tolerance of reference results of a
+ * finer tolerance, on the first few queries. */
+static int bench_tessellation(const Polygon_with_holes& scene, unsigned int batch_size, unsigned int seed) {
+    const std::string filename = "fdml_bench_result.json";
+    Locator locator;
+    init_locator(locator, scene);
+
+    std::mt19937 rand(seed);
+    const auto measurements = random_measurements(rand, batch_size);
+    const auto& ds = measurements.ds;
+    const auto& ds2 = measurements.ds2;
+
+    std::vector<std::pair<std::string, ResultOptions>> modes;
+    modes.emplace_back("fixed", ResultOptions());
+    for (double tolerance : {1.0, 0.1, 0.01, 0.001}) {
+        ResultOptions options;
+        options.tolerance = tolerance;
+        modes.emplace_back("tolerance " + std::to_string(tolerance), options);
+    }
+    ResultOptions parametric_options;
+    parametric_options.parametric = true;
+    modes.emplace_back("parametric", parametric_options);
+
+    typedef std::pair<Point, Point> Edge;
+    auto boundaries1 = [&locator](const Kernel::FT& d, const ResultOptions& options) {
+        ResultBoundaries<Edge> boundaries;
+        for (const auto& entry : locator.query(d, options))
+            for (auto it = entry.pos.edges_begin(); it != entry.pos.edges_end(); ++it)
+                boundaries.add(entry.edge, it->source(), it->target());
+        return boundaries;
+    };
+    auto boundaries2 = [&locator](const std::pair<Kernel::FT, Kernel::FT>& d, const ResultOptions& options) {
+        ResultBoundaries<std::pair<Edge, Edge>> boundaries;
+        for (const auto& entry : locator.query(d.first, d.second, options))
+            for (const Segment& seg : entry.pos)
+                boundaries.add({entry.edge1, entry.edge2}, seg.source(), seg.target());
+        return boundaries;
+    };
+    const unsigned int verify_num = std::min(batch_size, 4u);
+    ResultOptions reference_options;
+    reference_options.tolerance = 1e-4;
+    std::vector<ResultBoundaries<Edge>> references;
+    std::vector<ResultBoundaries<std::pair<Edge, Edge>>> references2;
+    for (unsigned int i = 0; i < verify_num; i++) {
+        references.push_back(boundaries1(ds[i], reference_options));
+        references2.push_back(boundaries2(ds2[i], reference_options));
+    }
+
+    auto file_size = [&filename]() {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        return (size_t)file.tellg();
+    };
+    for (const auto& [mode, options] : modes) {
+        Locator::BatchRes<Locator::Res1d> res;
+        double time = measure_ms([&]() { res = locator.query_batch(ds, options); });
+        std::vector<Polygon> polygons;
+        size_t points_num = 0;
+        for (const auto& entry : res.entries) {
+            polygons.push_back(entry.pos);
+            points_num += entry.pos.size();
+        }
+        JsonUtils::write_polygons(polygons, filename);
+        fdml_infoln("[Bench] query1 " << mode << ": " << time << "ms, " << points_num << " points, " << file_size()
+                                      << " bytes");
+
+        Locator::BatchRes<Locator::Res2d> res2;
+        double time2 = measure_ms([&]() { res2 = locator.query_batch(ds2, options); });
+        std::vector<Segment> segments;
+        for (const auto& entry : res2.entries)
+            segments.insert(segments.end(), entry.pos.begin(), entry.pos.end());
+        JsonUtils::write_segments(segments, filename);
+        fdml_infoln("[Bench] query2 " << mode << ": " << time2 << "ms, " << segments.size() << " segments, "
+                                      << file_size() << " bytes");
+
+        if (options.tolerance <= 0)
+            continue;
+        const double max_distance = options.tolerance + reference_options.tolerance + 1e-9;
+        for (unsigned int i = 0; i < verify_num; i++) {
+            const auto res_boundaries = boundaries1(ds[i], options);
+            if (res_boundaries.distance_to(references[i]) > max_distance ||
+                references[i].distance_to(res_boundaries) > max_distance)
+                throw std::runtime_error("query1 " + mode + " result is not within the tolerance of the reference");
+            const auto res_boundaries2 = boundaries2(ds2[i], options);
+            if (res_boundaries2.distance_to(references2[i]) > max_distance ||
+                references2[i].distance_to(res_boundaries2) > max_distance)
+                throw std::runtime_error("query2 " + mode + " result is not within the tolerance of the reference");
+        }
+    }
+    std::remove(filename.c_str());
+    return FDML_RETCODE_OK;
+}
+
+static int bench_analytic(const Polygon_with_holes& scene, unsigned int batch_size, unsigned int seed) {
+    Locator locator;
+    init_locator(locator, scene);
+
+    std::mt19937 rand(seed);
+    const auto measurements = random_measurements(rand, batch_size);
+    const auto& ds = measurements.ds;
+    const auto& ds2 = measurements.ds2;
+    ResultOptions analytic_options;
+    analytic_options.analytic = true;
+
+    /* compare the sampled results to the analytic results and their lazy evaluation. Both are sampled with a
+     * tolerance, so the areas of each are within the tolerance times the boundary length of the exact area */
+    const double tolerance = 1e-3;
+    ResultOptions sampling_options;
+    sampling_options.tolerance = tolerance;
+    Locator::BatchRes<Locator::Res1d> sampled, analytic;
+    double sampled_time = measure_ms([&]() { sampled = locator.query_batch(ds, sampling_options); });
+    double analytic_time = measure_ms([&]() { analytic = locator.query_batch(ds, analytic_options); });
+    size_t points_num = 0, curves_num = 0;
+    for (const auto& entry : sampled.entries)
+        points_num += entry.pos.size();
+    for (const auto& entry : analytic.entries)
+        curves_num += entry.boundary.size();
+    double sampled_area = 0, analytic_area = 0, perimeter = 0;
+    double eval_time = measure_ms([&]() {
+        for (const auto& entry : analytic.entries)
+            analytic_area += CGAL::to_double(entry.evaluate(sampling_options).area());
+    });
+    for (const auto& entry : sampled.entries) {
+        sampled_area += CGAL::to_double(entry.pos.area());
+        for (auto it = entry.pos.edges_begin(); it != entry.pos.edges_end(); ++it)
+            perimeter += std::sqrt(CGAL::to_double(it->squared_length()));
+    }
+    fdml_infoln("[Bench] query1 sampled: " << sampled_time << "ms, " << sampled.entries.size() << " entries, "
+                                           << points_num << " points, area " << sampled_area);
+    fdml_infoln("[Bench] query1 analytic: " << analytic_time << "ms, " << analytic.entries.size() << " entries, "
+                                            << curves_num << " curves, evaluation " << eval_time << "ms, area "
+                                            << analytic_area);
+    if (std::abs(analytic_area - sampled_area) > 2 * tolerance * perimeter + 1e-9 * std::abs(sampled_area))
+        throw std::runtime_error("evaluated analytic query1 area differs from the sampled area");
+
+    Locator::BatchRes<Locator::Res2d> sampled2, analytic2;
+    double sampled_time2 = measure_ms([&]() { sampled2 = locator.query_batch(ds2); });
+    double analytic_time2 = measure_ms([&]() { analytic2 = locator.query_batch(ds2, analytic_options); });
+    size_t segments_num = 0, curves_num2 = 0, evaluated_num = 0;
+    for (const auto& entry : sampled2.entries)
+        segments_num += entry.pos.size();
+    for (const auto& entry : analytic2.entries)
+        curves_num2 += entry.curves.size();
+    double eval_time2 = measure_ms([&]() {
+        for (const auto& entry : analytic2.entries)
+            evaluated_num += entry.evaluate().size();
+    });
+    fdml_infoln("[Bench] query2 sampled: " << sampled_time2 << "ms, " << segments_num << " segments");
+    fdml_infoln("[Bench] query2 analytic: " << analytic_time2 << "ms, " << curves_num2 << " curves, evaluation "
+                                            << eval_time2 << "ms, " << evaluated_num << " segments");
+    return FDML_RETCODE_OK;
+}
+
+/* Check if a point is within one of the areas of the range result entries of an edge, or within a distance tolerance of
+ * their boundary */
+static bool range_covers(const std::vector<std::pair<std::pair<Point, Point>, const Polygon*>>& areas,
+                         const std::pair<Point, Point>& edge, const Point& p, double tolerance) {
+    const double px = CGAL::to_double(p.x()), py = CGAL::to_double(p.y());
+    for (const auto& [area_edge, area] : areas) {
+        if (area_edge != edge)
+            continue;
+        if (area->bounded_side(p) != CGAL::ON_UNBOUNDED_SIDE)
+            return true;
+        for (auto it = area->edges_begin(); it != area->edges_end(); ++it) {
+            if (segment_squared_distance(px, py, CGAL::to_double(it->source().x()), CGAL::to_double(it->source().y()),
+                                         CGAL::to_double(it->target().x()),
+                                         CGAL::to_double(it->target().y())) <= tolerance * tolerance)
+                return true;
+        }
+    }
+    return false;
+}
+
+/* Verify that the results of jittered queries of distances in the ranges are within the areas of the range queries.
+ * The jittered queries are sampled with a fine tolerance, so their points are on the exact result curves up to the
+ * check tolerance. */
+static void verify_range(const Locator& locator, const std::vector<double>& ds,
+                         const std::vector<std::pair<double, double>>& ds2, double noise, unsigned int jitter_num) {
+    const double check_tolerance = 1e-5;
+    ResultOptions fine_options;
+    fine_options.tolerance = 1e-7;
+    auto jitter = [noise, jitter_num](double d, unsigned int j) {
+        return j == 0 ? d - noise : j + 1 == jitter_num ? d + noise : d - noise + 2 * noise * j / (jitter_num - 1);
+    };
+
+    size_t points_num = 0;
+    for (double d : ds) {
+        const auto range_res = locator.query(Locator::MeasurementRange(d - noise, d + noise));
+        std::vector<std::pair<std::pair<Point, Point>, const Polygon*>> areas;
+        for (const auto& entry : range_res)
+            areas.emplace_back(entry.edge, &entry.pos);
+        for (unsigned int j = 0; j < jitter_num; j++) {
+            for (const auto& entry : locator.query(jitter(d, j), fine_options)) {
+                for (auto it = entry.pos.vertices_begin(); it != entry.pos.vertices_end(); ++it, points_num++)
+                    if (!range_covers(areas, entry.edge, *it, check_tolerance))
+                        throw std::runtime_error("query1 result point outside of the range result");
+            }
+        }
+    }
+    for (const auto& d : ds2) {
+        const auto range_res = locator.query(Locator::MeasurementRange(d.first - noise, d.first + noise),
+                                             Locator::MeasurementRange(d.second - noise, d.second + noise));
+        for (unsigned int j1 = 0; j1 < jitter_num; j1++) {
+            for (unsigned int j2 = 0; j2 < jitter_num; j2++) {
+                for (const auto& entry : locator.query(jitter(d.first, j1), jitter(d.second, j2), fine_options)) {
+                    std::vector<std::pair<std::pair<Point, Point>, const Polygon*>> areas;
+                    for (const auto& range_entry : range_res)
+                        if (range_entry.edge2 == entry.edge2)
+                            for (const Polygon& area : range_entry.pos)
+                                areas.emplace_back(range_entry.edge1, &area);
+                    for (const Segment& seg : entry.pos) {
+                        for (const Point& p : {seg.source(), seg.target()})
+                            if (!range_covers(areas, entry.edge1, p, check_tolerance))
+                                throw std::runtime_error("query2 result point outside of the range result");
+                        points_num += 2;
+                    }
+                }
+            }
+        }
+    }
+    fdml_infoln("[Bench] verified " << points_num << " jittered result points are within the range results");
+}
+
+/* Compare measurements ranges queries to the union of jittered queries of sampled distances in the ranges, as used
+ * before to account for the sensor noise */
+static int bench_range(const Polygon_with_holes& scene, unsigned int repeat, unsigned int batch_size,
+                       unsigned int seed, bool verify) {
+    Locator locator;
+    init_locator(locator, scene);
+    const double noise = 0.5;
+    const unsigned int jitter_num = 16;
+
+    std::mt19937 rand(seed);
+    const auto measurements = random_measurements<double>(rand, batch_size);
+    const auto& ds = measurements.ds;
+    const auto& ds2 = measurements.ds2;
+    auto jitter = [noise](double d, unsigned int j) { return d - noise + 2 * noise * j / (jitter_num - 1); };
+    if (verify) {
+        const unsigned int verify_num = std::min(batch_size, 8u);
+        verify_range(locator, std::vector<double>(ds.begin(), ds.begin() + verify_num),
+                     std::vector<std::pair<double, double>>(ds2.begin(), ds2.begin() + verify_num), noise, jitter_num);
+    }
+
+    for (unsigned int r = 0; r < repeat; r++) {
+        size_t range_num = 0, range_num2 = 0, jitter_res_num = 0, jitter_res_num2 = 0;
+        double range_time = measure_ms([&]() {
+            for (double d : ds)
+                range_num += locator.query(Locator::MeasurementRange(d - noise, d + noise)).size();
+        });
+        double range_time2 = measure_ms([&]() {
+            for (const auto& d : ds2)
+                range_num2 += locator
+                                  .query(Locator::MeasurementRange(d.first - noise, d.first + noise),
+                                         Locator::MeasurementRange(d.second - noise, d.second + noise))
+                                  .size();
+        });
+        double jitter_time = measure_ms([&]() {
+            for (double d : ds)
+                for (unsigned int j = 0; j < jitter_num; j++)
+                    jitter_res_num += locator.query(jitter(d, j)).size();
+        });
+        double jitter_time2 = measure_ms([&]() {
+            for (const auto& d : ds2)
+                for (unsigned int j1 = 0; j1 < jitter_num; j1++)
+                    for (unsigned int j2 = 0; j2 < jitter_num; j2++)
+                        jitter_res_num2 += locator.query(jitter(d.first, j1), jitter(d.second, j2)).size();
+        });
+        fdml_infoln("[Bench] query1 range: " << range_time << "ms (" << range_num << " entries), " << jitter_num
+                                             << " jittered queries: " << jitter_time << "ms (" << jitter_res_num
+                                             << " entries)");
+        fdml_infoln("[Bench] query2 range: " << range_time2 << "ms (" << range_num2 << " entries), "
+                                             << jitter_num * jitter_num << " jittered queries: " << jitter_time2
+                                             << "ms (" << jitter_res_num2 << " entries)");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* The headings, as angles, in which a sensor at a point measures a distance at an edge. Distances within a tolerance
+ * of the measurement are accepted too, for points on the chords between the samples of a result. */
+static std::vector<double> measured_headings(const Point& p, const std::pair<Point, Point>& edge, double d,
+                                             double tolerance) {
+    const double px = CGAL::to_double(p.x()), py = CGAL::to_double(p.y());
+    const double sx = CGAL::to_double(edge.first.x()), sy = CGAL::to_double(edge.first.y());
+    const double vx = CGAL::to_double(edge.second.x()) - sx, vy = CGAL::to_double(edge.second.y()) - sy;
+    const double wx = sx - px, wy = sy - py, a = vx * vx + vy * vy, b = 2 * (vx * wx + vy * wy);
+    std::vector<double> headings;
+    for (double r : {d - tolerance, d, d + tolerance}) {
+        const double c = wx * wx + wy * wy - r * r, disc = b * b - 4 * a * c;
+        if (a == 0 || disc < 0)
+            continue;
+        for (double sign : {-1.0, 1.0}) {
+            const double t = (-b + sign * std::sqrt(disc)) / (2 * a);
+            if (t >= -1e-9 && t <= 1 + 1e-9)
+                headings.push_back(std::atan2(wy + vy * t, wx + vx * t));
+        }
+    }
+    return headings;
+}
+
+/* Verify that the results of heading queries are the unconstrained results clipped to the heading ranges, per edge.
+ * Every point of a heading result must be within an unconstrained result of the same edges, and measure them at a
+ * heading within the range. Every point of an unconstrained result which measures its edges only at headings within
+ * the range must be within a heading result of the same edges. The results are sampled with a fine tolerance, and
+ * their points are compared up to the check tolerance. */
+static void verify_heading(const Locator& locator, const std::vector<double>& ds,
+                           const std::vector<std::pair<double, double>>& ds2,
+                           const std::vector<Locator::HeadingRange>& headings) {
+    typedef std::pair<Point, Point> Edge;
+    const double check_tolerance = 1e-4, angle_margin = 1e-3;
+    ResultOptions fine_options;
+    fine_options.tolerance = 1e-5;
+
+    size_t points_num = 0;
+    for (size_t i = 0; i < ds.size(); i++) {
+        const Direction &begin = headings[i].begin, &end = headings[i].end;
+        const double heading_begin = std::atan2(CGAL::to_double(begin.dy()), CGAL::to_double(begin.dx()));
+        double heading_range = std::atan2(CGAL::to_double(end.dy()), CGAL::to_double(end.dx())) - heading_begin;
+        if (heading_range < 0)
+            heading_range += 2 * M_PI;
+        /* the heading range shrunk by a positive margin, or expanded by a negative one */
+        auto in_heading = [heading_begin, heading_range](double a, double margin) {
+            double offset = std::remainder(a - heading_begin - heading_range / 2, 2 * M_PI) + heading_range / 2;
+            return offset >= margin && offset <= heading_range - margin;
+        };
+
+        const auto res = locator.query(ds[i], fine_options);
+        const auto heading_res = locator.query(ds[i], headings[i], fine_options);
+        std::vector<std::pair<Edge, const Polygon*>> areas, heading_areas;
+        for (const auto& entry : res)
+            areas.emplace_back(entry.edge, &entry.pos);
+        for (const auto& entry : heading_res)
+            heading_areas.emplace_back(entry.edge, &entry.pos);
+        for (const auto& entry : heading_res) {
+            for (auto it = entry.pos.vertices_begin(); it != entry.pos.vertices_end(); ++it, points_num++) {
+                const auto measured = measured_headings(*it, entry.edge, ds[i], check_tolerance);
+                if (!range_covers(areas, entry.edge, *it, check_tolerance) ||
+                    std::none_of(measured.begin(), measured.end(),
+                                 [&in_heading, angle_margin](double a) { return in_heading(a, -angle_margin); }))
+                    throw std::runtime_error("query1 heading result point outside of the clipped result");
+            }
+        }
+        for (const auto& entry : res) {
+            for (auto it = entry.pos.vertices_begin(); it != entry.pos.vertices_end(); ++it, points_num++) {
+                const auto measured = measured_headings(*it, entry.edge, ds[i], check_tolerance);
+                if (!measured.empty() &&
+                    std::all_of(measured.begin(), measured.end(),
+                                [&in_heading, angle_margin](double a) { return in_heading(a, angle_margin); }) &&
+                    !range_covers(heading_areas, entry.edge, *it, check_tolerance))
+                    throw std::runtime_error("query1 result point within the heading range missing from the heading "
+                                             "result");
+            }
+        }
+
+        const double d1 = ds2[i].first, d2 = ds2[i].second;
+        const auto res2 = locator.query(d1, d2, fine_options);
+        const auto heading_res2 = locator.query(d1, d2, headings[i], fine_options);
+        /* the headings in which a point measures d1 at the first edge and d2 at the second in the opposite direction */
+        auto measured_headings2 = [d1, d2, check_tolerance](const Point& p, const Locator::Res2d& entry) {
+            const double px = CGAL::to_double(p.x()), py = CGAL::to_double(p.y());
+            const Edge& edge2 = entry.edge2;
+            std::vector<double> measured;
+            for (double a : measured_headings(p, entry.edge1, d1, check_tolerance))
+                if (segment_squared_distance(px - d2 * std::cos(a), py - d2 * std::sin(a),
+                                             CGAL::to_double(edge2.first.x()), CGAL::to_double(edge2.first.y()),
+                                             CGAL::to_double(edge2.second.x()), CGAL::to_double(edge2.second.y())) <=
+                    100 * check_tolerance * check_tolerance)
+                    measured.push_back(a);
+            return measured;
+        };
+        auto covers2 = [check_tolerance](const std::vector<Locator::Res2d>& entries, const Locator::Res2d& entry,
+                                         const Point& p) {
+            const double px = CGAL::to_double(p.x()), py = CGAL::to_double(p.y());
+            for (const auto& other : entries) {
+                if (other.edge1 != entry.edge1 || other.edge2 != entry.edge2)
+                    continue;
+                for (const Segment& seg : other.pos)
+                    if (segment_squared_distance(px, py, CGAL::to_double(seg.source().x()),
+                                                 CGAL::to_double(seg.source().y()), CGAL::to_double(seg.target().x()),
+                                                 CGAL::to_double(seg.target().y())) <=
+                        check_tolerance * check_tolerance)
+                        return true;
+            }
+            return false;
+        };
+        for (const auto& entry : heading_res2) {
+            for (const Segment& seg : entry.pos) {
+                for (const Point& p : {seg.source(), seg.target()}) {
+                    const auto measured = measured_headings2(p, entry);
+                    if (!covers2(res2, entry, p) ||
+                        std::none_of(measured.begin(), measured.end(),
+                                     [&in_heading, angle_margin](double a) { return in_heading(a, -angle_margin); }))
+                        throw std::runtime_error("query2 heading result point outside of the clipped result");
+                }
+                points_num += 2;
+            }
+        }
+        for (const auto& entry : res2) {
+            for (const Segment& seg : entry.pos) {
+                for (const Point& p : {seg.source(), seg.target()}) {
+                    const auto measured = measured_headings2(p, entry);
+                    if (!measured.empty() &&
+                        std::all_of(measured.begin(), measured.end(),
+                                    [&in_heading, angle_margin](double a) { return in_heading(a, angle_margin); }) &&
+                        !covers2(heading_res2, entry, p))
+                        throw std::runtime_error("query2 result point within the heading range missing from the "
+                                                 "heading result");
+                }
+                points_num += 2;
+            }
+        }
+    }
+    fdml_infoln("[Bench] verified " << points_num << " result points of the heading and unconstrained queries");
+}
+
+/* Compare queries with a known heading range of a quarter circle to unconstrained queries, in the number of
+ * candidate trapezoids and the query time. The heading results of the first queries are verified against the
+ * unconstrained results. */
+static int bench_heading(const Polygon_with_holes& scene, unsigned int repeat, unsigned int batch_size,
+                         unsigned int seed) {
+    Locator locator;
+    init_locator(locator, scene);
+
+    std::mt19937 rand(seed);
+    const auto measurements = random_measurements<double>(rand, batch_size);
+    const auto& ds = measurements.ds;
+    const auto& ds2 = measurements.ds2;
+    std::uniform_real_distribution<double> angle(0.0, 2 * M_PI);
+    std::vector<Locator::HeadingRange> headings;
+    for (unsigned int i = 0; i < batch_size; i++) {
+        const double a = angle(rand);
+        headings.emplace_back(Direction(std::cos(a), std::sin(a)),
+                              Direction(std::cos(a + M_PI / 2), std::sin(a + M_PI / 2)));
+    }
+    const unsigned int verify_num = std::min(batch_size, 8u);
+    verify_heading(locator, std::vector<double>(ds.begin(), ds.begin() + verify_num),
+                   std::vector<std::pair<double, double>>(ds2.begin(), ds2.begin() + verify_num),
+                   std::vector<Locator::HeadingRange>(headings.begin(), headings.begin() + verify_num));
+
+    for (unsigned int r = 0; r < repeat; r++) {
+        size_t candidates_num = 0, candidates_num2 = 0, heading_candidates_num = 0, heading_candidates_num2 = 0;
+        for (unsigned int i = 0; i < batch_size; i++) {
+            candidates_num += locator.query_candidates(ds[i]).size();
+            candidates_num2 += locator.query_candidates(ds2[i].first, ds2[i].second).size();
+            heading_candidates_num += locator.query_candidates(ds[i], headings[i]).size();
+            heading_candidates_num2 += locator.query_candidates(ds2[i].first, ds2[i].second, headings[i]).size();
+        }
+        double query_time = measure_ms([&]() {
+            for (double d : ds)
+                locator.query(d);
+        });
+        double query_time2 = measure_ms([&]() {
+            for (const auto& d : ds2)
+                locator.query(d.first, d.second);
+        });
+        double heading_time = measure_ms([&]() {
+            for (unsigned int i = 0; i < batch_size; i++)
+                locator.query(ds[i], headings[i]);
+        });
+        double heading_time2 = measure_ms([&]() {
+            for (unsigned int i = 0; i < batch_size; i++)
+                locator.query(ds2[i].first, ds2[i].second, headings[i]);
+        });
+        fdml_infoln("[Bench] query1: " << query_time << "ms (" << (double)candidates_num / batch_size
+                                       << " candidates), with heading: " << heading_time << "ms ("
+                                       << (double)heading_candidates_num / batch_size << " candidates)");
+        fdml_infoln("[Bench] query2: " << query_time2 << "ms (" << (double)candidates_num2 / batch_size
+                                       << " candidates), with heading: " << heading_time2 << "ms ("
+                                       << (double)heading_candidates_num2 / batch_size << " candidates)");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* Verify that the results of region queries are within their regions, and that their areas per edge are the areas of
+ * the unconstrained results clipped to the regions by the reference arrangement clipping */
+static void verify_region(const Locator& locator, const std::vector<double>& ds,
+                          const std::vector<CGAL::Bbox_2>& regions) {
+    typedef std::pair<Point, Point> Edge;
+    auto add_area = [](std::vector<std::pair<Edge, Kernel::FT>>& areas, const Edge& edge, const Kernel::FT& area) {
+        auto it = std::find_if(areas.begin(), areas.end(), [&edge](const auto& a) { return a.first == edge; });
+        if (it == areas.end())
+            areas.emplace_back(edge, area);
+        else
+            it->second += area;
+    };
+
+    size_t polygons_num = 0;
+    for (size_t i = 0; i < ds.size(); i++) {
+        const CGAL::Bbox_2& box = regions[i];
+        Polygon region;
+        for (const auto& [x, y] : {std::pair(box.xmin(), box.ymin()), std::pair(box.xmax(), box.ymin()),
+                                   std::pair(box.xmax(), box.ymax()), std::pair(box.xmin(), box.ymax())})
+            region.push_back(Point(x, y));
+
+        std::vector<std::pair<Edge, Kernel::FT>> region_areas, clipped_areas;
+        for (const auto& entry : locator.query(ds[i], box)) {
+            for (auto it = entry.pos.vertices_begin(); it != entry.pos.vertices_end(); ++it)
+                if (region.bounded_side(*it) == CGAL::ON_UNBOUNDED_SIDE)
+                    throw std::runtime_error("region query result point outside of the region");
+            add_area(region_areas, entry.edge, CGAL::abs(entry.pos.area()));
+            polygons_num++;
+        }
+        for (const auto& entry : locator.query(ds[i])) {
+            std::vector<Polygon> pieces = {entry.pos};
+            if (pieces[0].orientation() == CGAL::CLOCKWISE)
+                pieces[0].reverse_orientation();
+            for (auto edge = region.edges_begin(); edge != region.edges_end(); ++edge) {
+                std::vector<Polygon> clipped;
+                for (const Polygon& piece : pieces)
+                    for (Polygon& p : HalfPlaneClipper::clip_by_arrangement(piece, edge->supporting_line()))
+                        clipped.push_back(std::move(p));
+                pieces = std::move(clipped);
+            }
+            for (const Polygon& piece : pieces)
+                add_area(clipped_areas, entry.edge, CGAL::abs(piece.area()));
+        }
+
+        /* edges with an empty clipped area may have no region result entries, and vice versa */
+        for (const auto* areas : {&region_areas, &clipped_areas}) {
+            const auto& other = areas == &region_areas ? clipped_areas : region_areas;
+            for (const auto& edge_area : *areas) {
+                auto it = std::find_if(other.begin(), other.end(),
+                                       [&edge_area](const auto& a) { return a.first == edge_area.first; });
+                if (edge_area.second != (it == other.end() ? Kernel::FT(0) : it->second))
+                    throw std::runtime_error("region query result differs from the clipped unconstrained result");
+            }
+        }
+    }
+    fdml_infoln("[Bench] verified " << polygons_num << " region result polygons against the clipped results");
+}
+
+/* Compare single measurement queries within a region of interest, a random box of a quarter of the room width, to
+ * unconstrained queries, in the number of candidate trapezoids and the query time. The region results of the first
+ * queries are verified against the clipped unconstrained results. */
+static int bench_region(const Polygon_with_holes& scene, unsigned int repeat, unsigned int batch_size,
+                        unsigned int seed) {
+    Locator locator;
+    init_locator(locator, scene);
+
+    const CGAL::Bbox_2 scene_bbox = scene.outer_boundary().bbox();
+    const double box_width = (scene_bbox.xmax() - scene_bbox.xmin()) / 4;
+    std::mt19937 rand(seed);
+    const std::vector<double> ds = random_measurements<double>(rand, batch_size).ds;
+    std::uniform_real_distribution<double> box_x(scene_bbox.xmin(), scene_bbox.xmax() - box_width);
+    std::uniform_real_distribution<double> box_y(scene_bbox.ymin(), scene_bbox.ymax() - box_width);
+    std::vector<CGAL::Bbox_2> regions;
+    for (unsigned int i = 0; i < batch_size; i++) {
+        const double x = box_x(rand), y = box_y(rand);
+        regions.emplace_back(x, y, x + box_width, y + box_width);
+    }
+    const unsigned int verify_num = std::min(batch_size, 8u);
+    verify_region(locator, std::vector<double>(ds.begin(), ds.begin() + verify_num),
+                  std::vector<CGAL::Bbox_2>(regions.begin(), regions.begin() + verify_num));
+
+    for (unsigned int r = 0; r < repeat; r++) {
+        size_t candidates_num = 0, region_candidates_num = 0, res_num = 0, region_res_num = 0;
+        for (unsigned int i = 0; i < batch_size; i++) {
+            candidates_num += locator.query_candidates(ds[i]).size();
+            region_candidates_num += locator.query_candidates(ds[i], regions[i]).size();
+        }
+        double query_time = measure_ms([&]() {
+            for (double d : ds)
+                res_num += locator.query(d).size();
+        });
+        double region_time = measure_ms([&]() {
+            for (unsigned int i = 0; i < batch_size; i++)
+                region_res_num += locator.query(ds[i], regions[i]).size();
+        });
+        fdml_infoln("[Bench] query1: " << query_time << "ms (" << (double)candidates_num / batch_size
+                                       << " candidates, " << res_num << " entries), within region: " << region_time
+                                       << "ms (" << (double)region_candidates_num / batch_size << " candidates, "
+                                       << region_res_num << " entries)");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* Compare collecting the result polygons of single measurement queries from the returned entries, as done by the
+ * daemon before, to collecting them by a visitor */
+static int bench_visitor(const Polygon_with_holes& scene, unsigned int repeat, unsigned int batch_size,
+                         unsigned int threads_num, unsigned int seed) {
+    Locator locator;
+    init_locator(locator, scene, std::make_shared<Executor>(threads_num));
+
+    std::mt19937 rand(seed);
+    const std::vector<double> ds = random_measurements<double>(rand, batch_size).ds;
+
+    for (unsigned int r = 0; r < repeat; r++) {
+        size_t entries_num = 0, visited_num = 0;
+        double entries_time = measure_ms([&]() {
+            for (double d : ds) {
+                std::vector<Polygon> polygons;
+                for (const auto& res : locator.query(d))
+                    polygons.push_back(res.pos);
+                entries_num += polygons.size();
+            }
+        });
+        double visitor_time = measure_ms([&]() {
+            for (double d : ds) {
+                std::vector<Polygon> polygons;
+                locator.query(d, [&polygons](Locator::Res1dEntry& res) { polygons.push_back(std::move(res.pos)); });
+                visited_num += polygons.size();
+            }
+        });
+        if (entries_num != visited_num)
+            throw std::runtime_error("visitor entries differ from the returned entries");
+        fdml_infoln("[Bench] " << entries_num << " polygons, entries: " << entries_time << "ms, visitor: "
+                               << visitor_time << "ms");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* Read the numbers of a JSON document of nested arrays, in order */
+static std::vector<double> read_json_numbers(const std::string& json) {
+    std::vector<double> numbers;
+    for (const char* p = json.c_str(); *p;) {
+        if (*p == '-' || (*p >= '0' && *p <= '9')) {
+            char* end;
+            numbers.push_back(std::strtod(p, &end));
+            p = end;
+        } else {
+            p++;
+        }
+    }
+    return numbers;
+}
+
+/* Compare writing the JSON results of single and double measurement queries by JsonUtils, which builds the whole
+ * document before pretty printing it, to the streaming JsonResultWriter. The pretty output of the streaming writer must
+ * be identical to the JsonUtils output, and the compact output must read back to the exact coordinates. */
+static int bench_json_writer(const Polygon_with_holes& scene, unsigned int repeat, unsigned int batch_size,
+                             unsigned int seed) {
+    Locator locator;
+    init_locator(locator, scene);
+
+    std::mt19937 rand(seed);
+    const auto measurements = random_measurements(rand, batch_size);
+    const auto& ds = measurements.ds;
+    const auto& ds2 = measurements.ds2;
+    std::vector<Polygon> polygons;
+    std::vector<Segment> segments;
+    for (unsigned int i = 0; i < batch_size; i++) {
+        locator.query(ds[i], [&polygons](Locator::Res1dEntry& res) { polygons.push_back(std::move(res.pos)); });
+        locator.query(ds2[i].first, ds2[i].second, [&segments](Locator::Res2dEntry& res) {
+            segments.insert(segments.end(), res.pos.begin(), res.pos.end());
+        });
+    }
+    std::vector<double> coords;
+    for (const Polygon& polygon : polygons) {
+        for (auto it = polygon.vertices_begin(); it != polygon.vertices_end(); ++it)
+            coords.insert(coords.end(), {CGAL::to_double(it->x()), CGAL::to_double(it->y())});
+    }
+    for (const Segment& segment : segments) {
+        for (const Point& p : {segment.source(), segment.target()})
+            coords.insert(coords.end(), {CGAL::to_double(p.x()), CGAL::to_double(p.y())});
+    }
+
+    auto write_utils = [&](std::ostream& os) {
+        JsonUtils::write_polygons(polygons, os);
+        JsonUtils::write_segments(segments, os);
+    };
+    auto write_streaming = [&](std::ostream& os, JsonResultWriter::Style style, int precision) {
+        JsonResultWriter polygons_writer(os, "polygons", style, precision);
+        for (const Polygon& polygon : polygons)
+            polygons_writer.add_polygon(polygon);
+        polygons_writer.finish();
+        JsonResultWriter segments_writer(os, "segments", style, precision);
+        for (const Segment& segment : segments)
+            segments_writer.add_segment(segment);
+        segments_writer.finish();
+    };
+
+    for (unsigned int r = 0; r < repeat; r++) {
+        std::ostringstream utils_os, pretty_os, compact_os;
+        double utils_time = measure_ms([&]() { write_utils(utils_os); });
+        double pretty_time = measure_ms(
+            [&]() { write_streaming(pretty_os, JsonResultWriter::PRETTY, JsonResultWriter::PRETTY_PRECISION); });
+        double compact_time = measure_ms(
+            [&]() { write_streaming(compact_os, JsonResultWriter::COMPACT, JsonResultWriter::SHORTEST_PRECISION); });
+        if (pretty_os.str() != utils_os.str())
+            throw std::runtime_error("pretty streaming JSON differs from the JsonUtils output");
+        if (read_json_numbers(compact_os.str()) != coords)
+            throw std::runtime_error("compact streaming JSON doesn't read back to the result coordinates");
+
+        const size_t results_num = polygons.size() + segments.size();
+        fdml_infoln("[Bench] " << polygons.size() << " polygons, " << segments.size() << " segments");
+        fdml_infoln("[Bench]\tJsonUtils: " << utils_time << "ms (" << utils_time * 1e6 / results_num
+                                            << "ns per result), " << utils_os.str().size() / 1024 << "KB");
+        fdml_infoln("[Bench]\tstreaming pretty: " << pretty_time << "ms (" << pretty_time * 1e6 / results_num
+                                                   << "ns per result), " << pretty_os.str().size() / 1024 << "KB");
+        fdml_infoln("[Bench]\tstreaming compact: " << compact_time << "ms (" << compact_time * 1e6 / results_num
+                                                    << "ns per result), " << compact_os.str().size() / 1024 << "KB");
+    }
+    return FDML_RETCODE_OK;
+}
+
+/* Compare the static interval index to a boost rtree of 1D boxes, as used before by the locator, on random intervals.
+ * The sizes grow by a factor of 10 from 10^4 up to max_size, and the intervals are spread over a range proportional to
+ * their number, so a stab query reports about the same number of intervals at all sizes */
+static int bench_interval_index(unsigned int repeat, unsigned int queries_num, size_t max_size, unsigned int seed) {
+    typedef boost::geometry::model::point<double, 1, boost::geometry::cs::cartesian> RTreePoint;
+    typedef boost::geometry::model::box<RTreePoint> RTreeSegment;
+    typedef std::pair<RTreeSegment, uint32_t> RTreeValue;
+    typedef boost::geometry::index::rtree<RTreeValue, boost::geometry::index::linear<3>> RTree;
+
+    std::mt19937 rand(seed);
+    std::exponential_distribution<double> length(0.2);
+    for (size_t n = 10000; n <= max_size; n *= 10) {
+        std::uniform_real_distribution<double> position(0.0, n / 100.0);
+        std::vector<IntervalIndex::Interval> intervals(n);
+        for (size_t i = 0; i < n; i++) {
+            const double min = position(rand);
+            intervals[i] = {min, min + length(rand), (uint32_t)i};
+        }
+        std::vector<double> queries(queries_num);
+        for (auto& q : queries)
+            q = position(rand);
+
+        for (unsigned int r = 0; r < repeat; r++) {
+            IntervalIndex index;
+            RTree rtree;
+            double index_build_time = measure_ms([&]() { index.build(intervals); });
+            double rtree_build_time = measure_ms([&]() {
+                for (const auto& interval : intervals)
+                    rtree.insert(RTreeValue(RTreeSegment(RTreePoint(interval.min), RTreePoint(interval.max)),
+                                            interval.id));
+            });
+
+            size_t index_res_num = 0, rtree_res_num = 0;
+            std::vector<IntervalIndex::Interval> index_res;
+            std::vector<RTreeValue> rtree_res;
+            double index_stab_time = measure_ms([&]() {
+                for (double q : queries) {
+                    index_res.clear();
+                    index.stab(q, index_res);
+                    index_res_num += index_res.size();
+                }
+            });
+            double rtree_stab_time = measure_ms([&]() {
+                for (double q : queries) {
+                    rtree_res.clear();
+                    const RTreePoint point(q);
+                    const RTreeSegment query(point, point);
+                    rtree.query(boost::geometry::index::intersects(query), std::back_inserter(rtree_res));
+                    rtree_res_num += rtree_res.size();
+                }
+            });
+            if (index_res_num != rtree_res_num)
+                throw std::logic_error("interval index and rtree results mismatch");
+
+            /* the rtree memory is estimated by its values and a node overhead per max node capacity */
+            const size_t rtree_memory = n * sizeof(RTreeValue) + n / 3 * (sizeof(RTreeSegment) + sizeof(void*));
+            fdml_infoln("[Bench] " << n << " intervals, " << (double)index_res_num / queries_num
+                                   << " results per stab query");
+            fdml_infoln("[Bench]\tindex: build " << index_build_time << "ms, memory " << index.memory_usage() / 1024
+                                                 << "KB, stab " << index_stab_time * 1e6 / queries_num << "ns");
+            fdml_infoln("[Bench]\trtree: build " << rtree_build_time << "ms, memory ~" << rtree_memory / 1024
+                                                 << "KB, stab " << rtree_stab_time * 1e6 / queries_num << "ns");
+        }
+    }
+    return FDML_RETCODE_OK;
+}
+
+int fdml_bench_main(int argc, const char* argv[]) {
+    try {
+        std::string cmd;
+        unsigned int vertices_num, holes_num, seed, repeat, batch_size, threads_num;
+        size_t max_size;
+        bool verify;
+        boost::program_options::options_description desc{"Options"};
+        desc.add_options()("help,h", "Help message");
+        desc.add_options()("cmd", boost::program_options::value<std::string>(&cmd),
+                           "Benchmark [sort_events, snapshot, update, query_batch, query_parallel, query_inexact, "
+                           "clip, tessellation, analytic, candidates, interval_index, range, heading, region, "
+                           "visitor, json_writer]");
+        desc.add_options()("vertices", boost::program_options::value<unsigned int>(&vertices_num)->default_value(200),
+                           "number of vertices in the generated scene");
+        desc.add_options()("holes", boost::program_options::value<unsigned int>(&holes_num)->default_value(4),
+                           "number of holes in the generated scene");
+        desc.add_options()("seed", boost::program_options::value<unsigned int>(&seed)->default_value(0),
+                           "random seed of the generated scene");
+        desc.add_options()("repeat", boost::program_options::value<unsigned int>(&repeat)->default_value(3),
+                           "number of repetitions");
+        desc.add_options()("batch", boost::program_options::value<unsigned int>(&batch_size)->default_value(256),
+                           "number of queries in a batch, or clipping lines");
+        desc.add_options()("threads", boost::program_options::value<unsigned int>(&threads_num)->default_value(0),
+                           "number of threads, 0 for the hardware concurrency");
+        desc.add_options()("max_size", boost::program_options::value<size_t>(&max_size)->default_value(10000000),
+                           "max number of intervals in the interval index benchmark");
+        desc.add_options()("verify", boost::program_options::bool_switch(&verify),
+                           "verify the results against a full rebuild or jittered queries, where supported");
+
+        boost::program_options::variables_map vm;
+        const auto options = boost::program_options::parse_command_line(argc, argv, desc);
+        boost::program_options::store(options, vm);
+        notify(vm);
+
+        if (vm.count("help")) {
+            fdml_info(desc);
+            return FDML_RETCODE_OK;
+        } else if (!vm.count("cmd")) {
+            fdml_errln("The following flags are required: --cmd");
+            return FDML_RETCODE_MISSING_ARGS;
+        }
+
+        Polygon_with_holes scene = generate_scene(vertices_num, holes_num, seed);
+
+        if (cmd == std::string("sort_events")) {
+            return bench_sort_events(scene, repeat);
+        } else if (cmd == std::string("snapshot")) {
+            return bench_snapshot(scene, repeat);
+        } else if (cmd == std::string("update")) {
+            return bench_update(scene, repeat, verify);
+        } else if (cmd == std::string("query_batch")) {
+            return bench_query_batch(scene, repeat, batch_size, threads_num, seed);
+        } else if (cmd == std::string("query_parallel")) {
+            return bench_query_parallel(scene, repeat, threads_num, seed);
+        } else if (cmd == std::string("query_inexact")) {
+            return bench_query_inexact(scene, repeat, batch_size, seed);
+        } else if (cmd == std::string("clip")) {
+            return bench_clip(scene, repeat, batch_size, seed);
+        } else if (cmd == std::string("tessellation")) {
+            return bench_tessellation(scene, batch_size, seed);
+        } else if (cmd == std::string("analytic")) {
+            return bench_analytic(scene, batch_size, seed);
+        } else if (cmd == std::string("candidates")) {
+            return bench_candidates(scene, repeat, batch_size, seed);
+        } else if (cmd == std::string("interval_index")) {
+            return bench_interval_index(repeat, batch_size, max_size, seed);
+        } else if (cmd == std::string("range")) {
+            return bench_range(scene, repeat, batch_size, seed, verify);
+        } else if (cmd == std::string("heading")) {
+            return bench_heading(scene, repeat, batch_size, seed);
+        } else if (cmd == std::string("region")) {
+            return bench_region(scene, repeat, batch_size, seed);
+        } else if (cmd == std::string("visitor")) {
+            return bench_visitor(scene, repeat, batch_size, threads_num, seed);
+        } else if (cmd == std::string("json_writer")) {
+            return bench_json_writer(scene, repeat, batch_size, seed);
+        } else {
+            fdml_infoln("Unknown command: " << cmd);
+            fdml_infoln(desc);
+            return FDML_RETCODE_UNKNOWN_ARGS;
+        }
+    } catch (const std::exception& ex) {
+        fdml_errln(ex.what());
+        return FDML_RETCODE_RUNTIME_ERR;
+    }
+}
+
+} // namespace FDML
+
+int main(int argc, const char* argv[]) {
+    return FDML::fdml_bench_main(argc, argv);
+}
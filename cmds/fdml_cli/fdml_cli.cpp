@@ -12,15 +12,33 @@ int fdml_cli_main(int argc, const char* argv[]) {
         std::string scenefile, cmd;
         std::string resfile;
         double d, d1, d2;
+        unsigned int sectors_num, threads_num, query_threads_num;
+        ResultOptions result_options;
         boost::program_options::options_description desc{"Options"};
         desc.add_options()("help,h", "Help message");
-        desc.add_options()("scenefile", boost::program_options::value<std::string>(&scenefile), "Scene file");
-        desc.add_options()("cmd", boost::program_options::value<std::string>(&cmd), "Command [query1, query2]");
+        desc.add_options()("scenefile", boost::program_options::value<std::string>(&scenefile),
+                           "Scene file, or a preprocessed snapshot file");
+        desc.add_options()("cmd", boost::program_options::value<std::string>(&cmd),
+                           "Command [preprocess, query1, query2]");
         desc.add_options()("d", boost::program_options::value<double>(&d), "single measurement value");
         desc.add_options()("d1", boost::program_options::value<double>(&d1), "first value of double measurement query");
         desc.add_options()("d2", boost::program_options::value<double>(&d2),
                            "second value of double measurement query");
-        desc.add_options()("out", boost::program_options::value<std::string>(&resfile), "Output file for results");
+        desc.add_options()("out", boost::program_options::value<std::string>(&resfile),
+                           "Output file for results, or for the snapshot of the preprocess command");
+        desc.add_options()("sectors", boost::program_options::value<unsigned int>(&sectors_num)->default_value(1),
+                           "number of angle sectors the preprocessing is split into");
+        desc.add_options()("threads", boost::program_options::value<unsigned int>(&threads_num)->default_value(0),
+                           "number of preprocessing threads, 0 for the hardware concurrency");
+        desc.add_options()("query-threads",
+                           boost::program_options::value<unsigned int>(&query_threads_num)->default_value(1),
+                           "number of threads evaluating the query, 0 for the hardware concurrency");
+        desc.add_options()("inexact", boost::program_options::bool_switch(&result_options.inexact),
+                           "compute the result curves in double arithmetic");
+        desc.add_options()("tolerance", boost::program_options::value<double>(&result_options.tolerance),
+                           "maximum distance between a result curve and its approximation, 0 for a fixed sampling");
+        desc.add_options()("parametric", boost::program_options::bool_switch(&result_options.parametric),
+                           "represent each result curve only by the chord between its end points");
 
         boost::program_options::variables_map vm;
         const auto options = boost::program_options::parse_command_line(argc, argv, desc);
@@ -28,6 +46,7 @@ int fdml_cli_main(int argc, const char* argv[]) {
         notify(vm);
 
         enum command_type_t {
+            CMD_PREPROCESS,
             CMD_QUERY1,
             CMD_QUERY2,
         } command_type;
@@ -37,6 +56,8 @@ int fdml_cli_main(int argc, const char* argv[]) {
         else if (!vm.count("scenefile") || !vm.count("cmd") || !vm.count("out")) {
             fdml_errln("The following flags are required: --scenefile --cmd --out");
             return FDML_RETCODE_MISSING_ARGS;
+        } else if (cmd == std::string("preprocess")) {
+            command_type = CMD_PREPROCESS;
         } else if (cmd == std::string("query1")) {
             if (!vm.count("d")) {
                 fdml_errln("The following flags are required: --d");
@@ -57,22 +78,30 @@ int fdml_cli_main(int argc, const char* argv[]) {
             return FDML_RETCODE_UNKNOWN_ARGS;
         }
 
-        Polygon_with_holes scene = JsonUtils::read_scene(scenefile);
-
         Locator locator;
-        locator.init(scene);
+        if (Locator::is_snapshot(scenefile)) {
+            locator.load(scenefile);
+        } else {
+            Polygon_with_holes scene = JsonUtils::read_scene(scenefile);
+            locator.init(scene, sectors_num, threads_num);
+        }
+        if (query_threads_num != 1)
+            locator.set_executor(std::make_shared<Executor>(query_threads_num));
 
         std::vector<Polygon> polygons;
         std::vector<Segment> segments;
 
         switch (command_type) {
+        case CMD_PREPROCESS:
+            locator.save(resfile);
+            break;
         case CMD_QUERY1:
-            for (const auto& res : locator.query(d))
+            for (const auto& res : locator.query(d, result_options))
                 polygons.push_back(std::move(res.pos));
             JsonUtils::write_polygons(polygons, resfile);
             break;
         case CMD_QUERY2:
-            for (const auto& res : locator.query(d1, d2))
+            for (const auto& res : locator.query(d1, d2, result_options))
                 segments.insert(segments.end(), res.pos.begin(), res.pos.end());
             JsonUtils::write_segments(segments, resfile);
             break;
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "fdml/internal/utils.hpp"
+#include "fdml/locator_client.hpp"
+#include "fdml/retcode.hpp"
+
+namespace FDML {
+
+struct ClientOptions {
+    std::string socket_path;
+    unsigned int port = 0;
+    std::string request;
+    unsigned int repeat = 1;
+};
+
+static void connect(LocatorClient& client, const ClientOptions& opts) {
+    if (!opts.socket_path.empty())
+        client.connect_unix(opts.socket_path);
+    else
+        client.connect_tcp(opts.port);
+}
+
+/* Send the request repeatedly from concurrent clients, each with its own connection, and report the throughput and
+ * the round trip latency of all the requests */
+static void bench_clients(const ClientOptions& opts, unsigned int clients_num) {
+    std::vector<double> latencies;
+    std::mutex latencies_mutex;
+    std::exception_ptr error;
+    auto client_main = [&]() {
+        try {
+            LocatorClient client;
+            connect(client, opts);
+            std::vector<double> client_latencies;
+            std::string output;
+            for (unsigned int r = 0; r < opts.repeat; r++) {
+                auto begin = std::chrono::steady_clock::now();
+                int ret = client.request(opts.request, output);
+                auto end = std::chrono::steady_clock::now();
+                if (ret != FDML_RETCODE_OK)
+                    throw std::runtime_error("request failed with return code " + std::to_string(ret));
+                client_latencies.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+            }
+            std::lock_guard<std::mutex> lock(latencies_mutex);
+            latencies.insert(latencies.end(), client_latencies.begin(), client_latencies.end());
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(latencies_mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+    };
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (unsigned int c = 0; c < clients_num; c++)
+        clients.emplace_back(client_main);
+    for (auto& client : clients)
+        client.join();
+    auto end = std::chrono::steady_clock::now();
+    if (error)
+        std::rethrow_exception(error);
+
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double latency : latencies)
+        sum += latency;
+    auto percentile = [&latencies](double p) { return latencies[(size_t)(p * (latencies.size() - 1))]; };
+    const double seconds = std::chrono::duration<double>(end - begin).count();
+    fdml_infoln("[Client] " << clients_num << " clients, " << latencies.size() << " requests, "
+                            << latencies.size() / seconds << " requests/sec, round trip latency (us): min "
+                            << latencies.front() << ", mean " << sum / latencies.size() << ", p50 "
+                            << percentile(0.5) << ", p99 " << percentile(0.99) << ", max " << latencies.back());
+}
+
+int fdml_client_main(int argc, const char* argv[]) {
+    try {
+        ClientOptions opts;
+        std::vector<unsigned int> clients_nums;
+        boost::program_options::options_description desc{"Options"};
+        desc.add_options()("help,h", "Help message");
+        desc.add_options()("socket", boost::program_options::value<std::string>(&opts.socket_path),
+                           "Unix domain socket of the daemon");
+        desc.add_options()("port", boost::program_options::value<unsigned int>(&opts.port),
+                           "TCP loopback port of the daemon");
+        desc.add_options()("request", boost::program_options::value<std::string>(&opts.request),
+                           "Command line of the request, for example \"--cmd query1 --d 5.7\"");
+        desc.add_options()("repeat", boost::program_options::value<unsigned int>(&opts.repeat)->default_value(1),
+                           "Number of times the request is sent. If greater than 1, the round trip latency is reported "
+                           "instead of the output");
+        desc.add_options()("clients",
+                           boost::program_options::value<std::vector<unsigned int>>(&clients_nums)->multitoken(),
+                           "Numbers of concurrent clients, each sending the request --repeat times. The requests/sec "
+                           "and the latency are reported for each number of clients");
+
+        boost::program_options::variables_map vm;
+        const auto options = boost::program_options::parse_command_line(argc, argv, desc);
+        boost::program_options::store(options, vm);
+        notify(vm);
+
+        if (vm.count("help")) {
+            fdml_info(desc);
+            return FDML_RETCODE_OK;
+        } else if ((!vm.count("socket") && !vm.count("port")) || !vm.count("request")) {
+            fdml_errln("The following flags are required: --socket or --port, --request");
+            return FDML_RETCODE_MISSING_ARGS;
+        }
+
+        if (!clients_nums.empty() || opts.repeat > 1) {
+            if (clients_nums.empty())
+                clients_nums.push_back(1);
+            for (unsigned int clients_num : clients_nums)
+                bench_clients(opts, std::max(1u, clients_num));
+            return FDML_RETCODE_OK;
+        }
+
+        LocatorClient client;
+        connect(client, opts);
+        std::string output;
+        int ret = client.request(opts.request, output);
+        std::cout << output;
+        return ret;
+    } catch (const std::exception& ex) {
+        fdml_errln(ex.what());
+        return FDML_RETCODE_RUNTIME_ERR;
+    }
+}
+
+} // namespace FDML
+
+int main(int argc, const char* argv[]) {
+    return FDML::fdml_client_main(argc, argv);
+}
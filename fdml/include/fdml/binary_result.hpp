@@ -0,0 +1,130 @@
+#ifndef FDML_BINARY_RESULT_HPP
+#define FDML_BINARY_RESULT_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "fdml/config.hpp"
+#include "fdml/defs.hpp"
+
+namespace FDML {
+
+/**
+ * @brief Writer of the compact binary encoding of query results, an alternative to the JSON output
+ *
+ * A result starts with a 24 bytes header: the magic "FDMR", a 32 bit version, a 32 bit result type, 32 reserved bits
+ * and a 64 bit number of records. Each record starts with the IDs of the edges it was measured at, as in the scene
+ * topology (see Locator::get_edge()), followed by its points as packed float64 (x, y) pairs:
+ *  - POLYGONS: edge, vertices number, and the vertices of the polygon
+ *  - SEGMENTS: edge1, edge2, segments number, 32 reserved bits, and the source and target of each segment
+ *  - POINTS: edge1, edge2 of the first double measurement, edge3, edge4 of the second one, and a single point
+ * All the integers and floats are little endian, and all the records are aligned to 8 bytes.
+ *
+ * The records are encoded into a memory buffer as they are added, and the result is written by a single write.
+ */
+class FDML_FDML_DECL BinaryResultWriter {
+  public:
+    enum Type : uint32_t {
+        POLYGONS = 1,
+        SEGMENTS = 2,
+        POINTS = 3,
+    };
+
+  private:
+    Type type;
+    std::string buf;
+    uint64_t records_num = 0;
+
+  public:
+    /**
+     * @brief Create a writer of a result with records of a single type
+     *
+     * @param type the records type
+     */
+    explicit BinaryResultWriter(Type type);
+
+    /**
+     * @brief Add a single measurement record, the result type must be POLYGONS
+     *
+     * @param edge the measured edge ID
+     * @param polygon the area of the positions
+     */
+    void add_polygon(uint32_t edge, const Polygon& polygon);
+
+    /**
+     * @brief Add a double measurement record, the result type must be SEGMENTS
+     *
+     * @param edge1 the edge ID of the first measurement
+     * @param edge2 the edge ID of the second measurement
+     * @param segments the positions
+     */
+    void add_segments(uint32_t edge1, uint32_t edge2, const std::vector<Segment>& segments);
+
+    /**
+     * @brief Add a record of a position of two double measurements, the result type must be POINTS
+     *
+     * @param edge1 the edge ID of the first measurement of the first double measurement
+     * @param edge2 the edge ID of the second measurement of the first double measurement
+     * @param edge3 the edge ID of the first measurement of the second double measurement
+     * @param edge4 the edge ID of the second measurement of the second double measurement
+     * @param point the position
+     */
+    void add_point(uint32_t edge1, uint32_t edge2, uint32_t edge3, uint32_t edge4, const Point& point);
+
+    /**
+     * @brief Get the encoded result, including the records added so far
+     */
+    const std::string& data();
+
+    /**
+     * @brief Write the encoded result into a stream, by a single write
+     *
+     * @param os output stream, should be opened in binary mode
+     */
+    void write(std::ostream& os);
+
+  private:
+    char* append(size_t size);
+    void check_type(Type record_type) const;
+};
+
+/**
+ * @brief A decoded binary result, see BinaryResultWriter for the format
+ */
+struct FDML_FDML_DECL BinaryResult {
+    struct Record {
+        /* the edge IDs: one for polygons, two for segments and four for points */
+        std::vector<uint32_t> edges;
+        /* the points as x, y pairs. The vertices of a polygon, the source and target of each segment, or a single
+         * point */
+        std::vector<double> coords;
+    };
+
+    BinaryResultWriter::Type type;
+    std::vector<Record> records;
+
+    /**
+     * @brief Decode a binary result from a memory buffer
+     *
+     * @param data the encoded result
+     * @param size the size of the encoded result in bytes
+     * @return the decoded result
+     * @throws std::runtime_error if the buffer is not a valid binary result
+     */
+    static BinaryResult parse(const char* data, size_t size);
+
+    /**
+     * @brief Decode a binary result from a file
+     *
+     * @param filename path to a file written by BinaryResultWriter
+     * @return the decoded result
+     * @throws std::runtime_error if the file can't be read or is not a valid binary result
+     */
+    static BinaryResult read(const std::string& filename);
+};
+
+} // namespace FDML
+
+#endif
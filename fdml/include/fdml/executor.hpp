@@ -0,0 +1,97 @@
+#ifndef FDML_EXECUTOR_HPP
+#define FDML_EXECUTOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fdml/config.hpp"
+
+namespace FDML {
+
+/**
+ * @brief Executor of data parallel loops, either inline in the calling thread or by an internal pool of threads
+ *
+ * A loop is split into chunks, which are distributed evenly among the queues of the pool threads and the calling
+ * thread. A thread which finished its own chunks steals chunks from the queues of the other threads. Only a single
+ * loop is executed at a time, and a loop issued from within a loop task is executed inline.
+ */
+class FDML_FDML_DECL Executor {
+  private:
+    struct Range {
+        size_t begin, end;
+    };
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+    };
+
+    std::vector<std::thread> threads;
+    /* a queue for each pool thread, and a last one for the calling thread */
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+    /* allows a single loop at a time */
+    std::mutex run_mutex;
+    std::mutex mutex;
+    std::condition_variable job_cv;
+    std::condition_variable done_cv;
+    const std::function<void(size_t, size_t)>* job;
+    uint64_t job_generation;
+    std::atomic<size_t> pending_chunks;
+    std::atomic<bool> failed;
+    std::exception_ptr error;
+    bool stop;
+
+  public:
+    /**
+     * @brief Create an inline executor, executing loops in the calling thread
+     */
+    Executor();
+
+    /**
+     * @brief Create an executor with an internal pool of threads
+     *
+     * @param threads_num total number of threads executing a loop, including the calling thread. 0 for the hardware
+     * concurrency, 1 for an inline executor.
+     */
+    explicit Executor(unsigned int threads_num);
+
+    ~Executor();
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    /**
+     * @brief Get the number of threads executing a loop, including the calling thread
+     *
+     * @return the number of threads
+     */
+    unsigned int get_threads_num() const;
+
+    /**
+     * @brief Execute a loop over [0, n) in chunks
+     *
+     * The operation is called once for each chunk [k * chunk_size, min(n, (k + 1) * chunk_size)), in an unspecified
+     * order and possibly concurrently. If any of the operations throws, the remaining chunks are skipped and the first
+     * exception is rethrown after all running operations finished.
+     *
+     * @param n number of iterations
+     * @param chunk_size number of iterations in a chunk
+     * @param op operation receiving a chunk range [begin, end)
+     */
+    void parallel_for(size_t n, size_t chunk_size, const std::function<void(size_t, size_t)>& op);
+
+  private:
+    void worker_main(unsigned int worker);
+    bool pop_range(unsigned int worker, Range& range);
+    bool run_chunk(unsigned int worker);
+};
+
+} // namespace FDML
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef FDML_CURVE_SAMPLING_HPP
+#define FDML_CURVE_SAMPLING_HPP
+
+#ifndef M_PI
+// windows
+#define _USE_MATH_DEFINES
+#include <cmath>
+#endif
+#include <math.h>
+
+#include <algorithm>
+
+#include "fdml/defs.hpp"
+#include "fdml/trapezoid.hpp"
+
+namespace FDML {
+
+/* We use a polygon approximation to repsent the complex curves of the result. These defines determine the percision of
+ * the approximation. All approximations are done by discretizing the angle. The defines below define how many discrete
+ * step will be used in a 2*PI angle, relative approximation will be used for other angles. */
+static const unsigned int ARC_APPX_POINTS_NUM = 360;
+static const unsigned int CONCHOID_APPX_POINTS_NUM = 360;
+static const unsigned int ELLIPSE_APPX_POINTS_NUM = 360;
+
+/* Upper bound on the number of segments approximating a single curve with a tolerance */
+static const unsigned int MAX_APPX_POINTS_NUM = 1 << 16;
+
+/* Calculate the number of segments approximating a curve over an angle range. With a tolerance, the number is chosen
+ * such that the chords deviate from the curve by at most the tolerance, using the bound curvature_bound on the second
+ * derivative of the curve by the angle, as a chord over an angle step s deviates by at most s^2 * curvature_bound / 8.
+ * Otherwise, points_per_turn samples are used for a full turn. */
+inline unsigned int calc_appx_num(double angle_range, unsigned int points_per_turn, double curvature_bound,
+                                  const ResultOptions& options) {
+    if (options.parametric)
+        return 1;
+    if (options.tolerance > 0) {
+        double appx_num = std::ceil(std::abs(angle_range) * std::sqrt(curvature_bound / (8 * options.tolerance)));
+        return (unsigned int)std::max(1.0, std::min(appx_num, (double)MAX_APPX_POINTS_NUM));
+    }
+    return (unsigned int)((std::abs(angle_range) / (M_PI * 2)) * points_per_turn);
+}
+
+/* Double approximation of a line a*x + b*y + c = 0 */
+struct InexactLine {
+    double a, b, c;
+
+    InexactLine(const Line& l) : a(CGAL::to_double(l.a())), b(CGAL::to_double(l.b())), c(CGAL::to_double(l.c())) {}
+
+    double eval(double x, double y) const { return a * x + b * y + c; }
+};
+
+/* angle of a direction in [0, 2 * PI) */
+inline double direction_angle_inexact(const Direction& dir) {
+    double z = std::atan2(CGAL::to_double(dir.dy()), CGAL::to_double(dir.dx()));
+    return z < 0 ? z + 2 * M_PI : z;
+}
+
+/* counter clockwise angle from a begin direction to an end direction, in [0, 2 * PI) */
+inline double angle_between_inexact(const Direction& begin, const Direction& end) {
+    double r = direction_angle_inexact(end) - direction_angle_inexact(begin);
+    return r < 0 ? r + 2 * M_PI : r;
+}
+
+/* Bound the second derivative by the angle of a conchoid branch vertex + u(a) * (d + t(a)), where t(a) is the signed
+ * distance along the unit direction u(a) from the vertex to the top edge line. In polar form r(a) = d - h / cos(p)
+ * where p is the angle between u(a) and the line normal, and |p''(a)| <= |r'' - r| + 2|r'|, which is monotone in |p|.
+ * The angle interval doesn't contain the normal direction, so the bound is achieved at one of its ends. */
+inline double conchoid_curvature_bound(const InexactLine& top_line, double vx, double vy, double d, double a_begin,
+                                       double angle_range) {
+    const double normal_len = std::sqrt(top_line.a * top_line.a + top_line.b * top_line.b);
+    const double h = top_line.eval(vx, vy) / normal_len, normal_angle = std::atan2(top_line.b, top_line.a);
+    double bound = 0;
+    for (double a : {a_begin, a_begin + angle_range}) {
+        double sec = 1 / std::cos(a - normal_angle), tan = std::tan(a - normal_angle);
+        double r = d - h * sec, r1 = -h * sec * tan, r2 = -h * (sec * tan * tan + sec * sec * sec);
+        bound = std::max(bound, std::abs(r2 - r) + 2 * std::abs(r1));
+    }
+    return bound;
+}
+
+} // namespace FDML
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef FDML_HALF_PLANE_CLIPPER_HPP
+#define FDML_HALF_PLANE_CLIPPER_HPP
+
+#include <vector>
+
+#include "fdml/config.hpp"
+#include "fdml/defs.hpp"
+
+namespace FDML {
+
+/**
+ * @brief Clipping of simple polygons by a half plane
+ *
+ * The clipper is a variant of the Sutherland-Hodgman algorithm which supports non convex polygons. The polygon
+ * boundary is walked once, splitting it into chains within the half plane, which are connected along the line into
+ * the pieces of the intersection. All the predicates are exact.
+ */
+class FDML_FDML_DECL HalfPlaneClipper {
+  public:
+    /**
+     * @brief Intersect a simple polygon with a half plane
+     *
+     * The intersection is considered as an open set, namely pieces touching each other only at a point on the line
+     * are returned as different polygons.
+     *
+     * @param poly a simple polygon, in any orientation
+     * @param line the line defining the half plane, the half plane is the positive (left) side of the line
+     * @return the pieces of the intersection, each a simple polygon in counter clockwise orientation
+     */
+    static std::vector<Polygon> clip(const Polygon& poly, const Line& line);
+
+    /**
+     * @brief Intersect a simple polygon with a half plane using a general arrangement
+     *
+     * This is the reference implementation, slower by orders of magnitude, and should be used only to verify clip().
+     *
+     * @param poly a simple polygon, in counter clockwise orientation
+     * @param line the line defining the half plane, the half plane is the positive (left) side of the line
+     * @return the pieces of the intersection, each a simple polygon in counter clockwise orientation
+     */
+    static std::vector<Polygon> clip_by_arrangement(const Polygon& poly, const Line& line);
+};
+
+} // namespace FDML
+
+#endif
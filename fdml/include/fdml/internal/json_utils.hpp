@@ -1,6 +1,7 @@
 #ifndef FDML_JSON_UTILS_HPP
 #define FDML_JSON_UTILS_HPP
 
+#include <ostream>
 #include <vector>
 
 #include "fdml/config.hpp"
@@ -26,6 +27,14 @@ class FDML_FDML_DECL JsonUtils {
      */
     static void write_polygons(const std::vector<Polygon>& polygons, const std::string& filename);
 
+    /**
+     * @brief Write polygons as JSON into a stream
+     *
+     * @param polygons list of polygons
+     * @param os output stream
+     */
+    static void write_polygons(const std::vector<Polygon>& polygons, std::ostream& os);
+
     /**
      * @brief Write segments into a JSON file
      *
@@ -34,7 +43,16 @@ class FDML_FDML_DECL JsonUtils {
      */
     static void write_segments(const std::vector<Segment>& segments, const std::string& filename);
 
+    /**
+     * @brief Write segments as JSON into a stream
+     *
+     * @param segments list of segments
+     * @param os output stream
+     */
+    static void write_segments(const std::vector<Segment>& segments, std::ostream& os);
+
     static void write_points(const std::vector<Point>& points, const std::string& filename);
+    static void write_points(const std::vector<Point>& points, std::ostream& os);
 
 };
 
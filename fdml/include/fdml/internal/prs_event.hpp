@@ -0,0 +1,172 @@
+#ifndef FDML_PRS_EVENT_HPP
+#define FDML_PRS_EVENT_HPP
+
+#include <utility>
+#include <vector>
+
+#include <CGAL/Interval_nt.h>
+
+#include "fdml/defs.hpp"
+
+namespace FDML {
+
+/* An event that should be handled during a parallel rotational sweep. The event
+ * is composed as two vertices that align on the same line for some angle.
+ */
+class Event {
+  public:
+    /* the ray base vertex */
+    Vertex v1;
+    /* the ray end vertex */
+    Vertex v2;
+    /* the vertices indices */
+    unsigned int v1_id, v2_id;
+
+    Event(const Vertex& v1, const Vertex& v2, unsigned int v1_id, unsigned int v2_id)
+        : v1(v1), v2(v2), v1_id(v1_id), v2_id(v2_id) {}
+
+    Direction get_ray() const {
+        const Point &p1 = v1->point(), &p2 = v2->point();
+        return Direction(p2.x() - p1.x(), p2.y() - p1.y());
+    }
+};
+
+/* Compare two directions by the order they are encountered during the parallel rotational sweep, which starts at
+ * the y-axis direction and continue counter clockwise */
+inline bool angle_less(const Direction& a1, const Direction& a2) {
+    if (a1 == a2)
+        return false;
+
+    Line y_axis({0, 0}, Point(0, 1));
+    CGAL::Oriented_side a1_side = y_axis.oriented_side({a1.dx(), a1.dy()});
+    CGAL::Oriented_side a2_side = y_axis.oriented_side({a2.dx(), a2.dy()});
+
+    if (a1_side == CGAL::ON_ORIENTED_BOUNDARY)
+        return a2_side == CGAL::ON_NEGATIVE_SIDE ||
+               (a1.dy() >= 0 && (a2_side == CGAL::ON_POSITIVE_SIDE || a2.dy() < 0));
+    if (a2_side == CGAL::ON_ORIENTED_BOUNDARY)
+        return a1_side == CGAL::ON_POSITIVE_SIDE && a2.dy() < 0;
+    if (a1_side == CGAL::ON_POSITIVE_SIDE)
+        return ((a2_side == CGAL::ON_NEGATIVE_SIDE) ||
+                (Line({0, 0}, a2).oriented_side({a1.dx(), a1.dy()}) == CGAL::ON_NEGATIVE_SIDE));
+    // a1_side == CGAL::ON_NEGATIVE_SIDE
+    return ((a2_side == CGAL::ON_NEGATIVE_SIDE) &&
+            (Line({0, 0}, a2).oriented_side({a1.dx(), a1.dy()}) == CGAL::ON_NEGATIVE_SIDE));
+}
+
+/* A filtered key of an angle, allowing to compare most angles in the sweep order using double arithmetic only */
+class AngleKey {
+  public:
+    typedef CGAL::Interval_nt<> Interval;
+
+    /* The half plane of the angle in the sweep order: the y-axis direction, the left half plane, the negative y-axis
+     * direction and the right half plane. UNKNOWN if it can't be determined using the double approximation. */
+    enum Half { Y_AXIS = 0, LEFT = 1, NEGATIVE_Y_AXIS = 2, RIGHT = 3, UNKNOWN = 4 };
+
+    Half half;
+    /* Bounds on the slope dy/dx of the angle, which is increasing within each of the left and right half planes */
+    double slope_inf, slope_sup;
+
+    AngleKey() : half(UNKNOWN), slope_inf(0), slope_sup(0) {}
+
+    AngleKey(const Interval& dx, const Interval& dy) : half(UNKNOWN), slope_inf(0), slope_sup(0) {
+        if (dx.inf() > 0 || dx.sup() < 0) {
+            half = dx.inf() > 0 ? RIGHT : LEFT;
+            Interval slope = dy / dx;
+            slope_inf = slope.inf();
+            slope_sup = slope.sup();
+        } else if (dx.inf() == 0 && dx.sup() == 0 && (dy.inf() > 0 || dy.sup() < 0)) {
+            half = dy.inf() > 0 ? Y_AXIS : NEGATIVE_Y_AXIS;
+        }
+    }
+
+    explicit AngleKey(const Direction& dir) : AngleKey(CGAL::to_interval(dir.dx()), CGAL::to_interval(dir.dy())) {}
+
+    /* Compare two keys, returning CGAL::SMALLER or CGAL::LARGER if the order of the angles is certain, and
+     * CGAL::EQUAL if it can't be determined, in which case an exact comparison is required */
+    static CGAL::Comparison_result compare(const AngleKey& k1, const AngleKey& k2) {
+        if (k1.half == UNKNOWN || k2.half == UNKNOWN)
+            return CGAL::EQUAL;
+        if (k1.half != k2.half)
+            return k1.half < k2.half ? CGAL::SMALLER : CGAL::LARGER;
+        if (k1.half == LEFT || k1.half == RIGHT) {
+            if (k1.slope_sup < k2.slope_inf)
+                return CGAL::SMALLER;
+            if (k1.slope_inf > k2.slope_sup)
+                return CGAL::LARGER;
+        }
+        return CGAL::EQUAL;
+    }
+};
+
+/* Compare two events, given as pairs of vertices indices, by the order they should be handled during the parallel
+ * rotational sweep. The order is total, events on the exact same angle are ordered by the distance between their
+ * vertices and than by the vertices indices. The comparison is performed on the events filtered keys, and exact
+ * predicates are used only if the filtered comparison is uncertain. */
+class EventLess {
+  public:
+    typedef std::pair<unsigned int, unsigned int> VerticesPair;
+
+    /* An event with a precomputed filtered key of its angle */
+    struct KeyedEvent {
+        VerticesPair vertices;
+        AngleKey key;
+    };
+
+  private:
+    const std::vector<Vertex>& vertices;
+    /* double approximations of the vertices coordinates */
+    std::vector<std::pair<AngleKey::Interval, AngleKey::Interval>> points;
+
+  public:
+    EventLess(const std::vector<Vertex>& vertices) : vertices(vertices) {
+        points.reserve(vertices.size());
+        for (const auto& v : vertices)
+            points.emplace_back(CGAL::to_interval(v->point().x()), CGAL::to_interval(v->point().y()));
+    }
+
+    Direction get_ray(const VerticesPair& e) const {
+        return Event(vertices[e.first], vertices[e.second], e.first, e.second).get_ray();
+    }
+
+    KeyedEvent get_keyed(const VerticesPair& e) const {
+        const auto &p1 = points[e.first], &p2 = points[e.second];
+        return {e, AngleKey(p2.first - p1.first, p2.second - p1.second)};
+    }
+
+    bool operator()(const KeyedEvent& e1, const KeyedEvent& e2) const {
+        CGAL::Comparison_result res = AngleKey::compare(e1.key, e2.key);
+        if (res != CGAL::EQUAL)
+            return res == CGAL::SMALLER;
+        return exact_less(e1.vertices, e2.vertices);
+    }
+
+    bool operator()(const VerticesPair& e1, const VerticesPair& e2) const {
+        return (*this)(get_keyed(e1), get_keyed(e2));
+    }
+
+    /* Compare only the angles of two events, events on the exact same angle are considered equal */
+    bool angle_less(const KeyedEvent& e1, const KeyedEvent& e2) const {
+        CGAL::Comparison_result res = AngleKey::compare(e1.key, e2.key);
+        if (res != CGAL::EQUAL)
+            return res == CGAL::SMALLER;
+        return FDML::angle_less(get_ray(e1.vertices), get_ray(e2.vertices));
+    }
+
+    /* Compare two events using exact predicates only */
+    bool exact_less(const VerticesPair& e1, const VerticesPair& e2) const {
+        if (e1 == e2)
+            return false;
+        auto a1 = get_ray(e1), a2 = get_ray(e2);
+        if (a1 == a2) {
+            /* Both are exactly on the same angle, consider further vertices first */
+            auto l1 = a1.vector().squared_length(), l2 = a2.vector().squared_length();
+            return l1 != l2 ? l1 > l2 : e1 < e2;
+        }
+        return FDML::angle_less(a1, a2);
+    }
+};
+
+} // namespace FDML
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef FDML_SOCKET_FRAMES_HPP
+#define FDML_SOCKET_FRAMES_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace FDML {
+
+/* Encoding of the 32 bit big endian integers of the locator server frames, see LocatorServer */
+
+inline void append_frame_u32(std::string& buf, uint32_t x) {
+    const char bytes[4] = {(char)(x >> 24), (char)(x >> 16), (char)(x >> 8), (char)x};
+    buf.append(bytes, 4);
+}
+
+inline uint32_t read_frame_u32(const char* bytes) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(bytes);
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | (uint32_t)b[3];
+}
+
+} // namespace FDML
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef FDML_TOPOLOGY_HPP
+#define FDML_TOPOLOGY_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "fdml/config.hpp"
+#include "fdml/defs.hpp"
+
+namespace FDML {
+
+/**
+ * @brief Flat, index based view of the topology of an arrangement
+ *
+ * Vertices, halfedges and faces are assigned dense IDs, and the adjacency is stored in compressed arrays, so
+ * algorithms iterating over the arrangement many times can keep their bookkeeping in plain vectors indexed by IDs.
+ * The two halfedges of an edge have consecutive IDs, and an edge twin ID differs only in its lowest bit.
+ */
+class FDML_FDML_DECL Topology {
+  public:
+    typedef unsigned int VertexID;
+    typedef unsigned int EdgeID;
+    typedef unsigned int FaceID;
+    static const unsigned int INVALID_ID = 0xffffffff;
+
+  private:
+    std::vector<Vertex> vertices;
+    std::vector<Halfedge> edges;
+    std::vector<VertexID> edges_source;
+    std::vector<FaceID> edges_face;
+    /* is free bit for each face */
+    std::vector<bool> free_faces;
+    /* the halfedges going out of vertex v are out_edges[out_edges_offsets[v]..out_edges_offsets[v + 1]] */
+    std::vector<unsigned int> out_edges_offsets;
+    std::vector<EdgeID> out_edges;
+    /* map of (source, target) -> halfedge */
+    std::unordered_map<uint64_t, EdgeID> edges_lookup;
+    /* maps of handles to IDs, used to convert handles received from the arrangement */
+    std::unordered_map<Vertex, VertexID> vertices_ids;
+    std::unordered_map<Halfedge, EdgeID> edges_ids;
+    std::unordered_map<Face, FaceID> faces_ids;
+
+  public:
+    Topology() {}
+
+    /**
+     * @brief Build the topology of an arrangement
+     *
+     * A face is considered free if it is bounded and contained in the polygon set of the arrangement.
+     *
+     * @param arr the polygon set arrangement
+     */
+    void build(const Arrangement& arr);
+
+    size_t number_of_vertices() const { return vertices.size(); }
+    size_t number_of_edges() const { return edges.size(); }
+    size_t number_of_faces() const { return free_faces.size(); }
+
+    const std::vector<Vertex>& get_vertices() const { return vertices; }
+    const Vertex& vertex(VertexID v) const { return vertices[v]; }
+    const Halfedge& edge(EdgeID e) const { return edges[e]; }
+
+    VertexID vertex_id(const Vertex& v) const { return vertices_ids.at(v); }
+    EdgeID edge_id(const Halfedge& e) const { return edges_ids.at(e); }
+    FaceID face_id(const Face& f) const { return faces_ids.at(f); }
+
+    static EdgeID twin(EdgeID e) { return e ^ 1; }
+    /* ID of an edge ignoring its direction, in the range [0, number_of_edges() / 2) */
+    static unsigned int undirected_id(EdgeID e) { return e >> 1; }
+
+    VertexID source(EdgeID e) const { return edges_source[e]; }
+    VertexID target(EdgeID e) const { return edges_source[twin(e)]; }
+    FaceID face(EdgeID e) const { return edges_face[e]; }
+    bool is_free_face(FaceID f) const { return free_faces[f]; }
+    /* check if the face to the left of a halfedge is free */
+    bool is_free_edge(EdgeID e) const { return free_faces[edges_face[e]]; }
+
+    const EdgeID* out_edges_begin(VertexID v) const { return out_edges.data() + out_edges_offsets[v]; }
+    const EdgeID* out_edges_end(VertexID v) const { return out_edges.data() + out_edges_offsets[v + 1]; }
+    unsigned int degree(VertexID v) const { return out_edges_offsets[v + 1] - out_edges_offsets[v]; }
+
+    /**
+     * @brief Find the halfedge between two vertices
+     *
+     * @param source the source vertex of the halfedge
+     * @param target the target vertex of the halfedge
+     * @param res output result
+     * @return true if found, else false
+     */
+    bool find_edge(VertexID source, VertexID target, EdgeID& res) const;
+
+    /**
+     * @brief Get an estimate of the number of bytes used by the topology
+     */
+    size_t memory_usage() const;
+
+  private:
+    static uint64_t edge_key(VertexID source, VertexID target) { return ((uint64_t)source << 32) | target; }
+};
+
+} // namespace FDML
+
+#endif
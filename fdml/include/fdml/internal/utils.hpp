@@ -18,6 +18,10 @@ namespace FDML {
 
 static const bool DEBUG_PRINT_EN = false;
 
+/* Estimated heap bytes of the shared representation of a kernel object, which holds an interval approximation and a
+ * pointer to the exact value. Used by the memory usage estimations, exact values computed on demand are not counted. */
+static const size_t LAZY_REP_BYTES = 64;
+
 #define fdml_info(args)                                                                                                \
     do {                                                                                                               \
         std::cout << args;                                                                                             \
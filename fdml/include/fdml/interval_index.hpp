@@ -0,0 +1,91 @@
+#ifndef FDML_INTERVAL_INDEX_HPP
+#define FDML_INTERVAL_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fdml/config.hpp"
+
+namespace FDML {
+
+/**
+ * @brief A static index of closed intervals, supporting stabbing and range queries
+ *
+ * The intervals are sorted by their min, and stored in a structure of arrays layout split into fixed size blocks. A
+ * complete binary tree over the blocks, stored in breadth first order, holds the max of the intervals max values in
+ * each subtree. A query finds the prefix of intervals with a small enough min by a binary search, and descends only
+ * into subtrees of the prefix with a large enough max. The intervals of a reached block are checked by a branch free
+ * scan, which is suitable for vectorization. A query costs O(log n + k * log n) node visits for k reported blocks.
+ *
+ * The index is built once from all the intervals, and should be rebuilt if any of them changes.
+ */
+class FDML_FDML_DECL IntervalIndex {
+  public:
+    struct Interval {
+        double min, max;
+        uint32_t id;
+    };
+
+  private:
+    /* intervals sorted by their min, in a structure of arrays layout */
+    std::vector<double> mins;
+    std::vector<double> maxs;
+    std::vector<uint32_t> ids;
+    /* the max of the intervals max values of each subtree, the root is at 1 and the children of node i are 2i, 2i+1.
+     * The leaves are the blocks, starting at leaves_begin. */
+    std::vector<double> tree;
+    size_t leaves_begin = 0;
+
+  public:
+    /**
+     * @brief Build the index from a collection of intervals, replacing the previous intervals
+     *
+     * @param intervals the intervals, each with min <= max
+     */
+    void build(const std::vector<Interval>& intervals);
+
+    /**
+     * @brief Remove all the intervals from the index
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of intervals in the index
+     */
+    size_t size() const { return ids.size(); }
+
+    /**
+     * @brief Get an interval by its position in the index, the intervals are ordered by their min
+     *
+     * @param i the interval position, less than size()
+     * @return the interval
+     */
+    Interval get(size_t i) const { return {mins[i], maxs[i], ids[i]}; }
+
+    /**
+     * @brief Get the number of bytes used by the index
+     */
+    size_t memory_usage() const;
+
+    /**
+     * @brief Find all the intervals intersecting a query interval [min, max]
+     *
+     * @param min the query interval min
+     * @param max the query interval max
+     * @param res output vector, to which the intersecting intervals are appended ordered by their min
+     */
+    void query(double min, double max, std::vector<Interval>& res) const;
+
+    /**
+     * @brief Find all the intervals containing a value
+     *
+     * @param x the query value
+     * @param res output vector, to which the containing intervals are appended ordered by their min
+     */
+    void stab(double x, std::vector<Interval>& res) const { query(x, x, res); }
+};
+
+} // namespace FDML
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef FDML_JSON_RESULT_WRITER_HPP
+#define FDML_JSON_RESULT_WRITER_HPP
+
+#include <ostream>
+#include <string>
+
+#include "fdml/config.hpp"
+#include "fdml/defs.hpp"
+
+namespace FDML {
+
+/**
+ * @brief Streaming writer of query results as JSON, an object with a single field holding an array of results
+ *
+ * Results are encoded one by one as they are added, into a small buffer which is flushed to the output stream whenever
+ * it fills up, so the memory used is constant regardless of the result size. The PRETTY style with PRETTY_PRECISION
+ * writes the same bytes as JsonUtils::write_polygons(), write_segments() and write_points(), and the COMPACT style
+ * writes the whole document on a single line with no whitespace.
+ *
+ * Floats are formatted with std::to_chars, with a given number of significant digits, or with the shortest
+ * representation which reads back to the same double if the precision is SHORTEST_PRECISION.
+ *
+ * A result must be ended by finish(), a writer destroyed before it is finished writes nothing more.
+ */
+class FDML_FDML_DECL JsonResultWriter {
+  public:
+    enum Style {
+        PRETTY,
+        COMPACT,
+    };
+
+    /* Precision of the shortest round trip representation of floats */
+    static const int SHORTEST_PRECISION = 0;
+    /* Precision of the default formatting of floats by streams, as used by JsonUtils */
+    static const int PRETTY_PRECISION = 6;
+
+  private:
+    std::ostream& os;
+    Style style;
+    int precision;
+    std::string buf;
+    size_t results_num = 0;
+
+  public:
+    /**
+     * @brief Create a writer and encode the beginning of the result
+     *
+     * @param os output stream
+     * @param field the name of the results array field, such as "polygons"
+     * @param style the whitespace style
+     * @param precision number of significant digits of floats, or SHORTEST_PRECISION
+     */
+    JsonResultWriter(std::ostream& os, const std::string& field, Style style = COMPACT,
+                     int precision = SHORTEST_PRECISION);
+
+    /**
+     * @brief Add a polygon result, encoded as an array of its vertices
+     */
+    void add_polygon(const Polygon& polygon);
+
+    /**
+     * @brief Add a segment result, encoded as an array of its source and target
+     */
+    void add_segment(const Segment& segment);
+
+    /**
+     * @brief Add a point result, encoded as an array of its coordinates
+     */
+    void add_point(const Point& point);
+
+    /**
+     * @brief Encode the end of the result and flush it to the output stream
+     */
+    void finish();
+
+  private:
+    void open_array();
+    void next_element(unsigned int depth, bool first);
+    void close_array(unsigned int depth, bool empty);
+    void write_double(double x);
+    void write_point(const Point& point, unsigned int depth);
+    void result_added();
+};
+
+} // namespace FDML
+
+#endif
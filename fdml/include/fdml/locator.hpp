@@ -3,8 +3,13 @@
 
 #include "fdml/config.hpp"
 #include "fdml/defs.hpp"
+#include "fdml/executor.hpp"
+#include "fdml/interval_index.hpp"
 #include "fdml/trapezoider.hpp"
 
+#include <functional>
+#include <memory>
+
 #include <boost/geometry.hpp>
 
 namespace FDML {
@@ -13,6 +18,7 @@ namespace FDML {
  * @brief The locator class is used to preproccess a polygon room, and to query the possible positions a
  * sensor might be in the room given one or two measeraments.
  *
+ * The const query functions of an initialized locator may be called concurrently from multiple threads.
  */
 class FDML_FDML_DECL Locator {
   private:
@@ -22,23 +28,54 @@ class FDML_FDML_DECL Locator {
         TrapezoidOpening(const Kernel::FT& min, const Kernel::FT& max) : min(min), max(max){};
     };
 
-    typedef boost::geometry::model::point<Kernel::FT, 1, boost::geometry::cs::cartesian> TrapezoidRTreePoint;
-    typedef boost::geometry::model::box<TrapezoidRTreePoint> TrapezoidRTreeSegment;
-    typedef boost::geometry::index::linear<3> TrapezoidRTreeParams;
-    typedef std::pair<TrapezoidRTreeSegment, Trapezoid::ID> TrapezoidRTreeValue;
-    typedef boost::geometry::index::rtree<TrapezoidRTreeValue, TrapezoidRTreeParams> TrapezoidRTree;
-
     /* Trapezoider object used to calculate and store all trapezoids of the room */
     Trapezoider trapezoider;
     /* Max and min opening per trapezoid */
     std::vector<TrapezoidOpening> openings;
+    /* Query constants per trapezoid, read by the query kernels instead of the arrangement handles */
+    std::vector<Trapezoid::QueryPlan> plans;
 
     /* Trapezoids sorted by their max opening. Used for output sensitive calculation of single measurement queries */
     std::vector<Trapezoid::ID> sorted_by_max;
-    /* Trapezoids in an interval tree, each interval is the min and max opening of a trapezoid. Used for output
-     * sensitive calculation of two measurements queries
+    /* The max openings in the order of sorted_by_max, each as the smallest double not smaller than the exact value. The
+     * binary searches run on this array, and the exact openings are compared only for max openings within one ulp of
+     * the measurement. */
+    std::vector<double> sorted_max_upper;
+    /* Trapezoids in a static interval index, each interval is the min and max opening of a trapezoid rounded outwards
+     * to doubles. Used for output sensitive calculation of two measurements queries
      */
-    TrapezoidRTree rtree;
+    IntervalIndex interval_index;
+
+    typedef boost::geometry::model::point<double, 2, boost::geometry::cs::cartesian> HeadingIndexPoint;
+    typedef boost::geometry::model::box<HeadingIndexPoint> HeadingIndexBox;
+    typedef std::pair<HeadingIndexBox, Trapezoid::ID> HeadingIndexValue;
+    typedef boost::geometry::index::rtree<HeadingIndexValue, boost::geometry::index::rstar<16>> HeadingIndex;
+
+    /* Trapezoids in a 2D index of boxes [angle begin, angle end] x [min opening, max opening], where the angles are in
+     * radians in [0, 2 * PI] and an angle interval containing the zero angle is split into two boxes. All bounds are
+     * rounded outwards. Used for output sensitive calculation of heading constrained queries */
+    HeadingIndex heading_index;
+
+    /* The IDs of the top and bottom edges of each trapezoid in the scene topology. Recalculated whenever the scene
+     * changes, as the topology IDs change with it */
+    std::vector<std::pair<Topology::EdgeID, Topology::EdgeID>> trapezoids_edges;
+
+    typedef boost::geometry::model::point<double, 2, boost::geometry::cs::cartesian> RegionIndexPoint;
+    typedef boost::geometry::model::box<RegionIndexPoint> RegionIndexBox;
+    typedef std::pair<RegionIndexBox, Trapezoid::ID> RegionIndexValue;
+    typedef boost::geometry::index::rtree<RegionIndexValue, boost::geometry::index::rstar<16>> RegionIndex;
+
+    /* Trapezoids in a 2D index of the bounding boxes of their 2D bounds, rounded outwards. All the results of a
+     * trapezoid are within its box. Used to prune trapezoids in queries with a known region of interest */
+    RegionIndex region_index;
+
+    /* The preprocessing parallelism, reused by incremental updates */
+    unsigned int sectors_num = 1;
+    unsigned int threads_num = 0;
+    /* If set, each incremental update is compared to a full rebuild */
+    bool verify_updates = false;
+    /* Executor used to evaluate the candidate trapezoids of queries */
+    std::shared_ptr<Executor> executor;
 
   public:
     /* A result entry struct from a single measurement query. The struct represent the possible area in the 2D space a
@@ -47,10 +84,17 @@ class FDML_FDML_DECL Locator {
         /* The edge the sensor might measure */
         std::pair<Point, Point> edge;
         /* The area representing the position in the 2D space a sensor might be and measure the query distance of
-         * measuring the edge */
+         * measuring the edge. Empty for analytic results */
         Polygon pos;
+        /* The boundary of the area as a closed loop of curves, only for analytic results */
+        std::vector<ResultCurve> boundary;
 
         Res1d(const std::pair<Point, Point>& edge, const Polygon& pos) : edge(edge), pos(pos) {}
+        Res1d(const std::pair<Point, Point>& edge, const std::vector<ResultCurve>& boundary)
+            : edge(edge), boundary(boundary) {}
+
+        /* Get the area as a polygon, evaluating the boundary curves of an analytic result by the given options */
+        Polygon evaluate(const ResultOptions& options = ResultOptions()) const;
     };
 
     /* A result entry struct from a double measurement query. The struct represent the possible positions in the 2D
@@ -62,43 +106,452 @@ class FDML_FDML_DECL Locator {
         /* The edge the sensor might measure d2 distance to */
         std::pair<Point, Point> edge2;
         /* A collection of segments representing the positions a sensor might be and measure d1,d2 at edge1,edge2
-         * respectively */
+         * respectively. Empty for analytic results */
         std::vector<Segment> pos;
+        /* The curves of the positions, only for analytic results */
+        std::vector<ResultCurve> curves;
 
         Res2d(const std::pair<Point, Point>& edge1, const std::pair<Point, Point>& edge2,
               const std::vector<Segment>& pos)
             : edge1(edge1), edge2(edge2), pos(pos) {}
+        Res2d(const std::pair<Point, Point>& edge1, const std::pair<Point, Point>& edge2,
+              const std::vector<ResultCurve>& curves)
+            : edge1(edge1), edge2(edge2), curves(curves) {}
+
+        /* Get the positions as segments, evaluating the curves of an analytic result by the given options */
+        std::vector<Segment> evaluate(const ResultOptions& options = ResultOptions()) const;
+    };
+
+    /* A result entry of a single measurement query passed to a visitor. Same as Res1d, with the edge identified by its
+     * ID in the scene topology, see get_edge() */
+    struct Res1dEntry {
+        Topology::EdgeID edge;
+        /* The area of the positions, empty for analytic results */
+        Polygon pos;
+        /* The boundary of the area, only for analytic results */
+        std::vector<ResultCurve> boundary;
+    };
+
+    /* A result entry of a double measurement query passed to a visitor. Same as Res2d, with the edges identified by
+     * their IDs in the scene topology, see get_edge() */
+    struct Res2dEntry {
+        Topology::EdgeID edge1;
+        Topology::EdgeID edge2;
+        /* The positions as segments, empty for analytic results */
+        std::vector<Segment> pos;
+        /* The curves of the positions, only for analytic results */
+        std::vector<ResultCurve> curves;
+    };
+
+    /* Visitors receiving the entries of a query one at a time. An entry is owned by the query and valid only during the
+     * call, so a visitor may move its data */
+    typedef std::function<void(Res1dEntry&)> Res1dVisitor;
+    typedef std::function<void(Res2dEntry&)> Res2dVisitor;
+
+    /* A result entry struct from a double measurement ranges query. The struct represent the possible positions in
+     * the 2D space a sensor might be in the scene and measure a distance within the first range at a first edge and a
+     * distance within the second range at a second edge. */
+    struct Res2dRange {
+        /* The edge the sensor might measure the first distance to */
+        std::pair<Point, Point> edge1;
+        /* The edge the sensor might measure the second distance to */
+        std::pair<Point, Point> edge2;
+        /* Disjoint polygons containing the area of the positions */
+        std::vector<Polygon> pos;
+
+        Res2dRange(const std::pair<Point, Point>& edge1, const std::pair<Point, Point>& edge2,
+                   const std::vector<Polygon>& pos)
+            : edge1(edge1), edge2(edge2), pos(pos) {}
+    };
+
+    /* A range of headings of the sensor, from begin counter clockwise to end. The heading is the direction in which
+     * the sensor measures, the first direction of a double measurement. */
+    struct HeadingRange {
+        Direction begin;
+        Direction end;
+
+        HeadingRange(const Direction& begin, const Direction& end) : begin(begin), end(end) {}
+    };
+
+    /* A measurement with a bounded error, the measured distance is somewhere in [lo, hi] */
+    struct MeasurementRange {
+        Kernel::FT lo;
+        Kernel::FT hi;
+
+        MeasurementRange(const Kernel::FT& lo, const Kernel::FT& hi) : lo(lo), hi(hi) {}
+    };
+
+    /* The results of a batch of queries, stored in a single flat container. The result entries of the i-th input are
+     * entries[offsets[i]..offsets[i + 1]). */
+    template <typename Res> struct BatchRes {
+        std::vector<Res> entries;
+        std::vector<size_t> offsets;
+
+        size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+        typename std::vector<Res>::const_iterator begin(size_t i) const { return entries.begin() + offsets[i]; }
+        typename std::vector<Res>::const_iterator end(size_t i) const { return entries.begin() + offsets[i + 1]; }
     };
 
   public:
-    Locator() {}
+    Locator() : executor(std::make_shared<Executor>()) {}
 
     /**
      * @brief Init the locator with a polygon room
      *
      * @param scene polygon scene
+     * @param sectors_num number of angle sectors the trapezoids calculation is split into
+     * @param threads_num number of threads used to calculate the trapezoids, 0 for the hardware concurrency
+     */
+    void init(const Polygon_with_holes& scene, unsigned int sectors_num = 1, unsigned int threads_num = 0);
+
+    /**
+     * @brief Add a hole (obstacle) to the room and update the locator
+     *
+     * Only the trapezoids limited by vertices which might see the hole are recalculated, only the ones which changed
+     * get new openings, and the query data structures are patched in place. Trapezoids which were not affected keep
+     * their IDs. If the update fails, the locator keeps the previous scene.
+     *
+     * @param hole a polygon within the room, in clockwise orientation
+     */
+    void add_hole(const Polygon& hole);
+
+    /**
+     * @brief Remove a hole (obstacle) from the room and update the locator
+     *
+     * Same as add_hole(), only the changed trapezoids are updated.
+     *
+     * @param hole_idx the index of the hole in the scene holes
+     */
+    void remove_hole(unsigned int hole_idx);
+
+    /**
+     * @brief Enable or disable the verification of incremental updates
+     *
+     * When enabled, the result of each add_hole() or remove_hole() is compared to a full rebuild of the locator from
+     * the updated scene, and a std::logic_error is thrown if they differ. This is very slow, and intended for testing.
+     *
+     * @param enable true to enable the verification
+     */
+    void set_update_verification(bool enable);
+
+    /**
+     * @brief Set the executor used to evaluate the candidate trapezoids of queries
+     *
+     * By default the candidates are evaluated inline in the calling thread. With a pool executor, the candidates are
+     * split into chunks which are evaluated in parallel. The result entries are always ordered by the trapezoids IDs,
+     * independently of the executor. The executor may be shared between multiple locators.
+     *
+     * @param executor an executor, must not be null
+     */
+    void set_executor(std::shared_ptr<Executor> executor);
+
+    /**
+     * @brief Save the preprocessed locator into a binary snapshot file
+     *
+     * The snapshot contains the scene, the trapezoids, their openings and the query data structures, and can be loaded
+     * later without repeating the preprocessing. The format is versioned and protected by a checksum.
+     *
+     * @param filename path to the output snapshot file
+     */
+    void save(const std::string& filename) const;
+
+    /**
+     * @brief Load a preprocessed locator from a binary snapshot file created by save()
+     *
+     * The file is memory mapped and validated before use. If the loading fails, the locator should be initialized
+     * again before it is queried.
+     *
+     * @param filename path to a snapshot file
+     */
+    void load(const std::string& filename);
+
+    /**
+     * @brief Check if a file is a locator snapshot file, rather than a scene file
+     *
+     * @param filename path to a file
+     * @return true if the file starts with the snapshot magic, else false
+     */
+    static bool is_snapshot(const std::string& filename);
+
+    /**
+     * @brief Get an estimate of the number of bytes used by the locator
+     *
+     * The containers are counted by their capacity, and each kernel object constructed by the preprocessing by an
+     * estimate of its shared representation. Exact values computed on demand are not counted.
+     *
+     * @return the estimated memory usage in bytes
      */
-    void init(const Polygon_with_holes& scene);
+    size_t memory_usage() const;
 
     /**
      * @brief Calculate all the points in the room a sensor might be after it measure d at some wall
      *
+     * The result entries are ordered by the trapezoids IDs.
+     *
      * @param d the single measurement value
+     * @param options options of the result computation
      * @return collection of result entries, each representing possible positions a sensor might be and measure distance
      * d at a specific edge
      */
-    std::vector<Res1d> query(const Kernel::FT& d) const;
+    std::vector<Res1d> query(const Kernel::FT& d, const ResultOptions& options = ResultOptions()) const;
 
     /**
      * @brief Calculate all the points in the room a sensor might be after it measured d1 in a single direction and d2
      * at the opposite direction.
      *
+     * The result entries are ordered by the trapezoids IDs.
+     *
      * @param d1 the first measurement value
      * @param d2 the second measurement value
+     * @param options options of the result computation
      * @return collection of result entries, each representing possible positions a sensor might be and measure d1,d2 at
      * some specific edges e1,e2
      */
-    std::vector<Res2d> query(const Kernel::FT& d1, const Kernel::FT& d2) const;
+    std::vector<Res2d> query(const Kernel::FT& d1, const Kernel::FT& d2,
+                             const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Calculate all the points in the room a sensor might be after it measured d at some wall, passing each
+     * result entry to a visitor as it is calculated
+     *
+     * The visitor is called from the calling thread, with the same entries and in the same order as query(d). No
+     * container of all the entries is created. With a multi threaded executor the trapezoids are evaluated in windows
+     * of a few chunks per thread, and only the entries of a single window are buffered.
+     *
+     * @param d the single measurement value
+     * @param visitor function receiving each result entry
+     * @param options options of the result computation
+     */
+    void query(const Kernel::FT& d, const Res1dVisitor& visitor, const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Calculate all the points in the room a sensor might be after it measured d1 in a single direction and d2
+     * at the opposite direction, passing each result entry to a visitor as it is calculated
+     *
+     * Same as query(d, visitor), with the same entries and in the same order as query(d1, d2).
+     *
+     * @param d1 the first measurement value
+     * @param d2 the second measurement value
+     * @param visitor function receiving each result entry
+     * @param options options of the result computation
+     */
+    void query(const Kernel::FT& d1, const Kernel::FT& d2, const Res2dVisitor& visitor,
+               const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Get the end points of an edge of the scene by its ID, as passed to query visitors
+     *
+     * The IDs are stable as long as the scene is not changed.
+     *
+     * @param edge ID of a directed edge in the scene topology
+     * @return the source and target points of the edge
+     */
+    std::pair<Point, Point> get_edge(Topology::EdgeID edge) const;
+
+    /**
+     * @brief Calculate all the points in the room a sensor might be after it measured a distance within a range at
+     * some wall
+     *
+     * The candidate trapezoids are selected once for the whole range, and the result of each of them is the area swept
+     * by the results of all the distances in the range, rather than a union of queries of sampled distances. The area
+     * contains the results of all the distances in the range, and exceeds them by at most the tolerance of the
+     * options. The analytic result option is not supported, and the result is always sampled. The result entries are
+     * ordered by the trapezoids IDs.
+     *
+     * @param d the measurement range
+     * @param options options of the result computation
+     * @return collection of result entries, each representing possible positions a sensor might be and measure a
+     * distance within the range at a specific edge
+     */
+    std::vector<Res1d> query(const MeasurementRange& d, const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Calculate all the points in the room a sensor might be after it measured a distance within a first range
+     * in a single direction and a distance within a second range at the opposite direction
+     *
+     * The candidate trapezoids are selected by a single query of the sums range on the openings interval index. The
+     * area of each entry contains the results of all the distances in the ranges. The analytic result option is not
+     * supported. The result entries are ordered by the trapezoids IDs.
+     *
+     * @param d1 the first measurement range
+     * @param d2 the second measurement range
+     * @param options options of the result computation
+     * @return collection of result entries, each representing possible positions a sensor might be and measure
+     * distances within d1,d2 at some specific edges e1,e2
+     */
+    std::vector<Res2dRange> query(const MeasurementRange& d1, const MeasurementRange& d2,
+                                  const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Calculate all the points in the room a sensor might be after it measured d at some wall, with a heading
+     * within a known range
+     *
+     * The candidate trapezoids are selected by the heading index, and each of them is evaluated only for the part of
+     * its angle interval within the heading range. The result entries are ordered by the trapezoids IDs.
+     *
+     * @param d the single measurement value
+     * @param heading the range of the measurement direction, must not be a single direction
+     * @param options options of the result computation
+     * @return collection of result entries, each representing possible positions a sensor might be and measure distance
+     * d at a specific edge with a heading within the range
+     */
+    std::vector<Res1d> query(const Kernel::FT& d, const HeadingRange& heading,
+                             const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Calculate all the points in the room a sensor might be after it measured d1 in a single direction and d2
+     * at the opposite direction, with the first direction within a known range
+     *
+     * Same as query(d, heading), using the openings intervals containing d1 + d2 in the heading index.
+     *
+     * @param d1 the first measurement value
+     * @param d2 the second measurement value
+     * @param heading the range of the first measurement direction, must not be a single direction
+     * @param options options of the result computation
+     * @return collection of result entries, each representing possible positions a sensor might be and measure d1,d2 at
+     * some specific edges e1,e2 with a heading within the range
+     */
+    std::vector<Res2d> query(const Kernel::FT& d1, const Kernel::FT& d2, const HeadingRange& heading,
+                             const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Calculate all the points within a region of interest a sensor might be after it measured d at some wall
+     *
+     * Trapezoids with bounds outside the region bounding box are pruned by the region index before any geometry is
+     * evaluated. The results are clipped to the region, and are always polygons, regardless of options.analytic.
+     *
+     * @param d the single measurement value
+     * @param region a simple polygon in which the sensor is known to be, in any orientation
+     * @param options options of the result computation
+     * @return collection of result entries, each representing possible positions within the region a sensor might be
+     * and measure distance d at a specific edge. An entry is split to multiple entries if the clipping splits it.
+     */
+    std::vector<Res1d> query(const Kernel::FT& d, const Polygon& region,
+                             const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Calculate all the points within an axis aligned box a sensor might be after it measured d at some wall
+     *
+     * Same as query(d, region), with the box as the region.
+     *
+     * @param d the single measurement value
+     * @param region a non empty box in which the sensor is known to be
+     * @param options options of the result computation
+     * @return collection of result entries, each representing possible positions within the box a sensor might be and
+     * measure distance d at a specific edge
+     */
+    std::vector<Res1d> query(const Kernel::FT& d, const CGAL::Bbox_2& region,
+                             const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Perform a batch of single measurement queries
+     *
+     * The measurements are sorted and the trapezoids sorted by their max opening are walked once for the whole batch.
+     * The (trapezoid, measurement) pairs are evaluated by the locator executor.
+     *
+     * @param ds the measurements values
+     * @param options options of the result computation
+     * @return the results of each measurement, in the same order and with the same entries as query(d)
+     */
+    BatchRes<Res1d> query_batch(const std::vector<Kernel::FT>& ds,
+                                const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Perform a batch of double measurement queries
+     *
+     * The measurements are sorted by their sum, and the interval index is queried once for the whole batch. The
+     * (trapezoid, measurement) pairs are evaluated by the locator executor.
+     *
+     * @param ds the measurements values pairs (d1, d2)
+     * @param options options of the result computation
+     * @return the results of each measurements pair, in the same order and with the same entries as query(d1, d2)
+     */
+    BatchRes<Res2d> query_batch(const std::vector<std::pair<Kernel::FT, Kernel::FT>>& ds,
+                                const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Get the trapezoids which may contain results of a single measurement, without calculating the results
+     *
+     * @param d the single measurement value
+     * @return the IDs of the trapezoids with a max opening not smaller than d, sorted
+     */
+    std::vector<Trapezoid::ID> query_candidates(const Kernel::FT& d) const;
+
+    /**
+     * @brief Get the trapezoids which may contain results of a double measurement, without calculating the results
+     *
+     * @param d1 the first measurement value
+     * @param d2 the second measurement value
+     * @return the IDs of the trapezoids with openings interval containing d1 + d2, sorted
+     */
+    std::vector<Trapezoid::ID> query_candidates(const Kernel::FT& d1, const Kernel::FT& d2) const;
+
+    /**
+     * @brief Get the trapezoids which may contain results of a single measurement range
+     *
+     * @param d the measurement range
+     * @return the IDs of the trapezoids with a max opening not smaller than the range lower bound, sorted
+     */
+    std::vector<Trapezoid::ID> query_candidates(const MeasurementRange& d) const;
+
+    /**
+     * @brief Get the trapezoids which may contain results of a double measurement ranges
+     *
+     * @param d1 the first measurement range
+     * @param d2 the second measurement range
+     * @return the IDs of the trapezoids with openings interval intersecting the range of the measurements sum, sorted
+     */
+    std::vector<Trapezoid::ID> query_candidates(const MeasurementRange& d1, const MeasurementRange& d2) const;
+
+    /**
+     * @brief Get the trapezoids which may contain results of a single measurement with a heading within a range
+     *
+     * @param d the measurement value
+     * @param heading the range of the measurement direction
+     * @return the IDs of the trapezoids with a max opening not smaller than d and an angle interval intersecting the
+     * heading range, sorted
+     */
+    std::vector<Trapezoid::ID> query_candidates(const Kernel::FT& d, const HeadingRange& heading) const;
+
+    /**
+     * @brief Get the trapezoids which may contain results of a double measurement with a heading within a range
+     *
+     * @param d1 the first measurement value
+     * @param d2 the second measurement value
+     * @param heading the range of the first measurement direction
+     * @return the IDs of the trapezoids with openings interval containing d1 + d2 and an angle interval intersecting
+     * the heading range, sorted
+     */
+    std::vector<Trapezoid::ID> query_candidates(const Kernel::FT& d1, const Kernel::FT& d2,
+                                                const HeadingRange& heading) const;
+
+    /**
+     * @brief Get the trapezoids which may contain results of a single measurement within a region
+     *
+     * @param d the measurement value
+     * @param region the region of interest
+     * @return the IDs of the trapezoids with a max opening not smaller than d and bounds box intersecting the region
+     * bounding box, sorted
+     */
+    std::vector<Trapezoid::ID> query_candidates(const Kernel::FT& d, const CGAL::Bbox_2& region) const;
+
+  private:
+    void calc_query_plans();
+    void calc_sorted_max_upper();
+    void build_interval_index();
+    void build_heading_index();
+    void add_heading_index_values(Trapezoid::ID id, std::vector<HeadingIndexValue>& values) const;
+    void build_region_index();
+    static RegionIndexValue region_index_value(const Trapezoid& trapezoid);
+    void calc_trapezoids_edges();
+    std::vector<Trapezoid::ID> query_heading_index(const HeadingRange& heading, double opening_lower,
+                                                   double opening_upper) const;
+    size_t first_by_max(const Kernel::FT& d, size_t begin) const;
+    bool openings_intersect(const IntervalIndex::Interval& interval, const Kernel::FT& lo, const Kernel::FT& hi,
+                            const std::pair<double, double>& lo_bounds,
+                            const std::pair<double, double>& hi_bounds) const;
+    void update_scene(const Polygon_with_holes& scene, const Polygon& hole);
+    void verify_equal_to(const Locator& other) const;
 };
 
 } // namespace FDML
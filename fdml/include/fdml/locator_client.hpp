@@ -0,0 +1,57 @@
+#ifndef FDML_LOCATOR_CLIENT_HPP
+#define FDML_LOCATOR_CLIENT_HPP
+
+#include <string>
+
+#include "fdml/config.hpp"
+
+namespace FDML {
+
+/**
+ * @brief Client of a LocatorServer, sending requests and waiting for their responses
+ *
+ * See LocatorServer for the frames format. Available on Linux only.
+ */
+class FDML_FDML_DECL LocatorClient {
+  private:
+    int fd = -1;
+
+  public:
+    LocatorClient() {}
+    ~LocatorClient();
+
+    LocatorClient(const LocatorClient&) = delete;
+    LocatorClient& operator=(const LocatorClient&) = delete;
+
+    /**
+     * @brief Connect to a server listening on a Unix domain socket
+     *
+     * @param path the path of the socket
+     */
+    void connect_unix(const std::string& path);
+
+    /**
+     * @brief Connect to a server listening on a TCP port of the loopback interface
+     *
+     * @param port the TCP port
+     */
+    void connect_tcp(unsigned int port);
+
+    /**
+     * @brief Send a command and wait for its response
+     *
+     * @param cmd_line the command line, as in a daemon commands file
+     * @param output output of the command, the result JSON of query commands without an --out argument
+     * @return the command return code
+     */
+    int request(const std::string& cmd_line, std::string& output);
+
+    /**
+     * @brief Close the connection, if connected
+     */
+    void close();
+};
+
+} // namespace FDML
+
+#endif
@@ -1,6 +1,13 @@
 #ifndef FDML_LOCATOR_DAEMON_HPP
 #define FDML_LOCATOR_DAEMON_HPP
 
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
 #include "fdml/config.hpp"
 #include "fdml/locator.hpp"
 
@@ -8,25 +15,94 @@ namespace FDML {
 
 /**
  * @brief Wrapper daemon for the Locator class. Provide files communication with another proccess.
+ *
+ * The daemon holds a registry of named scenes, each preprocessed into its own locator, and every command addresses a
+ * scene by its name. A memory budget may be set, in which case the least recently used scenes are evicted when the
+ * locators exceed it. An evicted scene which was loaded from a snapshot, or was spilled into a snapshot in the spill
+ * directory, is reloaded on its next query.
+ *
+ * Commands may be executed concurrently from multiple threads. Each query runs against the locator of its scene when
+ * it started, and a scene is loaded into a new locator which replaces the current one atomically only once it is
+ * ready, so queries are served by the previous scene while a new one is preprocessed.
  */
 class FDML_FDML_DECL LocatorDaemon {
+  public:
+    /* Name of the scene addressed by commands without a scene name */
+    static constexpr const char* DEFAULT_SCENE = "default";
+
+    /* Formats of query results, see JsonResultWriter and BinaryResultWriter. RESULT_JSON is the pretty output with 6
+     * significant digits, and RESULT_JSON_COMPACT has no whitespace and the shortest round trip floats. */
+    enum ResultFormat {
+        RESULT_JSON,
+        RESULT_JSON_COMPACT,
+        RESULT_BINARY,
+    };
+
   private:
+    struct Scene {
+        /* The locator, null if the scene was evicted. A query holds its own reference, so a replaced or evicted
+         * locator is destroyed once the queries running on it are done. */
+        std::shared_ptr<const Locator> locator;
+        /* estimated memory usage of the locator, zero if evicted */
+        size_t memory = 0;
+        /* the file the scene was loaded from */
+        std::string scene_filename;
+        /* snapshot the scene is reloaded from after it is evicted, empty if it should be initialized again */
+        std::string snapshot_filename;
+        /* the time of the last use, by a logical clock */
+        uint64_t last_used = 0;
+    };
+
     /* file used to pass commands to the daemon */
     std::string cmd_filename;
     /* file used to acknowledge the user of the daemon when a command is finished */
     std::string ack_filename;
-    /* The underlying Locator */
-    std::unique_ptr<Locator> locator;
+
+    /* The scenes by their names, protected by scenes_mutex */
+    std::map<std::string, Scene> scenes;
+    uint64_t use_clock = 0;
+    std::mutex scenes_mutex;
+    /* serializes the updates of loaded locators in the registry, the reloads of evicted scenes and the eviction. A new
+     * scene is built before the mutex is taken. */
+    std::mutex load_mutex;
+    /* max total memory of the loaded locators in bytes, zero for unlimited */
+    size_t memory_budget = 0;
+    /* directory into which evicted scenes are saved as snapshots, empty to discard them */
+    std::string spill_dir;
 
   public:
     LocatorDaemon(const std::string& cmd_filename, const std::string& ack_filename);
 
     /**
-     * @brief Load a scene from a json file
+     * @brief Set the max total memory of the loaded scenes, beyond which the least recently used scenes are evicted
+     *
+     * The memory of a scene is estimated by Locator::memory_usage(). The most recently loaded scene is never evicted,
+     * even if it exceeds the budget by itself.
      *
-     * @param scene_filename path to a json file containing a scene
+     * @param bytes the memory budget in bytes, zero for unlimited
      */
-    void load_scene(const std::string& scene_filename);
+    void set_memory_budget(size_t bytes);
+
+    /**
+     * @brief Set a directory into which evicted scenes are saved as snapshots, for a fast reload on their next query
+     *
+     * Scenes loaded from a snapshot are reloaded from it, and are not saved again.
+     *
+     * @param dir an existing directory, or empty to discard evicted scenes which were not loaded from a snapshot
+     */
+    void set_spill_dir(const std::string& dir);
+
+    /**
+     * @brief Load a scene from a json file, or a preprocessed scene from a snapshot file
+     *
+     * A previous scene of the same name keeps serving queries until the new one is ready, and remains loaded if the
+     * loading fails. Scenes may be loaded concurrently, and if the same name is loaded twice at once the load which
+     * finishes last wins.
+     *
+     * @param scene_filename path to a json file containing a scene, or to a snapshot file created by Locator::save()
+     * @param name the scene name, consisting of letters, digits, '_', '-' and '.'
+     */
+    void load_scene(const std::string& scene_filename, const std::string& name = DEFAULT_SCENE);
 
     /**
      * @brief Query command of one measurement
@@ -34,9 +110,12 @@ class FDML_FDML_DECL LocatorDaemon {
      * This function should be called after the load_scene function has been called
      *
      * @param d the single measurement value
-     * @param outfile path to an output file for the query result (json)
+     * @param outfile path to an output file for the query result
+     * @param name the scene name
+     * @param format the result format
      */
-    void query(double d, const std::string& outfile) const;
+    void query(double d, const std::string& outfile, const std::string& name = DEFAULT_SCENE,
+               ResultFormat format = RESULT_JSON);
 
     /**
      * @brief Query command of two measurement
@@ -45,11 +124,42 @@ class FDML_FDML_DECL LocatorDaemon {
      *
      * @param d1 the first measurement value
      * @param d2 the second measurement value
-     * @param outfile path to an output file for the query result (json)
+     * @param outfile path to an output file for the query result
+     * @param name the scene name
+     * @param format the result format
      */
-    void query(double d1, double d2, const std::string& outfile) const;
+    void query(double d1, double d2, const std::string& outfile, const std::string& name = DEFAULT_SCENE,
+               ResultFormat format = RESULT_JSON);
 
-    void query(double d1, double d2, double d3, double d4, const std::string& outfile) const;
+    void query(double d1, double d2, double d3, double d4, const std::string& outfile,
+               const std::string& name = DEFAULT_SCENE, ResultFormat format = RESULT_JSON);
+
+    /**
+     * @brief Same as query(d, outfile, name, format), writing the result into a stream
+     */
+    void query(double d, std::ostream& os, const std::string& name = DEFAULT_SCENE, ResultFormat format = RESULT_JSON);
+
+    /**
+     * @brief Same as query(d1, d2, outfile, name, format), writing the result into a stream
+     */
+    void query(double d1, double d2, std::ostream& os, const std::string& name = DEFAULT_SCENE,
+               ResultFormat format = RESULT_JSON);
+
+    /**
+     * @brief Same as query(d1, d2, d3, d4, outfile, name, format), writing the result into a stream
+     */
+    void query(double d1, double d2, double d3, double d4, std::ostream& os, const std::string& name = DEFAULT_SCENE,
+               ResultFormat format = RESULT_JSON);
+
+    /**
+     * @brief Write a report of the scenes as a JSON array into a stream
+     *
+     * Each scene is an object with its name, whether it's loaded, its estimated memory usage in bytes, its scene file
+     * and the snapshot it's reloaded from.
+     *
+     * @param os output stream
+     */
+    void write_scenes(std::ostream& os);
 
     /**
      * @brief Run a infinity loop, reading commands from the given cmd_filename
@@ -63,9 +173,21 @@ class FDML_FDML_DECL LocatorDaemon {
      *
      * @param argv args of the command
      * @param quit will be set to true if the quit command was issued
+     * @param result if not null, the output of query commands without an --out file and of the scenes command is
+     * written into it
+     * @return on success, else on error
+     */
+    int exec_cmd(const std::vector<std::string>& argv, bool& quit, std::ostream* result = nullptr);
+
+    /**
+     * @brief Execute a single command given as a line of arguments separated by spaces
+     *
+     * @param cmd_line args of the command, as in a commands file
+     * @param quit will be set to true if the quit command was issued
+     * @param result the output of query commands without an --out file and of the scenes command is written into it
      * @return on success, else on error
      */
-    int exec_cmd(const std::vector<std::string>& argv, bool& quit);
+    int exec_cmd(const std::string& cmd_line, bool& quit, std::ostream& result);
 
     /**
      * @brief main function for daemon
@@ -79,8 +201,13 @@ class FDML_FDML_DECL LocatorDaemon {
     static int daemon_main(int argc, const char* argv[]);
 
   private:
-    /* Checks that a scene was actually loaded before handling a query command */
-    void check_state() const;
+    /* Get the current locator of a scene, checking that it was actually loaded before handling a query command.
+     * An evicted scene is reloaded from its snapshot. */
+    std::shared_ptr<const Locator> acquire_locator(const std::string& name);
+    std::shared_ptr<const Locator> reload_scene(const std::string& name);
+    /* Evict the least recently used scenes until the loaded scenes are within the memory budget. Called with the
+     * load_mutex locked */
+    void evict_scenes(const std::string& keep);
 };
 
 } // namespace FDML
@@ -0,0 +1,132 @@
+#ifndef FDML_LOCATOR_SERVER_HPP
+#define FDML_LOCATOR_SERVER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "fdml/config.hpp"
+#include "fdml/locator_daemon.hpp"
+
+namespace FDML {
+
+/**
+ * @brief Socket server of a LocatorDaemon, an alternative to the communication through files
+ *
+ * The server listens on a Unix domain socket and/or a TCP loopback port, and serves any number of connected clients by
+ * a single epoll event loop. A request is a frame containing a command line, with the same arguments as in a daemon
+ * commands file, and it is answered by a frame containing the command return code followed by its output. Query
+ * commands without an --out argument write their result JSON into the response rather than a file.
+ *
+ * The event loop only transfers the frames, and the commands are executed by a pool of worker threads, so the requests
+ * of different clients are served concurrently, and queries keep being served while an init command loads a new scene.
+ * The requests of a single connection are executed one at a time, and are answered in their order.
+ *
+ * A frame is a 32 bit big endian length of the payload followed by the payload, and a response payload starts with a
+ * 32 bit big endian return code. Available on Linux only.
+ */
+class FDML_FDML_DECL LocatorServer {
+  public:
+    /* Max size of a request payload, a larger request closes the connection */
+    static const uint32_t MAX_REQUEST_SIZE = 1 << 20;
+
+  private:
+    struct Connection {
+        /* received bytes which are not a complete request frame yet */
+        std::string in;
+        /* response bytes not sent yet, starting at out_begin */
+        std::string out;
+        size_t out_begin = 0;
+        /* if set, the connection is closed once its responses are sent */
+        bool closing = false;
+        /* if set, a request of the connection is executed by a worker */
+        bool busy = false;
+        /* the epoll events the connection is registered for */
+        uint32_t events = 0;
+        /* unique among all the connections of the server, while file descriptors are reused */
+        uint64_t id = 0;
+    };
+
+    /* A request passed to the workers, and its response passed back to the event loop */
+    struct Job {
+        int fd;
+        uint64_t conn_id;
+        std::string cmd_line;
+        std::string response;
+        bool quit;
+    };
+
+    LocatorDaemon& daemon;
+    int epoll_fd = -1;
+    std::vector<int> listen_fds;
+    /* path of the Unix domain socket, removed on destruction */
+    std::string unix_path;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    uint64_t next_conn_id = 0;
+
+    std::vector<std::thread> workers;
+    std::mutex jobs_mutex;
+    std::condition_variable jobs_cv;
+    std::deque<Job> jobs;
+    bool stop = false;
+    /* finished jobs, and an eventfd waking the event loop when a job is finished */
+    std::mutex done_mutex;
+    std::vector<Job> done_jobs;
+    int done_fd = -1;
+
+  public:
+    /**
+     * @brief Create a server of a daemon, which should listen on at least one address before run() is called
+     *
+     * @param daemon the daemon executing the requests commands
+     * @param workers_num number of worker threads executing the commands, 0 for the hardware concurrency
+     */
+    explicit LocatorServer(LocatorDaemon& daemon, unsigned int workers_num = 0);
+    ~LocatorServer();
+
+    LocatorServer(const LocatorServer&) = delete;
+    LocatorServer& operator=(const LocatorServer&) = delete;
+
+    /**
+     * @brief Listen on a Unix domain socket, replacing an existing file at the path
+     *
+     * @param path the path of the socket
+     */
+    void listen_unix(const std::string& path);
+
+    /**
+     * @brief Listen on a TCP port of the loopback interface
+     *
+     * @param port the TCP port
+     */
+    void listen_tcp(unsigned int port);
+
+    /**
+     * @brief Run the event loop, serving the clients requests
+     *
+     * This function return only if the quit command was issued or an error occurred. Commands executed concurrently
+     * with a quit command are not answered.
+     */
+    void run();
+
+  private:
+    void add_listen_fd(int fd);
+    void accept_connections(int listen_fd);
+    void read_connection(int fd, Connection& conn);
+    void dispatch_request(int fd, Connection& conn);
+    bool finish_jobs();
+    void write_connection(int fd, Connection& conn);
+    void close_connection(int fd);
+    void worker_main();
+    void stop_workers();
+};
+
+} // namespace FDML
+
+#endif
@@ -7,12 +7,120 @@
 #include <cmath>
 #endif
 
+#include "fdml/config.hpp"
 #include "fdml/defs.hpp"
 
 #include <math.h>
+#include <vector>
 
 namespace FDML {
 
+/**
+ * @brief Options of the computation of a query result
+ */
+struct ResultOptions {
+    /* If set, the result curves are sampled in double arithmetic, and exact arithmetic is used only for the predicates
+     * clipping the result by the trapezoid bounds. An order of magnitude faster, with result points accurate up to
+     * the double precision. */
+    bool inexact = false;
+    /* Maximum distance between a result curve and the polyline approximating it. The number of samples of each arc,
+     * conchoid or ellipse is chosen by its curvature and length. If zero, a fixed number of samples per full turn is
+     * used. */
+    double tolerance = 0;
+    /* If set, the result curves are not sampled, and each curve is represented only by the chord between its end
+     * points */
+    bool parametric = false;
+    /* If set, the results are returned as analytic curves, which are evaluated into points only on demand. The
+     * crossings of the curves with the trapezoids bounds are calculated in double arithmetic. */
+    bool analytic = false;
+};
+
+/**
+ * @brief An analytic curve of a query result
+ *
+ * All curves except segments are parameterized by the angle a (radians) of a ray direction u(a) = (cos(a), sin(a)).
+ * A curve spans the angles from angle_begin to angle_end, which may be decreasing, and is traversed in this order.
+ */
+class FDML_FDML_DECL ResultCurve {
+  public:
+    enum Type {
+        /* straight segment from source to target */
+        SEGMENT,
+        /* circular arc pole + u(a) * d */
+        ARC,
+        /* conchoid branch pole + u(a) * (t(a) + d), where t(a) is the signed distance along u(a) from the pole to the
+         * line */
+        CONCHOID,
+        /* ellipse pole + axis * scale * sin(a - phase) - u(a) * d */
+        ELLIPSE,
+    };
+
+    Type type;
+    /* end points of a segment */
+    Point source, target;
+    /* center of an arc, pole of a conchoid or the center of an ellipse */
+    Point pole;
+    /* base line of a conchoid */
+    Line line;
+    /* radius of an arc, distance beyond the base line of a conchoid or the rotating offset of an ellipse */
+    Kernel::FT d;
+    /* unit axis, scale and phase of an ellipse */
+    double axis_x, axis_y, scale, phase;
+    double angle_begin, angle_end;
+
+    static ResultCurve segment(const Point& source, const Point& target);
+    static ResultCurve arc(const Point& center, const Kernel::FT& radius, double angle_begin, double angle_end);
+    static ResultCurve conchoid(const Point& pole, const Line& line, const Kernel::FT& d, double angle_begin,
+                                double angle_end);
+    static ResultCurve ellipse(const Point& center, double axis_x, double axis_y, double scale, double phase,
+                               const Kernel::FT& d, double angle_begin, double angle_end);
+
+    /**
+     * @brief Calculate a point on the curve
+     *
+     * @param t curve parameter in [0, 1], 0 for the source of the curve and 1 for its target
+     * @return the point on the curve
+     */
+    Point point_at(double t) const;
+
+    /**
+     * @brief Get the part of the curve between two parameters
+     *
+     * @param t_begin begin parameter in [0, 1]
+     * @param t_end end parameter in [0, 1]
+     * @return the curve part from point_at(t_begin) to point_at(t_end)
+     */
+    ResultCurve part(double t_begin, double t_end) const;
+
+    /**
+     * @brief Get the curve traversed in the opposite direction
+     */
+    ResultCurve reversed() const;
+
+    /**
+     * @brief Evaluate the curve into a polyline
+     *
+     * @param options the sampling options, the inexact and analytic options are ignored
+     * @return the polyline points, from the source of the curve to its target
+     */
+    std::vector<Point> evaluate(const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Intersect the area bounded by a closed loop of curves with a half plane
+     *
+     * The crossings of the curves with the line are found numerically, and the area pieces are closed by segments on
+     * the line. Similar to HalfPlaneClipper, but for curved boundaries.
+     *
+     * @param boundary a closed loop of curves, each curve target is the source of the next one, in any orientation
+     * @param line the line defining the half plane, the half plane is the positive (left) side of the line
+     * @return the boundaries of the intersection pieces, each a closed loop in counter clockwise orientation
+     */
+    static std::vector<std::vector<ResultCurve>> clip(const std::vector<ResultCurve>& boundary, const Line& line);
+
+  private:
+    ResultCurve(Type type) : type(type), axis_x(0), axis_y(0), scale(0), phase(0), angle_begin(0), angle_end(0) {}
+};
+
 /**
  * The Trapezoid class represent a 3D cell in the (x,y,theta) configuration space. A trapezoid is defined by it's top
  * and bottom edges, and the right and left vertices and defines its imaginary rotated parallel edges. Each trapezoid
@@ -33,6 +141,56 @@ class Trapezoid {
 
     static const Direction ANGLE_NONE;
 
+    /**
+     * @brief Constants of a trapezoid used by the query kernels, which depend only on the trapezoid
+     *
+     * A plan is computed once per trapezoid, and the query kernels read only from it, without the arrangement handles.
+     * As it holds no handles, a plan remains valid when the arrangement of the trapezoid is recalculated.
+     */
+    struct QueryPlan {
+        Direction angle_begin, angle_end;
+        /* the top and bottom edges end points */
+        Point top_source, top_target, bottom_source, bottom_target;
+        /* the top and bottom edges supporting lines */
+        Line top_line, bottom_line;
+        /* the limiting vertices, left and right, and whether each of them is on the top line */
+        Point vertices[2];
+        bool vertex_on_top[2];
+        /* the half plane of the bottom edge containing the trapezoid, from its left vertex to its right vertex */
+        Line bottom_half_plane;
+        /* the line of the bottom edge directed from its source to its target */
+        Line bottom_edge_line;
+        /* the top edge direction from its target to its source, and the bottom edge direction */
+        Direction top_line_dir, bottom_line_dir;
+        /* the angle intervals of single measurement results, oriented relative to the top edge and split by its
+         * normal. Each interval may be empty. */
+        Direction m1_intervals[2][2];
+
+        /* true if the top and bottom edges are not parallel */
+        bool lines_intersect;
+        /* the intersection point of the top and bottom lines, and the unit direction from it to the middle of the top
+         * edge. Valid only if lines_intersect */
+        Point inter_point;
+        Vector k_dir;
+        /* angles (radians) of angle_begin and the bottom edge, the angle range of the trapezoid and the angle between
+         * the top and bottom edges. Valid only if lines_intersect */
+        double a_begin, bottom_line_angle, angle_range, angle_between;
+        /* the distance between the top and bottom lines. Valid only if not lines_intersect */
+        Kernel::FT lines_dis;
+
+        QueryPlan() = default;
+        explicit QueryPlan(const Trapezoid& trapezoid);
+
+        /**
+         * @brief Get the plan of the part of the trapezoid within a sub interval of its angles
+         *
+         * @param begin the sub interval begin, within [angle_begin, angle_end]
+         * @param end the sub interval end, counter clockwise from begin and within [angle_begin, angle_end]
+         * @return a plan equal to this one, with the angles dependent constants calculated for the sub interval
+         */
+        QueryPlan restricted(const Direction& begin, const Direction& end) const;
+    };
+
     Trapezoid(Trapezoid::ID id, Halfedge top_edge, Halfedge bottom_edge, Vertex left_vertex, Vertex right_vertex);
     Trapezoid(const Trapezoid& other) = default;
     Trapezoid::ID get_id() const;
@@ -41,9 +199,10 @@ class Trapezoid {
      * @brief Calculates all the points a sensor might be within the trapezoid measering distance 'd' at the top edge
      *
      * @param d the measurement value
+     * @param options options of the result computation
      * @return polygons representing areas a sensor might and measure the trapezoid top edge
      */
-    std::vector<Polygon> calc_result_m1(const Kernel::FT& d) const;
+    std::vector<Polygon> calc_result_m1(const Kernel::FT& d, const ResultOptions& options = ResultOptions()) const;
 
     /**
      * @brief Calculates all the points a sensor might be within the trapezoid measering distance 'd1' at top edge and
@@ -51,10 +210,106 @@ class Trapezoid {
      *
      * @param d1 the measurement value to the top edge
      * @param d2 the measurement value to the bottom edge
+     * @param options options of the result computation
      * @return segments representing segments a sensor might be and measure d1,d2 at the trapezoid top and bottom edges
      * respectively
      */
-    std::vector<Segment> calc_result_m2(const Kernel::FT& d1, const Kernel::FT& d2) const;
+    std::vector<Segment> calc_result_m2(const Kernel::FT& d1, const Kernel::FT& d2,
+                                        const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Calculates all the points a sensor might be within the trapezoid measuring a distance in [d_lo, d_hi] at
+     * the top edge
+     *
+     * The result contains the area swept by the single measurement results of all the distances in the range. The
+     * angles are swept by steps, and the positions of each step are covered by an inflated convex hull of the positions
+     * at its ends, so the result exceeds the exact area by at most the chords deviation tolerance of the options.
+     *
+     * @param d_lo the measurement range lower bound
+     * @param d_hi the measurement range upper bound
+     * @param options options of the result computation
+     * @return polygons representing areas a sensor might be and measure the trapezoid top edge within the range
+     */
+    std::vector<Polygon> calc_result_m1_range(const Kernel::FT& d_lo, const Kernel::FT& d_hi,
+                                              const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Calculates all the points a sensor might be within the trapezoid measuring a distance in [d1_lo, d1_hi] at
+     * the top edge and a distance in [d2_lo, d2_hi] at the bottom edge
+     *
+     * For a fixed angle the positions are a convex polygon. The angles are swept by steps, and the positions of each
+     * step are covered by an inflated convex hull of a relaxation of the polygons at its ends, so the result contains
+     * the exact area. The computation is in double arithmetic, up to the union of the step hulls.
+     *
+     * @param d1_lo the top edge measurement range lower bound
+     * @param d1_hi the top edge measurement range upper bound
+     * @param d2_lo the bottom edge measurement range lower bound
+     * @param d2_hi the bottom edge measurement range upper bound
+     * @param options options of the result computation
+     * @return polygons containing the area a sensor might be within the ranges
+     */
+    std::vector<Polygon> calc_result_m2_range(const Kernel::FT& d1_lo, const Kernel::FT& d1_hi,
+                                              const Kernel::FT& d2_lo, const Kernel::FT& d2_hi,
+                                              const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Calculates the single measurement result as analytic curves
+     *
+     * @param d the measurement value
+     * @return the boundaries of the areas a sensor might be and measure the trapezoid top edge, each a closed loop of
+     * arcs, conchoids and segments
+     */
+    std::vector<std::vector<ResultCurve>> calc_result_m1_analytic(const Kernel::FT& d) const;
+
+    /**
+     * @brief Calculates the double measurement result as analytic curves
+     *
+     * @param d1 the measurement value to the top edge
+     * @param d2 the measurement value to the bottom edge
+     * @param options the sampling options locating the valid parts of the ellipse, the parametric option is ignored
+     * @return ellipse parts or segments a sensor might be on and measure d1,d2 at the trapezoid top and bottom edges
+     */
+    std::vector<ResultCurve> calc_result_m2_analytic(const Kernel::FT& d1, const Kernel::FT& d2,
+                                                     const ResultOptions& options = ResultOptions()) const;
+
+    /**
+     * @brief Same as the non static calc_result_m1(), using a precomputed query plan of the trapezoid
+     */
+    static std::vector<Polygon> calc_result_m1(const QueryPlan& plan, const Kernel::FT& d,
+                                               const ResultOptions& options = ResultOptions());
+
+    /**
+     * @brief Same as the non static calc_result_m2(), using a precomputed query plan of the trapezoid
+     */
+    static std::vector<Segment> calc_result_m2(const QueryPlan& plan, const Kernel::FT& d1, const Kernel::FT& d2,
+                                               const ResultOptions& options = ResultOptions());
+
+    /**
+     * @brief Same as the non static calc_result_m1_range(), using a precomputed query plan of the trapezoid
+     */
+    static std::vector<Polygon> calc_result_m1_range(const QueryPlan& plan, const Kernel::FT& d_lo,
+                                                     const Kernel::FT& d_hi,
+                                                     const ResultOptions& options = ResultOptions());
+
+    /**
+     * @brief Same as the non static calc_result_m2_range(), using a precomputed query plan of the trapezoid
+     */
+    static std::vector<Polygon> calc_result_m2_range(const QueryPlan& plan, const Kernel::FT& d1_lo,
+                                                     const Kernel::FT& d1_hi, const Kernel::FT& d2_lo,
+                                                     const Kernel::FT& d2_hi,
+                                                     const ResultOptions& options = ResultOptions());
+
+    /**
+     * @brief Same as the non static calc_result_m1_analytic(), using a precomputed query plan of the trapezoid
+     */
+    static std::vector<std::vector<ResultCurve>> calc_result_m1_analytic(const QueryPlan& plan, const Kernel::FT& d);
+
+    /**
+     * @brief Same as the non static calc_result_m2_analytic(), using a precomputed query plan of the trapezoid
+     */
+    static std::vector<ResultCurve> calc_result_m2_analytic(const QueryPlan& plan, const Kernel::FT& d1,
+                                                            const Kernel::FT& d2,
+                                                            const ResultOptions& options = ResultOptions());
 
     /**
      * @brief Calculate the minimum and maximum opening of this trapezoid
@@ -67,22 +322,13 @@ class Trapezoid {
      */
     void calc_min_max_openings(Kernel::FT& opening_min, Kernel::FT& opening_max) const;
 
-private:
     /**
      * @brief Get the 2D bounds polygon of the trapezoid, which should be intersected with the calculated result area
-     * during a localization query.
+     * during a localization query. All the results of the trapezoid are within it.
      *
      * @return Polygon that represent the 2D bounds of the trapezoid
      */
     Polygon get_bounds_2d() const;
-
-    /**
-     * @brief Intersect a polygon with the halfplane of the bottom edge, and return a collection of polygons
-     *
-     * @param poly input polygon, which is assumed to be contained in the cells bound if the bottom edge wouldn't exists
-     * @return a collection of polygons which are sub polygons of the input polygon, contained in the half plane
-     */
-    std::vector<Polygon> intersect_with_bottom_edge_half_plane(Polygon& poly) const;
 };
 
 template <class OutputStream> OutputStream& operator<<(OutputStream& os, const Trapezoid& trapezoid) {
@@ -1,8 +1,12 @@
 #ifndef FDML_TRAPEZOIDER_HPP
 #define FDML_TRAPEZOIDER_HPP
 
+#include <functional>
+#include <memory>
+
 #include "fdml/defs.hpp"
 #include "fdml/internal/closer_edge.hpp"
+#include "fdml/internal/topology.hpp"
 #include "fdml/trapezoid.hpp"
 
 namespace FDML {
@@ -28,39 +32,127 @@ class Trapezoider {
         std::set<Halfedge, Closer_edge<Arrangement>> ray_edges;
         VertexData() {}
         VertexData(const Point& v, const Arrangement::Geometry_traits_2* geom_traits);
+        /* the trapezoid ID of one of the fields above, by their order */
+        Trapezoid::ID& trapezoid_at(unsigned int slot);
+    };
+
+    /* The state of a parallel rotational sweep over a single sector of angles. Each sector holds its own trapezoids,
+     * indexed by their id within the sector, and its own vertices data, so sectors can be swept independently. */
+    struct SweepState {
+        TrapezoidContainer trapezoids;
+        /* data associated with each vertex, indexed by the vertex topology ID */
+        std::vector<VertexData> vertices_data;
     };
 
-    /* Polygon set of the scene, built from the input points */
-    General_polygon_set_2 scene_set;
-    /* Map of 'face' -> is free */
-    std::unordered_map<Face, bool> is_free_faces;
+    /* The restriction of a rotational sweep to the trapezoids of a subset of the vertices, defined in the source */
+    struct SweepRestriction;
+
+    /* The input scene */
+    Polygon_with_holes scene;
+    /* Polygon set of the scene, built from the input points. Held by a pointer, so the arrangement handles stay valid
+     * while the trapezoids of a previous scene are kept during an update */
+    std::unique_ptr<General_polygon_set_2> scene_set;
+    /* Index based topology of the scene arrangement, including the free faces */
+    Topology topology;
     /* The calculated trapezoids within the room, indexed by their id */
     TrapezoidContainer trapezoids;
-    /* map containing the data associated with each vertex during the parallel rotational sweep */
-    std::unordered_map<Vertex, VertexData> vertices_data;
+    /* The maximum number of events held in memory during the last parallel rotational sweep */
+    size_t prs_events_peak = 0;
 
   public:
     Trapezoider() {}
     /**
      * @brief Calculates all the trapezoids that exists in the given room
      *
+     * The rotational sweep can be split into multiple sectors of angles, each swept by a different thread. The
+     * resulting trapezoids and their IDs depend only on the number of sectors, and not on the number of threads.
+     *
      * @param scene polygon scene
+     * @param sectors_num number of angle sectors the rotational sweep is split into
+     * @param threads_num number of threads used to sweep the sectors, 0 for the hardware concurrency
      */
-    void calc_trapezoids(const Polygon_with_holes& scene);
+    void calc_trapezoids(const Polygon_with_holes& scene, unsigned int sectors_num = 1, unsigned int threads_num = 0);
+
+    /**
+     * @brief Update the trapezoids to a scene which differs from the current scene by a single hole
+     *
+     * Only trapezoids limited by vertices which see the hole can change. The limiting vertices of the current
+     * trapezoids that intersect the hole, and the hole vertices, are active. The rotational sweep is restricted to the
+     * events of pairs with an active vertex, and calculates only the trapezoids limited by two active vertices.
+     * Trapezoids limited by an inactive vertex are kept from the current scene, and the sweep takes from them the
+     * neighbors created by the events it skipped. If the update fails, the current scene and trapezoids are kept.
+     *
+     * @param scene the updated polygon scene, with the hole added or removed
+     * @param hole the hole added or removed
+     * @param prev_ids output, for each updated trapezoid, the ID of the identical trapezoid of the current scene, or
+     * 0xffffffff if there is none. The kept trapezoids come first, in the order of their current IDs
+     * @param sectors_num number of angle sectors the restricted rotational sweep is split into
+     * @param threads_num number of threads used to sweep the sectors, 0 for the hardware concurrency
+     */
+    void update_trapezoids(const Polygon_with_holes& scene, const Polygon& hole, std::vector<Trapezoid::ID>& prev_ids,
+                           unsigned int sectors_num = 1, unsigned int threads_num = 0);
+
+    /**
+     * @brief Restore previously calculated trapezoids of a room, without performing the rotational sweep
+     *
+     * The scene is not validated, as it was already validated when the trapezoids were calculated. The trapezoids are
+     * created by the given function, which should resolve their edges and vertices using the topology of the scene
+     * arrangement, and assign them consecutive IDs.
+     *
+     * @param scene polygon scene
+     * @param create_trapezoids function filling the trapezoids container given the scene topology
+     */
+    void restore_trapezoids(const Polygon_with_holes& scene,
+                            const std::function<void(const Topology&, std::vector<Trapezoid>&)>& create_trapezoids);
+
+    /**
+     * @brief Change the IDs of the trapezoids
+     *
+     * @param ids the new ID of each trapezoid, indexed by its current ID. Must be a permutation of the current IDs.
+     */
+    void renumber_trapezoids(const std::vector<Trapezoid::ID>& ids);
+
+    const Polygon_with_holes& get_scene() const;
+    const Topology& get_topology() const;
 
     TrapezoidIterator trapezoids_begin() const;
     TrapezoidIterator trapezoids_end() const;
     size_t number_of_trapezoids() const;
     TrapezoidIterator get_trapezoid(Trapezoid::ID id) const;
 
+    /**
+     * @brief Get the maximum number of events held in memory during the last parallel rotational sweep
+     *
+     * The events are streamed from bounded per-vertex buffers rather than materialized all at once. When the sweep is
+     * split into multiple sectors, the peaks of all sectors are summed, as the sectors might be swept concurrently.
+     *
+     * @return the events peak
+     */
+    size_t get_prs_events_peak() const;
+
+    /**
+     * @brief Get an estimate of the number of bytes used by the scene, its arrangement and the trapezoids
+     */
+    size_t memory_usage() const;
+
   private:
-    void init_poly_set(const Polygon_with_holes& scene);
-    bool is_free(const Face& face);
-    Trapezoid::ID create_trapezoid(const Halfedge& top_edge, const Halfedge& bottom_edge, const Vertex& left_vertex,
-                                   const Vertex& right_vertex);
-    void finalize_trapezoid(const Trapezoid& trapezoid);
-    void init_trapezoids_with_regular_vertical_decomposition();
-    void calc_trapezoids_with_rotational_sweep();
+    void init_poly_set(const Polygon_with_holes& scene, bool validate = true);
+    bool is_free(const Face& face) const;
+    void init_sweep_state(SweepState& state) const;
+    Trapezoid::ID create_trapezoid(SweepState& state, const Halfedge& top_edge, const Halfedge& bottom_edge,
+                                   const Vertex& left_vertex, const Vertex& right_vertex) const;
+    void finalize_trapezoid(SweepState& state, const Trapezoid& trapezoid) const;
+    void init_trapezoids_with_regular_vertical_decomposition(SweepState& state) const;
+    void init_trapezoids_with_decomposition(SweepState& state, const Direction& dir) const;
+    void init_ray_edges(SweepState& state, const Direction& dir, const SweepRestriction* restriction) const;
+    Trapezoid::ID resolve_trapezoid(SweepState& state, const SweepRestriction& restriction, Topology::VertexID v,
+                                    unsigned int slot, const Direction& angle) const;
+    template <typename Events>
+    void calc_trapezoids_with_rotational_sweep(SweepState& state, Events& events,
+                                               const SweepRestriction* restriction) const;
+    void sweep_sectors(std::vector<SweepState>& states, unsigned int sectors_num, unsigned int threads_num,
+                       const SweepRestriction* restriction);
+    void merge_sweep_states(std::vector<SweepState>& states);
 };
 
 } // namespace FDML
@@ -0,0 +1,202 @@
+#include "fdml/binary_result.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace FDML {
+
+static const char BINARY_RESULT_MAGIC[4] = {'F', 'D', 'M', 'R'};
+static const uint32_t BINARY_RESULT_VERSION = 1;
+static const size_t BINARY_RESULT_HEADER_SIZE = 24;
+/* offset of the records number within the header */
+static const size_t BINARY_RESULT_RECORDS_NUM_OFFSET = 16;
+
+/* Little endian encoding, independent of the machine byte order. Compilers reduce the byte loops to plain stores and
+ * loads on little endian machines. */
+
+static void put_u32(char* p, uint32_t x) {
+    for (unsigned int i = 0; i < 4; i++)
+        p[i] = (char)(x >> (8 * i));
+}
+
+static void put_u64(char* p, uint64_t x) {
+    for (unsigned int i = 0; i < 8; i++)
+        p[i] = (char)(x >> (8 * i));
+}
+
+static void put_f64(char* p, double x) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    put_u64(p, bits);
+}
+
+static void put_point(char* p, const Point& point) {
+    put_f64(p, CGAL::to_double(point.x()));
+    put_f64(p + 8, CGAL::to_double(point.y()));
+}
+
+static uint32_t get_u32(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    uint32_t x = 0;
+    for (unsigned int i = 0; i < 4; i++)
+        x |= (uint32_t)b[i] << (8 * i);
+    return x;
+}
+
+static uint64_t get_u64(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    uint64_t x = 0;
+    for (unsigned int i = 0; i < 8; i++)
+        x |= (uint64_t)b[i] << (8 * i);
+    return x;
+}
+
+static double get_f64(const char* p) {
+    const uint64_t bits = get_u64(p);
+    double x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+BinaryResultWriter::BinaryResultWriter(Type type) : type(type) {
+    char* header = append(BINARY_RESULT_HEADER_SIZE);
+    std::memcpy(header, BINARY_RESULT_MAGIC, sizeof(BINARY_RESULT_MAGIC));
+    put_u32(header + 4, BINARY_RESULT_VERSION);
+    put_u32(header + 8, type);
+    put_u32(header + 12, 0);
+    put_u64(header + BINARY_RESULT_RECORDS_NUM_OFFSET, 0);
+}
+
+char* BinaryResultWriter::append(size_t size) {
+    const size_t offset = buf.size();
+    buf.resize(offset + size);
+    return &buf[offset];
+}
+
+void BinaryResultWriter::check_type(Type record_type) const {
+    if (record_type != type)
+        throw std::logic_error("binary result record type differs from the result type");
+}
+
+void BinaryResultWriter::add_polygon(uint32_t edge, const Polygon& polygon) {
+    check_type(POLYGONS);
+    char* p = append(8 + polygon.size() * 16);
+    put_u32(p, edge);
+    put_u32(p + 4, polygon.size());
+    p += 8;
+    for (auto it = polygon.vertices_begin(); it != polygon.vertices_end(); ++it, p += 16)
+        put_point(p, *it);
+    records_num++;
+}
+
+void BinaryResultWriter::add_segments(uint32_t edge1, uint32_t edge2, const std::vector<Segment>& segments) {
+    check_type(SEGMENTS);
+    char* p = append(16 + segments.size() * 32);
+    put_u32(p, edge1);
+    put_u32(p + 4, edge2);
+    put_u32(p + 8, segments.size());
+    put_u32(p + 12, 0);
+    p += 16;
+    for (auto it = segments.begin(); it != segments.end(); ++it, p += 32) {
+        put_point(p, it->source());
+        put_point(p + 16, it->target());
+    }
+    records_num++;
+}
+
+void BinaryResultWriter::add_point(uint32_t edge1, uint32_t edge2, uint32_t edge3, uint32_t edge4,
+                                   const Point& point) {
+    check_type(POINTS);
+    char* p = append(32);
+    put_u32(p, edge1);
+    put_u32(p + 4, edge2);
+    put_u32(p + 8, edge3);
+    put_u32(p + 12, edge4);
+    put_point(p + 16, point);
+    records_num++;
+}
+
+const std::string& BinaryResultWriter::data() {
+    put_u64(&buf[BINARY_RESULT_RECORDS_NUM_OFFSET], records_num);
+    return buf;
+}
+
+void BinaryResultWriter::write(std::ostream& os) {
+    const std::string& res = data();
+    os.write(res.data(), res.size());
+}
+
+static std::runtime_error invalid_result(const std::string& what) {
+    return std::runtime_error("invalid binary result: " + what);
+}
+
+BinaryResult BinaryResult::parse(const char* data, size_t size) {
+    if (size < BINARY_RESULT_HEADER_SIZE || std::memcmp(data, BINARY_RESULT_MAGIC, sizeof(BINARY_RESULT_MAGIC)) != 0)
+        throw invalid_result("bad magic");
+    if (get_u32(data + 4) != BINARY_RESULT_VERSION)
+        throw invalid_result("unsupported version " + std::to_string(get_u32(data + 4)));
+    BinaryResult res;
+    const uint32_t type = get_u32(data + 8);
+    if (type != BinaryResultWriter::POLYGONS && type != BinaryResultWriter::SEGMENTS &&
+        type != BinaryResultWriter::POINTS)
+        throw invalid_result("unknown type " + std::to_string(type));
+    res.type = (BinaryResultWriter::Type)type;
+    const uint64_t records_num = get_u64(data + BINARY_RESULT_RECORDS_NUM_OFFSET);
+
+    /* each record is at least 8 bytes, which bounds the number of records before they are allocated */
+    const char *p = data + BINARY_RESULT_HEADER_SIZE, *end = data + size;
+    if (records_num > (uint64_t)(end - p) / 8)
+        throw invalid_result("truncated");
+    res.records.resize(records_num);
+    for (Record& record : res.records) {
+        size_t edges_num, points_num;
+        switch (res.type) {
+        case BinaryResultWriter::POLYGONS:
+            edges_num = 1;
+            if (end - p < 8)
+                throw invalid_result("truncated");
+            points_num = get_u32(p + 4);
+            break;
+        case BinaryResultWriter::SEGMENTS:
+            edges_num = 2;
+            if (end - p < 16)
+                throw invalid_result("truncated");
+            points_num = 2 * (size_t)get_u32(p + 8);
+            break;
+        default:
+            edges_num = 4;
+            points_num = 1;
+            break;
+        }
+        const size_t record_header_size = res.type == BinaryResultWriter::POLYGONS ? 8 : 16;
+        if ((size_t)(end - p) < record_header_size || (size_t)(end - p - record_header_size) / 16 < points_num)
+            throw invalid_result("truncated");
+
+        record.edges.resize(edges_num);
+        for (size_t i = 0; i < edges_num; i++)
+            record.edges[i] = get_u32(p + 4 * i);
+        p += record_header_size;
+        record.coords.resize(2 * points_num);
+        for (double& x : record.coords) {
+            x = get_f64(p);
+            p += 8;
+        }
+    }
+    if (p != end)
+        throw invalid_result("trailing data");
+    return res;
+}
+
+BinaryResult BinaryResult::read(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("failed to open binary result file: " + filename);
+    std::ostringstream data;
+    data << file.rdbuf();
+    const std::string content = data.str();
+    return parse(content.data(), content.size());
+}
+
+} // namespace FDML
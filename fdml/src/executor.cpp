@@ -0,0 +1,136 @@
+#include "fdml/executor.hpp"
+
+#include <algorithm>
+
+namespace FDML {
+
+/* The executor whose loop is currently executed by this thread, used to execute nested loops inline */
+static thread_local const Executor* current_executor = nullptr;
+
+Executor::Executor() : Executor(1) {}
+
+Executor::Executor(unsigned int threads_num)
+    : job(nullptr), job_generation(0), pending_chunks(0), failed(false), stop(false) {
+    if (threads_num == 0)
+        threads_num = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int t = 0; t < threads_num; t++)
+        queues.push_back(std::make_unique<WorkerQueue>());
+    for (unsigned int t = 0; t + 1 < threads_num; t++)
+        threads.emplace_back(&Executor::worker_main, this, t);
+}
+
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    job_cv.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+unsigned int Executor::get_threads_num() const {
+    return threads.size() + 1;
+}
+
+void Executor::parallel_for(size_t n, size_t chunk_size, const std::function<void(size_t, size_t)>& op) {
+    chunk_size = std::max<size_t>(1, chunk_size);
+    const size_t chunks_num = (n + chunk_size - 1) / chunk_size;
+    if (threads.empty() || chunks_num <= 1 || current_executor == this) {
+        for (size_t begin = 0; begin < n; begin += chunk_size)
+            op(begin, std::min(n, begin + chunk_size));
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(run_mutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &op;
+        error = nullptr;
+        failed = false;
+        pending_chunks = chunks_num;
+        /* distribute contiguous blocks of chunks to the queues */
+        for (size_t c = 0; c < chunks_num; c++) {
+            WorkerQueue& queue = *queues[c * queues.size() / chunks_num];
+            std::lock_guard<std::mutex> queue_lock(queue.mutex);
+            queue.ranges.push_back({c * chunk_size, std::min(n, (c + 1) * chunk_size)});
+        }
+        job_generation++;
+    }
+    job_cv.notify_all();
+
+    /* the calling thread participates in the loop using the last queue */
+    const Executor* prev_executor = current_executor;
+    current_executor = this;
+    while (run_chunk(queues.size() - 1))
+        ;
+    current_executor = prev_executor;
+
+    std::exception_ptr err;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [this]() { return pending_chunks == 0; });
+        job = nullptr;
+        err = error;
+    }
+    if (err)
+        std::rethrow_exception(err);
+}
+
+void Executor::worker_main(unsigned int worker) {
+    current_executor = this;
+    uint64_t seen_generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_cv.wait(lock, [this, seen_generation]() { return stop || job_generation != seen_generation; });
+            if (stop)
+                return;
+            seen_generation = job_generation;
+        }
+        while (run_chunk(worker))
+            ;
+    }
+}
+
+/* Pop a range from the front of the thread own queue, or steal one from the back of another queue */
+bool Executor::pop_range(unsigned int worker, Range& range) {
+    for (unsigned int i = 0; i < queues.size(); i++) {
+        WorkerQueue& queue = *queues[(worker + i) % queues.size()];
+        std::lock_guard<std::mutex> queue_lock(queue.mutex);
+        if (queue.ranges.empty())
+            continue;
+        if (i == 0) {
+            range = queue.ranges.front();
+            queue.ranges.pop_front();
+        } else {
+            range = queue.ranges.back();
+            queue.ranges.pop_back();
+        }
+        return true;
+    }
+    return false;
+}
+
+bool Executor::run_chunk(unsigned int worker) {
+    Range range;
+    if (!pop_range(worker, range))
+        return false;
+    if (!failed) {
+        try {
+            (*job)(range.begin, range.end);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error)
+                error = std::current_exception();
+            failed = true;
+        }
+    }
+    if (pending_chunks.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done_cv.notify_all();
+    }
+    return true;
+}
+
+} // namespace FDML
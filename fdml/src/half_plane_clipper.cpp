@@ -0,0 +1,173 @@
+#include "fdml/internal/half_plane_clipper.hpp"
+
+#include <CGAL/Arr_observer.h>
+#include <CGAL/Boolean_set_operations_2.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace FDML {
+
+/* A point in which the polygon boundary crosses the line */
+struct Crossing {
+    Point point;
+    /* The position of the point along the line, and a tie breaker of crossings at the same point, which orders them as
+     * if the line was shifted infinitesimally into the half plane */
+    Kernel::FT pos, pos_tie;
+    /* true for a crossing into the half plane, false for a crossing out of it */
+    bool entry;
+    /* the chain starting (entry) or ending (exit) at the crossing */
+    unsigned int chain;
+};
+
+std::vector<Polygon> HalfPlaneClipper::clip(const Polygon& poly, const Line& line) {
+    std::vector<Point> points(poly.vertices_begin(), poly.vertices_end());
+    if (poly.orientation() == CGAL::CLOCKWISE)
+        std::reverse(points.begin(), points.end());
+    const unsigned int n = points.size();
+
+    /* Vertices on the line are considered outside the half plane, as if the line was shifted into the half plane */
+    std::vector<bool> inside(n);
+    for (unsigned int i = 0; i < n; i++)
+        inside[i] = line.oriented_side(points[i]) == CGAL::ON_POSITIVE_SIDE;
+    auto outside_it = std::find(inside.begin(), inside.end(), false);
+    if (outside_it == inside.end())
+        return {Polygon(points.begin(), points.end())};
+    if (std::find(inside.begin(), inside.end(), true) == inside.end())
+        return {};
+
+    /* Walk the boundary once starting at an outside vertex, and split it into chains within the half plane. Each chain
+     * starts at an entry crossing and ends at an exit crossing. */
+    const Vector line_vec = line.to_vector(), line_normal = line_vec.perpendicular(CGAL::COUNTERCLOCKWISE);
+    std::vector<std::vector<Point>> chains;
+    std::vector<Crossing> crossings;
+    auto add_crossing = [&](const Point& p_in, const Point& p_out, bool entry) {
+        Point x;
+        if (line.has_on(p_out)) {
+            x = p_out;
+        } else {
+            Kernel::FT val_in = line.a() * p_in.x() + line.b() * p_in.y() + line.c();
+            Kernel::FT val_out = line.a() * p_out.x() + line.b() * p_out.y() + line.c();
+            x = p_in + (p_out - p_in) * (val_in / (val_in - val_out));
+        }
+        Vector w = p_in - x;
+        crossings.push_back({x, (x - CGAL::ORIGIN) * line_vec, (w * line_vec) / (w * line_normal), entry,
+                             (unsigned int)chains.size() - 1});
+        chains.back().push_back(x);
+    };
+    const unsigned int start = outside_it - inside.begin();
+    for (unsigned int k = 0; k < n; k++) {
+        unsigned int i = (start + k) % n, j = (start + k + 1) % n;
+        if (!inside[i] && inside[j]) {
+            chains.emplace_back();
+            add_crossing(points[j], points[i], true);
+        }
+        if (inside[j])
+            chains.back().push_back(points[j]);
+        else if (inside[i])
+            add_crossing(points[i], points[j], false);
+    }
+
+    /* The line within the polygon is a set of intervals between consecutive crossings in their order along the line.
+     * Each piece continues from the exit crossing of a chain along its interval to the entry of the next chain. */
+    std::vector<unsigned int> order(crossings.size());
+    std::iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&crossings](unsigned int c1, unsigned int c2) {
+        const Crossing &x1 = crossings[c1], &x2 = crossings[c2];
+        return x1.pos != x2.pos ? x1.pos < x2.pos : x1.pos_tie < x2.pos_tie;
+    });
+    std::vector<unsigned int> next_chain(chains.size());
+    for (unsigned int k = 0; k + 1 < order.size(); k += 2) {
+        const Crossing &x1 = crossings[order[k]], &x2 = crossings[order[k + 1]];
+        if (x1.entry == x2.entry)
+            throw std::logic_error("polygon is not simple");
+        next_chain[x1.entry ? x2.chain : x1.chain] = x1.entry ? x1.chain : x2.chain;
+    }
+
+    std::vector<Polygon> res;
+    std::vector<bool> visited(chains.size(), false);
+    for (unsigned int c_begin = 0; c_begin < chains.size(); c_begin++) {
+        if (visited[c_begin])
+            continue;
+        Polygon piece;
+        for (unsigned int c = c_begin; !visited[c]; c = next_chain[c]) {
+            visited[c] = true;
+            for (const Point& p : chains[c])
+                if (piece.is_empty() || p != piece[piece.size() - 1])
+                    piece.push_back(p);
+        }
+        if (piece.size() > 1 && piece[0] == piece[piece.size() - 1])
+            piece.erase(piece.vertices_end() - 1);
+        if (piece.size() >= 3)
+            res.push_back(std::move(piece));
+    }
+    return res;
+}
+
+class Face_contained_prop_observer : public CGAL::Arr_observer<Arrangement> {
+public:
+  Face_contained_prop_observer(Arrangement& arr) : CGAL::Arr_observer<Arrangement>(arr) {}
+  virtual void after_split_face(Face_handle old_face, Face_handle new_face, bool _is_hole) {
+    new_face->set_contained(old_face->contained());
+  }
+};
+
+std::vector<Polygon> HalfPlaneClipper::clip_by_arrangement(const Polygon& poly, const Line& line) {
+    /* Create a long segment on the line, which will operate as half plane */
+    CGAL::Bbox_2 bbox = poly.bbox();
+    Point center = line.projection(Point((bbox.xmin() + bbox.xmax()) / 2, (bbox.ymin() + bbox.ymax()) / 2));
+    double diag = std::sqrt(std::pow(bbox.xmax() - bbox.xmin(), 2) + std::pow(bbox.ymax() - bbox.ymin(), 2));
+    Vector line_vec = line.to_vector() * ((diag + 1) / std::sqrt(CGAL::to_double(line.to_vector().squared_length())));
+    Segment halfplane_seg(center - line_vec, center + line_vec);
+
+    /* Create an arrangement containing the input polygon */
+    Polygon_set ps;
+    ps.insert(poly);
+    auto arr = ps.arrangement();
+
+    /* Add an observer to preseve the 'contained' property */
+    Face_contained_prop_observer obs(arr);
+
+    /* Insert the half plane segment */
+    CGAL::insert(arr, halfplane_seg);
+
+    /* Iterate over the resulting faces in the arrangement and collect all result polygon in the correct half plane */
+    std::vector<Polygon> res;
+    for (auto it = arr.faces_begin(); it != arr.faces_end(); ++it) {
+        auto face = it;
+        if (face->is_unbounded() || !face->contained())
+            continue;
+
+        /* Check on which side the face is relative to the half plane */
+        bool is_valid = false;
+        Arrangement::Ccb_halfedge_const_circulator circ = face->outer_ccb();
+        for (unsigned int i = 0; i < 3; i++) {
+            Point p = circ->target()->point();
+            CGAL::Orientation o = CGAL::orientation(halfplane_seg.source(), halfplane_seg.target(), p);
+            if (o == CGAL::LEFT_TURN) {
+                is_valid = true;
+                break;
+            } else if (o == CGAL::RIGHT_TURN) {
+                is_valid = false;
+                break;
+            }
+            /* else, point is collinear with halfplane, continue */
+            circ++;
+        }
+        if (!is_valid)
+            continue;
+
+        /* Add result face's polygon */
+        Polygon p;
+        for (Arrangement::Ccb_halfedge_const_circulator begin = face->outer_ccb(), e = begin;;) {
+            p.push_back(e->target()->point());
+            if (++e == begin)
+                break;
+        }
+        res.push_back(p);
+    }
+
+    return res;
+}
+
+} // namespace FDML
@@ -0,0 +1,93 @@
+#include "fdml/interval_index.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace FDML {
+
+/* Number of intervals in a leaf block of the tree */
+static const size_t BLOCK_SIZE = 32;
+
+void IntervalIndex::build(const std::vector<Interval>& intervals) {
+    const size_t n = intervals.size();
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&intervals](size_t i1, size_t i2) {
+        const Interval &a = intervals[i1], &b = intervals[i2];
+        return a.min != b.min ? a.min < b.min : a.id < b.id;
+    });
+    mins.resize(n);
+    maxs.resize(n);
+    ids.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        const Interval& interval = intervals[order[i]];
+        mins[i] = interval.min;
+        maxs[i] = interval.max;
+        ids[i] = interval.id;
+    }
+
+    /* the leaves are padded to a power of two with empty blocks, which are never reached by a query */
+    const size_t blocks_num = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    for (leaves_begin = 1; leaves_begin < blocks_num; leaves_begin *= 2)
+        ;
+    tree.assign(2 * leaves_begin, -std::numeric_limits<double>::infinity());
+    for (size_t b = 0; b < blocks_num; b++)
+        tree[leaves_begin + b] =
+            *std::max_element(maxs.begin() + b * BLOCK_SIZE, maxs.begin() + std::min(n, (b + 1) * BLOCK_SIZE));
+    for (size_t i = leaves_begin - 1; i >= 1; i--)
+        tree[i] = std::max(tree[2 * i], tree[2 * i + 1]);
+}
+
+void IntervalIndex::clear() {
+    mins.clear();
+    maxs.clear();
+    ids.clear();
+    tree.clear();
+    leaves_begin = 0;
+}
+
+size_t IntervalIndex::memory_usage() const {
+    return mins.capacity() * sizeof(double) + maxs.capacity() * sizeof(double) + ids.capacity() * sizeof(uint32_t) +
+           tree.capacity() * sizeof(double);
+}
+
+void IntervalIndex::query(double min, double max, std::vector<Interval>& res) const {
+    /* the intervals with a min not greater than the query max are a prefix of the sorted intervals */
+    const size_t prefix = std::upper_bound(mins.begin(), mins.end(), max) - mins.begin();
+    if (prefix == 0)
+        return;
+    const size_t last_block = (prefix - 1) / BLOCK_SIZE;
+
+    /* depth first traversal, visiting the left child first so the output is ordered by min */
+    struct Node {
+        size_t node, first_block, blocks_num;
+    };
+    Node stack[2 * std::numeric_limits<size_t>::digits];
+    size_t stack_size = 0;
+    stack[stack_size++] = {1, 0, leaves_begin};
+    while (stack_size > 0) {
+        const Node n = stack[--stack_size];
+        if (n.first_block > last_block || tree[n.node] < min)
+            continue;
+        if (n.blocks_num > 1) {
+            const size_t half = n.blocks_num / 2;
+            stack[stack_size++] = {2 * n.node + 1, n.first_block + half, half};
+            stack[stack_size++] = {2 * n.node, n.first_block, half};
+            continue;
+        }
+
+        /* scan the block without branches, each interval is written and kept only if it intersects the query */
+        const size_t begin = n.first_block * BLOCK_SIZE, end = std::min(prefix, begin + BLOCK_SIZE);
+        const size_t res_begin = res.size();
+        res.resize(res_begin + (end - begin));
+        size_t count = 0;
+        for (size_t j = begin; j < end; j++) {
+            res[res_begin + count] = {mins[j], maxs[j], ids[j]};
+            count += maxs[j] >= min;
+        }
+        res.resize(res_begin + count);
+    }
+}
+
+} // namespace FDML
@@ -0,0 +1,115 @@
+#include "fdml/json_result_writer.hpp"
+
+#include <charconv>
+#include <limits>
+#include <stdexcept>
+
+namespace FDML {
+
+/* Size of encoded results buffered before they are written to the output stream */
+static const size_t JSON_FLUSH_SIZE = 64 * 1024;
+/* Nesting depth of the results array elements, the top object is at depth 0 */
+static const unsigned int JSON_RESULTS_DEPTH = 2;
+
+JsonResultWriter::JsonResultWriter(std::ostream& os, const std::string& field, Style style, int precision)
+    : os(os), style(style), precision(precision) {
+    if (precision < 0 || precision > std::numeric_limits<double>::max_digits10)
+        throw std::invalid_argument("invalid JSON float precision: " + std::to_string(precision));
+    buf.reserve(JSON_FLUSH_SIZE + 1024);
+    if (style == PRETTY)
+        buf.append("{\n    \"").append(field).append("\" : ");
+    else
+        buf.append("{\"").append(field).append("\":");
+    open_array();
+}
+
+/* The pretty layout follows json_format_pretty of JsonUtils: each element on its own line indented by 4 spaces per
+ * depth, and an empty array spanning an empty line */
+
+void JsonResultWriter::open_array() { buf.push_back('['); }
+
+void JsonResultWriter::next_element(unsigned int depth, bool first) {
+    if (style == COMPACT) {
+        if (!first)
+            buf.push_back(',');
+        return;
+    }
+    buf.append(first ? "\n" : ",\n");
+    buf.append(4 * depth, ' ');
+}
+
+void JsonResultWriter::close_array(unsigned int depth, bool empty) {
+    if (style == PRETTY) {
+        buf.append(empty ? "\n\n" : "\n");
+        buf.append(4 * depth, ' ');
+    }
+    buf.push_back(']');
+}
+
+void JsonResultWriter::write_double(double x) {
+    char str[64];
+    const std::to_chars_result res = precision == SHORTEST_PRECISION
+                                         ? std::to_chars(str, str + sizeof(str), x)
+                                         : std::to_chars(str, str + sizeof(str), x, std::chars_format::general,
+                                                         precision);
+    if (res.ec != std::errc())
+        throw std::runtime_error("failed to format JSON float");
+    buf.append(str, res.ptr);
+}
+
+void JsonResultWriter::write_point(const Point& point, unsigned int depth) {
+    open_array();
+    next_element(depth + 1, true);
+    write_double(CGAL::to_double(point.x()));
+    next_element(depth + 1, false);
+    write_double(CGAL::to_double(point.y()));
+    close_array(depth, false);
+}
+
+void JsonResultWriter::result_added() {
+    results_num++;
+    if (buf.size() >= JSON_FLUSH_SIZE) {
+        os.write(buf.data(), buf.size());
+        buf.clear();
+    }
+}
+
+void JsonResultWriter::add_polygon(const Polygon& polygon) {
+    const unsigned int depth = JSON_RESULTS_DEPTH;
+    next_element(depth, results_num == 0);
+    open_array();
+    for (auto it = polygon.vertices_begin(); it != polygon.vertices_end(); ++it) {
+        next_element(depth + 1, it == polygon.vertices_begin());
+        write_point(*it, depth + 1);
+    }
+    close_array(depth, polygon.is_empty());
+    result_added();
+}
+
+void JsonResultWriter::add_segment(const Segment& segment) {
+    const unsigned int depth = JSON_RESULTS_DEPTH;
+    next_element(depth, results_num == 0);
+    open_array();
+    next_element(depth + 1, true);
+    write_point(segment.source(), depth + 1);
+    next_element(depth + 1, false);
+    write_point(segment.target(), depth + 1);
+    close_array(depth, false);
+    result_added();
+}
+
+void JsonResultWriter::add_point(const Point& point) {
+    next_element(JSON_RESULTS_DEPTH, results_num == 0);
+    write_point(point, JSON_RESULTS_DEPTH);
+    result_added();
+}
+
+void JsonResultWriter::finish() {
+    close_array(JSON_RESULTS_DEPTH - 1, results_num == 0);
+    buf.append(style == PRETTY ? "\n}\n" : "}\n");
+    os.write(buf.data(), buf.size());
+    buf.clear();
+    os.flush();
+}
+
+} // namespace FDML
@@ -235,6 +235,12 @@ static boost::json::array point2json(const Point& p) {
 
 void JsonUtils::write_polygons(const std::vector<Polygon>& polygons, const std::string& filename) {
     fdml_debugln("[JsonUtils] writing polygons into: " << filename);
+    std::ofstream outfile(filename);
+    write_polygons(polygons, outfile);
+    outfile.close();
+}
+
+void JsonUtils::write_polygons(const std::vector<Polygon>& polygons, std::ostream& os) {
     std::vector<boost::json::array> polygon_objs;
     for (const Polygon& polygon : polygons) {
         std::vector<boost::json::array> point_objs;
@@ -248,13 +254,17 @@ void JsonUtils::write_polygons(const std::vector<Polygon>& polygons, const std::
     boost::json::object top_lvl_obj(top_lvl_fields.begin(), top_lvl_fields.end());
     boost::json::value top_lvl_obj2(top_lvl_obj);
 
-    std::ofstream outfile(filename);
-    json_format_pretty(outfile, top_lvl_obj2);
-    outfile.close();
+    json_format_pretty(os, top_lvl_obj2);
 }
 
 void JsonUtils::write_segments(const std::vector<Segment>& segments, const std::string& filename) {
     fdml_debugln("[JsonUtils] writing segments into: " << filename);
+    std::ofstream outfile(filename);
+    write_segments(segments, outfile);
+    outfile.close();
+}
+
+void JsonUtils::write_segments(const std::vector<Segment>& segments, std::ostream& os) {
     std::vector<boost::json::array> segments_objs;
     for (const Segment& segment : segments) {
         std::vector<boost::json::array> point_objs;
@@ -267,13 +277,17 @@ void JsonUtils::write_segments(const std::vector<Segment>& segments, const std::
     boost::json::object top_lvl_obj(top_lvl_fields.begin(), top_lvl_fields.end());
     boost::json::value top_lvl_obj2(top_lvl_obj);
 
-    std::ofstream outfile(filename);
-    json_format_pretty(outfile, top_lvl_obj2);
-    outfile.close();
+    json_format_pretty(os, top_lvl_obj2);
 }
 
 void JsonUtils::write_points(const std::vector<Point>& points, const std::string& filename) {
     fdml_debugln("[JsonUtils] writing points into: " << filename);
+    std::ofstream outfile(filename);
+    write_points(points, outfile);
+    outfile.close();
+}
+
+void JsonUtils::write_points(const std::vector<Point>& points, std::ostream& os) {
     std::vector<boost::json::array> point_objs;
     for (auto it = points.begin(); it != points.end(); ++it)
         point_objs.push_back(point2json(*it));
@@ -284,9 +298,7 @@ void JsonUtils::write_points(const std::vector<Point>& points, const std::string
     boost::json::object top_lvl_obj(top_lvl_fields.begin(), top_lvl_fields.end());
     boost::json::value top_lvl_obj2(top_lvl_obj);
 
-    std::ofstream outfile(filename);
-    json_format_pretty(outfile, top_lvl_obj2);
-    outfile.close();
+    json_format_pretty(os, top_lvl_obj2);
 }
 
 } // namespace FDML
@@ -1,15 +1,56 @@
 #include "fdml/locator.hpp"
+#include "fdml/internal/curve_sampling.hpp"
+#include "fdml/internal/half_plane_clipper.hpp"
 #include "fdml/internal/utils.hpp"
 
+#include <CGAL/Boolean_set_operations_2.h>
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <tuple>
+
 namespace FDML {
 
-void Locator::init(const Polygon_with_holes& scene) {
+static const Trapezoid::ID INVALID_TRAPEZOID_ID = 0xffffffff;
+
+/* The geometric identity of a trapezoid, independent of the arrangement handles. Used to match the trapezoids of two
+ * different scenes. */
+class TrapezoidKey {
+    std::array<Point, 6> points;
+    Direction angle_begin, angle_end;
+
+  public:
+    TrapezoidKey(const Trapezoid& t)
+        : points({t.top_edge->source()->point(), t.top_edge->target()->point(), t.bottom_edge->source()->point(),
+                  t.bottom_edge->target()->point(), t.left_vertex->point(), t.right_vertex->point()}),
+          angle_begin(t.angle_begin), angle_end(t.angle_end) {}
+
+    bool operator<(const TrapezoidKey& other) const {
+        if (points != other.points)
+            return points < other.points;
+        if (angle_begin != other.angle_begin)
+            return angle_begin < other.angle_begin;
+        return angle_end != other.angle_end && angle_end < other.angle_end;
+    }
+};
+
+void Locator::init(const Polygon_with_holes& scene, unsigned int sectors_num, unsigned int threads_num) {
     fdml_infoln("[Locator] init...");
+    this->sectors_num = sectors_num;
+    this->threads_num = threads_num;
+    openings.clear();
+    plans.clear();
     sorted_by_max.clear();
-    rtree.clear();
+    sorted_max_upper.clear();
+    interval_index.clear();
+    heading_index.clear();
+    region_index.clear();
 
     /* Calculate all trapezoids */
-    trapezoider.calc_trapezoids(scene);
+    trapezoider.calc_trapezoids(scene, sectors_num, threads_num);
 
     /* Fill trapezoids data structure and calculate min and max opening */
     for (unsigned int i = 0; i < trapezoider.number_of_trapezoids(); i++) {
@@ -18,6 +59,8 @@ void Locator::init(const Polygon_with_holes& scene) {
         trapezoid.calc_min_max_openings(min, max);
         openings.emplace_back(min.exact(), max.exact());
     }
+    calc_query_plans();
+    calc_trapezoids_edges();
 
     fdml_debugln("[Locator] Trapezoids openings:");
     for (auto it = trapezoider.trapezoids_begin(); it != trapezoider.trapezoids_end(); ++it) {
@@ -30,68 +73,1018 @@ void Locator::init(const Polygon_with_holes& scene) {
         sorted_by_max.push_back(it->get_id());
     sort(sorted_by_max.begin(), sorted_by_max.end(),
          [this](const auto& t1, const auto& t2) { return openings.at(t1).max < openings.at(t2).max; });
+    calc_sorted_max_upper();
     fdml_debugln("[Locator] sorted_by_max:");
     for (const auto& t_id : sorted_by_max) {
         const auto& opening = openings.at(t_id);
         fdml_debugln("\tT" << t_id << " [" << opening.min << ", " << opening.max << "]");
     }
 
-    /* Populate interval tree of trapezoids, where each interval is [min opening, max opening] used for fast queries
+    /* Build the interval index of trapezoids, where each interval is [min opening, max opening] used for fast queries
      * with two measurements. */
+    build_interval_index();
+
+    /* Build the heading index of trapezoids, used for fast queries with a known heading range */
+    build_heading_index();
+
+    /* Build the region index of trapezoids, used for fast queries with a known region of interest */
+    build_region_index();
+
+    fdml_infoln("[Locator] init done");
+}
+
+/* The smallest double which is not smaller than an exact number, and the largest double which is not greater than it.
+ * The exact value is between them, or equal to both if it is a double. */
+static double upper_double(const Kernel::FT& x) {
+    return CGAL::to_interval(x.exact()).second;
+}
+static double lower_double(const Kernel::FT& x) {
+    return CGAL::to_interval(x.exact()).first;
+}
+
+void Locator::calc_sorted_max_upper() {
+    sorted_max_upper.resize(sorted_by_max.size());
+    for (size_t i = 0; i < sorted_by_max.size(); i++)
+        sorted_max_upper[i] = upper_double(openings.at(sorted_by_max[i]).max);
+}
+
+void Locator::build_interval_index() {
+    std::vector<IntervalIndex::Interval> intervals;
+    intervals.reserve(openings.size());
+    for (Trapezoid::ID id = 0; id < openings.size(); id++) {
+        const auto& opening = openings[id];
+        intervals.push_back({lower_double(opening.min), upper_double(opening.max), (uint32_t)id});
+    }
+    interval_index.build(intervals);
+}
+
+/* Margin in radians by which the angles of the heading index are rounded outwards, far above the error of the double
+ * angles of the directions */
+static const double HEADING_ANGLE_MARGIN = 1e-9;
+
+/* Split a counter clockwise angle interval, given by its begin angle and its range in radians, into intervals within
+ * [0, 2 * PI]. The interval is rounded outwards, and split into two if it contains the zero angle. */
+static std::vector<std::pair<double, double>> split_heading_angles(double angle_begin, double angle_range) {
+    double begin = angle_begin - HEADING_ANGLE_MARGIN, end = angle_begin + angle_range + HEADING_ANGLE_MARGIN;
+    if (end - begin >= 2 * M_PI)
+        return {{0, 2 * M_PI}};
+    if (begin < 0) {
+        begin += 2 * M_PI;
+        end += 2 * M_PI;
+    }
+    if (end <= 2 * M_PI)
+        return {{begin, end}};
+    return {{begin, 2 * M_PI}, {0, end - 2 * M_PI}};
+}
+
+void Locator::add_heading_index_values(Trapezoid::ID id, std::vector<HeadingIndexValue>& values) const {
+    const Trapezoid::QueryPlan& plan = plans.at(id);
+    const auto& opening = openings.at(id);
+    const double angle_range = angle_between_inexact(plan.angle_begin, plan.angle_end);
+    for (const auto& angles : split_heading_angles(direction_angle_inexact(plan.angle_begin), angle_range)) {
+        const HeadingIndexPoint min(angles.first, lower_double(opening.min));
+        const HeadingIndexPoint max(angles.second, upper_double(opening.max));
+        values.emplace_back(HeadingIndexBox(min, max), id);
+    }
+}
+
+void Locator::build_heading_index() {
+    std::vector<HeadingIndexValue> values;
+    values.reserve(plans.size());
+    for (Trapezoid::ID id = 0; id < plans.size(); id++)
+        add_heading_index_values(id, values);
+    /* bulk loading produces a better packed tree than inserting the boxes one by one */
+    heading_index = HeadingIndex(values.begin(), values.end());
+}
+
+std::vector<Trapezoid::ID> Locator::query_heading_index(const HeadingRange& heading, double opening_lower,
+                                                        double opening_upper) const {
+    std::vector<HeadingIndexValue> values;
+    const double heading_range = angle_between_inexact(heading.begin, heading.end);
+    for (const auto& angles : split_heading_angles(direction_angle_inexact(heading.begin), heading_range)) {
+        const HeadingIndexBox query_box(HeadingIndexPoint(angles.first, opening_lower),
+                                        HeadingIndexPoint(angles.second, opening_upper));
+        heading_index.query(boost::geometry::index::intersects(query_box), std::back_inserter(values));
+    }
+    std::vector<Trapezoid::ID> trapezoids_ids;
+    trapezoids_ids.reserve(values.size());
+    for (const HeadingIndexValue& value : values)
+        trapezoids_ids.push_back(value.second);
+    sort(trapezoids_ids.begin(), trapezoids_ids.end());
+    trapezoids_ids.erase(std::unique(trapezoids_ids.begin(), trapezoids_ids.end()), trapezoids_ids.end());
+    return trapezoids_ids;
+}
+
+Locator::RegionIndexValue Locator::region_index_value(const Trapezoid& trapezoid) {
+    /* the box of a polygon is calculated from the intervals of its vertices, so it is rounded outwards */
+    const CGAL::Bbox_2 bbox = trapezoid.get_bounds_2d().bbox();
+    const RegionIndexPoint min(bbox.xmin(), bbox.ymin()), max(bbox.xmax(), bbox.ymax());
+    return RegionIndexValue(RegionIndexBox(min, max), trapezoid.get_id());
+}
+
+void Locator::build_region_index() {
+    std::vector<RegionIndexValue> values;
+    values.reserve(trapezoider.number_of_trapezoids());
+    for (auto it = trapezoider.trapezoids_begin(); it != trapezoider.trapezoids_end(); ++it)
+        values.push_back(region_index_value(*it));
+    region_index = RegionIndex(values.begin(), values.end());
+}
+
+/* Intersect the angle interval of a trapezoid with a heading range, both counter clockwise. The result is up to two
+ * disjoint sub intervals of the trapezoid angles, two if the heading range wraps around and covers both ends of the
+ * trapezoid angles. Sub intervals of a single direction are omitted. */
+static std::vector<std::pair<Direction, Direction>> intersect_angles(const Direction& angle_begin,
+                                                                     const Direction& angle_end,
+                                                                     const Locator::HeadingRange& heading) {
+    auto in_interval = [](const Direction& dir, const Direction& begin, const Direction& end) {
+        return dir == begin || dir == end || dir.counterclockwise_in_between(begin, end);
+    };
+    std::vector<std::pair<Direction, Direction>> res;
+    /* an intersection sub interval starts at a begin contained in the other interval, and ends at the first end */
+    auto add = [&](const Direction& begin) {
+        if (begin == heading.end || begin == angle_end)
+            return;
+        const Direction& end = in_interval(angle_end, begin, heading.end) ? angle_end : heading.end;
+        if (begin != end)
+            res.emplace_back(begin, end);
+    };
+    if (in_interval(angle_begin, heading.begin, heading.end))
+        add(angle_begin);
+    if (heading.begin != angle_begin && in_interval(heading.begin, angle_begin, angle_end))
+        add(heading.begin);
+    return res;
+}
+
+/* Find the first position in sorted_by_max, starting at begin, of a trapezoid with a max opening not smaller than d.
+ * The binary searches run on the double upper bounds of the max openings. An upper bound u is greater than the exact
+ * value by less than an ulp, so u < lower(d) means the max opening is smaller than d, and u > upper(d) means it is not.
+ * The exact openings are compared only between these two positions, which are usually a few trapezoids at most. */
+size_t Locator::first_by_max(const Kernel::FT& d, size_t begin) const {
+    const std::pair<double, double> d_bounds = CGAL::to_interval(d.exact());
+    auto lo = std::lower_bound(sorted_max_upper.begin() + begin, sorted_max_upper.end(), d_bounds.first);
+    auto hi = std::upper_bound(lo, sorted_max_upper.end(), d_bounds.second);
+    auto it = std::lower_bound(sorted_by_max.begin() + (lo - sorted_max_upper.begin()),
+                               sorted_by_max.begin() + (hi - sorted_max_upper.begin()), d,
+                               [this](Trapezoid::ID t_id, const Kernel::FT& d) { return openings[t_id].max < d; });
+    return it - sorted_by_max.begin();
+}
+
+/* Check if the openings interval of an interval index candidate intersects [lo, hi], a single value if lo == hi. The
+ * interval bounds are rounded outwards by less than an ulp, so the candidate is decided by the doubles unless the range
+ * ends are within an ulp of the interval ends. */
+bool Locator::openings_intersect(const IntervalIndex::Interval& interval, const Kernel::FT& lo, const Kernel::FT& hi,
+                                 const std::pair<double, double>& lo_bounds,
+                                 const std::pair<double, double>& hi_bounds) const {
+    if (std::nextafter(interval.min, HUGE_VAL) <= hi_bounds.first &&
+        std::nextafter(interval.max, -HUGE_VAL) >= lo_bounds.second)
+        return true;
+    const auto& opening = openings[interval.id];
+    return opening.min <= hi && lo <= opening.max;
+}
+
+/* Calculate the query plans of all the trapezoids, stored contiguously by the trapezoids IDs */
+void Locator::calc_query_plans() {
+    plans.clear();
+    plans.reserve(trapezoider.number_of_trapezoids());
+    for (unsigned int i = 0; i < trapezoider.number_of_trapezoids(); i++)
+        plans.emplace_back(*trapezoider.get_trapezoid(i));
+}
+
+void Locator::calc_trapezoids_edges() {
+    const Topology& topology = trapezoider.get_topology();
+    trapezoids_edges.resize(trapezoider.number_of_trapezoids());
+    for (auto it = trapezoider.trapezoids_begin(); it != trapezoider.trapezoids_end(); ++it)
+        trapezoids_edges[it->get_id()] = {topology.edge_id(it->top_edge), topology.edge_id(it->bottom_edge)};
+}
+
+std::pair<Point, Point> Locator::get_edge(Topology::EdgeID edge) const {
+    const Topology& topology = trapezoider.get_topology();
+    if (edge >= topology.number_of_edges())
+        throw std::out_of_range("invalid edge ID: " + std::to_string(edge));
+    const Halfedge& e = topology.edge(edge);
+    return {e->source()->point(), e->target()->point()};
+}
+
+/* Number of (input, trapezoid) pairs evaluated by a thread at once during a query */
+static const size_t QUERY_CHUNK_SIZE = 16;
+
+/* Evaluate all the (input, trapezoid) pairs of a query using the executor. The pairs of the i-th input are
+ * [pairs_offsets[i], pairs_offsets[i + 1]), and op(i, j, entries) appends the result entries of the j-th pair of the
+ * i-th input. The pairs are split into chunks, each evaluated by a single thread, and the chunks entries are
+ * concatenated in order, so the result is independent of the executor. */
+template <typename Res, typename OP>
+static Locator::BatchRes<Res> evaluate_query_pairs(Executor& executor, const std::vector<size_t>& pairs_offsets,
+                                                   const OP& op) {
+    const size_t pairs_num = pairs_offsets.back();
+    const size_t chunks_num = (pairs_num + QUERY_CHUNK_SIZE - 1) / QUERY_CHUNK_SIZE;
+    std::vector<std::vector<Res>> chunks_entries(chunks_num);
+    std::vector<size_t> pairs_entries_num(pairs_num);
+
+    executor.parallel_for(pairs_num, QUERY_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        auto& entries = chunks_entries[begin / QUERY_CHUNK_SIZE];
+        size_t i = std::upper_bound(pairs_offsets.begin(), pairs_offsets.end(), begin) - pairs_offsets.begin() - 1;
+        for (size_t p = begin; p < end; p++) {
+            while (p >= pairs_offsets[i + 1])
+                i++;
+            size_t entries_num = entries.size();
+            op(i, p - pairs_offsets[i], entries);
+            pairs_entries_num[p] = entries.size() - entries_num;
+        }
+    });
+
+    Locator::BatchRes<Res> res;
+    res.offsets.resize(pairs_offsets.size());
+    res.offsets[0] = 0;
+    for (size_t i = 0; i + 1 < pairs_offsets.size(); i++)
+        res.offsets[i + 1] = std::accumulate(pairs_entries_num.begin() + pairs_offsets[i],
+                                             pairs_entries_num.begin() + pairs_offsets[i + 1], res.offsets[i]);
+    res.entries.reserve(res.offsets.back());
+    for (auto& entries : chunks_entries)
+        for (auto& entry : entries)
+            res.entries.push_back(std::move(entry));
+    return res;
+}
+
+/* Number of chunks per thread evaluated at once by a query with a visitor */
+static const size_t VISIT_WINDOW_CHUNKS = 4;
+
+/* Evaluate the candidates of a query and pass their entries to a visitor, in the order of the candidates, from the
+ * calling thread. op(j, entries) appends the entries of the j-th candidate. With a single thread the entries of each
+ * candidate are passed as soon as they are calculated. Otherwise the candidates are evaluated by the executor in
+ * windows of a few chunks per thread, and the entries of a window are passed once it is done, so the buffered entries
+ * are bounded by the window size rather than the result size. */
+template <typename Entry, typename OP>
+static void visit_query_candidates(Executor& executor, size_t candidates_num, const OP& op,
+                                   const std::function<void(Entry&)>& visitor) {
+    if (executor.get_threads_num() <= 1) {
+        std::vector<Entry> entries;
+        for (size_t j = 0; j < candidates_num; j++) {
+            op(j, entries);
+            for (Entry& entry : entries)
+                visitor(entry);
+            entries.clear();
+        }
+        return;
+    }
+
+    const size_t window_size = executor.get_threads_num() * VISIT_WINDOW_CHUNKS * QUERY_CHUNK_SIZE;
+    std::vector<std::vector<Entry>> chunks_entries(window_size / QUERY_CHUNK_SIZE);
+    for (size_t window_begin = 0; window_begin < candidates_num; window_begin += window_size) {
+        const size_t window_end = std::min(candidates_num, window_begin + window_size);
+        executor.parallel_for(window_end - window_begin, QUERY_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            auto& entries = chunks_entries[begin / QUERY_CHUNK_SIZE];
+            for (size_t j = begin; j < end; j++)
+                op(window_begin + j, entries);
+        });
+        for (auto& entries : chunks_entries) {
+            for (Entry& entry : entries)
+                visitor(entry);
+            entries.clear();
+        }
+    }
+}
+
+void Locator::set_executor(std::shared_ptr<Executor> executor) {
+    if (!executor)
+        throw std::invalid_argument("null executor");
+    this->executor = std::move(executor);
+}
+
+/* Kernel objects constructed for a query plan, the others share their representation with the arrangement */
+static const size_t QUERY_PLAN_CONSTRUCTED_OBJECTS = 13;
+
+/* Estimated bytes of an rtree, its values and a node overhead per max node capacity */
+template <typename RTree> static size_t rtree_memory_usage(const RTree& rtree) {
+    const size_t nodes_num = rtree.size() / RTree::parameters_type::max_elements;
+    return rtree.size() * sizeof(typename RTree::value_type) +
+           nodes_num * (sizeof(typename RTree::bounds_type) + sizeof(void*));
+}
+
+size_t Locator::memory_usage() const {
+    return trapezoider.memory_usage() + openings.capacity() * sizeof(TrapezoidOpening) +
+           openings.size() * 2 * LAZY_REP_BYTES + plans.capacity() * sizeof(Trapezoid::QueryPlan) +
+           plans.size() * QUERY_PLAN_CONSTRUCTED_OBJECTS * LAZY_REP_BYTES +
+           sorted_by_max.capacity() * sizeof(Trapezoid::ID) + sorted_max_upper.capacity() * sizeof(double) +
+           interval_index.memory_usage() + rtree_memory_usage(heading_index) + rtree_memory_usage(region_index) +
+           trapezoids_edges.capacity() * sizeof(trapezoids_edges[0]);
+}
+
+void Locator::add_hole(const Polygon& hole) {
+    fdml_infoln("[Locator] add hole...");
+    Polygon_with_holes scene = trapezoider.get_scene();
+    scene.add_hole(hole);
+    update_scene(scene, hole);
+}
+
+void Locator::remove_hole(unsigned int hole_idx) {
+    fdml_infoln("[Locator] remove hole " << hole_idx << "...");
+    Polygon_with_holes scene = trapezoider.get_scene();
+    if (hole_idx >= scene.number_of_holes())
+        throw std::invalid_argument("hole index is out of range");
+    const Polygon hole = *std::next(scene.holes_begin(), hole_idx);
+    scene.erase_hole(std::next(scene.holes_begin(), hole_idx));
+    update_scene(scene, hole);
+}
+
+void Locator::set_update_verification(bool enable) {
+    verify_updates = enable;
+}
+
+/* Update the locator to a new scene, which differs from the current one by a single hole. Only the trapezoids the hole
+ * might affect are recalculated, and the others are kept along with the recalculated ones which didn't change. Kept
+ * trapezoids keep their IDs and openings, and only the new trapezoids openings are calculated. Previous trapezoids IDs
+ * beyond the new number of trapezoids are moved to free IDs. */
+void Locator::update_scene(const Polygon_with_holes& scene, const Polygon& hole) {
+    if (trapezoider.get_scene().outer_boundary().is_empty())
+        throw std::logic_error("Locator wasn't initialized");
+    const size_t old_n = trapezoider.number_of_trapezoids();
+
+    std::vector<Trapezoid::ID> matched;
+    try {
+        trapezoider.update_trapezoids(scene, hole, matched, sectors_num, threads_num);
+    } catch (...) {
+        /* the trapezoider keeps the previous trapezoids, which the rest of the locator still matches */
+        fdml_errln("[Locator] update failed, the previous scene is kept");
+        throw;
+    }
+
+    const size_t n = matched.size();
+    std::vector<Trapezoid::ID> old_to_new(old_n, INVALID_TRAPEZOID_ID);
+    for (Trapezoid::ID i = 0; i < n; i++)
+        if (matched[i] != INVALID_TRAPEZOID_ID)
+            old_to_new[matched[i]] = matched[i];
+
+    /* kept trapezoids keep their IDs if possible, others are assigned the IDs of removed trapezoids first */
+    std::vector<Trapezoid::ID> free_ids;
+    for (Trapezoid::ID id = 0; id < n; id++)
+        if (id >= old_n || old_to_new[id] == INVALID_TRAPEZOID_ID)
+            free_ids.push_back(id);
+    auto next_free_id = free_ids.begin();
+    std::vector<Trapezoid::ID> new_ids(n, INVALID_TRAPEZOID_ID);
+    std::vector<Trapezoid::ID> moved, added;
+    for (Trapezoid::ID i = 0; i < n; i++)
+        if (matched[i] != INVALID_TRAPEZOID_ID && matched[i] < n)
+            new_ids[i] = matched[i];
+    for (Trapezoid::ID i = 0; i < n; i++) {
+        if (matched[i] != INVALID_TRAPEZOID_ID && matched[i] >= n) {
+            new_ids[i] = old_to_new[matched[i]] = *next_free_id++;
+            moved.push_back(matched[i]);
+        }
+    }
+    for (Trapezoid::ID i = 0; i < n; i++) {
+        if (matched[i] == INVALID_TRAPEZOID_ID) {
+            new_ids[i] = *next_free_id++;
+            added.push_back(new_ids[i]);
+        }
+    }
+    trapezoider.renumber_trapezoids(new_ids);
+    const size_t removed_num = old_n - (n - added.size());
+    fdml_infoln("[Locator] update: " << n - added.size() << " trapezoids kept (" << moved.size() << " moved), "
+                                     << removed_num << " removed, " << added.size() << " added");
+
+    /* remove the removed trapezoids from the sorted array, and rename the moved ones */
+    auto is_removed = [&old_to_new](Trapezoid::ID id) { return old_to_new[id] == INVALID_TRAPEZOID_ID; };
+    sorted_by_max.erase(std::remove_if(sorted_by_max.begin(), sorted_by_max.end(), is_removed), sorted_by_max.end());
+    for (auto& id : sorted_by_max)
+        id = old_to_new[id];
+
+    /* remove the heading index boxes of the removed and moved trapezoids, calculated from their previous openings and
+     * plans exactly as when they were inserted */
+    std::vector<HeadingIndexValue> heading_values;
+    for (Trapezoid::ID old_id = 0; old_id < old_n; old_id++)
+        if (old_to_new[old_id] != old_id)
+            add_heading_index_values(old_id, heading_values);
+    for (const HeadingIndexValue& value : heading_values)
+        if (heading_index.remove(value) != 1)
+            throw std::logic_error("heading index box of T" + std::to_string(value.second) + " not found");
+
+    /* remove the region index boxes of the removed and moved trapezoids. The previous trapezoids bounds are not
+     * available anymore, so their boxes are found by a scan of the index values, which is cheap relative to
+     * calculating the bounds of all the trapezoids */
+    std::vector<RegionIndexValue> region_values;
+    for (const RegionIndexValue& value : region_index)
+        if (old_to_new[value.second] != value.second)
+            region_values.push_back(value);
+    for (const RegionIndexValue& value : region_values)
+        if (region_index.remove(value) != 1)
+            throw std::logic_error("region index box of T" + std::to_string(value.second) + " not found");
+
+    /* patch the openings and query plans, calculate only the ones of the added trapezoids. The plans of kept
+     * trapezoids hold no arrangement handles, so they are valid for the new arrangement */
+    for (Trapezoid::ID old_id : moved) {
+        openings.at(old_to_new[old_id]) = openings.at(old_id);
+        plans.at(old_to_new[old_id]) = plans.at(old_id);
+    }
+    while (openings.size() < n)
+        openings.emplace_back(0, 0);
+    plans.resize(std::max(plans.size(), n));
+    for (Trapezoid::ID id : added) {
+        const Trapezoid& trapezoid = *trapezoider.get_trapezoid(id);
+        Kernel::FT min, max;
+        trapezoid.calc_min_max_openings(min, max);
+        openings.at(id) = TrapezoidOpening(min.exact(), max.exact());
+        plans.at(id) = Trapezoid::QueryPlan(trapezoid);
+    }
+    openings.erase(openings.begin() + n, openings.end());
+    plans.erase(plans.begin() + n, plans.end());
+
+    /* merge the added trapezoids into the sorted array */
+    std::vector<Trapezoid::ID> added_sorted(added);
+    auto max_less = [this](const auto& t1, const auto& t2) { return openings.at(t1).max < openings.at(t2).max; };
+    sort(added_sorted.begin(), added_sorted.end(), max_less);
+    const size_t kept_num = sorted_by_max.size();
+    sorted_by_max.insert(sorted_by_max.end(), added_sorted.begin(), added_sorted.end());
+    std::inplace_merge(sorted_by_max.begin(), sorted_by_max.begin() + kept_num, sorted_by_max.end(), max_less);
+    calc_sorted_max_upper();
+
+    /* the interval index is static, rebuild it from the patched openings. Building is a sort of the intervals, which is
+     * negligible relative to the trapezoids calculation */
+    build_interval_index();
+
+    /* insert the heading index boxes of the moved trapezoids with their new IDs, and of the added trapezoids */
+    heading_values.clear();
+    for (Trapezoid::ID old_id : moved)
+        add_heading_index_values(old_to_new[old_id], heading_values);
+    for (Trapezoid::ID id : added)
+        add_heading_index_values(id, heading_values);
+    heading_index.insert(heading_values.begin(), heading_values.end());
+
+    /* moved trapezoids keep their boxes with their new IDs, and only the added trapezoids bounds are calculated */
+    std::vector<RegionIndexValue> new_region_values;
+    for (const RegionIndexValue& value : region_values)
+        if (old_to_new[value.second] != INVALID_TRAPEZOID_ID)
+            new_region_values.emplace_back(value.first, old_to_new[value.second]);
+    for (Trapezoid::ID id : added)
+        new_region_values.push_back(region_index_value(*trapezoider.get_trapezoid(id)));
+    region_index.insert(new_region_values.begin(), new_region_values.end());
+    calc_trapezoids_edges();
+
+    if (verify_updates) {
+        fdml_infoln("[Locator] verifying update against a full rebuild...");
+        Locator rebuilt;
+        rebuilt.init(scene, sectors_num, threads_num);
+        verify_equal_to(rebuilt);
+        fdml_infoln("[Locator] update verified");
+    }
+}
+
+/* The values of a boxes index as sorted tuples of the box corners and the trapezoid ID, with the IDs mapped by a given
+ * function, so the contents of indexes of different trapezoids IDs can be compared */
+template <typename RTree, typename MapID>
+static std::vector<std::tuple<double, double, double, double, Trapezoid::ID>> rtree_contents(const RTree& rtree,
+                                                                                            const MapID& map_id) {
+    std::vector<std::tuple<double, double, double, double, Trapezoid::ID>> contents;
+    contents.reserve(rtree.size());
+    for (const auto& value : rtree) {
+        const auto &min = value.first.min_corner(), &max = value.first.max_corner();
+        contents.emplace_back(min.template get<0>(), min.template get<1>(), max.template get<0>(),
+                              max.template get<1>(), map_id(value.second));
+    }
+    sort(contents.begin(), contents.end());
+    return contents;
+}
+
+/* Check that two locators of the same scene are equivalent, up to the trapezoids IDs */
+void Locator::verify_equal_to(const Locator& other) const {
+    const size_t n = trapezoider.number_of_trapezoids();
+    if (other.trapezoider.number_of_trapezoids() != n)
+        throw std::logic_error("number of trapezoids differs");
+    if (openings.size() != n || plans.size() != n || sorted_by_max.size() != n || sorted_max_upper.size() != n ||
+        interval_index.size() != n || heading_index.size() < n || heading_index.size() > 2 * n ||
+        region_index.size() != n || trapezoids_edges.size() != n)
+        throw std::logic_error("data structures sizes don't match the number of trapezoids");
+
+    std::map<TrapezoidKey, Trapezoid::ID> other_ids;
+    for (auto it = other.trapezoider.trapezoids_begin(); it != other.trapezoider.trapezoids_end(); ++it)
+        other_ids.emplace(TrapezoidKey(*it), it->get_id());
+    std::vector<Trapezoid::ID> to_other(n, INVALID_TRAPEZOID_ID);
     for (auto it = trapezoider.trapezoids_begin(); it != trapezoider.trapezoids_end(); ++it) {
-        const auto& opening = openings.at(it->get_id());
-        TrapezoidRTreePoint min(CGAL::to_double(opening.min));
-        TrapezoidRTreePoint max(CGAL::to_double(opening.max));
-        rtree.insert(TrapezoidRTreeValue(TrapezoidRTreeSegment(min, max), it->get_id()));
+        auto other_it = other_ids.find(TrapezoidKey(*it));
+        if (other_it == other_ids.end())
+            throw std::logic_error("trapezoid T" + std::to_string(it->get_id()) + " doesn't exist in the rebuild");
+        const auto &opening = openings.at(it->get_id()), &other_opening = other.openings.at(other_it->second);
+        if (opening.min != other_opening.min || opening.max != other_opening.max)
+            throw std::logic_error("trapezoid T" + std::to_string(it->get_id()) + " openings differ from the rebuild");
+        to_other[it->get_id()] = other_it->second;
     }
 
-    fdml_infoln("[Locator] init done");
+    /* the boxes indexes must hold the same boxes as the rebuild, each of the matching trapezoid */
+    auto map_id = [n, &to_other](Trapezoid::ID id) { return id < n ? to_other[id] : INVALID_TRAPEZOID_ID; };
+    auto other_id = [](Trapezoid::ID id) { return id; };
+    if (rtree_contents(heading_index, map_id) != rtree_contents(other.heading_index, other_id))
+        throw std::logic_error("heading index doesn't match the rebuild");
+    if (rtree_contents(region_index, map_id) != rtree_contents(other.region_index, other_id))
+        throw std::logic_error("region index doesn't match the rebuild");
+
+    const Topology& topology = trapezoider.get_topology();
+    for (auto it = trapezoider.trapezoids_begin(); it != trapezoider.trapezoids_end(); ++it) {
+        const auto& edges = trapezoids_edges[it->get_id()];
+        if (edges.first != topology.edge_id(it->top_edge) || edges.second != topology.edge_id(it->bottom_edge))
+            throw std::logic_error("trapezoid T" + std::to_string(it->get_id()) + " edges don't match the topology");
+    }
+
+    std::vector<bool> seen(n, false);
+    for (unsigned int i = 0; i < n; i++) {
+        Trapezoid::ID id = sorted_by_max[i];
+        if (id >= n || seen[id])
+            throw std::logic_error("sorted_by_max is not a permutation of the trapezoids");
+        seen[id] = true;
+        if (i > 0 && openings.at(id).max < openings.at(sorted_by_max[i - 1]).max)
+            throw std::logic_error("sorted_by_max is not sorted");
+        if (sorted_max_upper[i] != upper_double(openings.at(id).max))
+            throw std::logic_error("sorted_max_upper doesn't match the trapezoids openings");
+    }
+
+    seen.assign(n, false);
+    for (size_t i = 0; i < interval_index.size(); i++) {
+        const IntervalIndex::Interval interval = interval_index.get(i);
+        if (interval.id >= n || seen[interval.id])
+            throw std::logic_error("interval index contains an invalid or duplicated trapezoid ID");
+        seen[interval.id] = true;
+        if (i > 0 && interval.min < interval_index.get(i - 1).min)
+            throw std::logic_error("interval index is not sorted");
+        const auto& opening = openings.at(interval.id);
+        if (interval.min != lower_double(opening.min) || interval.max != upper_double(opening.max))
+            throw std::logic_error("interval index doesn't match the trapezoids openings");
+    }
 }
 
-std::vector<Locator::Res1d> Locator::query(const Kernel::FT& d) const {
-    /* Single measurement query. Perform binary search on the sorted array for output sensitive running time */
-    fdml_infoln("[Locator] Single measurement query (d = " << d << "):");
-    auto it = std::lower_bound(sorted_by_max.begin(), sorted_by_max.end(), d,
-                               [this](const auto& t_id, const auto& d) { return openings.at(t_id).max < d; });
+/* Calculate the single measurement result entries of a trapezoid, either as polygons or as analytic curves */
+static void add_result_m1_entries(const Trapezoid::QueryPlan& plan, const Kernel::FT& d, const ResultOptions& options,
+                                  std::vector<Locator::Res1d>& entries) {
+    std::pair<Point, Point> edge_pair(plan.top_source, plan.top_target);
+    if (options.analytic) {
+        for (const auto& boundary : Trapezoid::calc_result_m1_analytic(plan, d))
+            entries.emplace_back(edge_pair, boundary);
+    } else {
+        for (const Polygon& res_p : Trapezoid::calc_result_m1(plan, d, options))
+            entries.emplace_back(edge_pair, res_p);
+    }
+}
+
+/* Calculate the double measurement result entry of a trapezoid, either as segments or as analytic curves */
+static void add_result_m2_entry(const Trapezoid::QueryPlan& plan, const Kernel::FT& d1, const Kernel::FT& d2,
+                                const ResultOptions& options, std::vector<Locator::Res2d>& entries) {
+    std::pair<Point, Point> top_edge_pair(plan.top_source, plan.top_target);
+    std::pair<Point, Point> bottom_edge_pair(plan.bottom_source, plan.bottom_target);
+    if (options.analytic)
+        entries.emplace_back(top_edge_pair, bottom_edge_pair,
+                             Trapezoid::calc_result_m2_analytic(plan, d1, d2, options));
+    else
+        entries.emplace_back(top_edge_pair, bottom_edge_pair, Trapezoid::calc_result_m2(plan, d1, d2, options));
+}
+
+Polygon Locator::Res1d::evaluate(const ResultOptions& options) const {
+    if (boundary.empty())
+        return pos;
+    Polygon res;
+    for (const ResultCurve& curve : boundary)
+        for (const Point& p : curve.evaluate(options))
+            if (res.is_empty() || p != res[res.size() - 1])
+                res.push_back(p);
+    if (res.size() > 1 && res[0] == res[res.size() - 1])
+        res.erase(res.vertices_end() - 1);
+    return res;
+}
 
-    std::vector<Locator::Res1d> res;
-    for (; it != sorted_by_max.end(); ++it) {
-        const auto& trapezoid = *trapezoider.get_trapezoid(*it);
-        const auto& opening = openings.at(trapezoid.get_id());
-        fdml_debugln("\tT" << trapezoid.get_id() << " [" << opening.min << ", " << opening.max << "]");
+std::vector<Segment> Locator::Res2d::evaluate(const ResultOptions& options) const {
+    if (curves.empty())
+        return pos;
+    std::vector<Segment> res;
+    for (const ResultCurve& curve : curves) {
+        std::vector<Point> points = curve.evaluate(options);
+        for (unsigned int i = 0; i + 1 < points.size(); i++)
+            res.emplace_back(points[i], points[i + 1]);
+    }
+    return res;
+}
 
-        std::pair<Point, Point> edge_pair(
-            {trapezoid.top_edge->source()->point(), trapezoid.top_edge->target()->point()});
-        for (const Polygon& res_p : trapezoid.calc_result_m1(d))
-            res.emplace_back(edge_pair, res_p);
+std::vector<Locator::Res1d> Locator::query(const Kernel::FT& d, const ResultOptions& options) const {
+    fdml_infoln("[Locator] Single measurement query (d = " << d << "):");
+    std::vector<Trapezoid::ID> trapezoids_ids = query_candidates(d);
+    for (const auto& t_id : trapezoids_ids) {
+        const auto& opening = openings.at(t_id);
+        fdml_debugln("\tT" << t_id << " [" << opening.min << ", " << opening.max << "]");
     }
 
+    /* Fix exact number of the measurement before it is shared between threads */
+    CGAL::exact(d);
+    auto evaluate_pair = [this, &d, &options, &trapezoids_ids](size_t, size_t j, std::vector<Res1d>& entries) {
+        add_result_m1_entries(plans[trapezoids_ids[j]], d, options, entries);
+    };
+    std::vector<Locator::Res1d> res =
+        evaluate_query_pairs<Res1d>(*executor, {0, trapezoids_ids.size()}, evaluate_pair).entries;
+
     fdml_infoln("[Locator] result consist of " << res.size() << " polygons.");
     return res;
 }
 
-std::vector<Locator::Res2d> Locator::query(const Kernel::FT& d1, const Kernel::FT& d2) const {
-    /* Double measurement query. Use the interval tree for output sensitive running time */
+std::vector<Locator::Res2d> Locator::query(const Kernel::FT& d1, const Kernel::FT& d2,
+                                           const ResultOptions& options) const {
     fdml_infoln("[Locator] Double measurement query (d1 = " << d1 << ", d2 = " << d2 << "):");
+    std::vector<Trapezoid::ID> trapezoids_ids = query_candidates(d1, d2);
+    for (const auto& t_id : trapezoids_ids) {
+        const auto& opening = openings.at(t_id);
+        fdml_debugln("\tT" << t_id << " [" << opening.min << ", " << opening.max << "]");
+    }
+
+    /* Fix exact numbers of the measurements before they are shared between threads */
+    CGAL::exact(d1);
+    CGAL::exact(d2);
+    auto evaluate_pair = [this, &d1, &d2, &options, &trapezoids_ids](size_t, size_t j, std::vector<Res2d>& entries) {
+        add_result_m2_entry(plans[trapezoids_ids[j]], d1, d2, options, entries);
+    };
+    return evaluate_query_pairs<Res2d>(*executor, {0, trapezoids_ids.size()}, evaluate_pair).entries;
+}
+
+void Locator::query(const Kernel::FT& d, const Res1dVisitor& visitor, const ResultOptions& options) const {
+    fdml_infoln("[Locator] Single measurement query (d = " << d << "), visited:");
+    std::vector<Trapezoid::ID> trapezoids_ids = query_candidates(d);
+
+    /* Fix exact number of the measurement before it is shared between threads */
+    CGAL::exact(d);
+    auto evaluate = [this, &d, &options, &trapezoids_ids](size_t j, std::vector<Res1dEntry>& entries) {
+        const Trapezoid::ID id = trapezoids_ids[j];
+        const Topology::EdgeID edge = trapezoids_edges[id].first;
+        if (options.analytic) {
+            for (auto& boundary : Trapezoid::calc_result_m1_analytic(plans[id], d))
+                entries.push_back({edge, Polygon(), std::move(boundary)});
+        } else {
+            for (Polygon& res_p : Trapezoid::calc_result_m1(plans[id], d, options))
+                entries.push_back({edge, std::move(res_p), {}});
+        }
+    };
+    visit_query_candidates<Res1dEntry>(*executor, trapezoids_ids.size(), evaluate, visitor);
+}
+
+void Locator::query(const Kernel::FT& d1, const Kernel::FT& d2, const Res2dVisitor& visitor,
+                    const ResultOptions& options) const {
+    fdml_infoln("[Locator] Double measurement query (d1 = " << d1 << ", d2 = " << d2 << "), visited:");
+    std::vector<Trapezoid::ID> trapezoids_ids = query_candidates(d1, d2);
+
+    /* Fix exact numbers of the measurements before they are shared between threads */
+    CGAL::exact(d1);
+    CGAL::exact(d2);
+    auto evaluate = [this, &d1, &d2, &options, &trapezoids_ids](size_t j, std::vector<Res2dEntry>& entries) {
+        const Trapezoid::ID id = trapezoids_ids[j];
+        const auto& edges = trapezoids_edges[id];
+        if (options.analytic)
+            entries.push_back(
+                {edges.first, edges.second, {}, Trapezoid::calc_result_m2_analytic(plans[id], d1, d2, options)});
+        else
+            entries.push_back({edges.first, edges.second, Trapezoid::calc_result_m2(plans[id], d1, d2, options), {}});
+    };
+    visit_query_candidates<Res2dEntry>(*executor, trapezoids_ids.size(), evaluate, visitor);
+}
+
+std::vector<Locator::Res1d> Locator::query(const MeasurementRange& d, const ResultOptions& options) const {
+    fdml_infoln("[Locator] Single measurement range query (d = [" << d.lo << ", " << d.hi << "]):");
+    std::vector<Trapezoid::ID> trapezoids_ids = query_candidates(d);
+
+    /* Fix exact numbers of the range before they are shared between threads */
+    CGAL::exact(d.lo);
+    CGAL::exact(d.hi);
+    auto evaluate_pair = [this, &d, &options, &trapezoids_ids](size_t, size_t j, std::vector<Res1d>& entries) {
+        const Trapezoid::QueryPlan& plan = plans[trapezoids_ids[j]];
+        std::pair<Point, Point> edge_pair(plan.top_source, plan.top_target);
+        for (const Polygon& res_p : Trapezoid::calc_result_m1_range(plan, d.lo, d.hi, options))
+            entries.emplace_back(edge_pair, res_p);
+    };
+    std::vector<Locator::Res1d> res =
+        evaluate_query_pairs<Res1d>(*executor, {0, trapezoids_ids.size()}, evaluate_pair).entries;
+
+    fdml_infoln("[Locator] result consist of " << res.size() << " polygons.");
+    return res;
+}
+
+std::vector<Locator::Res2dRange> Locator::query(const MeasurementRange& d1, const MeasurementRange& d2,
+                                                const ResultOptions& options) const {
+    fdml_infoln("[Locator] Double measurement range query (d1 = [" << d1.lo << ", " << d1.hi << "], d2 = [" << d2.lo
+                                                                   << ", " << d2.hi << "]):");
+    std::vector<Trapezoid::ID> trapezoids_ids = query_candidates(d1, d2);
+
+    /* Fix exact numbers of the ranges before they are shared between threads */
+    for (const MeasurementRange* d : {&d1, &d2}) {
+        CGAL::exact(d->lo);
+        CGAL::exact(d->hi);
+    }
+    auto evaluate_pair = [this, &d1, &d2, &options, &trapezoids_ids](size_t, size_t j,
+                                                                     std::vector<Res2dRange>& entries) {
+        const Trapezoid::QueryPlan& plan = plans[trapezoids_ids[j]];
+        std::vector<Polygon> pos = Trapezoid::calc_result_m2_range(plan, d1.lo, d1.hi, d2.lo, d2.hi, options);
+        if (!pos.empty())
+            entries.emplace_back(std::make_pair(plan.top_source, plan.top_target),
+                                 std::make_pair(plan.bottom_source, plan.bottom_target), pos);
+    };
+    return evaluate_query_pairs<Res2dRange>(*executor, {0, trapezoids_ids.size()}, evaluate_pair).entries;
+}
+
+std::vector<Locator::Res1d> Locator::query(const Kernel::FT& d, const HeadingRange& heading,
+                                           const ResultOptions& options) const {
+    fdml_infoln("[Locator] Single measurement heading query (d = " << d << ", heading = [" << heading.begin << ", "
+                                                                    << heading.end << "]):");
+    std::vector<Trapezoid::ID> trapezoids_ids = query_candidates(d, heading);
+
+    /* Fix exact values of the measurement and the heading range before they are shared between threads */
+    CGAL::exact(d);
+    CGAL::exact(heading.begin);
+    CGAL::exact(heading.end);
+    auto evaluate_pair = [this, &d, &heading, &options, &trapezoids_ids](size_t, size_t j,
+                                                                        std::vector<Res1d>& entries) {
+        const Trapezoid::QueryPlan& plan = plans[trapezoids_ids[j]];
+        for (const auto& angles : intersect_angles(plan.angle_begin, plan.angle_end, heading))
+            add_result_m1_entries(plan.restricted(angles.first, angles.second), d, options, entries);
+    };
+    std::vector<Locator::Res1d> res =
+        evaluate_query_pairs<Res1d>(*executor, {0, trapezoids_ids.size()}, evaluate_pair).entries;
+
+    fdml_infoln("[Locator] result consist of " << res.size() << " polygons.");
+    return res;
+}
+
+std::vector<Locator::Res2d> Locator::query(const Kernel::FT& d1, const Kernel::FT& d2, const HeadingRange& heading,
+                                           const ResultOptions& options) const {
+    fdml_infoln("[Locator] Double measurement heading query (d1 = " << d1 << ", d2 = " << d2 << ", heading = ["
+                                                                    << heading.begin << ", " << heading.end << "]):");
+    std::vector<Trapezoid::ID> trapezoids_ids = query_candidates(d1, d2, heading);
+
+    /* Fix exact values of the measurements and the heading range before they are shared between threads */
+    CGAL::exact(d1);
+    CGAL::exact(d2);
+    CGAL::exact(heading.begin);
+    CGAL::exact(heading.end);
+    auto evaluate_pair = [this, &d1, &d2, &heading, &options, &trapezoids_ids](size_t, size_t j,
+                                                                              std::vector<Res2d>& entries) {
+        const Trapezoid::QueryPlan& plan = plans[trapezoids_ids[j]];
+        for (const auto& angles : intersect_angles(plan.angle_begin, plan.angle_end, heading))
+            add_result_m2_entry(plan.restricted(angles.first, angles.second), d1, d2, options, entries);
+    };
+    return evaluate_query_pairs<Res2d>(*executor, {0, trapezoids_ids.size()}, evaluate_pair).entries;
+}
+
+/* Clip a result polygon to a region of interest in counter clockwise orientation. A convex region is clipped by the
+ * half planes of its edges lines, given in region_lines, and a general region, with empty region_lines, by a boolean
+ * intersection. The intersection of two simple polygons has no holes, so each piece is a simple polygon. */
+static void clip_to_region(const Polygon& poly, const Polygon& region, const std::vector<Line>& region_lines,
+                           std::vector<Polygon>& res) {
+    if (!region_lines.empty()) {
+        std::vector<Polygon> pieces = {poly};
+        for (const Line& line : region_lines) {
+            std::vector<Polygon> clipped;
+            for (const Polygon& piece : pieces)
+                for (Polygon& p : HalfPlaneClipper::clip(piece, line))
+                    clipped.push_back(std::move(p));
+            pieces = std::move(clipped);
+        }
+        res.insert(res.end(), pieces.begin(), pieces.end());
+        return;
+    }
+    Polygon ccw_poly(poly);
+    if (ccw_poly.orientation() == CGAL::CLOCKWISE)
+        ccw_poly.reverse_orientation();
+    std::vector<Polygon_with_holes> pieces;
+    CGAL::intersection(ccw_poly, region, std::back_inserter(pieces));
+    for (const Polygon_with_holes& piece : pieces)
+        res.push_back(piece.outer_boundary());
+}
+
+std::vector<Locator::Res1d> Locator::query(const Kernel::FT& d, const Polygon& region,
+                                           const ResultOptions& options) const {
+    fdml_infoln("[Locator] Single measurement region query (d = " << d << ", region of " << region.size()
+                                                                   << " vertices):");
+    if (region.size() < 3 || !region.is_simple())
+        throw std::invalid_argument("region must be a simple polygon");
+    Polygon ccw_region(region);
+    if (ccw_region.orientation() == CGAL::CLOCKWISE)
+        ccw_region.reverse_orientation();
+    std::vector<Trapezoid::ID> trapezoids_ids = query_candidates(d, ccw_region.bbox());
+
+    /* Fix exact values of the measurement and the region before they are shared between threads */
+    CGAL::exact(d);
+    for (auto v = ccw_region.vertices_begin(); v != ccw_region.vertices_end(); ++v)
+        CGAL::exact(*v);
+    std::vector<Line> region_lines;
+    if (ccw_region.is_convex())
+        for (auto e = ccw_region.edges_begin(); e != ccw_region.edges_end(); ++e)
+            CGAL::exact(region_lines.emplace_back(e->supporting_line()));
+
+    /* the clipping is done on polygons, so analytic results are not calculated */
+    ResultOptions polygon_options(options);
+    polygon_options.analytic = false;
+    auto evaluate_pair = [this, &d, &ccw_region, &region_lines, &polygon_options,
+                          &trapezoids_ids](size_t, size_t j, std::vector<Res1d>& entries) {
+        const Trapezoid::QueryPlan& plan = plans[trapezoids_ids[j]];
+        std::pair<Point, Point> edge_pair(plan.top_source, plan.top_target);
+        std::vector<Polygon> pieces;
+        for (const Polygon& res_p : Trapezoid::calc_result_m1(plan, d, polygon_options))
+            clip_to_region(res_p, ccw_region, region_lines, pieces);
+        for (const Polygon& piece : pieces)
+            entries.emplace_back(edge_pair, piece);
+    };
+    std::vector<Locator::Res1d> res =
+        evaluate_query_pairs<Res1d>(*executor, {0, trapezoids_ids.size()}, evaluate_pair).entries;
+
+    fdml_infoln("[Locator] result consist of " << res.size() << " polygons.");
+    return res;
+}
+
+std::vector<Locator::Res1d> Locator::query(const Kernel::FT& d, const CGAL::Bbox_2& region,
+                                           const ResultOptions& options) const {
+    if (!(region.xmin() < region.xmax() && region.ymin() < region.ymax()))
+        throw std::invalid_argument("region box must have a positive area");
+    const Point corners[] = {Point(region.xmin(), region.ymin()), Point(region.xmax(), region.ymin()),
+                             Point(region.xmax(), region.ymax()), Point(region.xmin(), region.ymax())};
+    return query(d, Polygon(std::begin(corners), std::end(corners)), options);
+}
+
+std::vector<Trapezoid::ID> Locator::query_candidates(const Kernel::FT& d) const {
+    /* Single measurement query. Perform binary search on the sorted array for output sensitive running time */
+    std::vector<Trapezoid::ID> trapezoids_ids(sorted_by_max.begin() + first_by_max(d, 0), sorted_by_max.end());
+    sort(trapezoids_ids.begin(), trapezoids_ids.end());
+    return trapezoids_ids;
+}
+
+std::vector<Trapezoid::ID> Locator::query_candidates(const Kernel::FT& d1, const Kernel::FT& d2) const {
+    /* Double measurement query. Use the interval index for output sensitive running time */
     const Kernel::FT d = d1 + d2;
-    TrapezoidRTreePoint a(d), b(d);
-    TrapezoidRTreeSegment query_interval(a, b);
-    std::vector<TrapezoidRTreeValue> res_vals;
-    rtree.query(boost::geometry::index::intersects(query_interval), std::back_inserter(res_vals));
+    const std::pair<double, double> d_bounds = CGAL::to_interval(d.exact());
+    std::vector<IntervalIndex::Interval> intervals;
+    interval_index.query(d_bounds.first, d_bounds.second, intervals);
+    std::vector<Trapezoid::ID> trapezoids_ids;
+    for (const IntervalIndex::Interval& interval : intervals)
+        if (openings_intersect(interval, d, d, d_bounds, d_bounds))
+            trapezoids_ids.push_back(interval.id);
+    sort(trapezoids_ids.begin(), trapezoids_ids.end());
+    return trapezoids_ids;
+}
 
-    std::vector<Locator::Res2d> res;
-    for (const TrapezoidRTreeValue& rtree_val : res_vals) {
-        const auto& trapezoid = *trapezoider.get_trapezoid(rtree_val.second);
-        const auto& opening = openings.at(rtree_val.second);
-        fdml_debugln("\tT" << rtree_val.second << " [" << opening.min << ", " << opening.max << "]");
+std::vector<Trapezoid::ID> Locator::query_candidates(const MeasurementRange& d) const {
+    /* A trapezoid contains results of some distance in the range iff it contains results of the range lower bound */
+    return query_candidates(d.lo);
+}
+
+std::vector<Trapezoid::ID> Locator::query_candidates(const MeasurementRange& d1, const MeasurementRange& d2) const {
+    /* Query the interval index once with the range of the measurements sum */
+    const Kernel::FT sum_lo = d1.lo + d2.lo, sum_hi = d1.hi + d2.hi;
+    const std::pair<double, double> lo_bounds = CGAL::to_interval(sum_lo.exact());
+    const std::pair<double, double> hi_bounds = CGAL::to_interval(sum_hi.exact());
+    std::vector<IntervalIndex::Interval> intervals;
+    interval_index.query(lo_bounds.first, hi_bounds.second, intervals);
+    std::vector<Trapezoid::ID> trapezoids_ids;
+    for (const IntervalIndex::Interval& interval : intervals)
+        if (openings_intersect(interval, sum_lo, sum_hi, lo_bounds, hi_bounds))
+            trapezoids_ids.push_back(interval.id);
+    sort(trapezoids_ids.begin(), trapezoids_ids.end());
+    return trapezoids_ids;
+}
+
+std::vector<Trapezoid::ID> Locator::query_candidates(const Kernel::FT& d, const HeadingRange& heading) const {
+    if (heading.begin == heading.end)
+        throw std::invalid_argument("heading range must not be a single direction");
+    /* The index returns all the trapezoids whose rounded boxes intersect the query, filter them by exact predicates */
+    const double d_lower = lower_double(d);
+    std::vector<Trapezoid::ID> trapezoids_ids;
+    for (Trapezoid::ID id : query_heading_index(heading, d_lower, std::numeric_limits<double>::max())) {
+        const Trapezoid::QueryPlan& plan = plans[id];
+        if (openings[id].max >= d && !intersect_angles(plan.angle_begin, plan.angle_end, heading).empty())
+            trapezoids_ids.push_back(id);
+    }
+    return trapezoids_ids;
+}
+
+std::vector<Trapezoid::ID> Locator::query_candidates(const Kernel::FT& d1, const Kernel::FT& d2,
+                                                     const HeadingRange& heading) const {
+    if (heading.begin == heading.end)
+        throw std::invalid_argument("heading range must not be a single direction");
+    const Kernel::FT d = d1 + d2;
+    const std::pair<double, double> d_bounds = CGAL::to_interval(d.exact());
+    std::vector<Trapezoid::ID> trapezoids_ids;
+    for (Trapezoid::ID id : query_heading_index(heading, d_bounds.first, d_bounds.second)) {
+        const Trapezoid::QueryPlan& plan = plans[id];
+        const auto& opening = openings[id];
+        if (opening.min <= d && d <= opening.max &&
+            !intersect_angles(plan.angle_begin, plan.angle_end, heading).empty())
+            trapezoids_ids.push_back(id);
+    }
+    return trapezoids_ids;
+}
+
+std::vector<Trapezoid::ID> Locator::query_candidates(const Kernel::FT& d, const CGAL::Bbox_2& region) const {
+    /* The region index prunes most of the trapezoids far from the region, filter the rest by their max opening */
+    const RegionIndexBox box(RegionIndexPoint(region.xmin(), region.ymin()),
+                             RegionIndexPoint(region.xmax(), region.ymax()));
+    std::vector<RegionIndexValue> values;
+    region_index.query(boost::geometry::index::intersects(box), std::back_inserter(values));
+    std::vector<Trapezoid::ID> trapezoids_ids;
+    for (const RegionIndexValue& value : values)
+        if (openings[value.second].max >= d)
+            trapezoids_ids.push_back(value.second);
+    sort(trapezoids_ids.begin(), trapezoids_ids.end());
+    return trapezoids_ids;
+}
 
-        std::pair<Point, Point> top_edge_pair(
-            {trapezoid.top_edge->source()->point(), trapezoid.top_edge->target()->point()});
-        std::pair<Point, Point> bottom_edge_pair(
-            {trapezoid.bottom_edge->source()->point(), trapezoid.bottom_edge->target()->point()});
-        res.emplace_back(top_edge_pair, bottom_edge_pair, trapezoid.calc_result_m2(d1, d2));
+Locator::BatchRes<Locator::Res1d> Locator::query_batch(const std::vector<Kernel::FT>& ds,
+                                                       const ResultOptions& options) const {
+    fdml_infoln("[Locator] Batch of " << ds.size() << " single measurement queries");
+    /* Fix exact numbers of the measurements before they are shared between threads */
+    for (const auto& d : ds)
+        CGAL::exact(d);
+
+    /* search the trapezoids sorted by their max opening with the measurements in increasing order, each search starts
+     * at the result of the previous one, to find the first trapezoid with a max opening not smaller than each
+     * measurement */
+    std::vector<size_t> order(ds.size());
+    std::iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&ds](size_t i1, size_t i2) { return ds[i1] < ds[i2]; });
+    std::vector<size_t> first(ds.size());
+    size_t prev_first = 0;
+    for (size_t i : order)
+        first[i] = prev_first = first_by_max(ds[i], prev_first);
+
+    /* the trapezoids of each measurement, sorted by their ID as in a single query */
+    std::vector<size_t> pairs_offsets(ds.size() + 1, 0);
+    for (size_t i = 0; i < ds.size(); i++)
+        pairs_offsets[i + 1] = pairs_offsets[i] + (sorted_by_max.size() - first[i]);
+    std::vector<Trapezoid::ID> trapezoids_ids(pairs_offsets.back());
+    for (size_t i = 0; i < ds.size(); i++) {
+        auto ids_begin = trapezoids_ids.begin() + pairs_offsets[i];
+        std::copy(sorted_by_max.begin() + first[i], sorted_by_max.end(), ids_begin);
+        sort(ids_begin, trapezoids_ids.begin() + pairs_offsets[i + 1]);
+    }
+
+    auto evaluate_pair = [this, &ds, &options, &pairs_offsets, &trapezoids_ids](size_t i, size_t j,
+                                                                                 std::vector<Res1d>& entries) {
+        add_result_m1_entries(plans[trapezoids_ids[pairs_offsets[i] + j]], ds[i], options, entries);
+    };
+    auto res = evaluate_query_pairs<Res1d>(*executor, pairs_offsets, evaluate_pair);
+    fdml_infoln("[Locator] batch result consist of " << res.entries.size() << " polygons.");
+    return res;
+}
+
+Locator::BatchRes<Locator::Res2d>
+Locator::query_batch(const std::vector<std::pair<Kernel::FT, Kernel::FT>>& ds, const ResultOptions& options) const {
+    fdml_infoln("[Locator] Batch of " << ds.size() << " double measurement queries");
+    std::vector<Kernel::FT> sums;
+    std::vector<std::pair<double, double>> sums_bounds;
+    sums.reserve(ds.size());
+    sums_bounds.reserve(ds.size());
+    for (const auto& d : ds) {
+        /* Fix exact numbers of the measurements before they are shared between threads */
+        CGAL::exact(d.first);
+        CGAL::exact(d.second);
+        Kernel::FT sum = d.first + d.second;
+        sums_bounds.push_back(CGAL::to_interval(sum.exact()));
+        sums.push_back(sum);
+    }
+
+    std::vector<size_t> order(ds.size());
+    std::iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&sums](size_t i1, size_t i2) { return sums[i1] < sums[i2]; });
+
+    /* query the interval index once for all the trapezoids which might contain any of the measurements sums. The
+     * candidates are reported ordered by their min */
+    std::vector<IntervalIndex::Interval> candidates;
+    if (!ds.empty())
+        interval_index.query(sums_bounds[order.front()].first, sums_bounds[order.back()].second, candidates);
+
+    /* sweep the measurements sums in increasing order, maintaining the intervals which may contain the current sum in
+     * a heap ordered by the interval max, and store the trapezoids of each input which contain the sum */
+    auto max_greater = [](const IntervalIndex::Interval* v1, const IntervalIndex::Interval* v2) {
+        return v1->max > v2->max;
+    };
+    std::vector<const IntervalIndex::Interval*> active;
+    std::vector<Trapezoid::ID> trapezoids_ids;
+    std::vector<size_t> first(ds.size());
+    std::vector<size_t> pairs_num(ds.size());
+    auto candidate = candidates.begin();
+    for (size_t i : order) {
+        for (; candidate != candidates.end() && candidate->min <= sums_bounds[i].second; ++candidate) {
+            active.push_back(&*candidate);
+            std::push_heap(active.begin(), active.end(), max_greater);
+        }
+        while (!active.empty() && active.front()->max < sums_bounds[i].first) {
+            std::pop_heap(active.begin(), active.end(), max_greater);
+            active.pop_back();
+        }
+        first[i] = trapezoids_ids.size();
+        for (const auto* v : active)
+            if (openings_intersect(*v, sums[i], sums[i], sums_bounds[i], sums_bounds[i]))
+                trapezoids_ids.push_back(v->id);
+        pairs_num[i] = trapezoids_ids.size() - first[i];
+        /* order the trapezoids of each input by their ID as in a single query */
+        sort(trapezoids_ids.begin() + first[i], trapezoids_ids.end());
     }
 
+    std::vector<size_t> pairs_offsets(ds.size() + 1, 0);
+    for (size_t i = 0; i < ds.size(); i++)
+        pairs_offsets[i + 1] = pairs_offsets[i] + pairs_num[i];
+
+    auto evaluate_pair = [this, &ds, &options, &first, &trapezoids_ids](size_t i, size_t j,
+                                                                        std::vector<Res2d>& entries) {
+        add_result_m2_entry(plans[trapezoids_ids[first[i] + j]], ds[i].first, ds[i].second, options, entries);
+    };
+    auto res = evaluate_query_pairs<Res2d>(*executor, pairs_offsets, evaluate_pair);
+    fdml_infoln("[Locator] batch result consist of " << res.entries.size() << " entries.");
     return res;
 }
 
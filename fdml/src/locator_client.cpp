@@ -0,0 +1,146 @@
+#include "fdml/locator_client.hpp"
+#include "fdml/defs.hpp"
+#include "fdml/internal/socket_frames.hpp"
+
+#include <limits>
+#include <stdexcept>
+
+#ifdef FDML_LINUX
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace FDML {
+
+#ifdef FDML_LINUX
+
+static std::runtime_error sys_error(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+LocatorClient::~LocatorClient() {
+    close();
+}
+
+void LocatorClient::connect_unix(const std::string& path) {
+    close();
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::invalid_argument("socket path is too long: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+        throw sys_error("socket failed");
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::runtime_error err = sys_error("connect failed: " + path);
+        close();
+        throw err;
+    }
+}
+
+void LocatorClient::connect_tcp(unsigned int port) {
+    close();
+    if (port > std::numeric_limits<uint16_t>::max())
+        throw std::invalid_argument("invalid port: " + std::to_string(port));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if ((fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+        throw sys_error("socket failed");
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::runtime_error err = sys_error("connect failed: port " + std::to_string(port));
+        close();
+        throw err;
+    }
+    /* a request is a single small write, send it immediately */
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+static void send_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t w = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            throw sys_error("send failed");
+        }
+        data += w;
+        size -= w;
+    }
+}
+
+static void recv_all(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t r = ::recv(fd, data, size, 0);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            throw sys_error("recv failed");
+        }
+        if (r == 0)
+            throw std::runtime_error("connection closed by the server");
+        data += r;
+        size -= r;
+    }
+}
+
+int LocatorClient::request(const std::string& cmd_line, std::string& output) {
+    if (fd < 0)
+        throw std::logic_error("client is not connected");
+    if (cmd_line.size() > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("request is too large");
+    std::string frame;
+    frame.reserve(4 + cmd_line.size());
+    append_frame_u32(frame, cmd_line.size());
+    frame += cmd_line;
+    send_all(fd, frame.data(), frame.size());
+
+    char header[8];
+    recv_all(fd, header, sizeof(header));
+    const uint32_t size = read_frame_u32(header);
+    if (size < 4)
+        throw std::runtime_error("invalid response frame");
+    const int ret = (int)read_frame_u32(header + 4);
+    output.resize(size - 4);
+    recv_all(fd, &output[0], output.size());
+    return ret;
+}
+
+void LocatorClient::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+#else
+
+LocatorClient::~LocatorClient() {}
+
+void LocatorClient::connect_unix(const std::string&) {
+    throw std::runtime_error("the locator client is supported on Linux only");
+}
+
+void LocatorClient::connect_tcp(unsigned int) {
+    throw std::runtime_error("the locator client is supported on Linux only");
+}
+
+int LocatorClient::request(const std::string&, std::string&) {
+    throw std::runtime_error("the locator client is supported on Linux only");
+}
+
+void LocatorClient::close() {}
+
+#endif
+
+} // namespace FDML
@@ -1,12 +1,20 @@
+#include <cctype>
 #include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <thread>
 
+#include <boost/json.hpp>
 #include <boost/program_options.hpp>
 
+#include "fdml/binary_result.hpp"
 #include "fdml/internal/json_utils.hpp"
 #include "fdml/internal/utils.hpp"
+#include "fdml/json_result_writer.hpp"
 #include "fdml/locator_daemon.hpp"
+#include "fdml/locator_server.hpp"
 #include "fdml/retcode.hpp"
 
 namespace FDML {
@@ -40,68 +48,271 @@ static void parse_cmd_from_file(const std::string& filename, std::vector<std::st
 }
 
 LocatorDaemon::LocatorDaemon(const std::string& cmd_filename, const std::string& ack_filename)
-    : cmd_filename(cmd_filename), ack_filename(ack_filename), locator(nullptr) {}
+    : cmd_filename(cmd_filename), ack_filename(ack_filename) {}
 
-void LocatorDaemon::load_scene(const std::string& scene_filename) {
-    fdml_infoln("[LocatorDaemon] Init with scene: " << scene_filename);
+void LocatorDaemon::set_memory_budget(size_t bytes) {
+    memory_budget = bytes;
+}
 
-    try {
-        if (locator)
-            locator.reset();
+void LocatorDaemon::set_spill_dir(const std::string& dir) {
+    spill_dir = dir;
+}
+
+/* Scene names are used as file names of the spilled snapshots */
+static void check_scene_name(const std::string& name) {
+    bool valid = !name.empty() && name[0] != '.';
+    for (char c : name)
+        valid = valid && (std::isalnum((unsigned char)c) || c == '_' || c == '-' || c == '.');
+    if (!valid)
+        throw std::invalid_argument("invalid scene name: " + name);
+}
+
+static double to_mb(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
 
+void LocatorDaemon::load_scene(const std::string& scene_filename, const std::string& name) {
+    check_scene_name(name);
+    fdml_infoln("[LocatorDaemon] Init scene " << name << " with: " << scene_filename);
+
+    /* the locator is built without any lock held, so queries, reloads of evicted scenes and loads of other scenes are
+     * not blocked by a long init. Only the registry update and the eviction are serialized. */
+    auto locator = std::make_shared<Locator>();
+    const bool is_snapshot = Locator::is_snapshot(scene_filename);
+    if (is_snapshot) {
+        locator->load(scene_filename);
+    } else {
         Polygon_with_holes scene = JsonUtils::read_scene(scene_filename);
-        locator = std::make_unique<Locator>();
         locator->init(scene);
+    }
+    const size_t memory = locator->memory_usage();
+
+    std::lock_guard<std::mutex> lock(load_mutex);
+    {
+        std::lock_guard<std::mutex> scenes_lock(scenes_mutex);
+        Scene& scene = scenes[name];
+        scene.locator = std::move(locator);
+        scene.memory = memory;
+        scene.scene_filename = scene_filename;
+        scene.snapshot_filename = is_snapshot ? scene_filename : "";
+        scene.last_used = ++use_clock;
+    }
+    fdml_infoln("[LocatorDaemon] Scene " << name << " loaded, memory ~" << to_mb(memory) << "MB");
+    evict_scenes(name);
+}
+
+std::shared_ptr<const Locator> LocatorDaemon::acquire_locator(const std::string& name) {
+    {
+        std::lock_guard<std::mutex> lock(scenes_mutex);
+        auto it = scenes.find(name);
+        if (it == scenes.end())
+            throw std::runtime_error("Locator wasn't initialized with scene: " + name);
+        Scene& scene = it->second;
+        scene.last_used = ++use_clock;
+        if (scene.locator)
+            return scene.locator;
+        if (scene.snapshot_filename.empty())
+            throw std::runtime_error("Scene was evicted and should be initialized again: " + name);
+    }
+    return reload_scene(name);
+}
+
+std::shared_ptr<const Locator> LocatorDaemon::reload_scene(const std::string& name) {
+    std::lock_guard<std::mutex> lock(load_mutex);
+    std::string snapshot_filename;
+    {
+        /* the scene may have been reloaded by a concurrent query */
+        std::lock_guard<std::mutex> scenes_lock(scenes_mutex);
+        const Scene& scene = scenes.at(name);
+        if (scene.locator)
+            return scene.locator;
+        snapshot_filename = scene.snapshot_filename;
+    }
+
+    fdml_infoln("[LocatorDaemon] Reload scene " << name << " from: " << snapshot_filename);
+    auto locator = std::make_shared<Locator>();
+    locator->load(snapshot_filename);
+    std::shared_ptr<const Locator> res(std::move(locator));
+    {
+        std::lock_guard<std::mutex> scenes_lock(scenes_mutex);
+        Scene& scene = scenes.at(name);
+        scene.locator = res;
+        scene.memory = res->memory_usage();
+    }
+    evict_scenes(name);
+    return res;
+}
+
+void LocatorDaemon::evict_scenes(const std::string& keep) {
+    if (memory_budget == 0)
+        return;
+    for (;;) {
+        std::string victim;
+        std::shared_ptr<const Locator> victim_locator;
+        bool spill;
+        {
+            std::lock_guard<std::mutex> lock(scenes_mutex);
+            size_t total = 0;
+            const Scene* lru = nullptr;
+            for (const auto& [name, scene] : scenes) {
+                if (!scene.locator)
+                    continue;
+                total += scene.memory;
+                if (name != keep && (!lru || scene.last_used < lru->last_used)) {
+                    lru = &scene;
+                    victim = name;
+                }
+            }
+            if (total <= memory_budget)
+                return;
+            if (!lru) {
+                fdml_errln("[LocatorDaemon] Scene " << keep << " exceeds the memory budget by itself");
+                return;
+            }
+            victim_locator = lru->locator;
+            spill = lru->snapshot_filename.empty() && !spill_dir.empty();
+        }
+
+        /* the scenes mutex is not held while saving, the victim keeps serving queries until it is evicted */
+        std::string snapshot_filename;
+        if (spill) {
+            snapshot_filename = spill_dir + "/" + victim + ".bin";
+            try {
+                victim_locator->save(snapshot_filename);
+            } catch (const std::exception& e) {
+                fdml_errln("[LocatorDaemon] Failed to spill scene " << victim << ": " << e.what());
+                snapshot_filename.clear();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(scenes_mutex);
+            Scene& scene = scenes.at(victim);
+            scene.locator.reset();
+            scene.memory = 0;
+            if (spill)
+                scene.snapshot_filename = snapshot_filename;
+            if (scene.snapshot_filename.empty())
+                fdml_infoln("[LocatorDaemon] Scene " << victim << " evicted");
+            else
+                fdml_infoln("[LocatorDaemon] Scene " << victim << " evicted, reloadable from "
+                                                     << scene.snapshot_filename);
+        }
+    }
+}
 
-    } catch (const std::exception& e) {
-        if (locator)
-            locator.reset();
-        throw e;
+void LocatorDaemon::write_scenes(std::ostream& os) {
+    boost::json::array res;
+    std::lock_guard<std::mutex> lock(scenes_mutex);
+    for (const auto& [name, scene] : scenes) {
+        res.push_back(boost::json::object{{"name", name},
+                                          {"loaded", scene.locator != nullptr},
+                                          {"memory", scene.memory},
+                                          {"scene", scene.scene_filename},
+                                          {"snapshot", scene.snapshot_filename}});
     }
+    os << boost::json::serialize(res) << std::endl;
+}
+
+/* Create a streaming writer of a JSON result format */
+static JsonResultWriter create_json_writer(std::ostream& os, const std::string& field,
+                                           LocatorDaemon::ResultFormat format) {
+    if (format == LocatorDaemon::RESULT_JSON_COMPACT)
+        return JsonResultWriter(os, field, JsonResultWriter::COMPACT, JsonResultWriter::SHORTEST_PRECISION);
+    return JsonResultWriter(os, field, JsonResultWriter::PRETTY, JsonResultWriter::PRETTY_PRECISION);
+}
+
+/* Open a result file for writing, failing if it can't be created */
+static std::ofstream open_outfile(const std::string& outfile, LocatorDaemon::ResultFormat format) {
+    std::ofstream os(outfile, format == LocatorDaemon::RESULT_BINARY ? std::ios::binary : std::ios::out);
+    if (!os)
+        throw std::runtime_error("failed to open output file: " + outfile);
+    return os;
 }
 
-void LocatorDaemon::query(double d, const std::string& outfile) const {
-    fdml_infoln("[LocatorDaemon] Query1: " << d);
-    check_state();
+void LocatorDaemon::query(double d, const std::string& outfile, const std::string& name, ResultFormat format) {
+    std::ofstream os = open_outfile(outfile, format);
+    query(d, os, name, format);
+}
+
+void LocatorDaemon::query(double d1, double d2, const std::string& outfile, const std::string& name,
+                          ResultFormat format) {
+    std::ofstream os = open_outfile(outfile, format);
+    query(d1, d2, os, name, format);
+}
 
-    std::vector<Polygon> polygons;
-    for (const auto& res : locator->query(d))
-        polygons.push_back(std::move(res.pos));
-    JsonUtils::write_polygons(polygons, outfile);
+void LocatorDaemon::query(double d1, double d2, double d3, double d4, const std::string& outfile,
+                          const std::string& name, ResultFormat format) {
+    std::ofstream os = open_outfile(outfile, format);
+    query(d1, d2, d3, d4, os, name, format);
 }
 
-void LocatorDaemon::query(double d1, double d2, const std::string& outfile) const {
-    fdml_infoln("[LocatorDaemon] Query2: " << d1 << " " << d2);
-    check_state();
+void LocatorDaemon::query(double d, std::ostream& os, const std::string& name, ResultFormat format) {
+    fdml_infoln("[LocatorDaemon] Query1 " << name << ": " << d);
+    std::shared_ptr<const Locator> current = acquire_locator(name);
 
-    std::vector<Segment> segments;
-    for (const auto& res : locator->query(d1, d2))
-        segments.insert(segments.end(), res.pos.begin(), res.pos.end());
-    JsonUtils::write_segments(segments, outfile);
+    if (format == RESULT_BINARY) {
+        BinaryResultWriter writer(BinaryResultWriter::POLYGONS);
+        current->query(d, [&writer](Locator::Res1dEntry& res) { writer.add_polygon(res.edge, res.pos); });
+        writer.write(os);
+        return;
+    }
+    JsonResultWriter writer = create_json_writer(os, "polygons", format);
+    current->query(d, [&writer](Locator::Res1dEntry& res) { writer.add_polygon(res.pos); });
+    writer.finish();
 }
 
-void LocatorDaemon::query(double d1, double d2, double d3, double d4, const std::string& outfile) const {
-    fdml_infoln("[LocatorDaemon] Query2 Double: " << d1 << " " << d2 << " " << d3 << " " << d4);
-    check_state();
+void LocatorDaemon::query(double d1, double d2, std::ostream& os, const std::string& name, ResultFormat format) {
+    fdml_infoln("[LocatorDaemon] Query2 " << name << ": " << d1 << " " << d2);
+    std::shared_ptr<const Locator> current = acquire_locator(name);
 
-    std::vector<Segment> segments1;
-    std::vector<Segment> segments2;
-    for (const auto& res : locator->query(d1, d2))
-        segments1.insert(segments1.end(), res.pos.begin(), res.pos.end());
-    for (const auto& res : locator->query(d3, d4))
-        segments2.insert(segments2.end(), res.pos.begin(), res.pos.end());
+    if (format == RESULT_BINARY) {
+        BinaryResultWriter writer(BinaryResultWriter::SEGMENTS);
+        current->query(d1, d2,
+                       [&writer](Locator::Res2dEntry& res) { writer.add_segments(res.edge1, res.edge2, res.pos); });
+        writer.write(os);
+        return;
+    }
+    JsonResultWriter writer = create_json_writer(os, "segments", format);
+    current->query(d1, d2, [&writer](Locator::Res2dEntry& res) {
+        for (const Segment& segment : res.pos)
+            writer.add_segment(segment);
+    });
+    writer.finish();
+}
 
-    std::vector<Point> points;
-    for (const auto& seg1 : segments1) {
-        for (const auto& seg2 : segments2) {
-            CGAL::Object res = CGAL::intersection(seg1, seg2);
-            Point point;
-            if (CGAL::assign(point, res))
-                points.push_back(point);
+void LocatorDaemon::query(double d1, double d2, double d3, double d4, std::ostream& os, const std::string& name,
+                          ResultFormat format) {
+    fdml_infoln("[LocatorDaemon] Query2 Double " << name << ": " << d1 << " " << d2 << " " << d3 << " " << d4);
+    std::shared_ptr<const Locator> current = acquire_locator(name);
+
+    std::vector<Locator::Res2dEntry> entries1;
+    std::vector<Locator::Res2dEntry> entries2;
+    current->query(d1, d2, [&entries1](Locator::Res2dEntry& res) { entries1.push_back(std::move(res)); });
+    current->query(d3, d4, [&entries2](Locator::Res2dEntry& res) { entries2.push_back(std::move(res)); });
+
+    BinaryResultWriter binary_writer(BinaryResultWriter::POINTS);
+    JsonResultWriter json_writer = create_json_writer(os, "points", format);
+    for (const auto& res1 : entries1) {
+        for (const auto& seg1 : res1.pos) {
+            for (const auto& res2 : entries2) {
+                for (const auto& seg2 : res2.pos) {
+                    CGAL::Object res = CGAL::intersection(seg1, seg2);
+                    Point point;
+                    if (!CGAL::assign(point, res))
+                        continue;
+                    if (format == RESULT_BINARY)
+                        binary_writer.add_point(res1.edge1, res1.edge2, res2.edge1, res2.edge2, point);
+                    else
+                        json_writer.add_point(point);
+                }
+            }
         }
     }
 
-    JsonUtils::write_points(points, outfile);
+    if (format == RESULT_BINARY)
+        binary_writer.write(os);
+    else
+        json_writer.finish();
 }
 
 void LocatorDaemon::run() {
@@ -127,7 +338,13 @@ void LocatorDaemon::run() {
     fdml_infoln("[LocatorDaemon] Quit.");
 }
 
-int LocatorDaemon::exec_cmd(const std::vector<std::string>& argv, bool& quit) {
+int LocatorDaemon::exec_cmd(const std::string& cmd_line, bool& quit, std::ostream& result) {
+    std::vector<std::string> argv;
+    split(cmd_line, ' ', argv);
+    return exec_cmd(argv, quit, &result);
+}
+
+int LocatorDaemon::exec_cmd(const std::vector<std::string>& argv, bool& quit, std::ostream* result) {
     fdml_debug("[LocatorDaemon] executing command:");
     for (const auto& arg : argv)
         fdml_debug(' ' << arg);
@@ -146,17 +363,22 @@ int LocatorDaemon::exec_cmd(const std::vector<std::string>& argv, bool& quit) {
         int argc = 1 + argv.size();
 
         std::string cmd;
+        std::string name;
         std::string scene_filename;
         double d;
         double d1, d2;
         double d3, d4;
         std::string out_filename;
+        std::string format_name;
 
         boost::program_options::options_description desc{"Options"};
         desc.add_options()("help", "Help message");
         desc.add_options()("cmd", boost::program_options::value<std::string>(&cmd),
-                           "Command [init, query1, query2, query2_double, quit]");
-        desc.add_options()("scene", boost::program_options::value<std::string>(&scene_filename), "Scene filename");
+                           "Command [init, query1, query2, query2_double, scenes, quit]");
+        desc.add_options()("name", boost::program_options::value<std::string>(&name)->default_value(DEFAULT_SCENE),
+                           "Name of the scene to init or query");
+        desc.add_options()("scene", boost::program_options::value<std::string>(&scene_filename),
+                           "Scene filename, or a preprocessed snapshot filename");
         desc.add_options()("d", boost::program_options::value<double>(&d), "single measurement value");
         desc.add_options()("d1", boost::program_options::value<double>(&d1), "first value of double measurement query");
         desc.add_options()("d2", boost::program_options::value<double>(&d2),
@@ -165,13 +387,28 @@ int LocatorDaemon::exec_cmd(const std::vector<std::string>& argv, bool& quit) {
                            "first value of a second double measurement query");
         desc.add_options()("d4", boost::program_options::value<double>(&d4),
                            "second value of a second double measurement query");
-        desc.add_options()("out", boost::program_options::value<std::string>(&out_filename), "Output file");
+        desc.add_options()("out", boost::program_options::value<std::string>(&out_filename),
+                           "Output file, optional for socket requests which receive the result in the response");
+        desc.add_options()("format", boost::program_options::value<std::string>(&format_name)->default_value("json"),
+                           "Format of query results [json, json_compact, binary]");
 
         const auto options = boost::program_options::parse_command_line(argc, argv_arr, desc);
         boost::program_options::variables_map vm;
         boost::program_options::store(options, vm);
         notify(vm);
 
+        ResultFormat format;
+        if (format_name == "json")
+            format = RESULT_JSON;
+        else if (format_name == "json_compact")
+            format = RESULT_JSON_COMPACT;
+        else if (format_name == "binary")
+            format = RESULT_BINARY;
+        else {
+            fdml_errln("Unknown result format: " << format_name);
+            return FDML_RETCODE_UNKNOWN_ARGS;
+        }
+
         if (vm.count("help"))
             fdml_info(desc);
         else if (!vm.count("cmd")) {
@@ -182,25 +419,34 @@ int LocatorDaemon::exec_cmd(const std::vector<std::string>& argv, bool& quit) {
                 fdml_errln("The following flags are required: --scene");
                 return FDML_RETCODE_MISSING_ARGS;
             } else
-                load_scene(scene_filename);
+                load_scene(scene_filename, name);
         } else if (cmd == std::string("query1")) {
-            if (!vm.count("d") || !vm.count("out")) {
+            if (!vm.count("d") || (!vm.count("out") && !result)) {
                 fdml_errln("The following flags are required: --d --out");
                 return FDML_RETCODE_MISSING_ARGS;
-            } else
-                query(d, out_filename);
+            } else if (vm.count("out"))
+                query(d, out_filename, name, format);
+            else
+                query(d, *result, name, format);
         } else if (cmd == std::string("query2")) {
-            if (!vm.count("d1") || !vm.count("d2") || !vm.count("out")) {
+            if (!vm.count("d1") || !vm.count("d2") || (!vm.count("out") && !result)) {
                 fdml_errln("The following flags are required: --d1 --d2 --out");
                 return FDML_RETCODE_MISSING_ARGS;
-            } else
-                query(d1, d2, out_filename);
+            } else if (vm.count("out"))
+                query(d1, d2, out_filename, name, format);
+            else
+                query(d1, d2, *result, name, format);
         } else if (cmd == std::string("query2_double")) {
-            if (!vm.count("d1") || !vm.count("d2") || !vm.count("d3") || !vm.count("d4") || !vm.count("out")) {
+            if (!vm.count("d1") || !vm.count("d2") || !vm.count("d3") || !vm.count("d4") ||
+                (!vm.count("out") && !result)) {
                 fdml_errln("The following flags are required: --d1 --d2 --d3 --d4 --out");
                 return FDML_RETCODE_MISSING_ARGS;
-            } else
-                query(d1, d2, d3, d4, out_filename);
+            } else if (vm.count("out"))
+                query(d1, d2, d3, d4, out_filename, name, format);
+            else
+                query(d1, d2, d3, d4, *result, name, format);
+        } else if (cmd == std::string("scenes")) {
+            write_scenes(result ? *result : std::cout);
         } else if (cmd == std::string("quit"))
             quit = true;
         else {
@@ -215,18 +461,26 @@ int LocatorDaemon::exec_cmd(const std::vector<std::string>& argv, bool& quit) {
     }
 }
 
-void LocatorDaemon::check_state() const {
-    if (!locator)
-        throw std::runtime_error("Locator wasn't initialized");
-}
-
 int LocatorDaemon::daemon_main(int argc, const char* argv[]) {
     try {
-        std::string cmd_filename, ack_filename;
+        std::string cmd_filename, ack_filename, socket_path, spill_dir;
+        unsigned int port, workers_num, memory_budget_mb;
         boost::program_options::options_description desc{"Options"};
         desc.add_options()("help,h", "Help message");
         desc.add_options()("cmdfile", boost::program_options::value<std::string>(&cmd_filename), "Commands file");
         desc.add_options()("ackfile", boost::program_options::value<std::string>(&ack_filename), "Acknowledges file");
+        desc.add_options()("socket", boost::program_options::value<std::string>(&socket_path),
+                           "Serve requests on a Unix domain socket at this path, instead of commands files");
+        desc.add_options()("port", boost::program_options::value<unsigned int>(&port),
+                           "Serve requests on this TCP loopback port, instead of commands files");
+        desc.add_options()("workers", boost::program_options::value<unsigned int>(&workers_num)->default_value(0),
+                           "Number of threads executing socket requests concurrently, 0 for the hardware concurrency");
+        desc.add_options()("memory-budget",
+                           boost::program_options::value<unsigned int>(&memory_budget_mb)->default_value(0),
+                           "Max memory of the loaded scenes in MB, beyond which the least recently used scenes are "
+                           "evicted. 0 for unlimited");
+        desc.add_options()("spill-dir", boost::program_options::value<std::string>(&spill_dir),
+                           "Directory into which evicted scenes are saved as snapshots, for a fast reload");
 
         boost::program_options::variables_map vm;
         const auto options = boost::program_options::parse_command_line(argc, argv, desc);
@@ -235,11 +489,23 @@ int LocatorDaemon::daemon_main(int argc, const char* argv[]) {
 
         if (vm.count("help"))
             fdml_info(desc);
-        else if (!vm.count("cmdfile") || !vm.count("ackfile")) {
-            fdml_errln("The following flags are required: --cmdfile --ackfile");
+        else if (vm.count("socket") || vm.count("port")) {
+            FDML::LocatorDaemon daemon("", "");
+            daemon.set_memory_budget((size_t)memory_budget_mb << 20);
+            daemon.set_spill_dir(spill_dir);
+            LocatorServer server(daemon, workers_num);
+            if (vm.count("socket"))
+                server.listen_unix(socket_path);
+            if (vm.count("port"))
+                server.listen_tcp(port);
+            server.run();
+        } else if (!vm.count("cmdfile") || !vm.count("ackfile")) {
+            fdml_errln("The following flags are required: --cmdfile --ackfile, or --socket or --port");
             return FDML_RETCODE_MISSING_ARGS;
         } else {
             FDML::LocatorDaemon daemon(cmd_filename, ack_filename);
+            daemon.set_memory_budget((size_t)memory_budget_mb << 20);
+            daemon.set_spill_dir(spill_dir);
             daemon.run();
         }
         return FDML_RETCODE_OK;
@@ -0,0 +1,408 @@
+#include "fdml/locator_server.hpp"
+#include "fdml/internal/socket_frames.hpp"
+#include "fdml/internal/utils.hpp"
+#include "fdml/retcode.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef FDML_LINUX
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace FDML {
+
+#ifdef FDML_LINUX
+
+static std::runtime_error sys_error(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+LocatorServer::LocatorServer(LocatorDaemon& daemon, unsigned int workers_num) : daemon(daemon) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+        throw sys_error("epoll_create1 failed");
+    done_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = done_fd;
+    if (done_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, done_fd, &ev) < 0) {
+        std::runtime_error err = sys_error("eventfd failed");
+        if (done_fd >= 0)
+            ::close(done_fd);
+        ::close(epoll_fd);
+        throw err;
+    }
+
+    if (workers_num == 0)
+        workers_num = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int w = 0; w < workers_num; w++)
+        workers.emplace_back(&LocatorServer::worker_main, this);
+}
+
+LocatorServer::~LocatorServer() {
+    stop_workers();
+    for (const auto& conn : connections)
+        ::close(conn.first);
+    for (int fd : listen_fds)
+        ::close(fd);
+    if (!unix_path.empty())
+        ::unlink(unix_path.c_str());
+    ::close(done_fd);
+    ::close(epoll_fd);
+}
+
+void LocatorServer::add_listen_fd(int fd) {
+    if (::listen(fd, SOMAXCONN) < 0) {
+        ::close(fd);
+        throw sys_error("listen failed");
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        ::close(fd);
+        throw sys_error("epoll_ctl failed");
+    }
+    listen_fds.push_back(fd);
+}
+
+void LocatorServer::listen_unix(const std::string& path) {
+    if (!unix_path.empty())
+        throw std::logic_error("server is already listening on a Unix domain socket");
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::invalid_argument("socket path is too long: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw sys_error("socket failed");
+    /* a socket file left by a previous run would fail the bind */
+    ::unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        throw sys_error("bind failed: " + path);
+    }
+    unix_path = path;
+    add_listen_fd(fd);
+    fdml_infoln("[LocatorServer] listening on " << path);
+}
+
+void LocatorServer::listen_tcp(unsigned int port) {
+    if (port > std::numeric_limits<uint16_t>::max())
+        throw std::invalid_argument("invalid port: " + std::to_string(port));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw sys_error("socket failed");
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        throw sys_error("bind failed: port " + std::to_string(port));
+    }
+    add_listen_fd(fd);
+    fdml_infoln("[LocatorServer] listening on 127.0.0.1:" << port);
+}
+
+void LocatorServer::run() {
+    if (listen_fds.empty())
+        throw std::logic_error("server is not listening on any address");
+    fdml_infoln("[LocatorServer] Server is running with " << workers.size() << " workers. Waiting for requests...");
+
+    const int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+    for (bool quit = false; !quit;) {
+        int events_num = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (events_num < 0) {
+            if (errno == EINTR)
+                continue;
+            throw sys_error("epoll_wait failed");
+        }
+        for (int i = 0; i < events_num && !quit; i++) {
+            const int fd = events[i].data.fd;
+            if (fd == done_fd) {
+                quit = finish_jobs();
+                continue;
+            }
+            if (std::find(listen_fds.begin(), listen_fds.end(), fd) != listen_fds.end()) {
+                accept_connections(fd);
+                continue;
+            }
+            /* the connection may have been closed while handling a previous event */
+            auto it = connections.find(fd);
+            if (it == connections.end())
+                continue;
+            /* the peer closed the connection entirely, the responses can't be delivered */
+            if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                close_connection(fd);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                read_connection(fd, *it->second);
+                if ((it = connections.find(fd)) == connections.end())
+                    continue;
+            }
+            if (events[i].events & EPOLLOUT)
+                write_connection(fd, *it->second);
+        }
+    }
+    stop_workers();
+    fdml_infoln("[LocatorServer] Quit.");
+}
+
+void LocatorServer::accept_connections(int listen_fd) {
+    for (;;) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                fdml_errln("[LocatorServer] accept failed: " << std::strerror(errno));
+            return;
+        }
+        /* send small responses immediately, fails harmlessly for Unix domain sockets */
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            fdml_errln("[LocatorServer] epoll_ctl failed: " << std::strerror(errno));
+            ::close(fd);
+            continue;
+        }
+        auto conn = std::make_unique<Connection>();
+        conn->events = ev.events;
+        conn->id = next_conn_id++;
+        connections.emplace(fd, std::move(conn));
+        fdml_debugln("[LocatorServer] connection " << fd << " accepted");
+    }
+}
+
+/* Check if a connection input buffer holds enough data to dispatch or reject its next request */
+static bool has_full_frame(const std::string& in, uint32_t max_request_size) {
+    if (in.size() < 4)
+        return false;
+    const uint32_t size = read_frame_u32(in.data());
+    return size > max_request_size || in.size() - 4 >= size;
+}
+
+void LocatorServer::read_connection(int fd, Connection& conn) {
+    char buf[4096];
+    /* the sockets are level triggered, so a burst stops once a whole request is buffered, and the rest of the data is
+     * read after the request is executed. This bounds the buffered input to about MAX_REQUEST_SIZE + 4 bytes, even
+     * for a client which sends faster than its requests are executed. */
+    while (!has_full_frame(conn.in, MAX_REQUEST_SIZE)) {
+        ssize_t r = ::read(fd, buf, sizeof(buf));
+        if (r > 0) {
+            conn.in.append(buf, r);
+        } else if (r < 0 && errno == EINTR) {
+            continue;
+        } else {
+            /* zero is an orderly shutdown of the peer, the requests received before it are still answered */
+            if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                conn.closing = true;
+            break;
+        }
+    }
+    dispatch_request(fd, conn);
+}
+
+void LocatorServer::dispatch_request(int fd, Connection& conn) {
+    /* pass the next complete request to the workers, unless the previous one is still executed */
+    if (!conn.busy && conn.in.size() >= 4) {
+        const uint32_t size = read_frame_u32(conn.in.data());
+        if (size > MAX_REQUEST_SIZE) {
+            fdml_errln("[LocatorServer] request of " << size << " bytes is too large, closing connection " << fd);
+            close_connection(fd);
+            return;
+        }
+        if (conn.in.size() - 4 >= size) {
+            Job job{fd, conn.id, conn.in.substr(4, size), std::string(), false};
+            conn.in.erase(0, 4 + size);
+            conn.busy = true;
+            {
+                std::lock_guard<std::mutex> lock(jobs_mutex);
+                jobs.push_back(std::move(job));
+            }
+            jobs_cv.notify_one();
+        }
+    }
+    write_connection(fd, conn);
+}
+
+bool LocatorServer::finish_jobs() {
+    uint64_t counter;
+    while (::read(done_fd, &counter, sizeof(counter)) < 0 && errno == EINTR)
+        ;
+    std::vector<Job> finished;
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        finished.swap(done_jobs);
+    }
+
+    bool quit = false;
+    for (Job& job : finished) {
+        /* the server quits even if the connection which requested it is gone */
+        if (job.quit)
+            quit = true;
+        /* the connection may have been closed while its request was executed, only the response is dropped */
+        auto it = connections.find(job.fd);
+        if (it == connections.end() || it->second->id != job.conn_id)
+            continue;
+        Connection& conn = *it->second;
+        conn.busy = false;
+        conn.out += job.response;
+        if (job.quit)
+            write_connection(job.fd, conn);
+        else
+            dispatch_request(job.fd, conn);
+    }
+    return quit;
+}
+
+void LocatorServer::worker_main() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex);
+            jobs_cv.wait(lock, [this]() { return stop || !jobs.empty(); });
+            if (stop)
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        int ret;
+        std::string body;
+        try {
+            std::ostringstream output;
+            ret = daemon.exec_cmd(job.cmd_line, job.quit, output);
+            body = output.str();
+        } catch (const std::exception& ex) {
+            fdml_errln("[LocatorServer] " << ex.what());
+            ret = FDML_RETCODE_RUNTIME_ERR;
+            body.clear();
+        }
+        if (body.size() > std::numeric_limits<uint32_t>::max() - 4) {
+            fdml_errln("[LocatorServer] response of " << body.size() << " bytes is too large");
+            ret = FDML_RETCODE_RUNTIME_ERR;
+            body.clear();
+        }
+        append_frame_u32(job.response, 4 + body.size());
+        append_frame_u32(job.response, (uint32_t)ret);
+        job.response += body;
+
+        {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            done_jobs.push_back(std::move(job));
+        }
+        const uint64_t one = 1;
+        if (::write(done_fd, &one, sizeof(one)) < 0)
+            fdml_errln("[LocatorServer] eventfd write failed: " << std::strerror(errno));
+    }
+}
+
+void LocatorServer::stop_workers() {
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        stop = true;
+    }
+    jobs_cv.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+    workers.clear();
+}
+
+void LocatorServer::write_connection(int fd, Connection& conn) {
+    while (conn.out_begin < conn.out.size()) {
+        ssize_t w = ::send(fd, conn.out.data() + conn.out_begin, conn.out.size() - conn.out_begin, MSG_NOSIGNAL);
+        if (w >= 0) {
+            conn.out_begin += w;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            close_connection(fd);
+            return;
+        }
+    }
+    const bool pending = conn.out_begin < conn.out.size();
+    if (!pending) {
+        conn.out.clear();
+        conn.out_begin = 0;
+        if (conn.closing && !conn.busy) {
+            close_connection(fd);
+            return;
+        }
+    }
+
+    /* wait for the socket to be writable only while there are pending responses, and stop reading from a closing
+     * connection, or while a request of the connection is executed */
+    const bool reading = !conn.closing && !conn.busy;
+    const uint32_t events = (reading ? (uint32_t)EPOLLIN : 0u) | (pending ? (uint32_t)EPOLLOUT : 0u);
+    if (events != conn.events) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+            close_connection(fd);
+            return;
+        }
+        conn.events = events;
+    }
+}
+
+void LocatorServer::close_connection(int fd) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections.erase(fd);
+    fdml_debugln("[LocatorServer] connection " << fd << " closed");
+}
+
+#else
+
+static std::runtime_error unsupported() {
+    return std::runtime_error("the locator server is supported on Linux only");
+}
+
+LocatorServer::LocatorServer(LocatorDaemon& daemon, unsigned int) : daemon(daemon) {
+    throw unsupported();
+}
+LocatorServer::~LocatorServer() {}
+void LocatorServer::listen_unix(const std::string&) {}
+void LocatorServer::listen_tcp(unsigned int) {}
+void LocatorServer::run() {}
+void LocatorServer::add_listen_fd(int) {}
+void LocatorServer::accept_connections(int) {}
+void LocatorServer::read_connection(int, Connection&) {}
+void LocatorServer::dispatch_request(int, Connection&) {}
+bool LocatorServer::finish_jobs() {
+    return false;
+}
+void LocatorServer::write_connection(int, Connection&) {}
+void LocatorServer::close_connection(int) {}
+void LocatorServer::worker_main() {}
+void LocatorServer::stop_workers() {}
+
+#endif
+
+} // namespace FDML
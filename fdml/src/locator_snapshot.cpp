@@ -0,0 +1,394 @@
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <type_traits>
+
+#include <boost/crc.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "fdml/internal/utils.hpp"
+#include "fdml/locator.hpp"
+
+namespace FDML {
+
+/* The snapshot file starts with a fixed size header, followed by sections of fixed size records, each aligned to 8
+ * bytes, so a mapped file can be accessed directly as arrays of records. Exact numbers are stored as their double
+ * approximation, and if the approximation is not exact, also as a reference to their text representation in the
+ * numbers section. All values are stored in the machine byte order, which is verified using the header byte order
+ * mark. The CRC-32 checksum covers the whole file, including the header with its checksum field zeroed (since
+ * version 3). */
+static const char SNAPSHOT_MAGIC[8] = {'F', 'D', 'M', 'L', 'S', 'N', 'A', 'P'};
+static const uint32_t SNAPSHOT_VERSION = 3;
+static const uint32_t SNAPSHOT_BYTE_ORDER_MARK = 0x01020304;
+static const size_t SNAPSHOT_ALIGNMENT = 8;
+
+enum SnapshotSectionType {
+    /* number of points of the scene outer boundary, followed by the number of points of each hole */
+    SNAPSHOT_SECTION_POLYGONS = 0,
+    /* points of all the scene polygons, in the order of the polygons section */
+    SNAPSHOT_SECTION_POINTS,
+    SNAPSHOT_SECTION_TRAPEZOIDS,
+    SNAPSHOT_SECTION_OPENINGS,
+    SNAPSHOT_SECTION_SORTED_BY_MAX,
+    /* the values of the openings interval index, rounded outwards to doubles (since version 2) */
+    SNAPSHOT_SECTION_INTERVALS,
+    /* text of exact numbers which are not representable as doubles */
+    SNAPSHOT_SECTION_NUMBERS,
+    SNAPSHOT_SECTIONS_NUM,
+};
+
+struct SnapshotSection {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t file_size;
+    uint32_t crc;
+    uint32_t reserved;
+    SnapshotSection sections[SNAPSHOT_SECTIONS_NUM];
+};
+
+struct SnapshotNumber {
+    double approx;
+    /* offset and length of the number text within the numbers section, the length is zero if approx is exact */
+    uint32_t text_offset;
+    uint32_t text_len;
+};
+
+struct SnapshotPoint {
+    SnapshotNumber x, y;
+};
+
+struct SnapshotDirection {
+    SnapshotNumber dx, dy;
+};
+
+struct SnapshotTrapezoid {
+    /* indices of points in the points section */
+    uint32_t top_source, top_target;
+    uint32_t bottom_source, bottom_target;
+    uint32_t left_vertex, right_vertex;
+    SnapshotDirection angle_begin, angle_end;
+};
+
+struct SnapshotOpening {
+    SnapshotNumber min, max;
+};
+
+struct SnapshotInterval {
+    double min, max;
+    uint32_t trapezoid_id;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) % SNAPSHOT_ALIGNMENT == 0, "unaligned snapshot header");
+static_assert(std::is_trivially_copyable<SnapshotTrapezoid>::value, "snapshot records must be trivially copyable");
+
+/* Calculate the checksum of a snapshot file content, with the header checksum field considered as zero */
+static uint32_t snapshot_crc(const char* data, size_t size) {
+    static const char zero_crc[sizeof(SnapshotHeader::crc)] = {};
+    const size_t crc_offset = offsetof(SnapshotHeader, crc), crc_end = crc_offset + sizeof(zero_crc);
+    boost::crc_32_type crc;
+    crc.process_bytes(data, crc_offset);
+    crc.process_bytes(zero_crc, sizeof(zero_crc));
+    crc.process_bytes(data + crc_end, size - crc_end);
+    return crc.checksum();
+}
+
+/* Builds the content of a snapshot file in memory */
+class SnapshotWriter {
+    std::vector<char> data;
+    std::vector<char> numbers;
+    SnapshotHeader header;
+
+  public:
+    SnapshotWriter() : data(sizeof(SnapshotHeader), 0) { std::memset(&header, 0, sizeof(header)); }
+
+    SnapshotNumber number(const Kernel::FT& x) {
+        SnapshotNumber res{CGAL::to_double(x), 0, 0};
+        if (Kernel::FT(res.approx) != x) {
+            std::ostringstream oss;
+            oss << x.exact();
+            const std::string text = oss.str();
+            if (numbers.size() + text.size() > UINT32_MAX)
+                throw std::runtime_error("snapshot numbers section is too large");
+            res.text_offset = numbers.size();
+            res.text_len = text.size();
+            numbers.insert(numbers.end(), text.begin(), text.end());
+        }
+        return res;
+    }
+
+    SnapshotPoint point(const Point& p) { return {number(p.x()), number(p.y())}; }
+    SnapshotDirection direction(const Direction& d) { return {number(d.dx()), number(d.dy())}; }
+
+    template <typename T> void add_section(SnapshotSectionType type, const std::vector<T>& records) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot records must be trivially copyable");
+        data.resize((data.size() + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT, 0);
+        header.sections[type] = {data.size(), records.size()};
+        const char* begin = reinterpret_cast<const char*>(records.data());
+        data.insert(data.end(), begin, begin + records.size() * sizeof(T));
+    }
+
+    const std::vector<char>& finish() {
+        add_section(SNAPSHOT_SECTION_NUMBERS, numbers);
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.byte_order_mark = SNAPSHOT_BYTE_ORDER_MARK;
+        header.file_size = data.size();
+        std::memcpy(data.data(), &header, sizeof(header));
+        header.crc = snapshot_crc(data.data(), data.size());
+        std::memcpy(data.data(), &header, sizeof(header));
+        return data;
+    }
+};
+
+/* Validates and provides access to the content of a mapped snapshot file */
+class SnapshotReader {
+    const char* data;
+    size_t size;
+    SnapshotHeader header;
+    const char* numbers;
+    size_t numbers_size;
+
+  public:
+    SnapshotReader(const char* data, size_t size) : data(data), size(size) {
+        if (size < sizeof(SnapshotHeader))
+            throw std::runtime_error("snapshot file is too small");
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+            throw std::runtime_error("not a snapshot file");
+        if (header.version != SNAPSHOT_VERSION)
+            throw std::runtime_error("unsupported snapshot version: " + std::to_string(header.version));
+        if (header.byte_order_mark != SNAPSHOT_BYTE_ORDER_MARK)
+            throw std::runtime_error("snapshot was created on a machine with a different byte order");
+        if (header.file_size != size)
+            throw std::runtime_error("snapshot file is truncated");
+        if (snapshot_crc(data, size) != header.crc)
+            throw std::runtime_error("snapshot checksum mismatch");
+        numbers = section<char>(SNAPSHOT_SECTION_NUMBERS, numbers_size);
+    }
+
+    template <typename T> const T* section(SnapshotSectionType type, size_t& count) const {
+        const SnapshotSection& s = header.sections[type];
+        if (s.offset % SNAPSHOT_ALIGNMENT != 0 || s.offset > size || s.count > (size - s.offset) / sizeof(T))
+            throw std::runtime_error("corrupted snapshot section");
+        count = s.count;
+        return reinterpret_cast<const T*>(data + s.offset);
+    }
+
+    Kernel::FT number(const SnapshotNumber& x) const {
+        if (x.text_len == 0)
+            return Kernel::FT(x.approx);
+        if ((size_t)x.text_offset + x.text_len > numbers_size)
+            throw std::runtime_error("corrupted snapshot number");
+        std::istringstream iss(std::string(numbers + x.text_offset, x.text_len));
+        Kernel::FT::Exact_type exact;
+        iss >> exact;
+        if (iss.fail())
+            throw std::runtime_error("corrupted snapshot number");
+        return Kernel::FT(exact);
+    }
+
+    Point point(const SnapshotPoint& p) const { return Point(number(p.x), number(p.y)); }
+    Direction direction(const SnapshotDirection& d) const { return Direction(number(d.dx), number(d.dy)); }
+};
+
+void Locator::save(const std::string& filename) const {
+    fdml_infoln("[Locator] saving snapshot: " << filename);
+    SnapshotWriter writer;
+
+    /* scene polygons, the trapezoids refer to vertices by their index within the scene points */
+    const Polygon_with_holes& scene = trapezoider.get_scene();
+    std::vector<uint32_t> polygons;
+    std::vector<SnapshotPoint> points;
+    std::map<Point, uint32_t> points_indices;
+    auto add_polygon = [&](const Polygon& polygon) {
+        polygons.push_back(polygon.size());
+        for (const Point& p : polygon.vertices()) {
+            points_indices[p] = points.size();
+            points.push_back(writer.point(p));
+        }
+    };
+    add_polygon(scene.outer_boundary());
+    for (auto hole = scene.holes_begin(); hole != scene.holes_end(); ++hole)
+        add_polygon(*hole);
+
+    std::vector<SnapshotTrapezoid> trapezoids;
+    trapezoids.reserve(trapezoider.number_of_trapezoids());
+    for (auto it = trapezoider.trapezoids_begin(); it != trapezoider.trapezoids_end(); ++it) {
+        const Trapezoid& t = *it;
+        SnapshotTrapezoid record;
+        record.top_source = points_indices.at(t.top_edge->source()->point());
+        record.top_target = points_indices.at(t.top_edge->target()->point());
+        record.bottom_source = points_indices.at(t.bottom_edge->source()->point());
+        record.bottom_target = points_indices.at(t.bottom_edge->target()->point());
+        record.left_vertex = points_indices.at(t.left_vertex->point());
+        record.right_vertex = points_indices.at(t.right_vertex->point());
+        record.angle_begin = writer.direction(t.angle_begin);
+        record.angle_end = writer.direction(t.angle_end);
+        trapezoids.push_back(record);
+    }
+
+    std::vector<SnapshotOpening> openings_records;
+    openings_records.reserve(openings.size());
+    for (const auto& opening : openings)
+        openings_records.push_back({writer.number(opening.min), writer.number(opening.max)});
+
+    std::vector<uint32_t> sorted_by_max_records(sorted_by_max.begin(), sorted_by_max.end());
+
+    std::vector<SnapshotInterval> intervals;
+    intervals.reserve(interval_index.size());
+    for (size_t i = 0; i < interval_index.size(); i++) {
+        const IntervalIndex::Interval interval = interval_index.get(i);
+        intervals.push_back({interval.min, interval.max, interval.id, 0});
+    }
+
+    writer.add_section(SNAPSHOT_SECTION_POLYGONS, polygons);
+    writer.add_section(SNAPSHOT_SECTION_POINTS, points);
+    writer.add_section(SNAPSHOT_SECTION_TRAPEZOIDS, trapezoids);
+    writer.add_section(SNAPSHOT_SECTION_OPENINGS, openings_records);
+    writer.add_section(SNAPSHOT_SECTION_SORTED_BY_MAX, sorted_by_max_records);
+    writer.add_section(SNAPSHOT_SECTION_INTERVALS, intervals);
+    const std::vector<char>& data = writer.finish();
+
+    std::ofstream file(filename, std::ofstream::binary | std::ofstream::trunc);
+    file.write(data.data(), data.size());
+    file.close();
+    if (!file)
+        throw std::runtime_error("failed to write snapshot file: " + filename);
+    fdml_infoln("[Locator] snapshot saved (" << data.size() << " bytes)");
+}
+
+void Locator::load(const std::string& filename) {
+    fdml_infoln("[Locator] loading snapshot: " << filename);
+    /* the snapshot is decoded into a temporary locator, whose data replaces the current one only if the whole snapshot
+     * is valid, so a failed load keeps the locator as it was */
+    Locator loaded;
+
+    boost::interprocess::file_mapping file(filename.c_str(), boost::interprocess::read_only);
+    boost::interprocess::mapped_region region(file, boost::interprocess::read_only);
+    const SnapshotReader reader(static_cast<const char*>(region.get_address()), region.get_size());
+
+    /* rebuild the scene */
+    size_t polygons_num, points_num;
+    const uint32_t* polygons = reader.section<uint32_t>(SNAPSHOT_SECTION_POLYGONS, polygons_num);
+    const SnapshotPoint* points_records = reader.section<SnapshotPoint>(SNAPSHOT_SECTION_POINTS, points_num);
+    std::vector<Point> points;
+    points.reserve(points_num);
+    for (size_t i = 0; i < points_num; i++)
+        points.push_back(reader.point(points_records[i]));
+    if (polygons_num == 0)
+        throw std::runtime_error("snapshot contains no scene");
+    std::vector<Polygon> scene_polygons;
+    for (size_t i = 0, begin = 0; i < polygons_num; begin += polygons[i++]) {
+        if (polygons[i] > points_num - begin)
+            throw std::runtime_error("corrupted snapshot scene");
+        scene_polygons.emplace_back(points.begin() + begin, points.begin() + begin + polygons[i]);
+    }
+    Polygon_with_holes scene(scene_polygons[0], scene_polygons.begin() + 1, scene_polygons.end());
+
+    size_t trapezoids_num;
+    const SnapshotTrapezoid* trapezoids =
+        reader.section<SnapshotTrapezoid>(SNAPSHOT_SECTION_TRAPEZOIDS, trapezoids_num);
+    loaded.trapezoider.restore_trapezoids(scene, [&](const Topology& topology, std::vector<Trapezoid>& res) {
+        /* resolve the scene points into the arrangement vertices */
+        std::map<Point, Topology::VertexID> vertices_ids;
+        for (Topology::VertexID v = 0; v < topology.number_of_vertices(); v++)
+            vertices_ids[topology.vertex(v)->point()] = v;
+        std::vector<Topology::VertexID> points_vertices;
+        points_vertices.reserve(points.size());
+        for (const Point& p : points) {
+            auto it = vertices_ids.find(p);
+            if (it == vertices_ids.end())
+                throw std::runtime_error("snapshot scene point is not a vertex of the arrangement");
+            points_vertices.push_back(it->second);
+        }
+        auto vertex = [&](uint32_t p) {
+            if (p >= points_vertices.size())
+                throw std::runtime_error("corrupted snapshot trapezoid");
+            return points_vertices[p];
+        };
+        auto edge = [&](uint32_t source, uint32_t target) {
+            Topology::EdgeID e;
+            if (!topology.find_edge(vertex(source), vertex(target), e))
+                throw std::runtime_error("snapshot trapezoid edge is not an edge of the arrangement");
+            return topology.edge(e);
+        };
+
+        res.reserve(trapezoids_num);
+        for (size_t i = 0; i < trapezoids_num; i++) {
+            const SnapshotTrapezoid& t = trapezoids[i];
+            res.emplace_back(i, edge(t.top_source, t.top_target), edge(t.bottom_source, t.bottom_target),
+                             topology.vertex(vertex(t.left_vertex)), topology.vertex(vertex(t.right_vertex)));
+            res.back().angle_begin = reader.direction(t.angle_begin);
+            res.back().angle_end = reader.direction(t.angle_end);
+        }
+    });
+
+    size_t openings_num, sorted_by_max_num, intervals_num;
+    const SnapshotOpening* openings_records = reader.section<SnapshotOpening>(SNAPSHOT_SECTION_OPENINGS, openings_num);
+    const uint32_t* sorted_by_max_records =
+        reader.section<uint32_t>(SNAPSHOT_SECTION_SORTED_BY_MAX, sorted_by_max_num);
+    const SnapshotInterval* intervals = reader.section<SnapshotInterval>(SNAPSHOT_SECTION_INTERVALS, intervals_num);
+    if (openings_num != trapezoids_num || sorted_by_max_num != trapezoids_num || intervals_num != trapezoids_num)
+        throw std::runtime_error("corrupted snapshot, sections sizes mismatch");
+
+    loaded.openings.reserve(openings_num);
+    for (size_t i = 0; i < openings_num; i++)
+        loaded.openings.emplace_back(reader.number(openings_records[i].min), reader.number(openings_records[i].max));
+
+    loaded.sorted_by_max.reserve(sorted_by_max_num);
+    for (size_t i = 0; i < sorted_by_max_num; i++) {
+        if (sorted_by_max_records[i] >= trapezoids_num)
+            throw std::runtime_error("corrupted snapshot trapezoid ID");
+        loaded.sorted_by_max.push_back(sorted_by_max_records[i]);
+    }
+    loaded.calc_sorted_max_upper();
+
+    /* build the interval index from the stored intervals, which are already rounded outwards */
+    std::vector<IntervalIndex::Interval> index_intervals;
+    index_intervals.reserve(intervals_num);
+    for (size_t i = 0; i < intervals_num; i++) {
+        if (intervals[i].trapezoid_id >= trapezoids_num)
+            throw std::runtime_error("corrupted snapshot trapezoid ID");
+        index_intervals.push_back({intervals[i].min, intervals[i].max, intervals[i].trapezoid_id});
+    }
+    loaded.interval_index.build(index_intervals);
+
+    /* the query plans are not stored in the snapshot, as they are cheap to calculate relative to the openings */
+    loaded.calc_query_plans();
+    loaded.calc_trapezoids_edges();
+    loaded.build_heading_index();
+    loaded.build_region_index();
+
+    /* the preprocessing parallelism and the executor are kept */
+    trapezoider = std::move(loaded.trapezoider);
+    openings = std::move(loaded.openings);
+    plans = std::move(loaded.plans);
+    sorted_by_max = std::move(loaded.sorted_by_max);
+    sorted_max_upper = std::move(loaded.sorted_max_upper);
+    interval_index = std::move(loaded.interval_index);
+    heading_index = std::move(loaded.heading_index);
+    trapezoids_edges = std::move(loaded.trapezoids_edges);
+    region_index = std::move(loaded.region_index);
+
+    fdml_infoln("[Locator] snapshot loaded (" << trapezoids_num << " trapezoids)");
+}
+
+bool Locator::is_snapshot(const std::string& filename) {
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    std::ifstream file(filename, std::ifstream::binary);
+    if (!file.read(magic, sizeof(magic)))
+        return false;
+    return std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0;
+}
+
+} // namespace FDML
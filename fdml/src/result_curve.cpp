@@ -0,0 +1,410 @@
+#include "fdml/internal/curve_sampling.hpp"
+#include "fdml/trapezoid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+namespace FDML {
+
+ResultCurve ResultCurve::segment(const Point& source, const Point& target) {
+    ResultCurve c(SEGMENT);
+    c.source = source;
+    c.target = target;
+    return c;
+}
+
+ResultCurve ResultCurve::arc(const Point& center, const Kernel::FT& radius, double angle_begin, double angle_end) {
+    ResultCurve c(ARC);
+    c.pole = center;
+    c.d = radius;
+    c.angle_begin = angle_begin;
+    c.angle_end = angle_end;
+    return c;
+}
+
+ResultCurve ResultCurve::conchoid(const Point& pole, const Line& line, const Kernel::FT& d, double angle_begin,
+                                  double angle_end) {
+    ResultCurve c(CONCHOID);
+    c.pole = pole;
+    c.line = line;
+    c.d = d;
+    c.angle_begin = angle_begin;
+    c.angle_end = angle_end;
+    return c;
+}
+
+ResultCurve ResultCurve::ellipse(const Point& center, double axis_x, double axis_y, double scale, double phase,
+                                 const Kernel::FT& d, double angle_begin, double angle_end) {
+    ResultCurve c(ELLIPSE);
+    c.pole = center;
+    c.axis_x = axis_x;
+    c.axis_y = axis_y;
+    c.scale = scale;
+    c.phase = phase;
+    c.d = d;
+    c.angle_begin = angle_begin;
+    c.angle_end = angle_end;
+    return c;
+}
+
+/* The angle of a curve parameter. The end parameters map exactly to the end angles, so adjacent parts of a curve
+ * share their end points. */
+static double angle_at(const ResultCurve& c, double t) {
+    return t == 1 ? c.angle_end : c.angle_begin + (c.angle_end - c.angle_begin) * t;
+}
+
+Point ResultCurve::point_at(double t) const {
+    if (type == SEGMENT) {
+        if (t == 0 || t == 1)
+            return t == 0 ? source : target;
+        const double sx = CGAL::to_double(source.x()), sy = CGAL::to_double(source.y());
+        return Point(sx + (CGAL::to_double(target.x()) - sx) * t, sy + (CGAL::to_double(target.y()) - sy) * t);
+    }
+
+    const double a = angle_at(*this, t), ux = std::cos(a), uy = std::sin(a);
+    const double px = CGAL::to_double(pole.x()), py = CGAL::to_double(pole.y()), dd = CGAL::to_double(d);
+    switch (type) {
+    case ARC:
+        return Point(px + ux * dd, py + uy * dd);
+    case CONCHOID: {
+        const InexactLine l(line);
+        const double r = dd - l.eval(px, py) / (l.a * ux + l.b * uy);
+        return Point(px + ux * r, py + uy * r);
+    }
+    case ELLIPSE: {
+        const double k = scale * std::sin(a - phase);
+        return Point(px + axis_x * k - ux * dd, py + axis_y * k - uy * dd);
+    }
+    default:
+        throw std::logic_error("unknown curve type");
+    }
+}
+
+ResultCurve ResultCurve::part(double t_begin, double t_end) const {
+    if (type == SEGMENT)
+        return segment(point_at(t_begin), point_at(t_end));
+    ResultCurve c(*this);
+    c.angle_begin = angle_at(*this, t_begin);
+    c.angle_end = angle_at(*this, t_end);
+    return c;
+}
+
+ResultCurve ResultCurve::reversed() const {
+    ResultCurve c(*this);
+    std::swap(c.source, c.target);
+    std::swap(c.angle_begin, c.angle_end);
+    return c;
+}
+
+std::vector<Point> ResultCurve::evaluate(const ResultOptions& options) const {
+    if (type == SEGMENT)
+        return {source, target};
+
+    const double angle_range = angle_end - angle_begin, dd = CGAL::to_double(d);
+    unsigned int appx_num;
+    switch (type) {
+    case ARC:
+        appx_num = calc_appx_num(angle_range, ARC_APPX_POINTS_NUM, dd, options);
+        break;
+    case CONCHOID: {
+        const double curvature_bound =
+            conchoid_curvature_bound(InexactLine(line), CGAL::to_double(pole.x()), CGAL::to_double(pole.y()), dd,
+                                     std::min(angle_begin, angle_end), std::abs(angle_range));
+        appx_num = calc_appx_num(angle_range, CONCHOID_APPX_POINTS_NUM, curvature_bound, options);
+        break;
+    }
+    default:
+        appx_num = calc_appx_num(angle_range, ELLIPSE_APPX_POINTS_NUM, std::abs(scale) + dd, options);
+        break;
+    }
+    appx_num = std::max(1u, appx_num);
+
+    std::vector<Point> points;
+    points.reserve(appx_num + 1);
+    for (unsigned int i = 0; i <= appx_num; i++)
+        points.push_back(point_at(i == appx_num ? 1 : (double)i / appx_num));
+    return points;
+}
+
+/* Bisection iterations used to refine a root of a polynomial within an interval in which it is monotone */
+static const unsigned int CLIP_BISECTION_ITERS = 64;
+
+static double poly_eval(const std::vector<double>& p, double x) {
+    double v = 0;
+    for (auto it = p.rbegin(); it != p.rend(); ++it)
+        v = v * x + *it;
+    return v;
+}
+
+/* Add the real roots within [lo, hi] of a polynomial, given by its coefficients starting from the constant one.
+ * Polynomials up to degree 2 are solved directly. Otherwise, the roots of the derivative split the interval into parts
+ * in which the polynomial is monotone, and the single root of each part with a sign change is refined by bisection. */
+static void poly_roots(std::vector<double> p, double lo, double hi, std::vector<double>& roots) {
+    while (!p.empty() && p.back() == 0)
+        p.pop_back();
+    auto add_root = [&roots, lo, hi](double x) {
+        if (x >= lo && x <= hi)
+            roots.push_back(x);
+    };
+    if (p.size() <= 1)
+        return;
+    if (p.size() == 2) {
+        add_root(-p[0] / p[1]);
+        return;
+    }
+    if (p.size() == 3) {
+        const double disc = p[1] * p[1] - 4 * p[2] * p[0];
+        if (disc < 0)
+            return;
+        /* the numerically stable form, avoiding the cancellation of -b and the discriminant root */
+        const double q = -(p[1] + std::copysign(std::sqrt(disc), p[1])) / 2;
+        add_root(q / p[2]);
+        if (q != 0)
+            add_root(p[0] / q);
+        return;
+    }
+
+    std::vector<double> derivative(p.size() - 1);
+    for (unsigned int i = 1; i < p.size(); i++)
+        derivative[i - 1] = i * p[i];
+    std::vector<double> bounds = {lo};
+    poly_roots(derivative, lo, hi, bounds);
+    bounds.push_back(hi);
+    std::sort(bounds.begin(), bounds.end());
+    for (unsigned int i = 0; i + 1 < bounds.size(); i++) {
+        double x_low = bounds[i], x_high = bounds[i + 1];
+        const double v_low = poly_eval(p, x_low), v_high = poly_eval(p, x_high);
+        if (v_low == 0)
+            add_root(x_low);
+        if ((v_low > 0) == (v_high > 0) || v_low == 0 || v_high == 0)
+            continue;
+        for (unsigned int iter = 0; iter < CLIP_BISECTION_ITERS; iter++) {
+            const double x_mid = (x_low + x_high) / 2;
+            ((poly_eval(p, x_mid) > 0) == (v_low > 0) ? x_low : x_high) = x_mid;
+        }
+        add_root(x_high);
+    }
+    if (poly_eval(p, hi) == 0)
+        add_root(hi);
+}
+
+/* Add the angles within [lo, hi] in which a trigonometric polynomial vanishes. The polynomial is
+ * c[0] + c[1] cos(a) + c[2] sin(a) + c[3] cos(2a) + c[4] sin(2a). The interval is split into parts of a quarter turn,
+ * and the polynomial of each part is written in the tangent of the half angle from the part middle, as a polynomial of
+ * degree 4, or of degree 2 after dividing by the common factor (1 + t^2) if it has no double angle terms. */
+static void trig_poly_roots(const double c[5], double lo, double hi, std::vector<double>& roots) {
+    const unsigned int parts_num = std::max(1, (int)std::ceil((hi - lo) / (M_PI / 2)));
+    for (unsigned int part = 0; part < parts_num; part++) {
+        const double part_lo = lo + (hi - lo) * part / parts_num;
+        const double part_hi = part + 1 == parts_num ? hi : lo + (hi - lo) * (part + 1) / parts_num;
+        const double m = (part_lo + part_hi) / 2, cm = std::cos(m), sm = std::sin(m);
+        const double c2m = std::cos(2 * m), s2m = std::sin(2 * m);
+        /* the coefficients relative to the part middle, a = m + b */
+        const double c1 = c[1] * cm + c[2] * sm, s1 = c[2] * cm - c[1] * sm;
+        const double c2 = c[3] * c2m + c[4] * s2m, s2 = c[4] * c2m - c[3] * s2m;
+        std::vector<double> p;
+        if (c2 == 0 && s2 == 0)
+            p = {c[0] + c1, 2 * s1, c[0] - c1};
+        else
+            p = {c[0] + c1 + c2, 2 * s1 + 4 * s2, 2 * c[0] - 6 * c2, 2 * s1 - 4 * s2, c[0] - c1 + c2};
+        std::vector<double> ts;
+        poly_roots(p, std::tan((part_lo - m) / 2), std::tan((part_hi - m) / 2), ts);
+        for (double t : ts)
+            roots.push_back(m + 2 * std::atan(t));
+    }
+}
+
+/* A part of a curve which is entirely within or outside the half plane */
+struct CurvePart {
+    ResultCurve curve;
+    bool inside;
+};
+
+/* A point in which the boundary crosses the line, see HalfPlaneClipper */
+struct CurveCrossing {
+    Point point;
+    /* position along the line, and a tie breaker of crossings at the same point */
+    double pos, pos_tie;
+    bool entry;
+    unsigned int chain;
+};
+
+/* A part of the boundary within the half plane, from an entry crossing to an exit crossing */
+struct CurveChain {
+    std::vector<ResultCurve> curves;
+    Point entry, exit;
+};
+
+static double line_value(const InexactLine& line, const Point& p) {
+    return line.eval(CGAL::to_double(p.x()), CGAL::to_double(p.y()));
+}
+
+/* The parameters in (0, 1) in which a curve crosses a line, sorted. The line value along each curve type is a
+ * trigonometric polynomial of the curve angle: an arc and an ellipse points are linear in the angle cosine and sine,
+ * and a conchoid line value is multiplied by the cosine of the angle relative to its own line, which doesn't vanish
+ * along the curve. */
+static std::vector<double> crossing_params(const ResultCurve& curve, const InexactLine& line) {
+    const double px = CGAL::to_double(curve.pole.x()), py = CGAL::to_double(curve.pole.y());
+    const double dd = CGAL::to_double(curve.d), pole_value = line.eval(px, py);
+    double c[5] = {pole_value, 0, 0, 0, 0};
+    switch (curve.type) {
+    case ResultCurve::ARC:
+        c[1] = dd * line.a;
+        c[2] = dd * line.b;
+        break;
+    case ResultCurve::CONCHOID: {
+        const InexactLine l(curve.line);
+        const double l_pole_value = l.eval(px, py);
+        c[0] = dd * (line.a * l.a + line.b * l.b) / 2;
+        c[1] = pole_value * l.a - l_pole_value * line.a;
+        c[2] = pole_value * l.b - l_pole_value * line.b;
+        c[3] = dd * (line.a * l.a - line.b * l.b) / 2;
+        c[4] = dd * (line.a * l.b + line.b * l.a) / 2;
+        break;
+    }
+    case ResultCurve::ELLIPSE: {
+        const double k = (line.a * curve.axis_x + line.b * curve.axis_y) * curve.scale;
+        c[1] = -k * std::sin(curve.phase) - dd * line.a;
+        c[2] = k * std::cos(curve.phase) - dd * line.b;
+        break;
+    }
+    default:
+        throw std::logic_error("unknown curve type");
+    }
+
+    std::vector<double> params;
+    const double range = curve.angle_end - curve.angle_begin;
+    if (range == 0)
+        return params;
+    std::vector<double> angles;
+    trig_poly_roots(c, std::min(curve.angle_begin, curve.angle_end), std::max(curve.angle_begin, curve.angle_end),
+                    angles);
+    for (double a : angles) {
+        const double t = (a - curve.angle_begin) / range;
+        if (t > 0 && t < 1)
+            params.push_back(t);
+    }
+    std::sort(params.begin(), params.end());
+    return params;
+}
+
+/* Split a curve into parts which are entirely within or outside the half plane. Points on the line are considered
+ * outside, as in HalfPlaneClipper. */
+static void split_curve(const ResultCurve& curve, const InexactLine& line, std::vector<CurvePart>& parts) {
+    std::vector<double> ts = {0};
+    if (curve.type == ResultCurve::SEGMENT) {
+        const double v0 = line_value(line, curve.source), v1 = line_value(line, curve.target);
+        if ((v0 > 0) != (v1 > 0) && v0 != 0 && v1 != 0)
+            ts.push_back(v0 / (v0 - v1));
+    } else {
+        for (double t : crossing_params(curve, line))
+            if (t > ts.back())
+                ts.push_back(t);
+    }
+    ts.push_back(1);
+
+    for (unsigned int i = 0; i + 1 < ts.size(); i++) {
+        ResultCurve part = ts[i] == 0 && ts[i + 1] == 1 ? curve : curve.part(ts[i], ts[i + 1]);
+        const bool inside = line_value(line, curve.point_at((ts[i] + ts[i + 1]) / 2)) > 0;
+        parts.push_back({std::move(part), inside});
+    }
+}
+
+std::vector<std::vector<ResultCurve>> ResultCurve::clip(const std::vector<ResultCurve>& boundary, const Line& line) {
+    if (boundary.empty())
+        return {};
+
+    /* orient the boundary counter clockwise, using the signed area of a sampled polygon */
+    double area = 0;
+    std::vector<Point> samples;
+    for (const ResultCurve& curve : boundary) {
+        unsigned int samples_num = curve.type == SEGMENT ? 1 : 8;
+        for (unsigned int i = 0; i < samples_num; i++)
+            samples.push_back(curve.point_at((double)i / samples_num));
+    }
+    for (unsigned int i = 0; i < samples.size(); i++) {
+        const Point &p = samples[i], &q = samples[(i + 1) % samples.size()];
+        area += CGAL::to_double(p.x()) * CGAL::to_double(q.y()) - CGAL::to_double(q.x()) * CGAL::to_double(p.y());
+    }
+    std::vector<ResultCurve> curves;
+    if (area >= 0) {
+        curves = boundary;
+    } else {
+        for (auto it = boundary.rbegin(); it != boundary.rend(); ++it)
+            curves.push_back(it->reversed());
+    }
+
+    const InexactLine line_inexact(line);
+    std::vector<CurvePart> parts;
+    for (const ResultCurve& curve : curves)
+        split_curve(curve, line_inexact, parts);
+    auto outside_it = std::find_if(parts.begin(), parts.end(), [](const CurvePart& p) { return !p.inside; });
+    if (outside_it == parts.end())
+        return {curves};
+    if (std::none_of(parts.begin(), parts.end(), [](const CurvePart& p) { return p.inside; }))
+        return {};
+
+    /* Walk the boundary once starting at an outside part, and split it into chains within the half plane */
+    const Vector line_vec = line.to_vector();
+    const double lx = CGAL::to_double(line_vec.x()), ly = CGAL::to_double(line_vec.y());
+    std::vector<CurveChain> chains;
+    std::vector<CurveCrossing> crossings;
+    auto add_crossing = [&](const Point& x, const ResultCurve& inside_curve, bool entry) {
+        const double px = CGAL::to_double(x.x()), py = CGAL::to_double(x.y());
+        const Point in = inside_curve.point_at(0.5);
+        const double wx = CGAL::to_double(in.x()) - px, wy = CGAL::to_double(in.y()) - py;
+        /* the line normal into the half plane is (-ly, lx) */
+        crossings.push_back({x, px * lx + py * ly, (wx * lx + wy * ly) / (wy * lx - wx * ly), entry,
+                             (unsigned int)chains.size() - 1});
+        (entry ? chains.back().entry : chains.back().exit) = x;
+    };
+    const unsigned int n = parts.size(), start = outside_it - parts.begin();
+    for (unsigned int k = 0; k < n; k++) {
+        const CurvePart &prev = parts[(start + k) % n], &part = parts[(start + k + 1) % n];
+        if (!prev.inside && part.inside) {
+            chains.emplace_back();
+            add_crossing(part.curve.point_at(0), part.curve, true);
+        }
+        if (part.inside)
+            chains.back().curves.push_back(part.curve);
+        else if (prev.inside)
+            add_crossing(prev.curve.point_at(1), prev.curve, false);
+    }
+
+    /* connect each exit crossing to the next entry crossing along the line */
+    std::vector<unsigned int> order(crossings.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&crossings](unsigned int c1, unsigned int c2) {
+        const CurveCrossing &x1 = crossings[c1], &x2 = crossings[c2];
+        return x1.pos != x2.pos ? x1.pos < x2.pos : x1.pos_tie < x2.pos_tie;
+    });
+    std::vector<unsigned int> next_chain(chains.size());
+    for (unsigned int k = 0; k + 1 < order.size(); k += 2) {
+        const CurveCrossing &x1 = crossings[order[k]], &x2 = crossings[order[k + 1]];
+        if (x1.entry == x2.entry)
+            throw std::runtime_error("failed to clip the analytic result");
+        next_chain[x1.entry ? x2.chain : x1.chain] = x1.entry ? x1.chain : x2.chain;
+    }
+
+    std::vector<std::vector<ResultCurve>> res;
+    std::vector<bool> visited(chains.size(), false);
+    for (unsigned int c_begin = 0; c_begin < chains.size(); c_begin++) {
+        if (visited[c_begin])
+            continue;
+        std::vector<ResultCurve> piece;
+        for (unsigned int c = c_begin; !visited[c]; c = next_chain[c]) {
+            visited[c] = true;
+            const CurveChain& chain = chains[c];
+            piece.insert(piece.end(), chain.curves.begin(), chain.curves.end());
+            const Point& next_entry = chains[next_chain[c]].entry;
+            if (chain.exit != next_entry)
+                piece.push_back(segment(chain.exit, next_entry));
+        }
+        res.push_back(std::move(piece));
+    }
+    return res;
+}
+
+} // namespace FDML
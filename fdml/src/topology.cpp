@@ -0,0 +1,78 @@
+#include "fdml/internal/topology.hpp"
+
+namespace FDML {
+
+void Topology::build(const Arrangement& arr) {
+    vertices.clear();
+    edges.clear();
+    edges_source.clear();
+    edges_face.clear();
+    free_faces.clear();
+    out_edges_offsets.clear();
+    out_edges.clear();
+    edges_lookup.clear();
+    vertices_ids.clear();
+    edges_ids.clear();
+    faces_ids.clear();
+
+    vertices.reserve(arr.number_of_vertices());
+    for (auto v = arr.vertices_begin(); v != arr.vertices_end(); ++v) {
+        vertices_ids[v] = vertices.size();
+        vertices.push_back(v);
+    }
+
+    free_faces.reserve(arr.number_of_faces());
+    for (auto face = arr.faces_begin(); face != arr.faces_end(); ++face) {
+        faces_ids[face] = free_faces.size();
+        free_faces.push_back(!face->is_unbounded() && face->contained());
+    }
+
+    /* each edge is stored as two consecutive halfedges */
+    edges.reserve(arr.number_of_halfedges());
+    for (auto edge = arr.edges_begin(); edge != arr.edges_end(); ++edge) {
+        for (const Halfedge& e : {Halfedge(edge), Halfedge(edge->twin())}) {
+            edges_ids[e] = edges.size();
+            edges.push_back(e);
+            edges_source.push_back(vertices_ids.at(e->source()));
+            edges_face.push_back(faces_ids.at(e->face()));
+        }
+    }
+
+    /* compress the outgoing halfedges of each vertex */
+    out_edges_offsets.assign(vertices.size() + 1, 0);
+    for (EdgeID e = 0; e < edges.size(); e++)
+        out_edges_offsets[edges_source[e] + 1]++;
+    for (VertexID v = 0; v < vertices.size(); v++)
+        out_edges_offsets[v + 1] += out_edges_offsets[v];
+    out_edges.resize(edges.size());
+    std::vector<unsigned int> next(out_edges_offsets.begin(), out_edges_offsets.end() - 1);
+    for (EdgeID e = 0; e < edges.size(); e++)
+        out_edges[next[edges_source[e]]++] = e;
+
+    edges_lookup.reserve(edges.size());
+    for (EdgeID e = 0; e < edges.size(); e++)
+        edges_lookup[edge_key(source(e), target(e))] = e;
+}
+
+bool Topology::find_edge(VertexID source, VertexID target, EdgeID& res) const {
+    auto it = edges_lookup.find(edge_key(source, target));
+    if (it == edges_lookup.end())
+        return false;
+    res = it->second;
+    return true;
+}
+
+/* Estimated bytes of a hash map, a node per entry and a pointer per bucket */
+template <typename Map> static size_t map_memory_usage(const Map& map) {
+    return map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*)) + map.bucket_count() * sizeof(void*);
+}
+
+size_t Topology::memory_usage() const {
+    return vertices.capacity() * sizeof(Vertex) + edges.capacity() * sizeof(Halfedge) +
+           edges_source.capacity() * sizeof(VertexID) + edges_face.capacity() * sizeof(FaceID) +
+           free_faces.capacity() / 8 + out_edges_offsets.capacity() * sizeof(unsigned int) +
+           out_edges.capacity() * sizeof(EdgeID) + map_memory_usage(edges_lookup) + map_memory_usage(vertices_ids) +
+           map_memory_usage(edges_ids) + map_memory_usage(faces_ids);
+}
+
+} // namespace FDML
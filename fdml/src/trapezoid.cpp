@@ -1,12 +1,16 @@
 #include "fdml/trapezoid.hpp"
+#include "fdml/internal/curve_sampling.hpp"
+#include "fdml/internal/half_plane_clipper.hpp"
 #include "fdml/internal/utils.hpp"
 
 #include <CGAL/Boolean_set_operations_2.h>
 #include <CGAL/Boolean_set_operations_2/Gps_polygon_validation.h>
 #include <CGAL/Polygon_with_holes_2.h>
-#include <CGAL/Arr_observer.h>
+#include <CGAL/convex_hull_2.h>
 #include <CGAL/enum.h>
 
+#include <array>
+
 namespace FDML {
 
 const Direction Trapezoid::ANGLE_NONE(0, 0);
@@ -77,103 +81,222 @@ static Point intersection(const Line& l1, const Line& l2) {
     return boost::get<Point>(res.get());
 }
 
-/* We use a polygon approximation to repsent the complex curves of the result. These defines determine the percision of
- * the approximation. All approximations are done by discretizing the angle. The defines below define how many discrete
- * step will be used in a 2*PI angle, relative approximation will be used for other angles. */
-static const unsigned int ARC_APPX_POINTS_NUM = 360;
-static const unsigned int CONCHOID_APPX_POINTS_NUM = 360;
-static const unsigned int ELLIPSE_APPX_POINTS_NUM = 360;
-
 static Direction edge_direction(const Halfedge& edge) {
     auto s = edge->source()->point(), t = edge->target()->point();
     return Direction(t.x() - s.x(), t.y() - s.y());
 }
 
-std::vector<Polygon> Trapezoid::calc_result_m1(const Kernel::FT& d) const {
-    if (d <= 0)
-        throw std::invalid_argument("distance measurement must be positive.");
-    fdml_debugln("[Trapezoid] calculating single measurement result...");
+/* Sample the curve of a limiting vertex of a single measurement result in double arithmetic. The curve points are
+ * vertex + u * (t + d) for unit directions u in the angle interval, where t is the signed distance along u from the
+ * vertex to the top edge line, which is zero for an arc. The loops are free of branches to allow vectorization. */
+static void sample_m1_curve_inexact(const InexactLine& top_line, const Point& vertex, bool is_arc, double a_begin,
+                                    double angle_between, const Kernel::FT& d, const ResultOptions& options,
+                                    std::vector<Point>& points) {
+    const double vx = CGAL::to_double(vertex.x()), vy = CGAL::to_double(vertex.y()), dd = CGAL::to_double(d);
+    const unsigned int appx_num = std::max(
+        1u, is_arc ? calc_appx_num(angle_between, ARC_APPX_POINTS_NUM, dd, options)
+                   : calc_appx_num(angle_between, CONCHOID_APPX_POINTS_NUM,
+                                   conchoid_curvature_bound(top_line, vx, vy, dd, a_begin, angle_between), options));
+    const double step = angle_between / appx_num;
+
+    std::vector<double> ux(appx_num + 1), uy(appx_num + 1), r(appx_num + 1);
+    for (unsigned int i = 0; i <= appx_num; i++) {
+        ux[i] = std::cos(a_begin + i * step);
+        uy[i] = std::sin(a_begin + i * step);
+    }
+    if (is_arc) {
+        std::fill(r.begin(), r.end(), dd);
+    } else {
+        const double vertex_val = top_line.eval(vx, vy);
+        for (unsigned int i = 0; i <= appx_num; i++)
+            r[i] = dd - vertex_val / (top_line.a * ux[i] + top_line.b * uy[i]);
+    }
+    for (unsigned int i = 0; i <= appx_num; i++)
+        points.emplace_back(vx + ux[i] * r[i], vy + uy[i] * r[i]);
+}
+
+/* Sample the curve of a limiting vertex of a single measurement result over an angle interval. The curve is an arc if
+ * the vertex is on the top line and a conchoid otherwise, and the samples are ordered from i_begin to i_end. */
+static void sample_m1_curve(const Trapezoid::QueryPlan& plan, unsigned int side, const Direction& i_begin,
+                            const Direction& i_end, const Kernel::FT& d, const ResultOptions& options,
+                            std::vector<Point>& points) {
+    const Line& top_edge_line = plan.top_line;
+    const Point& vertex = plan.vertices[side];
+    if (options.inexact) {
+        double a_begin = direction_angle_inexact(i_begin), angle_between = angle_between_inexact(i_begin, i_end);
+        sample_m1_curve_inexact(InexactLine(top_edge_line), vertex, plan.vertex_on_top[side], a_begin, angle_between,
+                                d, options, points);
+        return;
+    }
+
+    auto v_begin = Utils::normalize(i_begin.vector()), v_end = Utils::normalize(i_end.vector());
+    double angle_between = std::acos(CGAL::to_double(v_begin * v_end));
+    assert(angle_between != 0);
+    fdml_debugln("\tv_begin(" << v_begin << ") v_end(" << v_end << ')');
+
+    if (plan.vertex_on_top[side]) {
+        /* Arc curve */
+        fdml_debugln("\tcurve " << (side == 0 ? "left" : "right") << " is arc");
+        Point begin = vertex + v_begin * d;
+        Point end = vertex + v_end * d;
+        unsigned int appx_num = calc_appx_num(angle_between, ARC_APPX_POINTS_NUM, CGAL::to_double(d), options);
+
+        /* approximate all points of the curve by used angle steps */
+        points.push_back(begin);
+        for (unsigned int i = 1; i < appx_num; i++) {
+            Direction dir = rotate(i_begin, i * angle_between / appx_num);
+            points.emplace_back(vertex + Utils::normalize(dir.vector()) * d);
+        }
+        points.push_back(end);
+        fdml_debugln("\t\tO(" << vertex << ") r(" << d << ") B(" << begin << ") E(" << end << ')');
+
+    } else {
+        /* Conchoid curve */
+        fdml_debugln("\tcurve " << (side == 0 ? "left" : "right") << " is conchoid");
+        Point begin = intersection(top_edge_line, Line(vertex, i_begin)) + v_begin * d;
+        Point end = intersection(top_edge_line, Line(vertex, i_end)) + v_end * d;
+        double curvature_bound = 0;
+        if (options.tolerance > 0)
+            curvature_bound = conchoid_curvature_bound(InexactLine(top_edge_line), CGAL::to_double(vertex.x()),
+                                                       CGAL::to_double(vertex.y()), CGAL::to_double(d),
+                                                       direction_angle_inexact(i_begin), angle_between);
+        unsigned int appx_num = calc_appx_num(angle_between, CONCHOID_APPX_POINTS_NUM, curvature_bound, options);
+
+        /* approximate all points of the curve by used angle steps */
+        points.push_back(begin);
+        for (unsigned int i = 1; i < appx_num; i++) {
+            Direction dir = rotate(i_begin, i * angle_between / appx_num);
+            points.push_back(intersection(top_edge_line, Line(vertex, dir)) + Utils::normalize(dir.vector()) * d);
+        }
+        points.push_back(end);
+
+        fdml_debugln("\t\tO(" << vertex << ") r(" << d << ") B(" << begin << ") E(" << end << ')');
+    }
+
+    fdml_debug("\t\tcurve points:");
+    for (auto& p : points)
+        fdml_debug(" (" << p << ')');
+    fdml_debugln("");
+}
+
+/* Split the angle interval of a trapezoid, or a part of it, oriented relative to the top edge, by the mid angle which
+ * is perpendicular to the top edge. The first interval is before the mid angle and the second after it, and each of
+ * them may be empty. The split ensures a simple polygon output for each single measurement result entry. */
+static void split_m1_angle_interval(const Direction& angle_begin, const Direction& angle_end,
+                                    const Direction& top_edge_direction, Direction (&angle_intervals)[2][2]) {
     /* oriante angles relative to the top edge */
     Direction a_begin = -angle_begin, a_end = -angle_end;
     assert(Line({0, 0}, a_begin).oriented_side({a_end.dx(), a_end.dy()}) == CGAL::ON_POSITIVE_SIDE);
-    Direction top_edge_direction = edge_direction(top_edge);
 
-    /* calculate the mid angle, which is perpendicular to the top edge, and use it to split the trapezoid angle
-     * interval into 2 to ensure simple polygon output for each result entry. */
     Direction mid_angle = top_edge_direction.perpendicular(CGAL::LEFT_TURN);
     bool begin_before_mid =
         Line({0, 0}, mid_angle).oriented_side({a_begin.dx(), a_begin.dy()}) == CGAL::ON_NEGATIVE_SIDE;
     bool end_after_mid = Line({0, 0}, mid_angle).oriented_side({a_end.dx(), a_end.dy()}) == CGAL::ON_POSITIVE_SIDE;
-    Direction angle_intervals[2][2] = {{begin_before_mid ? a_begin : mid_angle, end_after_mid ? mid_angle : a_end},
-                                       {begin_before_mid ? mid_angle : a_begin, end_after_mid ? a_end : mid_angle}};
+    angle_intervals[0][0] = begin_before_mid ? a_begin : mid_angle;
+    angle_intervals[0][1] = end_after_mid ? mid_angle : a_end;
+    angle_intervals[1][0] = begin_before_mid ? mid_angle : a_begin;
+    angle_intervals[1][1] = end_after_mid ? a_end : mid_angle;
+}
 
-    fdml_debugln("\ttop edge (" << top_edge->curve() << ") bottom edge (" << bottom_edge->curve() << ')');
+static double atan2(const Kernel::FT& y, const Kernel::FT& x) {
+    double z = std::atan2(CGAL::to_double(y), CGAL::to_double(x));
+    if (z < 0)
+        z += 2 * M_PI;
+    assert(0 <= z && z <= 2 * M_PI);
+    return z;
+}
+
+Trapezoid::QueryPlan::QueryPlan(const Trapezoid& trapezoid)
+    : angle_begin(trapezoid.angle_begin), angle_end(trapezoid.angle_end),
+      top_source(trapezoid.top_edge->source()->point()), top_target(trapezoid.top_edge->target()->point()),
+      bottom_source(trapezoid.bottom_edge->source()->point()), bottom_target(trapezoid.bottom_edge->target()->point()),
+      top_line(trapezoid.top_edge->curve().line()), bottom_line(trapezoid.bottom_edge->curve().line()),
+      bottom_edge_line(bottom_source, bottom_target), top_line_dir(-edge_direction(trapezoid.top_edge)),
+      bottom_line_dir(edge_direction(trapezoid.bottom_edge)), a_begin(0), bottom_line_angle(0), angle_range(0),
+      angle_between(0) {
+    vertices[0] = trapezoid.left_vertex->point();
+    vertices[1] = trapezoid.right_vertex->point();
+    for (auto side : {0, 1})
+        vertex_on_top[side] = top_line.has_on(vertices[side]);
+    split_m1_angle_interval(angle_begin, angle_end, edge_direction(trapezoid.top_edge), m1_intervals);
+
+    /* The valid half plane is left to the bottom edge, directed from its left vertex to its right vertex */
+    Point bottom_left, bottom_right;
+    calc_edge_left_right_vertices(trapezoid.bottom_edge, get_mid_angle(angle_begin, angle_end), bottom_left,
+                                  bottom_right);
+    bottom_half_plane = Line(bottom_left, bottom_right);
+
+    lines_intersect = CGAL::do_intersect(top_line, bottom_line);
+    if (lines_intersect) {
+        inter_point = intersection(top_line, bottom_line);
+        angle_range =
+            std::acos(CGAL::to_double(Utils::normalize(angle_begin.vector()) * Utils::normalize(angle_end.vector())));
+        assert(angle_range != 0);
+        bottom_line_angle = atan2(bottom_line_dir.dy(), bottom_line_dir.dx());
+        a_begin = atan2(angle_begin.dy(), angle_begin.dx());
+        angle_between = std::acos(
+            CGAL::to_double(Utils::normalize(bottom_line_dir.vector()) * Utils::normalize(top_line_dir.vector())));
+        k_dir = Utils::normalize(Vector((top_source.x() + top_target.x()) / 2 - inter_point.x(),
+                                        (top_source.y() + top_target.y()) / 2 - inter_point.y()));
+    } else {
+        lines_dis = CGAL::approximate_sqrt(CGAL::squared_distance(top_line, bottom_line));
+    }
+
+    /* Fix exact values of the constructed objects, as a plan is shared between query threads */
+    CGAL::exact(top_line);
+    CGAL::exact(bottom_half_plane);
+    CGAL::exact(bottom_edge_line);
+    if (lines_intersect) {
+        CGAL::exact(inter_point);
+        CGAL::exact(k_dir);
+    } else {
+        CGAL::exact(lines_dis);
+    }
+}
+
+Trapezoid::QueryPlan Trapezoid::QueryPlan::restricted(const Direction& begin, const Direction& end) const {
+    QueryPlan plan(*this);
+    plan.angle_begin = begin;
+    plan.angle_end = end;
+    split_m1_angle_interval(begin, end, -top_line_dir, plan.m1_intervals);
+    /* the bottom half plane is independent of the angles, as no angle of the trapezoid is parallel to the bottom
+     * edge */
+    if (lines_intersect) {
+        auto v_begin = Utils::normalize(begin.vector()), v_end = Utils::normalize(end.vector());
+        plan.angle_range = std::acos(CGAL::to_double(v_begin * v_end));
+        assert(plan.angle_range != 0);
+        plan.a_begin = atan2(begin.dy(), begin.dx());
+    }
+    return plan;
+}
+
+std::vector<Polygon> Trapezoid::calc_result_m1(const Kernel::FT& d, const ResultOptions& options) const {
+    return calc_result_m1(QueryPlan(*this), d, options);
+}
+
+std::vector<Polygon> Trapezoid::calc_result_m1(const QueryPlan& plan, const Kernel::FT& d,
+                                               const ResultOptions& options) {
+    if (d <= 0)
+        throw std::invalid_argument("distance measurement must be positive.");
+    fdml_debugln("[Trapezoid] calculating single measurement result...");
+    fdml_debugln("\ttop line (" << plan.top_line << ") bottom line (" << plan.bottom_line << ')');
 
     std::vector<Polygon> res;
 
     /* calculate result for each angle interval */
     for (unsigned int internal_idx = 0; internal_idx < 2; internal_idx++) {
-        auto& angle_interval = angle_intervals[internal_idx];
+        auto& angle_interval = plan.m1_intervals[internal_idx];
         bool before_mid = internal_idx == 0;
         auto i_begin = angle_interval[0], i_end = angle_interval[1];
         if (i_begin == i_end)
             continue; /* ignore if the angle interval is empty */
 
         fdml_debugln("\tangle interval [" << i_begin << ", " << i_end << ']');
-        auto top_edge_line = top_edge->curve().line();
-        auto v_begin = Utils::normalize(i_begin.vector()), v_end = Utils::normalize(i_end.vector());
-        double angle_between = std::acos(CGAL::to_double(v_begin * v_end));
-        assert(angle_between != 0);
-        fdml_debugln("\tv_begin(" << v_begin << ") v_end(" << v_end << ')');
 
         /* calculate the points representing the curves in both sides of the trapezoid */
         std::vector<Point> left_points, right_points;
-        const auto LEFT = 0, RIGHT = 1;
-        for (auto side : {LEFT, RIGHT}) {
-            auto vertex = (side == LEFT ? left_vertex : right_vertex)->point();
-            auto& points = side == LEFT ? left_points : right_points;
-
-            if (top_edge_line.has_on(vertex)) {
-                /* Arc curve */
-                fdml_debugln("\tcurve " << (side == LEFT ? "left" : "right") << " is arc");
-                Point begin = vertex + v_begin * d;
-                Point end = vertex + v_end * d;
-                unsigned int appx_num = (unsigned int)((std::abs(angle_between) / (M_PI * 2)) * ARC_APPX_POINTS_NUM);
-
-                /* approximate all points of the curve by used angle steps */
-                points.push_back(begin);
-                for (unsigned int i = 1; i < appx_num; i++) {
-                    Direction dir = rotate(i_begin, i * angle_between / appx_num);
-                    points.emplace_back(vertex + Utils::normalize(dir.vector()) * d);
-                }
-                points.push_back(end);
-                fdml_debugln("\t\tO(" << vertex << ") r(" << d << ") B(" << begin << ") E(" << end << ')');
-
-            } else {
-                /* Conchoid curve */
-                fdml_debugln("\tcurve " << (side == LEFT ? "left" : "right") << " is conchoid");
-                Point begin = intersection(top_edge_line, Line(vertex, i_begin)) + v_begin * d;
-                Point end = intersection(top_edge_line, Line(vertex, i_end)) + v_end * d;
-                unsigned int appx_num =
-                    (unsigned int)((std::abs(angle_between) / (M_PI * 2)) * CONCHOID_APPX_POINTS_NUM);
-
-                /* approximate all points of the curve by used angle steps */
-                points.push_back(begin);
-                for (unsigned int i = 1; i < appx_num; i++) {
-                    Direction dir = rotate(i_begin, i * angle_between / appx_num);
-                    points.push_back(intersection(top_edge_line, Line(vertex, dir)) +
-                                     Utils::normalize(dir.vector()) * d);
-                }
-                points.push_back(end);
-
-                fdml_debugln("\t\tO(" << vertex << ") r(" << d << ") B(" << begin << ") E(" << end << ')');
-            }
-
-            fdml_debug("\t\tcurve points:");
-            for (auto& p : left_points)
-                fdml_debug(" (" << p << ')');
-            fdml_debugln("");
-        }
+        for (auto side : {0, 1})
+            sample_m1_curve(plan, side, i_begin, i_end, d, options, side == 0 ? left_points : right_points);
 
         /* construct a simple polygon from the two approximated curves */
         Polygon res_unbounded;
@@ -200,7 +323,7 @@ std::vector<Polygon> Trapezoid::calc_result_m1(const Kernel::FT& d) const {
         }
 
         /* intersect the result polygon with the trapezoids bound and add the result to the output */
-        auto res_bounded = intersect_with_bottom_edge_half_plane(res_unbounded);
+        auto res_bounded = HalfPlaneClipper::clip(res_unbounded, plan.bottom_half_plane);
         for (const auto& res_cell : res_bounded) {
             res.push_back(res_cell);
             fdml_debugln("\t\t" << res_cell);
@@ -210,45 +333,381 @@ std::vector<Polygon> Trapezoid::calc_result_m1(const Kernel::FT& d) const {
     return res;
 }
 
-static double atan2(const Kernel::FT& y, const Kernel::FT& x) {
-    double z = std::atan2(CGAL::to_double(y), CGAL::to_double(x));
-    if (z < 0)
-        z += 2 * M_PI;
-    assert(0 <= z && z <= 2 * M_PI);
-    return z;
+std::vector<Polygon> Trapezoid::calc_result_m1_range(const Kernel::FT& d_lo, const Kernel::FT& d_hi,
+                                                     const ResultOptions& options) const {
+    return calc_result_m1_range(QueryPlan(*this), d_lo, d_hi, options);
+}
+
+/* A point in the parameters plane of the positions of a range result at an angle u: the first coordinate is the
+ * position t of the measure point along the top line, and the second is the distance d of the position from the
+ * measure point, so the position is m(t) - u * d */
+typedef std::array<double, 2> ChordPoint;
+
+/* Clip a convex polygon in the parameters plane by the half plane a * t + b * d + c >= 0 */
+static void clip_chords_polygon(std::vector<ChordPoint>& poly, double a, double b, double c) {
+    std::vector<ChordPoint> res;
+    for (unsigned int i = 0; i < poly.size(); i++) {
+        const ChordPoint &p = poly[i], &q = poly[(i + 1) % poly.size()];
+        const double vp = a * p[0] + b * p[1] + c, vq = a * q[0] + b * q[1] + c;
+        if (vp >= 0)
+            res.push_back(p);
+        if ((vp >= 0) != (vq >= 0)) {
+            const double t = vp / (vp - vq);
+            res.push_back({p[0] + (q[0] - p[0]) * t, p[1] + (q[1] - p[1]) * t});
+        }
+    }
+    poly = std::move(res);
+}
+
+/* Range of cos(a - phase) over the angles [a0, a1], where a1 - a0 < 2 * PI */
+static void cos_range(double a0, double a1, double phase, double& lo, double& hi) {
+    lo = std::min(std::cos(a0 - phase), std::cos(a1 - phase));
+    hi = std::max(std::cos(a0 - phase), std::cos(a1 - phase));
+    auto contains = [a0, a1](double x) { return x + 2 * M_PI * std::ceil((a0 - x) / (2 * M_PI)) <= a1; };
+    if (contains(phase))
+        hi = 1;
+    if (contains(phase + M_PI))
+        lo = -1;
+}
+
+/* Relative slack added to the inflation of the swept cells, covering the rounding errors of the double arithmetic */
+static const double RANGE_INFLATION_SLACK = 1e-9;
+
+/* Double approximation of a trapezoid plan, used to compute conservative areas of range results */
+struct RangeSweep {
+    InexactLine top_line, bottom_line;
+    /* origin and unit direction of the positions t along the top line */
+    double ox, oy, ex, ey;
+    double vx[2], vy[2], vertex_val[2];
+    bool on_top[2];
+    double a_begin, angle_range;
+
+    RangeSweep(const Trapezoid::QueryPlan& plan)
+        : top_line(plan.top_line), bottom_line(plan.bottom_line),
+          a_begin(direction_angle_inexact(plan.angle_begin)),
+          angle_range(angle_between_inexact(plan.angle_begin, plan.angle_end)) {
+        ox = CGAL::to_double(plan.top_source.x());
+        oy = CGAL::to_double(plan.top_source.y());
+        ex = CGAL::to_double(plan.top_target.x()) - ox;
+        ey = CGAL::to_double(plan.top_target.y()) - oy;
+        const double e_norm = std::sqrt(ex * ex + ey * ey);
+        ex /= e_norm;
+        ey /= e_norm;
+        for (auto side : {0, 1}) {
+            vx[side] = CGAL::to_double(plan.vertices[side].x());
+            vy[side] = CGAL::to_double(plan.vertices[side].y());
+            on_top[side] = plan.vertex_on_top[side];
+            vertex_val[side] = on_top[side] ? 0 : top_line.eval(vx[side], vy[side]);
+        }
+    }
+
+    /* The position along the top line of the measure point of a limiting vertex at an angle */
+    double vertex_t(unsigned int side, double a) const {
+        const double ux = std::cos(a), uy = std::sin(a);
+        const double t = on_top[side] ? 0 : -vertex_val[side] / (top_line.a * ux + top_line.b * uy);
+        return (vx[side] + ux * t - ox) * ex + (vy[side] + uy * t - oy) * ey;
+    }
+
+    /* The range of positions along the top line of the measure points between the limiting vertices over the angles
+     * [a0, a1]. The measure point of a vertex moves monotonically along the top line as the ray from the vertex
+     * rotates, as the ray is never parallel to the top line within the trapezoid, so the range is achieved at the ends
+     * of the angles. */
+    void measure_range(double a0, double a1, double& t_min, double& t_max) const {
+        const double ts[4] = {vertex_t(0, a0), vertex_t(1, a0), vertex_t(0, a1), vertex_t(1, a1)};
+        t_min = *std::min_element(ts, ts + 4);
+        t_max = *std::max_element(ts, ts + 4);
+    }
+
+    /* The area swept by the positions over the angles of the trapezoid, sampled by appx_num steps. For each step,
+     * step_params returns a convex polygon in the parameters plane containing the parameters of the positions of all
+     * the angles of the step. Positions of fixed parameters move along an arc of radius d, which deviates from the
+     * chord between the step ends by at most d * (1 - cos(step / 2)). Therefore the convex hull of the positions at
+     * the step ends, inflated by this deviation, contains all the positions of the step. The union of the hulls is
+     * returned, with holes filled in, so the area is never smaller than the exact one. */
+    template <typename StepParams>
+    std::vector<Polygon> sweep(unsigned int appx_num, double d_max, const StepParams& step_params) const {
+        const double step = angle_range / appx_num;
+        const double inflation =
+            d_max * (1 - std::cos(step / 2)) + RANGE_INFLATION_SLACK * (d_max + std::abs(ox) + std::abs(oy));
+        /* the disk of the inflation radius is contained in the octagon with the radius of its circumscribed circle */
+        const double octagon_radius = inflation / std::cos(M_PI / 8);
+
+        std::vector<Polygon> cells;
+        for (unsigned int i = 0; i < appx_num; i++) {
+            const double a0 = a_begin + i * step, a1 = i + 1 == appx_num ? a_begin + angle_range : a0 + step;
+            const std::vector<ChordPoint> params = step_params(a0, a1);
+            if (params.empty())
+                continue;
+            std::vector<Point> points, hull;
+            for (double a : {a0, a1}) {
+                const double ux = std::cos(a), uy = std::sin(a);
+                for (const ChordPoint& p : params) {
+                    const double x = ox + ex * p[0] - ux * p[1], y = oy + ey * p[0] - uy * p[1];
+                    for (unsigned int k = 0; k < 8; k++)
+                        points.emplace_back(x + octagon_radius * std::cos(k * M_PI / 4),
+                                            y + octagon_radius * std::sin(k * M_PI / 4));
+                }
+            }
+            CGAL::convex_hull_2(points.begin(), points.end(), std::back_inserter(hull));
+            cells.emplace_back(hull.begin(), hull.end());
+        }
+
+        if (cells.empty())
+            return {};
+        std::vector<Polygon_with_holes> areas;
+        CGAL::join(cells.begin(), cells.end(), std::back_inserter(areas));
+        std::vector<Polygon> res;
+        for (const Polygon_with_holes& area : areas)
+            res.push_back(area.outer_boundary());
+        return res;
+    }
+};
+
+/* The number of steps of the angles sweep of a range result, in which positions of fixed parameters move along arcs
+ * of radius at most d_max. The sweep is never parametric, as the cells of a single step may be too coarse. */
+static unsigned int calc_range_appx_num(double angle_range, double d_max, const ResultOptions& options) {
+    ResultOptions sampling_options(options);
+    sampling_options.parametric = false;
+    return std::max(1u, calc_appx_num(angle_range, ARC_APPX_POINTS_NUM, d_max, sampling_options));
+}
+
+std::vector<Polygon> Trapezoid::calc_result_m1_range(const QueryPlan& plan, const Kernel::FT& d_lo,
+                                                     const Kernel::FT& d_hi, const ResultOptions& options) {
+    if (d_lo <= 0 || d_hi < d_lo)
+        throw std::invalid_argument("distance measurement range must be positive and non empty.");
+    if (d_lo == d_hi)
+        return calc_result_m1(plan, d_lo, options);
+    fdml_debugln("[Trapezoid] calculating single measurement range result...");
+
+    /* At an angle, the positions are the measure points between the measure points of the limiting vertices moved by
+     * any distance in the range, and their parameters are a rectangle */
+    const RangeSweep sweep(plan);
+    const double d_min = CGAL::to_double(d_lo), d_max = CGAL::to_double(d_hi);
+    const unsigned int appx_num = calc_range_appx_num(sweep.angle_range, d_max, options);
+    auto step_params = [&sweep, d_min, d_max](double a0, double a1) {
+        double t_min, t_max;
+        sweep.measure_range(a0, a1, t_min, t_max);
+        return std::vector<ChordPoint>{{t_min, d_min}, {t_max, d_min}, {t_max, d_max}, {t_min, d_max}};
+    };
+
+    /* intersect the result area with the trapezoids bound */
+    std::vector<Polygon> res;
+    for (const Polygon& area : sweep.sweep(appx_num, d_max, step_params)) {
+        for (auto& res_cell : HalfPlaneClipper::clip(area, plan.bottom_half_plane)) {
+            fdml_debugln("\t\t" << res_cell);
+            res.push_back(std::move(res_cell));
+        }
+    }
+    return res;
+}
+
+std::vector<std::vector<ResultCurve>> Trapezoid::calc_result_m1_analytic(const Kernel::FT& d) const {
+    return calc_result_m1_analytic(QueryPlan(*this), d);
+}
+
+std::vector<std::vector<ResultCurve>> Trapezoid::calc_result_m1_analytic(const QueryPlan& plan, const Kernel::FT& d) {
+    if (d <= 0)
+        throw std::invalid_argument("distance measurement must be positive.");
+    fdml_debugln("[Trapezoid] calculating analytic single measurement result...");
+
+    std::vector<std::vector<ResultCurve>> res;
+    for (unsigned int internal_idx = 0; internal_idx < 2; internal_idx++) {
+        auto i_begin = plan.m1_intervals[internal_idx][0], i_end = plan.m1_intervals[internal_idx][1];
+        if (i_begin == i_end)
+            continue; /* ignore if the angle interval is empty */
+        double a_begin = direction_angle_inexact(i_begin), a_end = a_begin + angle_between_inexact(i_begin, i_end);
+
+        /* the curves in both sides of the trapezoid, from the interval begin to its end */
+        std::vector<ResultCurve> curves;
+        for (auto side : {0, 1}) {
+            const Point& vertex = plan.vertices[side];
+            curves.push_back(plan.vertex_on_top[side]
+                                 ? ResultCurve::arc(vertex, d, a_begin, a_end)
+                                 : ResultCurve::conchoid(vertex, plan.top_line, d, a_begin, a_end));
+        }
+
+        /* construct a closed loop from the two curves, traversed as the polygon of calc_result_m1(). The connecting
+         * segments are omitted if the two curves share start/end vertices */
+        const ResultCurve &left = curves[0], &right = curves[1];
+        std::vector<ResultCurve> loop;
+        auto add_segment = [&loop](const Point& source, const Point& target) {
+            if (source != target)
+                loop.push_back(ResultCurve::segment(source, target));
+        };
+        if (internal_idx == 0) {
+            loop.push_back(left);
+            add_segment(left.point_at(1), right.point_at(1));
+            loop.push_back(right.reversed());
+            add_segment(right.point_at(0), left.point_at(0));
+        } else {
+            loop.push_back(left.reversed());
+            add_segment(left.point_at(0), right.point_at(0));
+            loop.push_back(right);
+            add_segment(right.point_at(1), left.point_at(1));
+        }
+
+        /* intersect the result area with the trapezoids bound */
+        for (auto& piece : ResultCurve::clip(loop, plan.bottom_half_plane))
+            res.push_back(std::move(piece));
+    }
+    return res;
+}
+
+/* Calculate the number of samples of the ellipse of a double measurement result. The valid parts of the ellipse are
+ * determined by its samples, so in parametric mode the fixed sampling is still used, and only the output is reduced to
+ * a chord per valid part. */
+static unsigned int calc_ellipse_appx_num(double angle_range, double curvature_bound, const ResultOptions& options) {
+    ResultOptions sampling_options(options);
+    sampling_options.parametric = false;
+    return std::max(1u, calc_appx_num(angle_range, ELLIPSE_APPX_POINTS_NUM, curvature_bound, sampling_options));
+}
+
+/* Add a segment between two consecutive valid samples of an ellipse. In parametric mode, segments continuing the
+ * previous one are merged into a single chord. */
+static void add_ellipse_segment(std::vector<Segment>& res, const Point& prev, const Point& p,
+                                const ResultOptions& options) {
+    if (options.parametric && !res.empty() && res.back().target() == prev)
+        res.back() = Segment(res.back().source(), p);
+    else
+        res.emplace_back(prev, p);
 }
 
-std::vector<Segment> Trapezoid::calc_result_m2(const Kernel::FT& d1, const Kernel::FT& d2) const {
+/* Double approximation of the ellipse of a double measurement result of a trapezoid with non parallel top and bottom
+ * edges. The ellipse point at angle a is inter + k_dir * k(a) - u(a) * d1, where k(a) = k_factor * sin(a - b) is the
+ * distance of the measure point in the top edge from the intersection point, and b is the bottom line angle. */
+struct InexactEllipse {
+    InexactLine top_line;
+    double d1;
+    /* intersection point of the top and bottom lines */
+    double inter_x, inter_y;
+    /* the direction from the intersection point to the middle of top edge, used with k */
+    double k_dir_x, k_dir_y;
+    double k_factor, bottom_line_angle;
+    double a_begin, angle_range;
+    /* the limiting vertices, and whether they are on the top line */
+    double vx[2], vy[2], vertex_val[2];
+    bool on_top[2];
+
+    InexactEllipse(const Trapezoid::QueryPlan& plan, const Kernel::FT& d1, const Kernel::FT& d2)
+        : top_line(plan.top_line), d1(CGAL::to_double(d1)) {
+        const InexactLine bottom_line(plan.bottom_line);
+        const double det = top_line.a * bottom_line.b - bottom_line.a * top_line.b;
+        inter_x = (top_line.b * bottom_line.c - bottom_line.b * top_line.c) / det;
+        inter_y = (bottom_line.a * top_line.c - top_line.a * bottom_line.c) / det;
+
+        angle_range = angle_between_inexact(plan.angle_begin, plan.angle_end);
+        assert(angle_range != 0);
+        const Direction &top_line_dir = plan.top_line_dir, &bottom_line_dir = plan.bottom_line_dir;
+        bottom_line_angle = direction_angle_inexact(bottom_line_dir);
+        a_begin = direction_angle_inexact(plan.angle_begin);
+        /* angle between top and bottom edges, in [0, PI] */
+        const double bx = CGAL::to_double(bottom_line_dir.dx()), by = CGAL::to_double(bottom_line_dir.dy());
+        const double tx = CGAL::to_double(top_line_dir.dx()), ty = CGAL::to_double(top_line_dir.dy());
+        const double cos_between = (bx * tx + by * ty) / std::sqrt((bx * bx + by * by) * (tx * tx + ty * ty));
+        const double angle_between = std::acos(std::max(-1.0, std::min(1.0, cos_between)));
+        k_factor = (this->d1 + CGAL::to_double(d2)) / std::sin(angle_between);
+
+        const Point &top_s = plan.top_source, &top_t = plan.top_target;
+        k_dir_x = (CGAL::to_double(top_s.x()) + CGAL::to_double(top_t.x())) / 2 - inter_x;
+        k_dir_y = (CGAL::to_double(top_s.y()) + CGAL::to_double(top_t.y())) / 2 - inter_y;
+        const double k_dir_norm = std::sqrt(k_dir_x * k_dir_x + k_dir_y * k_dir_y);
+        k_dir_x /= k_dir_norm;
+        k_dir_y /= k_dir_norm;
+
+        for (auto side : {0, 1}) {
+            vx[side] = CGAL::to_double(plan.vertices[side].x());
+            vy[side] = CGAL::to_double(plan.vertices[side].y());
+            on_top[side] = plan.vertex_on_top[side];
+            vertex_val[side] = on_top[side] ? 0 : top_line.eval(vx[side], vy[side]);
+        }
+    }
+
+    /* Calculate the ellipse point at an angle, and whether its measure point is within the top edge limits */
+    bool eval(double a, double& x, double& y) const {
+        const double ux = std::cos(a), uy = std::sin(a);
+        /* distance of measure point in top edge from intersection point */
+        const double k = k_factor * std::sin(a - bottom_line_angle);
+
+        double k_limits_squared[2];
+        for (unsigned int side = 0; side < 2; side++) {
+            /* the measure point of the vertex is the vertex itself if it is on the top line, and otherwise the
+             * intersection of the top line and the ray from the vertex */
+            const double t = on_top[side] ? 0 : -vertex_val[side] / (top_line.a * ux + top_line.b * uy);
+            const double mx = vx[side] + ux * t - inter_x, my = vy[side] + uy * t - inter_y;
+            k_limits_squared[side] = mx * mx + my * my;
+        }
+        x = inter_x + k_dir_x * k - ux * d1;
+        y = inter_y + k_dir_y * k - uy * d1;
+        const double k_min = std::min(k_limits_squared[0], k_limits_squared[1]);
+        const double k_max = std::max(k_limits_squared[0], k_limits_squared[1]);
+        return k_min <= k * k && k * k <= k_max;
+    }
+};
+
+/* Sample the ellipse of a double measurement result of a trapezoid with non parallel top and bottom edges in double
+ * arithmetic. The samples are computed by a branch free loop to allow vectorization, and only the bottom edge half
+ * plane predicate of each sample is exact. */
+static std::vector<Segment> sample_m2_ellipse_inexact(const Trapezoid::QueryPlan& plan, const Kernel::FT& d1,
+                                                      const Kernel::FT& d2, const ResultOptions& options) {
+    const InexactEllipse ellipse(plan, d1, d2);
+    const unsigned int appx_num =
+        calc_ellipse_appx_num(ellipse.angle_range, std::abs(ellipse.k_factor) + ellipse.d1, options);
+    std::vector<double> xs(appx_num + 1), ys(appx_num + 1);
+    std::vector<char> valid(appx_num + 1);
+    for (unsigned int i = 0; i <= appx_num; i++)
+        valid[i] = ellipse.eval(ellipse.a_begin + i * ellipse.angle_range / appx_num, xs[i], ys[i]);
+
+    const Line& bottom_half_plane = plan.bottom_edge_line;
+    std::vector<Segment> res;
+    Point prev;
+    bool prev_valid = false;
+    for (unsigned int i = 0; i <= appx_num; i++) {
+        if (!valid[i]) {
+            prev_valid = false;
+            continue;
+        }
+        Point res_point(xs[i], ys[i]);
+        if (bottom_half_plane.oriented_side(res_point) == CGAL::ON_NEGATIVE_SIDE) {
+            prev_valid = false;
+            continue;
+        }
+        if (prev_valid)
+            add_ellipse_segment(res, prev, res_point, options);
+        prev = res_point;
+        prev_valid = true;
+    }
+    return res;
+}
+
+std::vector<Segment> Trapezoid::calc_result_m2(const Kernel::FT& d1, const Kernel::FT& d2,
+                                               const ResultOptions& options) const {
+    return calc_result_m2(QueryPlan(*this), d1, d2, options);
+}
+
+std::vector<Segment> Trapezoid::calc_result_m2(const QueryPlan& plan, const Kernel::FT& d1, const Kernel::FT& d2,
+                                               const ResultOptions& options) {
     if (d1 <= 0 || d2 <= 0)
         throw std::invalid_argument("distance measurements must be positive.");
     fdml_debugln("[Trapezoid] calculating double measurement result...");
-    Line top_line = top_edge->curve().line();
-    Line bottom_line = bottom_edge->curve().line();
+    const Line& top_line = plan.top_line;
+    const Direction &angle_begin = plan.angle_begin, &angle_end = plan.angle_end;
 
     std::vector<Segment> res;
 
-    if (CGAL::do_intersect(top_line, bottom_line)) { /* top and bottom edges are not parallel */
-        Point inter_point = intersection(top_line, bottom_line);
-        /* angle range between angle_begin and angle_end */
-        double angle_range =
-            std::acos(CGAL::to_double(Utils::normalize(angle_begin.vector()) * Utils::normalize(angle_end.vector())));
-        assert(angle_range != 0);
-        Direction top_line_dir = -edge_direction(top_edge), bottom_line_dir = edge_direction(bottom_edge);
-        double bottom_line_angle = atan2(bottom_line_dir.dy(), bottom_line_dir.dx());
-        double a_begin = atan2(angle_begin.dy(), angle_begin.dx());
-        /* angle between top and bottom edges */
-        double angle_between = std::acos(
-            CGAL::to_double(Utils::normalize(bottom_line_dir.vector()) * Utils::normalize(top_line_dir.vector())));
+    if (plan.lines_intersect && options.inexact) {
+        /* top and bottom edges are not parallel, sample in double arithmetic */
+        res = sample_m2_ellipse_inexact(plan, d1, d2, options);
 
-        /* calc the direction from the intersection point to the middle of top edge. use with k */
-        auto top_s = top_edge->source()->point(), top_t = top_edge->target()->point();
-        auto k_dir = Utils::normalize(
-            Vector((top_s.x() + top_t.x()) / 2 - inter_point.x(), (top_s.y() + top_t.y()) / 2 - inter_point.y()));
+    } else if (plan.lines_intersect) { /* top and bottom edges are not parallel */
+        const Point& inter_point = plan.inter_point;
+        const double angle_range = plan.angle_range, angle_between = plan.angle_between;
+        const double bottom_line_angle = plan.bottom_line_angle, a_begin = plan.a_begin;
+        const Vector& k_dir = plan.k_dir;
 
         Point prev;
         bool prev_valid = false;
-        unsigned int appx_num = std::max(1u,
-            (unsigned int)((std::abs(angle_range) / (M_PI * 2)) * ELLIPSE_APPX_POINTS_NUM));
+        unsigned int appx_num = calc_ellipse_appx_num(
+            angle_range, std::abs(CGAL::to_double(d1 + d2) / std::sin(angle_between)) + CGAL::to_double(d1), options);
         for (unsigned int i = 0; i <= appx_num; i++) {
             double a = i * angle_range / appx_num;
             Direction dir = rotate(angle_begin, a);
@@ -260,8 +719,8 @@ std::vector<Segment> Trapezoid::calc_result_m2(const Kernel::FT& d1, const Kerne
             Kernel::FT k_limits_squared[2];
             const auto LEFT = 0, RIGHT = 1;
             for (auto side : {LEFT, RIGHT}) {
-                auto vertex = (side == LEFT ? left_vertex : right_vertex)->point();
-                auto measure_point = top_line.has_on(vertex) ? vertex : intersection(top_line, Line(vertex, dir));
+                const Point& vertex = plan.vertices[side];
+                auto measure_point = plan.vertex_on_top[side] ? vertex : intersection(top_line, Line(vertex, dir));
                 k_limits_squared[side] = CGAL::squared_distance(inter_point, measure_point);
             }
             if (k_limits_squared[0] > k_limits_squared[1])
@@ -273,33 +732,30 @@ std::vector<Segment> Trapezoid::calc_result_m2(const Kernel::FT& d1, const Kerne
 
             auto measure_point = inter_point + k_dir * k;
             Point res_point = measure_point + Utils::normalize((-dir).vector()) * d1;
-            if (Line(bottom_edge->source()->point(), bottom_line_dir).oriented_side(res_point) ==
-                CGAL::ON_NEGATIVE_SIDE) {
+            if (plan.bottom_edge_line.oriented_side(res_point) == CGAL::ON_NEGATIVE_SIDE) {
                 prev_valid = false;
                 continue;
             }
 
             if (prev_valid)
-                res.emplace_back(prev, res_point);
+                add_ellipse_segment(res, prev, res_point, options);
             prev = res_point;
             prev_valid = true;
         }
 
     } else { /* top and bottom are parallel */
-        auto lines_dis = CGAL::approximate_sqrt(CGAL::squared_distance(top_line, bottom_line));
-        Direction bottom_line_dir = edge_direction(bottom_edge);
-        double local_angle = std::asin(CGAL::to_double(lines_dis / (d1 + d2)));
+        double local_angle = std::asin(CGAL::to_double(plan.lines_dis / (d1 + d2)));
         for (double angle : {local_angle, M_PI - local_angle}) {
             assert(0 <= angle && angle <= M_PI);
-            auto dir = rotate(bottom_line_dir, angle);
+            auto dir = rotate(plan.bottom_line_dir, angle);
             if (!dir.counterclockwise_in_between(angle_begin, angle_end))
                 continue;
 
             Point points[2];
             const auto LEFT = 0, RIGHT = 1;
             for (auto side : {LEFT, RIGHT}) {
-                auto vertex = (side == LEFT ? left_vertex : right_vertex)->point();
-                auto measure_point = top_line.has_on(vertex) ? vertex : intersection(top_line, Line(vertex, dir));
+                const Point& vertex = plan.vertices[side];
+                auto measure_point = plan.vertex_on_top[side] ? vertex : intersection(top_line, Line(vertex, dir));
                 points[side] = measure_point + Utils::normalize((-dir).vector()) * d1;
             }
             res.emplace_back(points[0], points[1]);
@@ -309,6 +765,115 @@ std::vector<Segment> Trapezoid::calc_result_m2(const Kernel::FT& d1, const Kerne
     return res;
 }
 
+std::vector<ResultCurve> Trapezoid::calc_result_m2_analytic(const Kernel::FT& d1, const Kernel::FT& d2,
+                                                            const ResultOptions& options) const {
+    return calc_result_m2_analytic(QueryPlan(*this), d1, d2, options);
+}
+
+std::vector<ResultCurve> Trapezoid::calc_result_m2_analytic(const QueryPlan& plan, const Kernel::FT& d1,
+                                                            const Kernel::FT& d2, const ResultOptions& options) {
+    if (d1 <= 0 || d2 <= 0)
+        throw std::invalid_argument("distance measurements must be positive.");
+    fdml_debugln("[Trapezoid] calculating analytic double measurement result...");
+    std::vector<ResultCurve> res;
+    if (!plan.lines_intersect) {
+        /* top and bottom are parallel, the result is already exact */
+        for (const Segment& seg : calc_result_m2(plan, d1, d2))
+            res.push_back(ResultCurve::segment(seg.source(), seg.target()));
+        return res;
+    }
+
+    /* The valid parts of the ellipse are found by sampling as dense as the sampled result, and their ends are refined
+     * by bisection */
+    const InexactEllipse ellipse(plan, d1, d2);
+    const InexactLine bottom_half_plane(plan.bottom_edge_line);
+    auto is_valid = [&ellipse, &bottom_half_plane](double a) {
+        double x, y;
+        return ellipse.eval(a, x, y) && bottom_half_plane.eval(x, y) >= 0;
+    };
+    auto refine = [&is_valid](double a_valid, double a_invalid) {
+        for (unsigned int iter = 0; iter < 64; iter++) {
+            double mid = (a_valid + a_invalid) / 2;
+            (is_valid(mid) ? a_valid : a_invalid) = mid;
+        }
+        return a_valid;
+    };
+
+    const unsigned int appx_num =
+        calc_ellipse_appx_num(ellipse.angle_range, std::abs(ellipse.k_factor) + ellipse.d1, options);
+    const double step = ellipse.angle_range / appx_num;
+    auto sample_angle = [&ellipse, step](unsigned int i) { return ellipse.a_begin + i * step; };
+    for (unsigned int i = 0; i <= appx_num;) {
+        if (!is_valid(sample_angle(i))) {
+            i++;
+            continue;
+        }
+        unsigned int j = i;
+        while (j + 1 <= appx_num && is_valid(sample_angle(j + 1)))
+            j++;
+        double a0 = i == 0 ? sample_angle(0) : refine(sample_angle(i), sample_angle(i - 1));
+        double a1 = j == appx_num ? sample_angle(appx_num) : refine(sample_angle(j), sample_angle(j + 1));
+        if (a0 != a1)
+            res.push_back(ResultCurve::ellipse(Point(ellipse.inter_x, ellipse.inter_y), ellipse.k_dir_x,
+                                               ellipse.k_dir_y, ellipse.k_factor, ellipse.bottom_line_angle, d1, a0,
+                                               a1));
+        i = j + 1;
+    }
+    return res;
+}
+
+std::vector<Polygon> Trapezoid::calc_result_m2_range(const Kernel::FT& d1_lo, const Kernel::FT& d1_hi,
+                                                     const Kernel::FT& d2_lo, const Kernel::FT& d2_hi,
+                                                     const ResultOptions& options) const {
+    return calc_result_m2_range(QueryPlan(*this), d1_lo, d1_hi, d2_lo, d2_hi, options);
+}
+
+std::vector<Polygon> Trapezoid::calc_result_m2_range(const QueryPlan& plan, const Kernel::FT& d1_lo,
+                                                     const Kernel::FT& d1_hi, const Kernel::FT& d2_lo,
+                                                     const Kernel::FT& d2_hi, const ResultOptions& options) {
+    if (d1_lo <= 0 || d1_hi < d1_lo || d2_lo <= 0 || d2_hi < d2_lo)
+        throw std::invalid_argument("distance measurements ranges must be positive and non empty.");
+    fdml_debugln("[Trapezoid] calculating double measurement range result...");
+    const double d1_min = CGAL::to_double(d1_lo), d1_max = CGAL::to_double(d1_hi);
+    const double d2_min = CGAL::to_double(d2_lo), d2_max = CGAL::to_double(d2_hi);
+    const RangeSweep sweep(plan);
+
+    /* The chord from the measure point m(t) in direction -u reaches the bottom line after a length g(t) / p(u), where
+     * g(t) is the bottom line equation at m(t), which is affine in t, and p(u) is the bottom line normal dot u. The
+     * positions at an angle have d1 in [d1_lo, d1_hi] and chord length minus d1 in [d2_lo, d2_hi]. */
+    const InexactLine& bottom_line = sweep.bottom_line;
+    const double g0 = bottom_line.eval(sweep.ox, sweep.oy), g1 = bottom_line.a * sweep.ex + bottom_line.b * sweep.ey;
+    const double p_norm = std::sqrt(bottom_line.a * bottom_line.a + bottom_line.b * bottom_line.b);
+    const double p_phase = std::atan2(bottom_line.b, bottom_line.a);
+
+    /* Over the angles of a step, p(u) is within a range computed exactly from its phase. If it has a single sign s,
+     * 1 / |p(u)| is within [w_min, w_max], and the parameters of a position of some angle of the step satisfy
+     * s * g(t) * w_max >= d1 + d2_lo and s * g(t) * w_min <= d1 + d2_hi. Otherwise the chord length isn't bounded
+     * and only the measure points and d1 ranges are used. */
+    auto step_params = [&](double a0, double a1) {
+        double t_min, t_max;
+        sweep.measure_range(a0, a1, t_min, t_max);
+        std::vector<ChordPoint> poly = {{t_min, d1_min}, {t_max, d1_min}, {t_max, d1_max}, {t_min, d1_max}};
+        double cos_lo, cos_hi;
+        cos_range(a0, a1, p_phase, cos_lo, cos_hi);
+        const double p_lo = p_norm * cos_lo, p_hi = p_norm * cos_hi;
+        if (p_lo > 0 || p_hi < 0) {
+            const double s = p_lo > 0 ? 1 : -1;
+            const double w_min = 1 / std::max(std::abs(p_lo), std::abs(p_hi));
+            const double w_max = 1 / std::min(std::abs(p_lo), std::abs(p_hi));
+            clip_chords_polygon(poly, s * g1 * w_max, -1, s * g0 * w_max - d2_min);
+            clip_chords_polygon(poly, -s * g1 * w_min, 1, d2_max - s * g0 * w_min);
+        }
+        return poly;
+    };
+
+    const double curvature_bound = plan.lines_intersect
+                                       ? std::abs((d1_max + d2_max) / std::sin(plan.angle_between)) + d1_max
+                                       : d1_max + d2_max;
+    const unsigned int appx_num = calc_ellipse_appx_num(sweep.angle_range, curvature_bound, options);
+    return sweep.sweep(appx_num, d1_max, step_params);
+}
+
 void Trapezoid::calc_min_max_openings(Kernel::FT& opening_min, Kernel::FT& opening_max) const {
     /* for any fixed angle, the opening function is a affine function, and therefore monotonically increasing or
      * decreasing as a function x. Therefore, to calculate the minimum or the maximum of the opening function we only
@@ -403,71 +968,4 @@ void Trapezoid::calc_min_max_openings(Kernel::FT& opening_min, Kernel::FT& openi
     }
 }
 
-class Face_contained_prop_observer : public CGAL::Arr_observer<Arrangement> {
-public:
-  Face_contained_prop_observer(Arrangement& arr) : CGAL::Arr_observer<Arrangement>(arr) {}
-  virtual void after_split_face(Face_handle old_face, Face_handle new_face, bool _is_hole) {
-    new_face->set_contained(old_face->contained());
-  }
-};
-
-std::vector<Polygon> Trapezoid::intersect_with_bottom_edge_half_plane(Polygon& poly) const {
-    /* Calculate left and right vertices of the bottom edge relative to the trapezoid's direction */
-    auto v_mid = get_mid_angle(angle_begin, angle_end);
-    Point bottom_left, bottom_right;
-    calc_edge_left_right_vertices(bottom_edge, v_mid, bottom_left, bottom_right);
-
-    /* Create a long segment, defined by bottom edge, which will operate as half plane */
-    Segment halfplane_seg(bottom_left + 8*(bottom_left-bottom_right), bottom_right+8*(bottom_right-bottom_left));
-
-    /* Create an arrangement containing the input polygon */
-    Polygon_set ps;
-    ps.insert(poly);
-    auto arr = ps.arrangement();
-
-    /* Add an observer to preseve the 'contained' property */
-    Face_contained_prop_observer obs(arr);
-
-    /* Insert the half plane segment */
-    CGAL::insert(arr, halfplane_seg);
-
-    /* Iterate over the resulting faces in the arrangement and collect all result polygon in the correct half plane */
-    std::vector<Polygon> res;
-    for (auto it = arr.faces_begin(); it != arr.faces_end(); ++it) {
-        auto face = it;
-        if (face->is_unbounded() || !face->contained())
-            continue;
-
-        /* Check on which side the face is relative to the half plane */
-        bool is_valid = false;
-        Arrangement::Ccb_halfedge_const_circulator circ = face->outer_ccb();
-        for (unsigned int i = 0; i < 3; i++) {
-            Point p = circ->target()->point();
-            CGAL::Orientation o = CGAL::orientation(halfplane_seg.source(), halfplane_seg.target(), p);
-            if (o == CGAL::LEFT_TURN) {
-                is_valid = true;
-                break;
-            } else if (o == CGAL::RIGHT_TURN) {
-                is_valid = false;
-                break;
-            }
-            /* else, point is collinear with halfplane, continue */
-            circ++;
-        }
-        if (!is_valid)
-            continue;
-
-        /* Add result face's polygon */
-        Polygon p;
-        for (Arrangement::Ccb_halfedge_const_circulator begin = face->outer_ccb(), e = begin;;) {
-            p.push_back(e->target()->point());
-            if (++e == begin)
-                break;
-        }
-        res.push_back(p);
-    }
-
-    return res;
-}
-
 } // namespace FDML
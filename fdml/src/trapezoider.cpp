@@ -1,28 +1,20 @@
 #include "fdml/trapezoider.hpp"
+#include "fdml/internal/prs_event.hpp"
 #include "fdml/internal/utils.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <numeric>
+#include <thread>
+
 #include <CGAL/Arr_vertical_decomposition_2.h>
+#include <CGAL/convex_hull_2.h>
 
 namespace FDML {
 
-/* An event that should be handled during a parallel rotational sweep. The event
- * is composed as two vertices that align on the same line for some angle.
- */
-class Event {
-  public:
-    /* the ray base vertex */
-    Vertex v1;
-    /* the ray end vertex */
-    Vertex v2;
-
-    Event(const Vertex& v1, const Vertex& v2) : v1(v1), v2(v2) {}
-
-    Direction get_ray() const {
-        const Point &p1 = v1->point(), &p2 = v2->point();
-        return Direction(p2.x() - p1.x(), p2.y() - p1.y());
-    }
-};
-
 /* perform an operation on all edges coming out of a vertex */
 template <typename OP> static void foreach_vertex_edge(const Vertex& v, const OP& op) {
     auto edge = v->incident_halfedges();
@@ -111,28 +103,31 @@ class DecompVertexData {
  * another vertex u, we say the edge going out of v to the x negative side is
  * the object above u. If there is no such edge, the vertex v is a reflex
  * vertex, and we say the object above u is the object above v recursively. */
-static void vertical_decomposition(const Arrangement& arr, std::vector<Vertex>& vertices,
-                                   std::map<Vertex, DecompVertexData>& decomp) {
+static void vertical_decomposition(const Arrangement& arr, const Topology& topology,
+                                   std::vector<Topology::VertexID>& vertices,
+                                   std::vector<DecompVertexData>& decomp) {
     /* use CGAL vertical decomposition, which will result for each vertex the
      * object above and below the vertex. The object might be an edge, a vertex,
      * or an unbounded face. */
     std::vector<std::pair<Vertex, std::pair<CGAL::Object, CGAL::Object>>> vd_list;
     CGAL::decompose(arr, std::back_inserter(vd_list));
 
-    /* convert the pairs list into map data structure for fast access and fill the
-     * vertices list */
-    std::map<Vertex, CGAL::Object> above_orig;
-    std::map<Vertex, CGAL::Object> below_orig;
+    /* convert the pairs list into vectors indexed by the vertices IDs for fast
+     * access and fill the vertices list */
+    const size_t n = topology.number_of_vertices();
+    std::vector<CGAL::Object> above_orig(n);
+    std::vector<CGAL::Object> below_orig(n);
     for (auto& decomp_entry : vd_list) {
-        const auto& v = decomp_entry.first;
+        const auto v = topology.vertex_id(decomp_entry.first);
         vertices.push_back(v);
         above_orig[v] = decomp_entry.second.second;
         below_orig[v] = decomp_entry.second.first;
     }
 
     /* sort vertices firstly by x and than by y */
-    sort(vertices.begin(), vertices.end(),
-         [](const Vertex& v1, const Vertex& v2) { return v1->point() < v2->point(); });
+    sort(vertices.begin(), vertices.end(), [&topology](Topology::VertexID v1, Topology::VertexID v2) {
+        return topology.vertex(v1)->point() < topology.vertex(v2)->point();
+    });
 
     /* This assume the DCEL implementation stores the LEFT face of an edge as
      * edge->face() */
@@ -145,39 +140,29 @@ static void vertical_decomposition(const Arrangement& arr, std::vector<Vertex>&
 
     /* CGAL decomposition doesn't seems to compute the above and below vertices
      * correctly, we do it manually */
-    std::map<Vertex, std::pair<bool, Vertex>> vertex_above;
-    std::map<Vertex, std::pair<bool, Vertex>> vertex_below;
+    std::vector<Topology::VertexID> vertex_above(n, Topology::INVALID_ID);
+    std::vector<Topology::VertexID> vertex_below(n, Topology::INVALID_ID);
     for (unsigned int i = 0; i < vertices.size(); i++) {
-        const auto& v = vertices[i];
-        bool has_above = i < (vertices.size() - 1) && v->point().x() == vertices[i + 1]->point().x() &&
-                         v->point().y() < vertices[i + 1]->point().y();
-        bool has_below =
-            i > 0 && v->point().x() == vertices[i - 1]->point().x() && v->point().y() > vertices[i - 1]->point().y();
-        vertex_above[v] = std::make_pair(has_above, has_above ? vertices[i + 1] : /* dummy */ v);
-        vertex_below[v] = std::make_pair(has_below, has_below ? vertices[i - 1] : /* dummy */ v);
-    }
-    auto get_above_vertex = [&vertex_above](const Vertex& v, Vertex& above) {
-        const auto& p = vertex_above[v];
-        if (!p.first)
-            return false;
-        above = p.second;
-        return true;
-    };
-    auto get_below_vertex = [&vertex_below](const Vertex& v, Vertex& below) {
-        const auto& p = vertex_below[v];
-        if (!p.first)
-            return false;
-        below = p.second;
-        return true;
-    };
+        const Point& p = topology.vertex(vertices[i])->point();
+        if (i < (vertices.size() - 1)) {
+            const Point& above = topology.vertex(vertices[i + 1])->point();
+            if (p.x() == above.x() && p.y() < above.y())
+                vertex_above[vertices[i]] = vertices[i + 1];
+        }
+        if (i > 0) {
+            const Point& below = topology.vertex(vertices[i - 1])->point();
+            if (p.x() == below.x() && p.y() > below.y())
+                vertex_below[vertices[i]] = vertices[i - 1];
+        }
+    }
 
     /* for each vertex, findout the edge above it. If there is a vertex above it,
      * take the edge that goes out of it towards the negative x direction or if
      * there is no such edge, the edge above it recursively */
-    for (auto& v : vertices) {
+    for (auto v : vertices) {
         DecompVertexData v_data;
         Halfedge edge;
-        for (Vertex p = v, up_vertex;; p = up_vertex) {
+        for (Topology::VertexID p = v, up_vertex;; p = up_vertex) {
             auto& above_obj = above_orig[p];
             /* if the above object is an edge, we are done */
             if (CGAL::assign(edge, above_obj)) {
@@ -186,18 +171,22 @@ static void vertical_decomposition(const Arrangement& arr, std::vector<Vertex>&
                 break;
             }
             /* if there is no vertex above, we reached the end of the room, done */
-            if (!CGAL::assign(up_vertex, above_obj) && !get_above_vertex(p, up_vertex))
+            Vertex up_vertex_handle;
+            if (CGAL::assign(up_vertex_handle, above_obj))
+                up_vertex = topology.vertex_id(up_vertex_handle);
+            else if ((up_vertex = vertex_above[p]) == Topology::INVALID_ID)
                 break;
             /* there is a vertex above, search for an edge from it to the negative x
              * direction */
-            if (find_edge_relative_to_angle(up_vertex, Direction(0, 1), CGAL::ON_NEGATIVE_SIDE, MinMax::Min, edge)) {
+            if (find_edge_relative_to_angle(topology.vertex(up_vertex), Direction(0, 1), CGAL::ON_NEGATIVE_SIDE,
+                                            MinMax::Min, edge)) {
                 v_data.edge_above = direct_above_edge(edge);
                 v_data.is_edge_above = true;
                 break;
             }
             /* continue searching up */
         }
-        for (Vertex p = v, below_vertex;; p = below_vertex) {
+        for (Topology::VertexID p = v, below_vertex;; p = below_vertex) {
             auto& below_obj = below_orig[p];
             /* if the below object is an edge, we are done */
             if (CGAL::assign(edge, below_obj)) {
@@ -206,11 +195,14 @@ static void vertical_decomposition(const Arrangement& arr, std::vector<Vertex>&
                 break;
             }
             /* if there is no vertex below, we reached the end of the room, done */
-            if (!CGAL::assign(below_vertex, below_obj) && !get_below_vertex(p, below_vertex))
+            Vertex below_vertex_handle;
+            if (CGAL::assign(below_vertex_handle, below_obj))
+                below_vertex = topology.vertex_id(below_vertex_handle);
+            else if ((below_vertex = vertex_below[p]) == Topology::INVALID_ID)
                 break;
             /* there is a vertex below, search for an edge from it to the negative x
              * direction */
-            if (find_edge_left_from_vertex(below_vertex, MinMax::Min, edge)) {
+            if (find_edge_left_from_vertex(topology.vertex(below_vertex), MinMax::Min, edge)) {
                 v_data.edge_below = direct_below_edge(edge);
                 v_data.is_edge_below = true;
                 break;
@@ -228,48 +220,88 @@ static bool undirected_eq(const Halfedge& e1, const Halfedge& e2) {
 
 static const unsigned int INVALID_TRAPEZOID_ID = 0xffffffff;
 
+/* The trapezoids slots of a vertex, in the order of the VertexData fields */
+enum VertexSlot { TOP_LEFT, TOP_RIGHT, BOTTOM_LEFT, BOTTOM_RIGHT, SLOTS_NUM };
+
 Trapezoider::VertexData::VertexData(const Point& v, const Arrangement::Geometry_traits_2* geom_traits) {
     top_left_trapezoid = top_right_trapezoid = INVALID_TRAPEZOID_ID;
     bottom_left_trapezoid = bottom_right_trapezoid = INVALID_TRAPEZOID_ID;
     ray_edges = std::set<Halfedge, Closer_edge<Arrangement>>(Closer_edge<Arrangement>(geom_traits, v));
 }
 
-/* "less" object used for maps of edges */
-class Less_edge : public CGAL::cpp98::binary_function<Halfedge, Halfedge, bool> {
-  private:
-    const Arrangement::Geometry_traits_2* geom_traits;
+Trapezoid::ID& Trapezoider::VertexData::trapezoid_at(unsigned int slot) {
+    switch (slot) {
+    case TOP_LEFT:
+        return top_left_trapezoid;
+    case TOP_RIGHT:
+        return top_right_trapezoid;
+    case BOTTOM_LEFT:
+        return bottom_left_trapezoid;
+    default:
+        return bottom_right_trapezoid;
+    }
+}
+
+/* perform an operation on each slot of the limiting vertices a trapezoid occupies. A limiting vertex on both the top
+ * and bottom lines occupies both of its slots on the trapezoid side */
+template <typename OP> static void foreach_limiting_slot(const Trapezoid& trapezoid, const OP& op) {
+    /* trapezoid left limiting vertex */
+    bool left_on_top = trapezoid.top_edge->curve().line().has_on(trapezoid.left_vertex->point());
+    bool left_on_bottom = trapezoid.bottom_edge->curve().line().has_on(trapezoid.left_vertex->point());
+    if (!left_on_top || left_on_bottom)
+        op(trapezoid.left_vertex, TOP_RIGHT);
+    if (!left_on_bottom || left_on_top)
+        op(trapezoid.left_vertex, BOTTOM_RIGHT);
+
+    /* trapezoid right limiting vertex */
+    bool right_on_top = trapezoid.top_edge->curve().line().has_on(trapezoid.right_vertex->point());
+    bool right_on_bottom = trapezoid.bottom_edge->curve().line().has_on(trapezoid.right_vertex->point());
+    if (!right_on_top || right_on_bottom)
+        op(trapezoid.right_vertex, TOP_LEFT);
+    if (!right_on_bottom || right_on_top)
+        op(trapezoid.right_vertex, BOTTOM_LEFT);
+}
+
+/* Map of edge -> the most right vertex that it's ray is hitting the edge, ignoring the edges direction */
+class MostRightVertex {
+    const Topology& topology;
+    std::vector<Topology::VertexID> vertices;
 
   public:
-    Less_edge() {}
-    Less_edge(const Arrangement::Geometry_traits_2* traits) : geom_traits(traits) {}
-    bool operator()(const Halfedge& e1, const Halfedge& e2) const {
-        const auto e1_ = e1->source()->point() <= e1->target()->point() ? e1 : e1->twin();
-        const auto e2_ = e2->source()->point() <= e2->target()->point() ? e2 : e2->twin();
-        CGAL::Comparison_result c;
-        if ((c = CGAL::compare_xy(e1_->source()->point(), e2_->source()->point())) != CGAL::EQUAL)
-            return c == CGAL::SMALLER;
-        if ((c = CGAL::compare_xy(e1_->target()->point(), e2_->target()->point())) != CGAL::EQUAL)
-            return c == CGAL::SMALLER;
-        return false;
+    MostRightVertex(const Topology& topology)
+        : topology(topology), vertices(topology.number_of_edges() / 2, Topology::INVALID_ID) {}
+
+    const Vertex& at(const Halfedge& edge) const {
+        auto v = vertices[Topology::undirected_id(topology.edge_id(edge))];
+        if (v == Topology::INVALID_ID)
+            throw std::logic_error("no vertex is known to the left of edge");
+        return topology.vertex(v);
+    }
+
+    void set(const Halfedge& edge, Topology::VertexID v) {
+        vertices[Topology::undirected_id(topology.edge_id(edge))] = v;
     }
 };
 
-bool Trapezoider::is_free(const Face& face) {
-    auto it = is_free_faces.find(face);
-    return it != is_free_faces.end() && it->second;
+bool Trapezoider::is_free(const Face& face) const {
+    return topology.is_free_face(topology.face_id(face));
 }
 
-void Trapezoider::init_poly_set(const Polygon_with_holes& scene) {
-    scene_set = General_polygon_set_2(scene);
-    is_free_faces.clear();
-
-    const Arrangement& polygon_set_arr = scene_set.arrangement();
+void Trapezoider::init_poly_set(const Polygon_with_holes& scene, bool validate) {
+    this->scene = scene;
+    scene_set = std::make_unique<General_polygon_set_2>(scene);
+    const Arrangement& polygon_set_arr = scene_set->arrangement();
+    topology.build(polygon_set_arr);
 
-    for (auto face = polygon_set_arr.faces_begin(); face != polygon_set_arr.faces_end(); ++face)
-        is_free_faces[face] = !face->is_unbounded() && face->contained();
+    /* Fix exact numbers of the scene, as it is shared between threads during the sweep and the queries, to avoid
+     * concurrent lazy evaluation */
+    for (auto v = polygon_set_arr.vertices_begin(); v != polygon_set_arr.vertices_end(); ++v)
+        CGAL::exact(v->point());
+    for (auto edge = polygon_set_arr.edges_begin(); edge != polygon_set_arr.edges_end(); ++edge)
+        CGAL::exact(edge->curve().line());
 
     for (auto face = polygon_set_arr.faces_begin(); face != polygon_set_arr.faces_end(); ++face) {
-        fdml_debug("[InitPolySet] face is free: " << is_free_faces[face]);
+        fdml_debug("[InitPolySet] face is free: " << is_free(face));
         if (face->has_outer_ccb()) {
             auto eit = face->outer_ccb();
             auto eit_end = eit;
@@ -283,20 +315,21 @@ void Trapezoider::init_poly_set(const Polygon_with_holes& scene) {
         }
     }
 
+    if (!validate)
+        return;
+
     if (polygon_set_arr.number_of_vertices() < 3)
         throw std::invalid_argument("input scene contains too few vertices");
 
     /* validate all vertices have a degree of 2 */
-    for (auto v = polygon_set_arr.vertices_begin(); v != polygon_set_arr.vertices_end(); ++v)
-        if (v->degree() != 2)
+    for (Topology::VertexID v = 0; v < topology.number_of_vertices(); v++)
+        if (topology.degree(v) != 2)
             throw std::invalid_argument("Invalid vertex degree, expected 2.");
 
     /* validate no zero width edges exists */
-    for (auto v = polygon_set_arr.vertices_begin(); v != polygon_set_arr.vertices_end(); ++v)
-        foreach_vertex_edge(v, [&](const auto& e) {
-            if (!(is_free(e->face()) ^ is_free(e->twin()->face())))
-                throw std::invalid_argument("zero width edges are not supported");
-        });
+    for (Topology::EdgeID e = 0; e < topology.number_of_edges(); e++)
+        if (!(topology.is_free_edge(e) ^ topology.is_free_edge(Topology::twin(e))))
+            throw std::invalid_argument("zero width edges are not supported");
 
     /* This detection takes O(n^3) time, consider disabling it */
     bool found_3collinear = false;
@@ -323,84 +356,55 @@ void Trapezoider::init_poly_set(const Polygon_with_holes& scene) {
 }
 
 /* Create a new Trapezoid and update the relevant data structures */
-Trapezoid::ID Trapezoider::create_trapezoid(const Halfedge& top_edge, const Halfedge& bottom_edge,
-                                            const Vertex& left_vertex, const Vertex& right_vertex) {
+Trapezoid::ID Trapezoider::create_trapezoid(SweepState& state, const Halfedge& top_edge, const Halfedge& bottom_edge,
+                                            const Vertex& left_vertex, const Vertex& right_vertex) const {
 
     /* return an edge or it's twin, the one with the free face, that is face
      * representing the interior of the room */
     auto direct_edge_free_face = [&](const Halfedge& edge) { return is_free(edge->face()) ? edge : edge->twin(); };
 
     /* create the Trapezoid */
-    Trapezoid::ID t_id = trapezoids.size();
+    Trapezoid::ID t_id = state.trapezoids.size();
     auto top_edge_d = direct_edge_free_face(top_edge), bottom_edge_d = direct_edge_free_face(bottom_edge);
-    trapezoids.emplace_back(t_id, top_edge_d, bottom_edge_d, left_vertex, right_vertex);
-    Trapezoid& trapezoid = trapezoids.back();
-
-    auto& left_v_data = vertices_data[trapezoid.left_vertex];
-    auto& right_v_data = vertices_data[trapezoid.right_vertex];
-
-    /* update trapezoid left limiting vertex data */
-    bool left_on_top = trapezoid.top_edge->curve().line().has_on(trapezoid.left_vertex->point());
-    bool left_on_bottom = trapezoid.bottom_edge->curve().line().has_on(trapezoid.left_vertex->point());
-    if (!left_on_top || left_on_bottom)
-        left_v_data.top_right_trapezoid = t_id;
-    if (!left_on_bottom || left_on_top)
-        left_v_data.bottom_right_trapezoid = t_id;
-
-    /* update trapezoid right limiting vertex data */
-    bool right_on_top = trapezoid.top_edge->curve().line().has_on(trapezoid.right_vertex->point());
-    bool right_on_bottom = trapezoid.bottom_edge->curve().line().has_on(trapezoid.right_vertex->point());
-    if (!right_on_top || right_on_bottom)
-        right_v_data.top_left_trapezoid = t_id;
-    if (!right_on_bottom || right_on_top)
-        right_v_data.bottom_left_trapezoid = t_id;
+    state.trapezoids.emplace_back(t_id, top_edge_d, bottom_edge_d, left_vertex, right_vertex);
 
+    /* update trapezoid limiting vertices data */
+    foreach_limiting_slot(state.trapezoids.back(), [this, &state, t_id](const Vertex& v, VertexSlot slot) {
+        state.vertices_data[topology.vertex_id(v)].trapezoid_at(slot) = t_id;
+    });
     return t_id;
 }
 
 /* finalize trapezoid, that it updating the relevant data structures */
-void Trapezoider::finalize_trapezoid(const Trapezoid& trapezoid) {
-    auto& left_v_data = vertices_data[trapezoid.left_vertex];
-    auto& right_v_data = vertices_data[trapezoid.right_vertex];
-
-    /* update trapezoid left limiting vertex data */
-    bool left_on_top = trapezoid.top_edge->curve().line().has_on(trapezoid.left_vertex->point());
-    bool left_on_bottom = trapezoid.bottom_edge->curve().line().has_on(trapezoid.left_vertex->point());
-    if (!left_on_top || left_on_bottom)
-        left_v_data.top_right_trapezoid = INVALID_TRAPEZOID_ID;
-    if (!left_on_bottom || left_on_top)
-        left_v_data.bottom_right_trapezoid = INVALID_TRAPEZOID_ID;
-
-    /* update trapezoid right limiting vertex data */
-    bool right_on_top = trapezoid.top_edge->curve().line().has_on(trapezoid.right_vertex->point());
-    bool right_on_bottom = trapezoid.bottom_edge->curve().line().has_on(trapezoid.right_vertex->point());
-    if (!right_on_top || right_on_bottom)
-        right_v_data.top_left_trapezoid = INVALID_TRAPEZOID_ID;
-    if (!right_on_bottom || right_on_top)
-        right_v_data.bottom_left_trapezoid = INVALID_TRAPEZOID_ID;
+void Trapezoider::finalize_trapezoid(SweepState& state, const Trapezoid& trapezoid) const {
+    foreach_limiting_slot(trapezoid, [this, &state](const Vertex& v, VertexSlot slot) {
+        state.vertices_data[topology.vertex_id(v)].trapezoid_at(slot) = INVALID_TRAPEZOID_ID;
+    });
 }
 
 /* perform a regular vertical decomposition and calculate all trapezoids that
  * exists in that angle */
-void Trapezoider::init_trapezoids_with_regular_vertical_decomposition() {
+void Trapezoider::init_trapezoids_with_regular_vertical_decomposition(SweepState& state) const {
     fdml_infoln("[Trapezoider] Performing regular vertcal decomposition");
-    const Arrangement& arr = scene_set.arrangement();
+    const Arrangement& arr = scene_set->arrangement();
 
-    std::vector<Vertex> vertices;
-    std::map<Vertex, DecompVertexData> decomp;
-    vertical_decomposition(arr, vertices, decomp);
+    std::vector<Topology::VertexID> vertices;
+    std::vector<DecompVertexData> decomp(topology.number_of_vertices());
+    vertical_decomposition(arr, topology, vertices, decomp);
 
     /* sort vertices. unusual sort, prefer smaller x bigger y */
-    sort(vertices.begin(), vertices.end(), [](const Vertex& v1, const Vertex& v2) {
-        if (v1->point().x() != v2->point().x())
-            return v1->point().x() < v2->point().x();
-        return v1->point().y() > v2->point().y();
+    sort(vertices.begin(), vertices.end(), [this](Topology::VertexID v1_id, Topology::VertexID v2_id) {
+        const Point &p1 = topology.vertex(v1_id)->point(), &p2 = topology.vertex(v2_id)->point();
+        if (p1.x() != p2.x())
+            return p1.x() < p2.x();
+        return p1.y() > p2.y();
     });
 
     /* for each edge, stores the vertex that it's ray is hitting the edge */
-    std::map<Halfedge, Vertex, Less_edge> most_right_vertex(Less_edge(arr.geometry_traits()));
-    for (const auto& v : vertices) {
-        const DecompVertexData& v_decomp_data = decomp[v];
+    MostRightVertex most_right_vertex(topology);
+    for (const auto v_id : vertices) {
+        const Vertex& v = topology.vertex(v_id);
+        const DecompVertexData& v_decomp_data = decomp[v_id];
         Halfedge top_edge, bottom_edge;
 
         if ((v_decomp_data.is_edge_above && is_free(v_decomp_data.edge_above->face())) &&
@@ -410,8 +414,8 @@ void Trapezoider::init_trapezoids_with_regular_vertical_decomposition() {
             /* Reflex (more than 180 degrees) vertex */
             fdml_debugln("[Trapezoider] New trapezoid: reflex (" << v->point() << ')');
             auto left_v = most_right_vertex.at(v_decomp_data.edge_above);
-            auto id = create_trapezoid(v_decomp_data.edge_above, v_decomp_data.edge_below, left_v, v);
-            most_right_vertex[trapezoids.at(id).top_edge] = v;
+            auto id = create_trapezoid(state, v_decomp_data.edge_above, v_decomp_data.edge_below, left_v, v);
+            most_right_vertex.set(state.trapezoids.at(id).top_edge, v_id);
 
         } else if ((!v_decomp_data.is_edge_above || !is_free(v_decomp_data.edge_above->face())) &&
                    (!v_decomp_data.is_edge_below || !is_free(v_decomp_data.edge_below->face())) &&
@@ -422,7 +426,7 @@ void Trapezoider::init_trapezoids_with_regular_vertical_decomposition() {
             /* v is a vertex of a triangle trapezoid */
             fdml_debugln("[Trapezoider] New trapezoid: triangle (" << v->point() << ')');
             auto left_v = most_right_vertex.at(top_edge);
-            create_trapezoid(top_edge, bottom_edge, left_v, v);
+            create_trapezoid(state, top_edge, bottom_edge, left_v, v);
 
         } else {
             if (v_decomp_data.is_edge_above && is_free(v_decomp_data.edge_above->face())) {
@@ -434,8 +438,8 @@ void Trapezoider::init_trapezoids_with_regular_vertical_decomposition() {
                     throw std::logic_error("failed to find bottom edge for up trapezoid");
 
                 auto left_v = most_right_vertex.at(v_decomp_data.edge_above);
-                auto id = create_trapezoid(v_decomp_data.edge_above, bottom_edge, left_v, v);
-                most_right_vertex[trapezoids.at(id).top_edge] = v;
+                auto id = create_trapezoid(state, v_decomp_data.edge_above, bottom_edge, left_v, v);
+                most_right_vertex.set(state.trapezoids.at(id).top_edge, v_id);
             }
             if (v_decomp_data.is_edge_below && is_free(v_decomp_data.edge_below->face())) {
 
@@ -445,29 +449,17 @@ void Trapezoider::init_trapezoids_with_regular_vertical_decomposition() {
                     !find_edge_vertical(v, CGAL::POSITIVE, top_edge))
                     throw std::logic_error("failed to find top edge for down trapezoid");
                 auto left_v = most_right_vertex.at(top_edge);
-                create_trapezoid(top_edge, v_decomp_data.edge_below, left_v, v);
+                create_trapezoid(state, top_edge, v_decomp_data.edge_below, left_v, v);
             }
         }
-        foreach_vertex_edge(v, [&v, &most_right_vertex](const auto& edge) { most_right_vertex[edge] = v; });
+        foreach_vertex_edge(v, [v_id, &most_right_vertex](const auto& edge) { most_right_vertex.set(edge, v_id); });
     }
 
     fdml_debugln("[Trapezoider] After regular vertical decomposition, trapezoids:");
-    for (const auto& trapezoid : trapezoids)
+    for (const auto& trapezoid : state.trapezoids)
         fdml_debugln("\t" << trapezoid);
 }
 
-static bool get_edge(const Vertex& source, const Vertex& target, Halfedge& res) {
-    // TODO better to implement this as hashmap
-    bool found = false;
-    foreach_vertex_edge(source, [&target, &res, &found](const auto& edge) {
-        if (edge->target() == target) {
-            res = edge;
-            found = true;
-        }
-    });
-    return found;
-}
-
 static bool is_same_direction(Direction d1, Direction d2) {
     return Line({0, 0}, d1).oriented_side({d2.dx(), d2.dy()}) == CGAL::ON_ORIENTED_BOUNDARY &&
            d1.vector() * d2.vector() > 0;
@@ -486,76 +478,531 @@ static void calc_edge_left_right_vertices(const Halfedge& edge, const Direction&
     }
 }
 
-/* perfrom a parallel rotational sweep to calculate all trapezoids of all
- * angles. Assume the data structres have been filled with trapezoids that
- * exists in the regular vertical decomposition direction */
-void Trapezoider::calc_trapezoids_with_rotational_sweep() {
-    fdml_infoln("[Trapezoider] Performing parallel rotational sweep (PRS)");
-    /* Calculate all events */
-    const Arrangement& arr = scene_set.arrangement();
-    std::vector<Event> events;
-    events.reserve(arr.number_of_vertices() * (arr.number_of_vertices() - 1));
-    for (auto v1 = arr.vertices_begin(); v1 != arr.vertices_end(); ++v1)
-        for (auto v2 = arr.vertices_begin(); v2 != arr.vertices_end(); ++v2)
-            if (v1 != v2)
-                events.emplace_back(v1, v2);
-
-    /* Sort events by their angle */
-    sort(events.begin(), events.end(), [](const Event& e1, const Event& e2) {
-        auto a1 = e1.get_ray(), a2 = e2.get_ray();
-        if (a1 == a2)
+/* A subset of the vertices, to which a restricted rotational sweep is limited. Only the events of pairs with at least
+ * one active vertex are handled. */
+class ActiveVertices {
+    std::vector<bool> is_active;
+    std::vector<unsigned int> active;
+
+  public:
+    ActiveVertices(size_t vertices_num) : is_active(vertices_num, false) {}
+
+    void add(unsigned int v) {
+        if (!is_active[v]) {
+            is_active[v] = true;
+            active.push_back(v);
+        }
+    }
+
+    bool contains(unsigned int v) const { return is_active[v]; }
+    size_t size() const { return active.size(); }
+
+    bool is_handled(unsigned int v1, unsigned int v2) const { return is_active[v1] || is_active[v2]; }
+
+    /* perform an operation on each vertex v2 such that the event (v1, v2) is handled */
+    template <typename OP> void foreach_handled(unsigned int v1, const OP& op) const {
+        if (is_active[v1]) {
+            for (unsigned int v2 = 0; v2 < is_active.size(); v2++)
+                if (v2 != v1)
+                    op(v2);
+        } else {
+            for (unsigned int v2 : active)
+                op(v2);
+        }
+    }
+};
+
+/* Number of events buffered by all the vertices of a single events queue. The buffer of each vertex is refilled by a
+ * scan over all the vertices when exhausted, so a larger budget trades memory for fewer scans. */
+static const size_t PRS_EVENTS_BUFFERS_BUDGET = 1 << 22;
+static const size_t PRS_EVENTS_BUFFER_MIN_SIZE = 32;
+
+/* A queue of the events within a sector of angles, yielding them in the order they should be handled during the
+ * parallel rotational sweep. Instead of materializing and sorting all the O(n^2) events, each vertex holds a bounded
+ * buffer of its next events, sorted by their angle. When a vertex buffer is exhausted, it is refilled by a scan over
+ * all the vertices, selecting the events following the last one consumed. The vertices buffers are merged using a
+ * heap, yielding exactly the same order as sorting all the events of the sector. If active vertices are given, only
+ * the events they handle are yielded, and the scan of an inactive vertex is limited to the active vertices. */
+class EventQueue {
+    typedef EventLess::VerticesPair VerticesPair;
+    typedef EventLess::KeyedEvent KeyedEvent;
+
+    const std::vector<Vertex>& vertices;
+    const ActiveVertices* const active;
+    const EventLess event_less;
+    /* the sector angles range [begin, end), the last sector is not bounded */
+    const Direction sector_begin, sector_end;
+    const AngleKey sector_begin_key, sector_end_key;
+    const bool is_bounded;
+    const size_t buffer_size;
+    /* the next events of each vertex, sorted in reverse order so the next event is at the back */
+    std::vector<std::vector<KeyedEvent>> buffers;
+    /* the last event consumed of each vertex, valid only if is_last is set */
+    std::vector<KeyedEvent> last;
+    std::vector<bool> is_last;
+    /* heap of the next event of each vertex, the first event is at the front */
+    std::vector<KeyedEvent> heap;
+    size_t events_num, events_peak;
+
+  public:
+    EventQueue(const std::vector<Vertex>& vertices, const ActiveVertices* active, const Direction& sector_begin)
+        : EventQueue(vertices, active, sector_begin, sector_begin, false) {}
+    EventQueue(const std::vector<Vertex>& vertices, const ActiveVertices* active, const Direction& sector_begin,
+               const Direction& sector_end)
+        : EventQueue(vertices, active, sector_begin, sector_end, true) {}
+
+    bool has_next() const { return !heap.empty(); }
+
+    Event next() {
+        std::pop_heap(heap.begin(), heap.end(), heap_less());
+        const KeyedEvent e = heap.back();
+        heap.pop_back();
+
+        const unsigned int v1 = e.vertices.first;
+        auto& buffer = buffers[v1];
+        buffer.pop_back();
+        events_num--;
+        last[v1] = e;
+        is_last[v1] = true;
+        if (buffer.empty())
+            refill(v1);
+        if (!buffer.empty()) {
+            heap.push_back(buffer.back());
+            std::push_heap(heap.begin(), heap.end(), heap_less());
+        }
+        return Event(vertices[v1], vertices[e.vertices.second], v1, e.vertices.second);
+    }
+
+    /* The maximum number of events held in memory by the queue at once */
+    size_t get_events_peak() const { return events_peak; }
+
+  private:
+    EventQueue(const std::vector<Vertex>& vertices, const ActiveVertices* active, const Direction& sector_begin,
+               const Direction& sector_end, bool is_bounded)
+        : vertices(vertices), active(active), event_less(vertices), sector_begin(sector_begin), sector_end(sector_end),
+          sector_begin_key(sector_begin), sector_end_key(sector_end), is_bounded(is_bounded),
+          buffer_size(std::max(PRS_EVENTS_BUFFER_MIN_SIZE, PRS_EVENTS_BUFFERS_BUDGET / (vertices.size() + 1))),
+          buffers(vertices.size()), last(vertices.size()), is_last(vertices.size(), false), events_num(0),
+          events_peak(0) {
+        for (unsigned int v = 0; v < vertices.size(); v++) {
+            refill(v);
+            if (!buffers[v].empty())
+                heap.push_back(buffers[v].back());
+        }
+        std::make_heap(heap.begin(), heap.end(), heap_less());
+    }
+
+    auto heap_less() const {
+        return [this](const KeyedEvent& e1, const KeyedEvent& e2) { return event_less(e2, e1); };
+    }
+
+    /* Check if an event angle is before a sector boundary, which is never on the exact angle of any event */
+    bool is_before(const KeyedEvent& e, const Direction& boundary, const AngleKey& boundary_key) const {
+        CGAL::Comparison_result res = AngleKey::compare(e.key, boundary_key);
+        if (res != CGAL::EQUAL)
+            return res == CGAL::SMALLER;
+        return angle_less(event_less.get_ray(e.vertices), boundary);
+    }
+
+    bool is_in_sector(const KeyedEvent& e) const {
+        return !is_before(e, sector_begin, sector_begin_key) &&
+               (!is_bounded || is_before(e, sector_end, sector_end_key));
+    }
+
+    void refill(unsigned int v1) {
+        auto& buffer = buffers[v1];
+        assert(buffer.empty());
+
+        /* select the first events following the last consumed one, using a bounded max heap */
+        auto select = [this, v1, &buffer](unsigned int v2) {
+            const KeyedEvent e = event_less.get_keyed({v1, v2});
+            if ((is_last[v1] && !event_less(last[v1], e)) || !is_in_sector(e))
+                return;
+            if (buffer.size() < buffer_size) {
+                buffer.push_back(e);
+                std::push_heap(buffer.begin(), buffer.end(), event_less);
+            } else if (event_less(e, buffer.front())) {
+                std::pop_heap(buffer.begin(), buffer.end(), event_less);
+                buffer.back() = e;
+                std::push_heap(buffer.begin(), buffer.end(), event_less);
+            }
+        };
+        if (active != nullptr) {
+            active->foreach_handled(v1, select);
+        } else {
+            for (unsigned int v2 = 0; v2 < vertices.size(); v2++)
+                if (v2 != v1)
+                    select(v2);
+        }
+        std::sort_heap(buffer.begin(), buffer.end(), event_less);
+        std::reverse(buffer.begin(), buffer.end());
+        if (buffer.empty())
+            buffer.shrink_to_fit(); /* all the vertex events were consumed */
+
+        events_num += buffer.size();
+        events_peak = std::max(events_peak, events_num);
+    }
+};
+
+/* Number of events sampled to choose the sectors boundaries */
+static const size_t PRS_SECTORS_SAMPLE_SIZE = 1 << 16;
+
+/* Split the angles into sectors with roughly the same number of events. The first sector starts at the y-axis
+ * direction, and each other sector starts at a direction strictly between two consecutive events of different angles,
+ * which is therefore not aligned with any pair of vertices. The boundaries are chosen as quantiles of a uniform sample
+ * of the events, so all the events are never held in memory at once. If active vertices are given, only the events
+ * they handle are sampled. */
+static std::vector<Direction> calc_sectors_begins(const std::vector<Vertex>& vertices, unsigned int sectors_num,
+                                                  const ActiveVertices* active) {
+    const EventLess event_less(vertices);
+    std::vector<Direction> begins = {Direction(0, 1)};
+    const size_t n = vertices.size();
+    if (sectors_num <= 1 || n < 2)
+        return begins;
+
+    /* sample the events uniformly, and use the sample quantiles as candidates for the boundaries */
+    std::vector<EventLess::KeyedEvent> sample;
+    const size_t events_num = n * (n - 1);
+    const size_t stride = std::max<size_t>(1, events_num / PRS_SECTORS_SAMPLE_SIZE);
+    for (size_t k = 0; k < events_num; k += stride) {
+        unsigned int v1 = k / (n - 1), v2 = k % (n - 1);
+        if (v2 >= v1)
+            v2++;
+        if (active == nullptr || active->is_handled(v1, v2))
+            sample.push_back(event_less.get_keyed({v1, v2}));
+    }
+    if (sample.empty())
+        return begins;
+    sort(sample.begin(), sample.end(), event_less);
+    std::vector<EventLess::KeyedEvent> candidates;
+    for (unsigned int s = 1; s < sectors_num; s++) {
+        const auto& candidate = sample[sample.size() * s / sectors_num];
+        if (candidates.empty() || event_less.angle_less(candidates.back(), candidate))
+            candidates.push_back(candidate);
+    }
+
+    /* find the first angle of any event following each candidate */
+    auto angle_less = [&event_less](const EventLess::KeyedEvent& e1, const EventLess::KeyedEvent& e2) {
+        return event_less.angle_less(e1, e2);
+    };
+    std::vector<EventLess::KeyedEvent> next(candidates.size());
+    std::vector<bool> is_next(candidates.size(), false);
+    for (unsigned int v1 = 0; v1 < n; v1++) {
+        for (unsigned int v2 = 0; v2 < n; v2++) {
+            if (v1 == v2)
+                continue;
+            const auto e = event_less.get_keyed({v1, v2});
+            auto it = std::upper_bound(candidates.begin(), candidates.end(), e, angle_less);
+            if (it == candidates.begin() || !angle_less(*(--it), e))
+                continue;
+            const size_t i = it - candidates.begin();
+            if (!is_next[i] || angle_less(e, next[i])) {
+                next[i] = e;
+                is_next[i] = true;
+            }
+        }
+    }
+
+    /* place each boundary strictly between a candidate and the angle following it */
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (!is_next[i]) {
+            if (i + 1 == candidates.size())
+                continue;
+            next[i] = candidates[i + 1];
+        }
+        const Direction a_prev = event_less.get_ray(candidates[i].vertices);
+        const Direction a_next = event_less.get_ray(next[i].vertices);
+        const Vector boundary_vec = a_prev.vector() + a_next.vector();
+        if (boundary_vec == CGAL::NULL_VECTOR)
+            continue;
+        const Direction boundary = boundary_vec.direction();
+        if (FDML::angle_less(a_prev, boundary) && FDML::angle_less(boundary, a_next))
+            begins.push_back(boundary);
+    }
+    return begins;
+}
+
+/* The restriction of a rotational sweep to the events of the active vertices. The trapezoids limited by an inactive
+ * vertex are known in advance, and are kept rather than calculated. As the sweep skips the events which created them,
+ * a kept trapezoid ending at a handled event is taken as a neighbor of the event instead of the vertex slot content. */
+struct Trapezoider::SweepRestriction {
+    ActiveVertices active;
+    /* the kept trapezoids, with the handles of the swept arrangement */
+    TrapezoidContainer kept;
+    /* the indices of the kept trapezoids occupying each slot of each vertex, sorted by their end angle */
+    std::vector<std::array<std::vector<unsigned int>, SLOTS_NUM>> kept_slots;
+
+    SweepRestriction(const Topology& topology, TrapezoidContainer&& kept_trapezoids)
+        : active(topology.number_of_vertices()), kept(std::move(kept_trapezoids)),
+          kept_slots(topology.number_of_vertices()) {
+        for (unsigned int i = 0; i < kept.size(); i++) {
+            foreach_limiting_slot(kept[i], [this, &topology, i](const Vertex& v, VertexSlot slot) {
+                kept_slots[topology.vertex_id(v)][slot].push_back(i);
+            });
+        }
+        auto end_less = [this](unsigned int i1, unsigned int i2) {
+            return angle_less(kept[i1].angle_end, kept[i2].angle_end);
+        };
+        for (auto& slots : kept_slots)
+            for (auto& slot_kept : slots)
+                sort(slot_kept.begin(), slot_kept.end(), end_less);
+    }
+
+    /* find the kept trapezoid occupying a vertex slot which ends at the given angle, if any */
+    const Trapezoid* find_ending(Topology::VertexID v, unsigned int slot, const Direction& angle) const {
+        const auto& slot_kept = kept_slots[v][slot];
+        auto end_less = [this](unsigned int i, const Direction& a) { return angle_less(kept[i].angle_end, a); };
+        auto it = std::lower_bound(slot_kept.begin(), slot_kept.end(), angle, end_less);
+        return it != slot_kept.end() && kept[*it].angle_end == angle ? &kept[*it] : nullptr;
+    }
+};
+
+/* An edge of the arrangement with its endpoints sorted relative to a sweep direction. The edge is represented by the
+ * halfedge directed from its lexicographically larger endpoint. */
+struct SweepEdge {
+    Halfedge edge;
+    Point left, right;
+};
+
+/* "Less" object used in the status of a plane sweep, ordering edges crossing the sweep line from bottom to top
+ * relative to the sweep direction. The edges never cross each other, so it's enough to compare an endpoint of one
+ * edge to the other edge. Points on the sweep line can be compared to the edges as well. */
+class SweepEdgeBelow {
+    const Vector right;
+
+  public:
+    using is_transparent = void;
+
+    SweepEdgeBelow(const Vector& right) : right(right) {}
+
+    bool operator()(const SweepEdge& e1, const SweepEdge& e2) const {
+        if (e1.edge == e2.edge)
             return false;
+        if ((e1.left - e2.left) * right >= 0) {
+            /* e1 starts at or after e2 */
+            auto o = CGAL::orientation(e2.left, e2.right, e1.left);
+            if (o == CGAL::COLLINEAR)
+                o = CGAL::orientation(e2.left, e2.right, e1.right);
+            return o == CGAL::RIGHT_TURN;
+        }
+        auto o = CGAL::orientation(e1.left, e1.right, e2.left);
+        if (o == CGAL::COLLINEAR)
+            o = CGAL::orientation(e1.left, e1.right, e2.right);
+        return o == CGAL::LEFT_TURN;
+    }
+    bool operator()(const SweepEdge& e, const Point& p) const {
+        return CGAL::orientation(e.left, e.right, p) == CGAL::LEFT_TURN;
+    }
+    bool operator()(const Point& p, const SweepEdge& e) const {
+        return CGAL::orientation(e.left, e.right, p) == CGAL::RIGHT_TURN;
+    }
+};
+
+typedef std::set<SweepEdge, SweepEdgeBelow> SweepStatus;
+
+/* Perform a plane sweep over the arrangement with a sweep line parallel to the given direction, moving to the right of
+ * it. The operation is called for each vertex with the sweep status, which contains all the edges crossing the sweep
+ * line through the vertex, excluding edges with an endpoint on the line, and an iterator to the first edge above the
+ * vertex. The status is ordered from bottom to top, so the edges above the vertex are ordered from the closest one.
+ * The sweep takes O((n + k) log n) time, where k is the total number of edges reported above the vertices. */
+template <typename OP>
+static void plane_sweep_vertices(const Topology& topology, const Direction& dir, const OP& op) {
+    const Vector right = dir.perpendicular(CGAL::CLOCKWISE).vector();
+    std::vector<std::pair<Kernel::FT, Topology::VertexID>> vertices;
+    vertices.reserve(topology.number_of_vertices());
+    for (Topology::VertexID v = 0; v < topology.number_of_vertices(); v++)
+        vertices.emplace_back((topology.vertex(v)->point() - CGAL::ORIGIN) * right, v);
+    sort(vertices.begin(), vertices.end(),
+         [](const auto& v1, const auto& v2) { return v1.first < v2.first; });
+
+    auto canonical_edge = [&topology](Topology::EdgeID e) {
+        const Halfedge& edge = topology.edge(e);
+        return edge->source()->point() < edge->target()->point() ? edge->twin() : edge;
+    };
+
+    /* the status position of each edge, indexed by the undirected edge ID */
+    SweepStatus status{SweepEdgeBelow(right)};
+    std::vector<SweepStatus::iterator> status_its(topology.number_of_edges() / 2);
+    std::vector<bool> in_status(topology.number_of_edges() / 2, false);
+    for (size_t i = 0, j; i < vertices.size(); i = j) {
+        /* all vertices on the current sweep line */
+        for (j = i; j < vertices.size() && vertices[j].first == vertices[i].first;)
+            j++;
+
+        /* remove the edges ending at the sweep line */
+        for (size_t k = i; k < j; k++) {
+            const Topology::VertexID v = vertices[k].second;
+            for (auto e = topology.out_edges_begin(v); e != topology.out_edges_end(v); ++e) {
+                const unsigned int e_id = Topology::undirected_id(*e);
+                if (in_status[e_id]) {
+                    status.erase(status_its[e_id]);
+                    in_status[e_id] = false;
+                }
+            }
+        }
+
+        for (size_t k = i; k < j; k++)
+            op(vertices[k].second, status, status.upper_bound(topology.vertex(vertices[k].second)->point()));
+
+        /* insert the edges starting at the sweep line */
+        for (size_t k = i; k < j; k++) {
+            const Topology::VertexID v = vertices[k].second;
+            const Point& vp = topology.vertex(v)->point();
+            for (auto e = topology.out_edges_begin(v); e != topology.out_edges_end(v); ++e) {
+                const Point& other = topology.edge(*e)->target()->point();
+                if ((other - vp) * right > 0) {
+                    const unsigned int e_id = Topology::undirected_id(*e);
+                    status_its[e_id] = status.insert(SweepEdge{canonical_edge(*e), vp, other}).first;
+                    in_status[e_id] = true;
+                }
+            }
+        }
+    }
+}
+
+void Trapezoider::init_sweep_state(SweepState& state) const {
+    const Arrangement& arr = scene_set->arrangement();
+    state.trapezoids.clear();
+    state.vertices_data.clear();
+    state.vertices_data.reserve(topology.number_of_vertices());
+    for (const auto& v : topology.get_vertices())
+        state.vertices_data.emplace_back(v->point(), arr.geometry_traits());
+}
 
-        if (is_same_direction(a1, a2))
-            /* Both are exactly on the same angle, consider further vertices first */
-            return a1.dx() * a1.dx() + a1.dy() * a1.dy() > a2.dx() * a2.dx() + a2.dy() * a2.dy();
-
-        Line y_axis({0, 0}, Point(0, 1));
-        CGAL::Oriented_side a1_side = y_axis.oriented_side({a1.dx(), a1.dy()});
-        CGAL::Oriented_side a2_side = y_axis.oriented_side({a2.dx(), a2.dy()});
-
-        if (a1_side == CGAL::ON_ORIENTED_BOUNDARY)
-            return a2_side == CGAL::ON_NEGATIVE_SIDE ||
-                   (a1.dy() >= 0 && (a2_side == CGAL::ON_POSITIVE_SIDE || a2.dy() < 0));
-        if (a2_side == CGAL::ON_ORIENTED_BOUNDARY)
-            return a1_side == CGAL::ON_POSITIVE_SIDE && a2.dy() < 0;
-        if (a1_side == CGAL::ON_POSITIVE_SIDE)
-            return ((a2_side == CGAL::ON_NEGATIVE_SIDE) ||
-                    (Line({0, 0}, a2).oriented_side({a1.dx(), a1.dy()}) == CGAL::ON_NEGATIVE_SIDE));
-        // a1_side == CGAL::ON_NEGATIVE_SIDE
-        return ((a2_side == CGAL::ON_NEGATIVE_SIDE) &&
-                (Line({0, 0}, a2).oriented_side({a1.dx(), a1.dy()}) == CGAL::ON_NEGATIVE_SIDE));
+/* Perform a decomposition of the room in a general direction and calculate all trapezoids that exists in that angle.
+ * In contrast to the regular vertical decomposition, the direction must not be aligned with any pair of vertices,
+ * therefore no vertex is exactly above or below another vertex, and the edges above and below each vertex are simply
+ * the closest edges hit by rays shot from it. */
+void Trapezoider::init_trapezoids_with_decomposition(SweepState& state, const Direction& dir) const {
+    fdml_debugln("[Trapezoider] Performing decomposition in direction " << Utils::direction_to_angles(dir));
+    const Line dir_line({0, 0}, dir);
+    auto is_left = [&dir_line](const Point& from, const Point& to) {
+        return dir_line.oriented_side({to.x() - from.x(), to.y() - from.y()}) == CGAL::ON_POSITIVE_SIDE;
+    };
+
+    /* for each vertex, find the closest edges above and below it relative to the direction */
+    std::vector<Topology::VertexID> vertices;
+    std::vector<DecompVertexData> decomp(topology.number_of_vertices());
+    plane_sweep_vertices(topology, dir, [&](Topology::VertexID v, const SweepStatus& status, auto above) {
+        DecompVertexData v_data;
+        if (above != status.end()) {
+            const Halfedge& edge = above->edge;
+            v_data.edge_above = is_left(edge->source()->point(), edge->target()->point()) ? edge : edge->twin();
+            v_data.is_edge_above = true;
+        }
+        if (above != status.begin()) {
+            const Halfedge& edge = std::prev(above)->edge;
+            v_data.edge_below = is_left(edge->source()->point(), edge->target()->point()) ? edge->twin() : edge;
+            v_data.is_edge_below = true;
+        }
+        vertices.push_back(v);
+        decomp[v] = v_data;
     });
 
-    fdml_debugln("[Trapezoider] PRS events:");
-    for (const auto& event : events)
-        fdml_debugln("\t(" << event.v1->point() << ") (" << event.v2->point()
-                           << ") angle= " << Utils::direction_to_angles(event.get_ray()));
-
-    /* init rays */
-    Direction init_ray_direction(0, 1);
-    for (auto& p : vertices_data) {
-        VertexData& v_data = p.second;
-        const auto vp = p.first->point();
-        const auto init_ray = Kernel::Ray_2(vp, init_ray_direction);
-        for (auto uit = arr.vertices_begin(); uit != arr.vertices_end(); ++uit) {
-            foreach_vertex_edge(uit, [&vp, &init_ray, &v_data](const auto& edge) {
-                if (edge->source()->point() < edge->target()->point())
-                    return; /* consider only one of the edge and its twin */
-                if (edge->source()->point().x() == vp.x() || edge->target()->point().x() == vp.x())
-                    return; /* avoid edges the ray itersect at an endpoint */
-                if (do_intersect(init_ray, Segment(edge->source()->point(), edge->target()->point())))
-                    v_data.ray_edges.insert(edge);
-            });
+    auto find_edge_left = [&dir](const Vertex& v, enum MinMax min_max, Halfedge& res) {
+        return find_edge_relative_to_angle(v, dir, CGAL::ON_POSITIVE_SIDE, min_max, res);
+    };
+
+    /* for each edge, stores the vertex that it's ray is hitting the edge */
+    MostRightVertex most_right_vertex(topology);
+    for (const auto v_id : vertices) {
+        const Vertex& v = topology.vertex(v_id);
+        const DecompVertexData& v_decomp_data = decomp[v_id];
+        bool is_free_above = v_decomp_data.is_edge_above && is_free(v_decomp_data.edge_above->face());
+        bool is_free_below = v_decomp_data.is_edge_below && is_free(v_decomp_data.edge_below->face());
+        Halfedge top_edge, bottom_edge;
+
+        if (is_free_above && is_free_below && !find_edge_left(v, MinMax::Min, top_edge)) {
+
+            /* Reflex (more than 180 degrees) vertex */
+            fdml_debugln("[Trapezoider] New trapezoid: reflex (" << v->point() << ')');
+            auto left_v = most_right_vertex.at(v_decomp_data.edge_above);
+            auto id = create_trapezoid(state, v_decomp_data.edge_above, v_decomp_data.edge_below, left_v, v);
+            most_right_vertex.set(state.trapezoids.at(id).top_edge, v_id);
+
+        } else if (!is_free_above && !is_free_below && find_edge_left(v, MinMax::Min, top_edge) &&
+                   find_edge_left(v, MinMax::Max, bottom_edge)) {
+
+            /* v is a vertex of a triangle trapezoid */
+            fdml_debugln("[Trapezoider] New trapezoid: triangle (" << v->point() << ')');
+            auto left_v = most_right_vertex.at(top_edge);
+            create_trapezoid(state, top_edge, bottom_edge, left_v, v);
+
+        } else {
+            if (is_free_above) {
+
+                // Edge above the vertex
+                fdml_debugln("[Trapezoider] New trapezoid: up (" << v->point() << ')');
+                if (!find_edge_left(v, MinMax::Min, bottom_edge))
+                    throw std::logic_error("failed to find bottom edge for up trapezoid");
+
+                auto left_v = most_right_vertex.at(v_decomp_data.edge_above);
+                auto id = create_trapezoid(state, v_decomp_data.edge_above, bottom_edge, left_v, v);
+                most_right_vertex.set(state.trapezoids.at(id).top_edge, v_id);
+            }
+            if (is_free_below) {
+
+                // Edge below the vertex
+                fdml_debugln("[Trapezoider] New trapezoid: down (" << v->point() << ')');
+                if (!find_edge_left(v, MinMax::Max, top_edge))
+                    throw std::logic_error("failed to find top edge for down trapezoid");
+                auto left_v = most_right_vertex.at(top_edge);
+                create_trapezoid(state, top_edge, v_decomp_data.edge_below, left_v, v);
+            }
         }
+        foreach_vertex_edge(v, [v_id, &most_right_vertex](const auto& edge) { most_right_vertex.set(edge, v_id); });
     }
+}
+
+/* init the edges intersected by the ray of each vertex. The direction of the rays should be either the y-axis
+ * direction, or a direction which is not aligned with any pair of vertices. In a restricted sweep, only the rays of
+ * active vertices are maintained */
+void Trapezoider::init_ray_edges(SweepState& state, const Direction& dir, const SweepRestriction* restriction) const {
+    plane_sweep_vertices(topology, dir, [&](Topology::VertexID v, const SweepStatus& status, auto above) {
+        if (restriction != nullptr && !restriction->active.contains(v))
+            return;
+        auto& ray_edges = state.vertices_data[v].ray_edges;
+        for (auto it = above; it != status.end(); ++it)
+            ray_edges.insert(ray_edges.end(), it->edge);
+    });
+}
+
+/* Get the trapezoid occupying a vertex slot at an event of a restricted sweep. A kept trapezoid ending at the event
+ * angle was created by an event the sweep skipped, so a copy of it is added to the state to be finalized by the event.
+ * Copies of kept trapezoids are limited by an inactive vertex, and are dropped after the sweep. */
+Trapezoid::ID Trapezoider::resolve_trapezoid(SweepState& state, const SweepRestriction& restriction,
+                                             Topology::VertexID v, unsigned int slot, const Direction& angle) const {
+    const Trapezoid* kept = restriction.find_ending(v, slot, angle);
+    if (kept == nullptr) {
+        const Trapezoid::ID id = state.vertices_data[v].trapezoid_at(slot);
+        if (id == INVALID_TRAPEZOID_ID)
+            throw std::logic_error("no trapezoid occupies the vertex slot during the restricted sweep");
+        return id;
+    }
+    const Trapezoid::ID id = state.trapezoids.size();
+    state.trapezoids.push_back(*kept);
+    state.trapezoids.back().id = id;
+    state.trapezoids.back().angle_end = Trapezoid::ANGLE_NONE;
+    return id;
+}
 
+/* perfrom a parallel rotational sweep to calculate all trapezoids of all the angles of the given events. Assume the
+ * state have been filled with trapezoids that exists in the angle in which the sweep starts. If a restriction is
+ * given, only the events of active vertices are expected, and the neighbors are resolved from the kept trapezoids */
+template <typename Events>
+void Trapezoider::calc_trapezoids_with_rotational_sweep(SweepState& state, Events& events,
+                                                        const SweepRestriction* restriction) const {
     /* Perform rotational sweep by handling all events in the sorted order */
-    for (Event& event : events) {
-        VertexData& v1_data = vertices_data.at(event.v1);
-        VertexData& v2_data = vertices_data.at(event.v2);
+    while (events.has_next()) {
+        const Event event = events.next();
         const auto ray = event.get_ray();
-        auto& ray_edges = v1_data.ray_edges;
+        auto trapezoid_at = [this, &state, restriction, &ray](Topology::VertexID v, VertexSlot slot) {
+            return restriction == nullptr ? state.vertices_data[v].trapezoid_at(slot)
+                                          : resolve_trapezoid(state, *restriction, v, slot, ray);
+        };
+        /* the rays of inactive vertices are not maintained, as not all their events are handled */
+        const bool is_v1_active = restriction == nullptr || restriction->active.contains(event.v1_id);
+        auto& ray_edges = state.vertices_data[event.v1_id].ray_edges;
         bool closest_edge_orig_valid = ray_edges.size() > 0;
         Halfedge closest_edge_orig;
         if (closest_edge_orig_valid)
@@ -565,36 +1012,42 @@ void Trapezoider::calc_trapezoids_with_rotational_sweep() {
 
         /* Maintaine ray_edges - the binary search tree used to determine the
          * closest edge intersection the ray */
-        std::vector<Halfedge> edges_to_insert;
-        std::vector<Halfedge> edges_to_remove;
-        foreach_vertex_edge(event.v2, [ray, &edges_to_insert, &edges_to_remove](const auto& edge) {
-            auto s = edge->source()->point(), t = edge->target()->point();
-            Point edge_direction(t.x() - s.x(), t.y() - s.y());
-
-            if (Line({0, 0}, ray).oriented_side(edge_direction) == CGAL::ON_POSITIVE_SIDE)
-                edges_to_insert.push_back(edge);
-            else
-                edges_to_remove.push_back(edge);
-        });
-        for (const auto& edge : edges_to_remove)
-            ray_edges.erase(edge);
-        for (const auto& edge : edges_to_insert)
-            ray_edges.insert(edge);
+        if (is_v1_active) {
+            std::vector<Halfedge> edges_to_insert;
+            std::vector<Halfedge> edges_to_remove;
+            for (auto e = topology.out_edges_begin(event.v2_id); e != topology.out_edges_end(event.v2_id); ++e) {
+                const Halfedge& edge = topology.edge(*e);
+                auto s = edge->source()->point(), t = edge->target()->point();
+                Point edge_direction(t.x() - s.x(), t.y() - s.y());
+
+                if (Line({0, 0}, ray).oriented_side(edge_direction) == CGAL::ON_POSITIVE_SIDE)
+                    edges_to_insert.push_back(edge);
+                else
+                    edges_to_remove.push_back(edge);
+            }
+            for (const auto& edge : edges_to_remove)
+                ray_edges.erase(edge);
+            for (const auto& edge : edges_to_insert)
+                ray_edges.insert(edge);
+        }
 
         /* Create and terminate trapezoids due to the event */
         auto current_angle = ray;
-        Halfedge v1v2_edge;
-        if (get_edge(event.v1, event.v2, v1v2_edge)) {
+        Topology::EdgeID v1v2_edge_id;
+        if (topology.find_edge(event.v1_id, event.v2_id, v1v2_edge_id)) {
 
             /* Type 1 event - an edge between v1 and v2 exists. */
-            bool left_is_free = is_free(v1v2_edge->face());
+            const Halfedge& v1v2_edge = topology.edge(v1v2_edge_id);
+            bool left_is_free = topology.is_free_edge(v1v2_edge_id);
             fdml_debugln("[Trapezoider] PRS event type 1: v1v2_edge (" << v1v2_edge->curve() << ") left is "
                                                                        << (left_is_free ? "free" : "not free"));
             if (left_is_free) {
-                assert(v2_data.bottom_left_trapezoid != INVALID_TRAPEZOID_ID);
-                assert(v2_data.bottom_right_trapezoid != INVALID_TRAPEZOID_ID);
-                Trapezoid& left = trapezoids.at(v2_data.bottom_left_trapezoid);
-                Trapezoid& mid = trapezoids.at(v2_data.bottom_right_trapezoid);
+                const Trapezoid::ID left_id = trapezoid_at(event.v2_id, BOTTOM_LEFT);
+                const Trapezoid::ID mid_id = trapezoid_at(event.v2_id, BOTTOM_RIGHT);
+                assert(left_id != INVALID_TRAPEZOID_ID);
+                assert(mid_id != INVALID_TRAPEZOID_ID);
+                Trapezoid& left = state.trapezoids.at(left_id);
+                Trapezoid& mid = state.trapezoids.at(mid_id);
                 /* CAREFUL - don't use these references after create_trapezoid is
                  * called, container may change */
 
@@ -604,9 +1057,9 @@ void Trapezoider::calc_trapezoids_with_rotational_sweep() {
 
                 /* finalize the triangle trapezoid and its neighbor */
                 left.angle_end = current_angle;
-                finalize_trapezoid(left);
+                finalize_trapezoid(state, left);
                 mid.angle_end = current_angle;
-                finalize_trapezoid(mid);
+                finalize_trapezoid(state, mid);
                 fdml_debugln("\told mid: " << mid);
                 fdml_debugln("\told left: " << left);
 
@@ -614,21 +1067,23 @@ void Trapezoider::calc_trapezoids_with_rotational_sweep() {
                 auto left_lvertex = left.left_vertex;
 
                 /* replace neighbor trapezoid with one with updated limiting vertices */
-                auto left_new = create_trapezoid(left_top, left_bottom, left_lvertex, event.v1);
-                trapezoids.at(left_new).angle_begin = current_angle;
+                auto left_new = create_trapezoid(state, left_top, left_bottom, left_lvertex, event.v1);
+                state.trapezoids.at(left_new).angle_begin = current_angle;
 
                 /* Crate new triangle trapezoid */
-                auto mid_new = create_trapezoid(left_top, v1v2_edge, event.v1, event.v2);
-                trapezoids.at(mid_new).angle_begin = current_angle;
+                auto mid_new = create_trapezoid(state, left_top, v1v2_edge, event.v1, event.v2);
+                state.trapezoids.at(mid_new).angle_begin = current_angle;
 
-                fdml_debugln("\tnew mid: " << trapezoids.at(mid_new));
-                fdml_debugln("\tnew left: " << trapezoids.at(left_new));
+                fdml_debugln("\tnew mid: " << state.trapezoids.at(mid_new));
+                fdml_debugln("\tnew left: " << state.trapezoids.at(left_new));
 
             } else {
-                assert(v1_data.top_left_trapezoid != INVALID_TRAPEZOID_ID);
-                assert(v1_data.top_right_trapezoid != INVALID_TRAPEZOID_ID);
-                Trapezoid& mid = trapezoids.at(v1_data.top_left_trapezoid);
-                Trapezoid& right = trapezoids.at(v1_data.top_right_trapezoid);
+                const Trapezoid::ID mid_id = trapezoid_at(event.v1_id, TOP_LEFT);
+                const Trapezoid::ID right_id = trapezoid_at(event.v1_id, TOP_RIGHT);
+                assert(mid_id != INVALID_TRAPEZOID_ID);
+                assert(right_id != INVALID_TRAPEZOID_ID);
+                Trapezoid& mid = state.trapezoids.at(mid_id);
+                Trapezoid& right = state.trapezoids.at(right_id);
                 /* CAREFUL - don't use these references after create_trapezoid is
                  * called, container may change */
 
@@ -638,9 +1093,9 @@ void Trapezoider::calc_trapezoids_with_rotational_sweep() {
 
                 /* finalize the triangle trapezoid and its neighbor */
                 mid.angle_end = current_angle;
-                finalize_trapezoid(mid);
+                finalize_trapezoid(state, mid);
                 right.angle_end = current_angle;
-                finalize_trapezoid(right);
+                finalize_trapezoid(state, right);
                 fdml_debugln("\told right: " << right);
                 fdml_debugln("\told mid: " << mid);
 
@@ -648,39 +1103,50 @@ void Trapezoider::calc_trapezoids_with_rotational_sweep() {
                 auto right_rvertex = right.right_vertex;
 
                 /* Crate new triangle trapezoid */
-                auto mid_new = create_trapezoid(v1v2_edge, right_bottom, event.v1, event.v2);
-                trapezoids.at(mid_new).angle_begin = current_angle;
+                auto mid_new = create_trapezoid(state, v1v2_edge, right_bottom, event.v1, event.v2);
+                state.trapezoids.at(mid_new).angle_begin = current_angle;
 
                 /* replace neighbor trapezoid with one with updated limiting vertices */
-                auto right_new = create_trapezoid(right_top, right_bottom, event.v2, right_rvertex);
-                trapezoids.at(right_new).angle_begin = current_angle;
+                auto right_new = create_trapezoid(state, right_top, right_bottom, event.v2, right_rvertex);
+                state.trapezoids.at(right_new).angle_begin = current_angle;
 
-                fdml_debugln("\tnew right: " << trapezoids.at(right_new));
-                fdml_debugln("\tnew mid: " << trapezoids.at(mid_new));
+                fdml_debugln("\tnew right: " << state.trapezoids.at(right_new));
+                fdml_debugln("\tnew mid: " << state.trapezoids.at(mid_new));
             }
         } else {
-            if (ray_edges.size() == 0)
-                continue; /* the ray intersect no edge */
-            auto closest_edge = *ray_edges.begin();
-            if (closest_edge_orig_valid && closest_edge_orig == closest_edge)
-                continue; /* Closest edge didn't changed */
-
-            Point closest_left, closest_right;
-            calc_edge_left_right_vertices(closest_edge, ray, closest_left, closest_right);
-            if (closest_edge->source()->point() != closest_right)
-                closest_edge = closest_edge->twin();
-            if (!is_free(closest_edge->face()))
-                continue; // The ray is in non free area of the room
-
-            /* Type 2 event */
-            fdml_debugln("[Trapezoider] PRS event type 2: closest edge (" << closest_edge->curve() << ')');
-            assert(v2_data.bottom_left_trapezoid != INVALID_TRAPEZOID_ID);
-            assert(v1_data.top_left_trapezoid != INVALID_TRAPEZOID_ID);
-            assert(v1_data.top_left_trapezoid == v2_data.bottom_right_trapezoid);
-            assert(v1_data.top_right_trapezoid != INVALID_TRAPEZOID_ID);
-            Trapezoid& left = trapezoids.at(v2_data.bottom_left_trapezoid);
-            Trapezoid& mid = trapezoids.at(v1_data.top_left_trapezoid);
-            Trapezoid& right = trapezoids.at(v1_data.top_right_trapezoid);
+            if (is_v1_active) {
+                if (ray_edges.size() == 0)
+                    continue; /* the ray intersect no edge */
+                auto closest_edge = *ray_edges.begin();
+                if (closest_edge_orig_valid && closest_edge_orig == closest_edge)
+                    continue; /* Closest edge didn't changed */
+
+                Point closest_left, closest_right;
+                calc_edge_left_right_vertices(closest_edge, ray, closest_left, closest_right);
+                if (closest_edge->source()->point() != closest_right)
+                    closest_edge = closest_edge->twin();
+                if (!is_free(closest_edge->face()))
+                    continue; // The ray is in non free area of the room
+
+                /* Type 2 event */
+                fdml_debugln("[Trapezoider] PRS event type 2: closest edge (" << closest_edge->curve() << ')');
+            } else {
+                /* Type 2 event of an inactive vertex, which finalizes the kept trapezoid between v2 and v1 */
+                const Trapezoid* kept_mid = restriction->find_ending(event.v1_id, TOP_LEFT, ray);
+                if (kept_mid == nullptr || kept_mid->left_vertex != event.v2)
+                    continue;
+                fdml_debugln("[Trapezoider] PRS event type 2: kept trapezoid " << *kept_mid);
+            }
+            const Trapezoid::ID left_id = trapezoid_at(event.v2_id, BOTTOM_LEFT);
+            const Trapezoid::ID mid_id = trapezoid_at(event.v1_id, TOP_LEFT);
+            const Trapezoid::ID right_id = trapezoid_at(event.v1_id, TOP_RIGHT);
+            assert(left_id != INVALID_TRAPEZOID_ID);
+            assert(mid_id != INVALID_TRAPEZOID_ID);
+            assert(restriction != nullptr || mid_id == state.vertices_data[event.v2_id].bottom_right_trapezoid);
+            assert(right_id != INVALID_TRAPEZOID_ID);
+            Trapezoid& left = state.trapezoids.at(left_id);
+            Trapezoid& mid = state.trapezoids.at(mid_id);
+            Trapezoid& right = state.trapezoids.at(right_id);
             /* CAREFUL - don't use these references after create_trapezoid is called,
              * container may change */
 
@@ -691,11 +1157,11 @@ void Trapezoider::calc_trapezoids_with_rotational_sweep() {
 
             /* finalize all the trapezoids around the ray */
             left.angle_end = current_angle;
-            finalize_trapezoid(left);
+            finalize_trapezoid(state, left);
             mid.angle_end = current_angle;
-            finalize_trapezoid(mid);
+            finalize_trapezoid(state, mid);
             right.angle_end = current_angle;
-            finalize_trapezoid(right);
+            finalize_trapezoid(state, right);
 
             fdml_debugln("\told right: " << right);
             fdml_debugln("\told mid: " << mid);
@@ -707,70 +1173,106 @@ void Trapezoider::calc_trapezoids_with_rotational_sweep() {
             auto left_lvertex = left.left_vertex;
 
             /* create new right trapezoid */
-            auto right_new = create_trapezoid(right_top, right_bottom, event.v2, right_rvertex);
-            trapezoids.at(right_new).angle_begin = current_angle;
+            auto right_new = create_trapezoid(state, right_top, right_bottom, event.v2, right_rvertex);
+            state.trapezoids.at(right_new).angle_begin = current_angle;
 
             /* create new mid trapezoid */
             Halfedge bottom_edge;
             if (!find_edge_relative_to_angle(event.v1, current_angle, CGAL::ON_NEGATIVE_SIDE, MinMax::Max, bottom_edge))
                 bottom_edge = right_bottom;
-            auto mid_new = create_trapezoid(left_top, bottom_edge, event.v1, event.v2);
-            trapezoids.at(mid_new).angle_begin = current_angle;
+            auto mid_new = create_trapezoid(state, left_top, bottom_edge, event.v1, event.v2);
+            state.trapezoids.at(mid_new).angle_begin = current_angle;
 
             /* create new left trapezoid */
-            auto left_new = create_trapezoid(left_top, left_bottom, left_lvertex, event.v1);
-            trapezoids.at(left_new).angle_begin = current_angle;
+            auto left_new = create_trapezoid(state, left_top, left_bottom, left_lvertex, event.v1);
+            state.trapezoids.at(left_new).angle_begin = current_angle;
 
-            fdml_debugln("\tnew right: " << trapezoids.at(right_new));
-            fdml_debugln("\tnew mid: " << trapezoids.at(mid_new));
-            fdml_debugln("\tnew left: " << trapezoids.at(left_new));
+            fdml_debugln("\tnew right: " << state.trapezoids.at(right_new));
+            fdml_debugln("\tnew mid: " << state.trapezoids.at(mid_new));
+            fdml_debugln("\tnew left: " << state.trapezoids.at(left_new));
         }
     }
+}
 
-    /* We started with regular vertical decomposition, and the trapezoids
-     * calculated from the beginning lack the start angle. In addition, near the
-     * end of the rotational sweep, we created some trapezoids we considered new,
-     * but they are actually a duplication of the original starting trapezoids. We
-     * union them and remove the later ones. */
+/* Merge the trapezoids of all sweep states into a single container. Each sector started with a decomposition, and
+ * the trapezoids calculated from the beginning of a sector lack the start angle. In addition, near the end of each
+ * sector, we created some trapezoids we considered new, but they are actually a duplication of the starting trapezoids
+ * of the next sector (the last sector is followed by the first one). We union them and remove the earlier ones. With
+ * multiple sectors, a trapezoid might exist along a whole sector and lack both angles, in which case it is a part of a
+ * longer chain of duplications. */
+void Trapezoider::merge_sweep_states(std::vector<SweepState>& states) {
     fdml_debugln("[Trapezoider] PRS merge unfinished trapezoids:");
-    std::map<std::pair<Vertex, Vertex>, Trapezoid::ID> no_begin_ts;
-    std::map<std::pair<Vertex, Vertex>, Trapezoid::ID> no_end_ts;
-    for (const auto& trapezoid : trapezoids) {
-        assert(!(trapezoid.angle_begin == Trapezoid::ANGLE_NONE && trapezoid.angle_end == Trapezoid::ANGLE_NONE));
-        if (trapezoid.angle_begin == Trapezoid::ANGLE_NONE) {
-            assert(no_begin_ts.find({trapezoid.left_vertex, trapezoid.right_vertex}) == no_begin_ts.end());
-            no_begin_ts[{trapezoid.left_vertex, trapezoid.right_vertex}] = trapezoid.get_id();
-        } else if (trapezoid.angle_end == Trapezoid::ANGLE_NONE) {
-            assert(no_end_ts.find({trapezoid.left_vertex, trapezoid.right_vertex}) == no_end_ts.end());
-            no_end_ts[{trapezoid.left_vertex, trapezoid.right_vertex}] = trapezoid.get_id();
-        }
-    }
-    assert(no_begin_ts.size() == no_end_ts.size());
-    std::set<Trapezoid::ID> to_remove;
-    for (auto& p : no_begin_ts) {
-        const std::pair<Vertex, Vertex>& v = p.first;
-        Trapezoid& trapezoid = trapezoids.at(p.second);
-        assert(no_end_ts.find(v) != no_end_ts.end());
-        Trapezoid& other = trapezoids.at(no_end_ts[v]);
-        fdml_debugln("\tT" << trapezoid.get_id() << " with T" << other.get_id() << ": " << trapezoid);
-        assert(undirected_eq(trapezoid.top_edge, other.top_edge));
-        assert(undirected_eq(trapezoid.bottom_edge, other.bottom_edge));
-        assert(trapezoid.left_vertex == other.left_vertex);
-        assert(trapezoid.right_vertex == other.right_vertex);
-        trapezoid.angle_begin = other.angle_begin;
-        to_remove.insert(other.get_id());
+    trapezoids.clear();
+    const unsigned int sectors_num = states.size();
+    /* unfinished trapezoids of each sector, keyed by their limiting vertices IDs */
+    std::vector<std::unordered_map<uint64_t, Trapezoid::ID>> no_begin_ts(sectors_num);
+    std::vector<std::unordered_map<uint64_t, Trapezoid::ID>> no_end_ts(sectors_num);
+    auto vertices_key = [this](const Trapezoid& trapezoid) {
+        return ((uint64_t)topology.vertex_id(trapezoid.left_vertex) << 32) | topology.vertex_id(trapezoid.right_vertex);
+    };
+    for (unsigned int s = 0; s < sectors_num; s++) {
+        for (auto& trapezoid : states[s].trapezoids) {
+            assert(sectors_num > 1 ||
+                   !(trapezoid.angle_begin == Trapezoid::ANGLE_NONE && trapezoid.angle_end == Trapezoid::ANGLE_NONE));
+            trapezoid.id = trapezoids.size();
+            if (trapezoid.angle_begin == Trapezoid::ANGLE_NONE) {
+                assert(no_begin_ts[s].find(vertices_key(trapezoid)) == no_begin_ts[s].end());
+                no_begin_ts[s][vertices_key(trapezoid)] = trapezoid.get_id();
+            }
+            if (trapezoid.angle_end == Trapezoid::ANGLE_NONE) {
+                assert(no_end_ts[s].find(vertices_key(trapezoid)) == no_end_ts[s].end());
+                no_end_ts[s][vertices_key(trapezoid)] = trapezoid.get_id();
+            }
+            trapezoids.push_back(std::move(trapezoid));
+        }
+        states[s].trapezoids.clear();
+    }
+
+    /* link each trapezoid lacking a start angle with its duplication at the end of the previous sector */
+    std::vector<Trapezoid::ID> prev(trapezoids.size(), INVALID_TRAPEZOID_ID);
+    for (unsigned int s = 0; s < sectors_num; s++) {
+        auto& prev_no_end_ts = no_end_ts[(s + sectors_num - 1) % sectors_num];
+        assert(no_begin_ts[s].size() == prev_no_end_ts.size());
+        for (auto& p : no_begin_ts[s]) {
+            auto other_it = prev_no_end_ts.find(p.first);
+            if (other_it == prev_no_end_ts.end())
+                throw std::logic_error("failed to find the duplication of an unfinished trapezoid");
+            const Trapezoid& trapezoid = trapezoids.at(p.second);
+            const Trapezoid& other = trapezoids.at(other_it->second);
+            fdml_debugln("\tT" << trapezoid.get_id() << " with T" << other.get_id() << ": " << trapezoid);
+            assert(undirected_eq(trapezoid.top_edge, other.top_edge));
+            assert(undirected_eq(trapezoid.bottom_edge, other.bottom_edge));
+            assert(trapezoid.left_vertex == other.left_vertex);
+            assert(trapezoid.right_vertex == other.right_vertex);
+            FDML_UNUSED(other);
+            prev[p.second] = other_it->second;
+        }
+    }
+
+    /* union each chain of duplications into its last trapezoid, the one with an end angle */
+    std::vector<bool> to_remove(trapezoids.size(), false);
+    for (auto& trapezoid : trapezoids) {
+        if (trapezoid.angle_begin != Trapezoid::ANGLE_NONE || trapezoid.angle_end == Trapezoid::ANGLE_NONE)
+            continue;
+        Trapezoid::ID other_id = prev[trapezoid.get_id()];
+        for (unsigned int chain_len = 0; trapezoids.at(other_id).angle_begin == Trapezoid::ANGLE_NONE; chain_len++) {
+            if (chain_len == sectors_num)
+                throw std::logic_error("unfinished trapezoids chain is too long");
+            to_remove[other_id] = true;
+            other_id = prev[other_id];
+        }
+        trapezoid.angle_begin = trapezoids.at(other_id).angle_begin;
+        to_remove[other_id] = true;
     }
 
     trapezoids.erase(std::remove_if(trapezoids.begin(), trapezoids.end(),
-                                    [&to_remove](const Trapezoid& trapezoid) {
-                                        return to_remove.find(trapezoid.get_id()) != to_remove.end();
-                                    }),
+                                    [&to_remove](const Trapezoid& trapezoid) { return to_remove[trapezoid.get_id()]; }),
                      trapezoids.end());
 
     /* Remove degenerated trapezoids, these are trapezoids that start and finish
      * at the same angle */
     trapezoids.erase(std::remove_if(trapezoids.begin(), trapezoids.end(),
-                                    [&to_remove](const Trapezoid& trapezoid) {
+                                    [](const Trapezoid& trapezoid) {
                                         return is_same_direction(trapezoid.angle_begin, trapezoid.angle_end);
                                     }),
                      trapezoids.end());
@@ -780,28 +1282,83 @@ void Trapezoider::calc_trapezoids_with_rotational_sweep() {
         trapezoids[i].id = i;
 }
 
-void Trapezoider::calc_trapezoids(const Polygon_with_holes& scene) {
+/* Perform a parallel rotational sweep split into sectors, each starting with a decomposition followed by a rotational
+ * sweep over the sector events. The first sector starts with a regular vertical decomposition. */
+void Trapezoider::sweep_sectors(std::vector<SweepState>& states, unsigned int sectors_num, unsigned int threads_num,
+                                const SweepRestriction* restriction) {
+    /* the events queues refer to vertices by their topology IDs */
+    const std::vector<Vertex>& vertices = topology.get_vertices();
+    const ActiveVertices* active = restriction != nullptr ? &restriction->active : nullptr;
+
+    const std::vector<Direction> sectors = calc_sectors_begins(vertices, sectors_num, active);
+    fdml_infoln("[Trapezoider] Performing parallel rotational sweep (PRS) in " << sectors.size() << " sectors");
+    states.clear();
+    states.resize(sectors.size());
+    std::vector<size_t> events_peaks(sectors.size(), 0);
+    auto sweep_sector = [this, &states, &sectors, &vertices, &events_peaks, restriction, active](unsigned int s) {
+        SweepState& state = states[s];
+        init_sweep_state(state);
+        if (s == 0)
+            init_trapezoids_with_regular_vertical_decomposition(state);
+        else
+            init_trapezoids_with_decomposition(state, sectors[s]);
+        init_ray_edges(state, sectors[s], restriction);
+        EventQueue events = s + 1 < sectors.size() ? EventQueue(vertices, active, sectors[s], sectors[s + 1])
+                                                   : EventQueue(vertices, active, sectors[s]);
+        calc_trapezoids_with_rotational_sweep(state, events, restriction);
+        events_peaks[s] = events.get_events_peak();
+    };
+    if (sectors.size() == 1) {
+        sweep_sector(0);
+    } else {
+        if (threads_num == 0)
+            threads_num = std::max(1u, std::thread::hardware_concurrency());
+        threads_num = std::min(threads_num, (unsigned int)sectors.size());
+
+        std::atomic<unsigned int> next_sector(0);
+        std::vector<std::exception_ptr> errors(sectors.size());
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < threads_num; t++) {
+            threads.emplace_back([&sweep_sector, &next_sector, &errors, &sectors]() {
+                for (unsigned int s; (s = next_sector++) < sectors.size();) {
+                    try {
+                        sweep_sector(s);
+                    } catch (...) {
+                        errors[s] = std::current_exception();
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        for (const auto& err : errors)
+            if (err)
+                std::rethrow_exception(err);
+    }
+
+    prs_events_peak = std::accumulate(events_peaks.begin(), events_peaks.end(), size_t(0));
+    fdml_infoln("[Trapezoider] PRS events peak: " << prs_events_peak);
+}
+
+/* Fix exact numbers and avoid lazy evaluation */
+static void fix_exact_angles(Trapezoid& trapezoid) {
+    trapezoid.angle_begin = Direction(trapezoid.angle_begin.dx().exact(), trapezoid.angle_begin.dy().exact());
+    trapezoid.angle_end = Direction(trapezoid.angle_end.dx().exact(), trapezoid.angle_end.dy().exact());
+}
+
+void Trapezoider::calc_trapezoids(const Polygon_with_holes& scene, unsigned int sectors_num, unsigned int threads_num) {
     fdml_infoln("[Trapezoider] Calculating trapezoids...");
     trapezoids.clear();
-    vertices_data.clear();
 
     init_poly_set(scene);
-    const Arrangement& arr = scene_set.arrangement();
-
-    /* init vertices associated data structure */
-    for (auto v = arr.vertices_begin(); v != arr.vertices_end(); ++v)
-        vertices_data[v] = VertexData(v->point(), arr.geometry_traits());
 
-    /* perform all trapezoids by useing regular vertical decomposition followed by
-     * a parallel rotational sweep */
-    init_trapezoids_with_regular_vertical_decomposition();
-    calc_trapezoids_with_rotational_sweep();
+    /* perform all trapezoids by useing a decomposition followed by a parallel rotational sweep for each sector */
+    std::vector<SweepState> states;
+    sweep_sectors(states, sectors_num, threads_num, nullptr);
+    merge_sweep_states(states);
 
-    /* Fix exact numbers and avoid lazy evaluation */
-    for (auto& trapezoid : trapezoids) {
-        trapezoid.angle_begin = Direction(trapezoid.angle_begin.dx().exact(), trapezoid.angle_begin.dy().exact());
-        trapezoid.angle_end = Direction(trapezoid.angle_end.dx().exact(), trapezoid.angle_end.dy().exact());
-    }
+    for (auto& trapezoid : trapezoids)
+        fix_exact_angles(trapezoid);
 
     fdml_debugln("[Trapezoider] After rotational sweep, trapezoids:");
     for (const auto& trapezoid : trapezoids)
@@ -809,6 +1366,206 @@ void Trapezoider::calc_trapezoids(const Polygon_with_holes& scene) {
     fdml_infoln("[Trapezoider] " << trapezoids.size() << " trapezoids found successfully");
 }
 
+/* Check if two polygons intersect, including their boundaries */
+static bool do_intersect_closed(const Polygon& p1, const Polygon& p2) {
+    for (auto e1 = p1.edges_begin(); e1 != p1.edges_end(); ++e1)
+        for (auto e2 = p2.edges_begin(); e2 != p2.edges_end(); ++e2)
+            if (CGAL::do_intersect(*e1, *e2))
+                return true;
+    return p1.bounded_side(p2[0]) != CGAL::ON_UNBOUNDED_SIDE || p2.bounded_side(p1[0]) != CGAL::ON_UNBOUNDED_SIDE;
+}
+
+/* The convex hull of the top and bottom edges of a trapezoid, which contains the trapezoid in all of its angles */
+static Polygon edges_hull(const Trapezoid& trapezoid) {
+    std::vector<Point> points = {trapezoid.top_edge->source()->point(), trapezoid.top_edge->target()->point(),
+                                 trapezoid.bottom_edge->source()->point(), trapezoid.bottom_edge->target()->point()};
+    std::vector<Point> hull;
+    CGAL::convex_hull_2(points.begin(), points.end(), std::back_inserter(hull));
+    return Polygon(hull.begin(), hull.end());
+}
+
+/* Check if two trapezoids of different arrangements are identical, given their limiting vertices are the same */
+static bool is_same_trapezoid(const Trapezoid& t1, const Trapezoid& t2) {
+    auto same_edge = [](const Halfedge& e1, const Halfedge& e2) {
+        const Point &s1 = e1->source()->point(), &t1 = e1->target()->point();
+        const Point &s2 = e2->source()->point(), &t2 = e2->target()->point();
+        return (s1 == s2 && t1 == t2) || (s1 == t2 && t1 == s2);
+    };
+    return same_edge(t1.top_edge, t2.top_edge) && same_edge(t1.bottom_edge, t2.bottom_edge) &&
+           t1.angle_begin == t2.angle_begin && t1.angle_end == t2.angle_end;
+}
+
+void Trapezoider::update_trapezoids(const Polygon_with_holes& scene, const Polygon& hole,
+                                    std::vector<Trapezoid::ID>& prev_ids, unsigned int sectors_num,
+                                    unsigned int threads_num) {
+    fdml_infoln("[Trapezoider] Updating trapezoids...");
+    if (!scene_set)
+        throw std::logic_error("trapezoids weren't calculated");
+
+    /* The trapezoids limited by an active vertex are recalculated, and the others are kept. The active vertices are
+     * the hole vertices, and the limiting vertices of previous trapezoids whose closed edges hull intersects the hole.
+     * The kept trapezoids are valid and the recalculated ones cover all the changes, since at each angle, the region
+     * of a trapezoid is the segment of the ray through a limiting vertex between the top and bottom edges, which is
+     * within the edges hull:
+     * - A previous trapezoid with a hull disjoint from the hole has no segment the hole blocks or ends, and no hole
+     *   vertex enters its region, so it's unchanged in the updated scene.
+     * - A trapezoid of the updated scene which differs from all the previous ones has an angle at which the segment
+     *   through one of its limiting vertices v differs from the previous segment through v, or an interval end event
+     *   which didn't exist before. Then the added hole blocks the previous segment, or the removed hole ended it, or a
+     *   hole vertex is on it at the event. In all cases the previous trapezoid of v at that angle touches the hole,
+     *   unless v is a hole vertex, and v is active either way. */
+    std::set<Point> active_points(hole.vertices_begin(), hole.vertices_end());
+    const CGAL::Bbox_2 hole_bbox = hole.bbox();
+    for (const auto& trapezoid : trapezoids) {
+        const CGAL::Bbox_2 edges_bbox =
+            trapezoid.top_edge->source()->point().bbox() + trapezoid.top_edge->target()->point().bbox() +
+            trapezoid.bottom_edge->source()->point().bbox() + trapezoid.bottom_edge->target()->point().bbox();
+        if (CGAL::do_overlap(edges_bbox, hole_bbox) && do_intersect_closed(edges_hull(trapezoid), hole)) {
+            active_points.insert(trapezoid.left_vertex->point());
+            active_points.insert(trapezoid.right_vertex->point());
+        }
+    }
+    auto is_active = [&active_points](const Vertex& v) { return active_points.count(v->point()) != 0; };
+
+    /* keep the current scene, so it's restored if the update fails */
+    Polygon_with_holes prev_scene = std::move(this->scene);
+    std::unique_ptr<General_polygon_set_2> prev_scene_set = std::move(scene_set);
+    Topology prev_topology = std::move(topology);
+    TrapezoidContainer prev_trapezoids = std::move(trapezoids);
+    const size_t prev_events_peak = prs_events_peak;
+    try {
+        init_poly_set(scene);
+        std::map<Point, Topology::VertexID> vertices_ids;
+        for (Topology::VertexID v = 0; v < topology.number_of_vertices(); v++)
+            vertices_ids[topology.vertex(v)->point()] = v;
+
+        /* convert the trapezoids limited by an inactive vertex to the updated arrangement. The others are recalculated,
+         * and are indexed by their limiting vertices to identify the ones which didn't change */
+        auto vertex_id = [&vertices_ids](const Vertex& v) {
+            auto it = vertices_ids.find(v->point());
+            if (it == vertices_ids.end())
+                throw std::logic_error("a kept trapezoid vertex doesn't exist in the updated scene");
+            return it->second;
+        };
+        auto edge = [this, &vertex_id](const Halfedge& e) {
+            Topology::EdgeID e_id;
+            if (!topology.find_edge(vertex_id(e->source()), vertex_id(e->target()), e_id))
+                throw std::logic_error("a kept trapezoid edge doesn't exist in the updated scene");
+            return topology.edge(e_id);
+        };
+        TrapezoidContainer kept;
+        std::vector<Trapezoid::ID> kept_prev_ids;
+        std::unordered_map<uint64_t, std::vector<Trapezoid::ID>> recalculated;
+        for (const auto& trapezoid : prev_trapezoids) {
+            if (is_active(trapezoid.left_vertex) && is_active(trapezoid.right_vertex)) {
+                auto left_it = vertices_ids.find(trapezoid.left_vertex->point());
+                auto right_it = vertices_ids.find(trapezoid.right_vertex->point());
+                if (left_it != vertices_ids.end() && right_it != vertices_ids.end())
+                    recalculated[((uint64_t)left_it->second << 32) | right_it->second].push_back(trapezoid.get_id());
+                continue;
+            }
+            kept.emplace_back(kept.size(), edge(trapezoid.top_edge), edge(trapezoid.bottom_edge),
+                              topology.vertex(vertex_id(trapezoid.left_vertex)),
+                              topology.vertex(vertex_id(trapezoid.right_vertex)));
+            kept.back().angle_begin = trapezoid.angle_begin;
+            kept.back().angle_end = trapezoid.angle_end;
+            kept_prev_ids.push_back(trapezoid.get_id());
+        }
+
+        SweepRestriction restriction(topology, std::move(kept));
+        for (Topology::VertexID v = 0; v < topology.number_of_vertices(); v++)
+            if (is_active(topology.vertex(v)))
+                restriction.active.add(v);
+        fdml_infoln("[Trapezoider] " << restriction.active.size() << " active vertices, "
+                                     << restriction.kept.size() << " trapezoids kept");
+
+        /* calculate the trapezoids limited by two active vertices, dropping the copies of the kept trapezoids */
+        std::vector<SweepState> states;
+        sweep_sectors(states, sectors_num, threads_num, &restriction);
+        auto is_calculated = [this, &restriction](const Trapezoid& trapezoid) {
+            return restriction.active.contains(topology.vertex_id(trapezoid.left_vertex)) &&
+                   restriction.active.contains(topology.vertex_id(trapezoid.right_vertex));
+        };
+        for (auto& state : states) {
+            auto& ts = state.trapezoids;
+            ts.erase(std::remove_if(ts.begin(), ts.end(), [&](const Trapezoid& t) { return !is_calculated(t); }),
+                     ts.end());
+        }
+        merge_sweep_states(states);
+
+        TrapezoidContainer calculated = std::move(trapezoids);
+        trapezoids = std::move(restriction.kept);
+        prev_ids = std::move(kept_prev_ids);
+        for (auto& trapezoid : calculated) {
+            fix_exact_angles(trapezoid);
+            Trapezoid::ID prev_id = INVALID_TRAPEZOID_ID;
+            auto it = recalculated.find(((uint64_t)topology.vertex_id(trapezoid.left_vertex) << 32) |
+                                        topology.vertex_id(trapezoid.right_vertex));
+            if (it != recalculated.end())
+                for (Trapezoid::ID id : it->second)
+                    if (is_same_trapezoid(trapezoid, prev_trapezoids[id]))
+                        prev_id = id;
+            trapezoid.id = trapezoids.size();
+            trapezoids.push_back(std::move(trapezoid));
+            prev_ids.push_back(prev_id);
+        }
+    } catch (...) {
+        this->scene = std::move(prev_scene);
+        scene_set = std::move(prev_scene_set);
+        topology = std::move(prev_topology);
+        trapezoids = std::move(prev_trapezoids);
+        prs_events_peak = prev_events_peak;
+        throw;
+    }
+
+    fdml_debugln("[Trapezoider] After update, trapezoids:");
+    for (const auto& trapezoid : trapezoids)
+        fdml_debugln("\t" << trapezoid);
+    fdml_infoln("[Trapezoider] " << trapezoids.size() << " trapezoids updated successfully");
+}
+
+void Trapezoider::restore_trapezoids(
+    const Polygon_with_holes& scene,
+    const std::function<void(const Topology&, std::vector<Trapezoid>&)>& create_trapezoids) {
+    fdml_infoln("[Trapezoider] Restoring trapezoids...");
+    trapezoids.clear();
+    prs_events_peak = 0;
+
+    init_poly_set(scene, false);
+    create_trapezoids(topology, trapezoids);
+    for (unsigned int i = 0; i < trapezoids.size(); ++i)
+        if (trapezoids[i].get_id() != i)
+            throw std::invalid_argument("restored trapezoids IDs are not consecutive");
+
+    fdml_infoln("[Trapezoider] " << trapezoids.size() << " trapezoids restored successfully");
+}
+
+void Trapezoider::renumber_trapezoids(const std::vector<Trapezoid::ID>& ids) {
+    if (ids.size() != trapezoids.size())
+        throw std::invalid_argument("IDs number doesn't match the trapezoids number");
+    TrapezoidContainer renumbered;
+    renumbered.reserve(trapezoids.size());
+    std::vector<Trapezoid::ID> order(trapezoids.size(), INVALID_TRAPEZOID_ID);
+    for (Trapezoid::ID i = 0; i < ids.size(); i++) {
+        if (ids[i] >= ids.size() || order[ids[i]] != INVALID_TRAPEZOID_ID)
+            throw std::invalid_argument("IDs are not a permutation");
+        order[ids[i]] = i;
+    }
+    for (Trapezoid::ID id = 0; id < order.size(); id++) {
+        renumbered.push_back(std::move(trapezoids[order[id]]));
+        renumbered.back().id = id;
+    }
+    trapezoids = std::move(renumbered);
+}
+
+const Polygon_with_holes& Trapezoider::get_scene() const {
+    return scene;
+}
+
+const Topology& Trapezoider::get_topology() const {
+    return topology;
+}
+
 Trapezoider::TrapezoidIterator Trapezoider::trapezoids_begin() const {
     return trapezoids.begin();
 }
@@ -825,4 +1582,26 @@ Trapezoider::TrapezoidIterator Trapezoider::get_trapezoid(Trapezoid::ID id) cons
     return trapezoids.begin() + id;
 }
 
+size_t Trapezoider::get_prs_events_peak() const {
+    return prs_events_peak;
+}
+
+size_t Trapezoider::memory_usage() const {
+    size_t scene_points = scene.outer_boundary().size();
+    for (auto hole = scene.holes_begin(); hole != scene.holes_end(); ++hole)
+        scene_points += hole->size();
+
+    /* the arrangement points and curves have their own representations, the trapezoids directions are constructed */
+    size_t arr_memory = 0;
+    if (scene_set) {
+        const Arrangement& arr = scene_set->arrangement();
+        arr_memory = arr.number_of_vertices() * (sizeof(Arrangement::Vertex) + LAZY_REP_BYTES) +
+                     arr.number_of_halfedges() * sizeof(Arrangement::Halfedge) +
+                     arr.number_of_edges() * (sizeof(Arrangement::X_monotone_curve_2) + LAZY_REP_BYTES) +
+                     arr.number_of_faces() * sizeof(Arrangement::Face);
+    }
+    return scene_points * (sizeof(Point) + LAZY_REP_BYTES) + arr_memory + topology.memory_usage() +
+           trapezoids.capacity() * sizeof(Trapezoid) + trapezoids.size() * 2 * LAZY_REP_BYTES;
+}
+
 } // namespace FDML
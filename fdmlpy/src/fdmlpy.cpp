@@ -1,9 +1,11 @@
 // Author(s): Efi Fogel         <efifogel@gmail.com>
 
+#include <memory>
 #include <string>
 
 #include <nanobind/nanobind.h>
 
+#include "fdml/binary_result.hpp"
 #include "fdml/defs.hpp"
 #include "fdml/locator.hpp"
 
@@ -76,8 +78,13 @@ void export_kernel(py::module_& m) {
   }
 }
 
-py::list query1(const FDML::Locator& locator, const FDML::Kernel::FT& d) {
-  std::vector<FDML::Locator::Res1d> pgns = locator.query(d);
+py::list query1(const FDML::Locator& locator, const FDML::Kernel::FT& d, bool inexact, double tolerance,
+                bool parametric) {
+  FDML::ResultOptions options;
+  options.inexact = inexact;
+  options.tolerance = tolerance;
+  options.parametric = parametric;
+  std::vector<FDML::Locator::Res1d> pgns = locator.query(d, options);
   py::list lst;
   /* TODO return to python the measured edge along with the possible position polygon */
   for (auto pgn : pgns) {
@@ -90,8 +97,13 @@ py::list query1(const FDML::Locator& locator, const FDML::Kernel::FT& d) {
   return lst;
 }
 
-py::list query2(const FDML::Locator& locator, const FDML::Kernel::FT& d1, const FDML::Kernel::FT& d2) {
-  std::vector<FDML::Locator::Res2d> pls = locator.query(d1, d2);
+py::list query2(const FDML::Locator& locator, const FDML::Kernel::FT& d1, const FDML::Kernel::FT& d2,
+                bool inexact, double tolerance, bool parametric) {
+  FDML::ResultOptions options;
+  options.inexact = inexact;
+  options.tolerance = tolerance;
+  options.parametric = parametric;
+  std::vector<FDML::Locator::Res2d> pls = locator.query(d1, d2, options);
   py::list lst;
   /* TODO return to python the measured edge along with the possible position polygon */
   for (auto pl : pls) {
@@ -108,6 +120,20 @@ py::list query2(const FDML::Locator& locator, const FDML::Kernel::FT& d1, const
   return lst;
 }
 
+// Convert a decoded binary result into (type, records), each record is a tuple of the edge IDs and a list of (x, y)
+py::tuple binary_result2py(const FDML::BinaryResult& result) {
+  py::list records;
+  for (const auto& record : result.records) {
+    py::list edges;
+    for (uint32_t edge : record.edges) edges.append(edge);
+    py::list points;
+    for (size_t i = 0; i + 1 < record.coords.size(); i += 2)
+      points.append(py::make_tuple(record.coords[i], record.coords[i + 1]));
+    records.append(py::make_tuple(py::tuple(edges), points));
+  }
+  return py::make_tuple((uint32_t)result.type, records);
+}
+
 NB_MODULE(fdmlpy, m) {
   typedef FDML::Kernel::FT FT;
   typedef FDML::Polygon Polygon;
@@ -126,10 +152,28 @@ NB_MODULE(fdmlpy, m) {
 
   py::class_<FDML::Locator>(m, "Locator")
     .def(py::init<>())
-    .def("init", &Locator::init)
-    .def("query1", &query1)
-    .def("query2", &query2)
+    .def("init", &Locator::init, py::arg("pwh"), py::arg("sectors_num") = 1, py::arg("threads_num") = 0)
+    .def("add_hole", &Locator::add_hole, py::arg("hole"))
+    .def("remove_hole", &Locator::remove_hole, py::arg("hole_idx"))
+    .def("set_update_verification", &Locator::set_update_verification, py::arg("enable"))
+    .def("set_query_threads",
+         [](Locator& locator, unsigned int threads_num)
+         { locator.set_executor(std::make_shared<FDML::Executor>(threads_num)); },
+         py::arg("threads_num"))
+    .def("save", &Locator::save, py::arg("filename"))
+    .def("load", &Locator::load, py::arg("filename"))
+    .def("query1", &query1, py::arg("d"), py::arg("inexact") = false, py::arg("tolerance") = 0.0,
+         py::arg("parametric") = false)
+    .def("query2", &query2, py::arg("d1"), py::arg("d2"), py::arg("inexact") = false, py::arg("tolerance") = 0.0,
+         py::arg("parametric") = false)
     // .def<Query1>("query1", &Locator::query)
     // .def<Query2>("query2", &Locator::query)
     ;
+
+  m.def("read_binary_result",
+        [](const std::string& filename) { return binary_result2py(FDML::BinaryResult::read(filename)); },
+        py::arg("filename"));
+  m.def("parse_binary_result",
+        [](py::bytes data) { return binary_result2py(FDML::BinaryResult::parse(data.c_str(), data.size())); },
+        py::arg("data"));
 }
@@ -3,6 +3,18 @@ import numpy as np
 
 class Locator():
   def __init__(self) -> None: ...
-  def init(self, pwh: Polygon_with_holes) -> None: ...
-  def query1(self, d: FT) -> list: ...
-  def query2(self, d1: FT, d2: FT) -> list: ...
+  def init(self, pwh: Polygon_with_holes, sectors_num: int = 1, threads_num: int = 0) -> None: ...
+  def add_hole(self, hole: Polygon_2) -> None: ...
+  def remove_hole(self, hole_idx: int) -> None: ...
+  def set_update_verification(self, enable: bool) -> None: ...
+  def set_query_threads(self, threads_num: int) -> None: ...
+  def save(self, filename: str) -> None: ...
+  def load(self, filename: str) -> None: ...
+  def query1(self, d: FT, inexact: bool = False, tolerance: float = 0.0, parametric: bool = False) -> list: ...
+  def query2(self, d1: FT, d2: FT, inexact: bool = False, tolerance: float = 0.0,
+             parametric: bool = False) -> list: ...
+
+# Decoders of the daemon binary results, returning (type, records) where type is 1 for polygons, 2 for segments and 3
+# for points, and each record is a tuple of the edge IDs and the list of (x, y) points
+def read_binary_result(filename: str) -> tuple[int, list[tuple[tuple[int, ...], list[tuple[float, float]]]]]: ...
+def parse_binary_result(data: bytes) -> tuple[int, list[tuple[tuple[int, ...], list[tuple[float, float]]]]]: ...